@@ -0,0 +1,112 @@
+#ifndef BENCH_CLIENT_HPP
+#define BENCH_CLIENT_HPP
+
+#include <drogon/HttpClient.h>
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <drogon/WebSocketClient.h>
+#include <json/json.h>
+
+#include <functional>
+#include <future>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * HTTP and WebSocket helpers for the benches that drive a running server
+ * (load_bench, notification_bench). Calls block until the server answers,
+ * so they must not run on the event loop of the client they use.
+ */
+namespace bench_client {
+
+constexpr double kTimeoutSeconds = 10.0;
+
+// Status of the response, 0 when no response arrived
+inline int send(const drogon::HttpClientPtr& client,
+                const drogon::HttpRequestPtr& req,
+                Json::Value* body = nullptr) {
+  auto [result, resp] = client->sendRequest(req, kTimeoutSeconds);
+  if (result != drogon::ReqResult::Ok || !resp) {
+    return 0;
+  }
+  if (body && resp->getJsonObject()) {
+    *body = *resp->getJsonObject();
+  }
+  return static_cast<int>(resp->statusCode());
+}
+
+inline drogon::HttpRequestPtr get_request(std::string path,
+                                          std::string_view token) {
+  auto req = drogon::HttpRequest::newHttpRequest();
+  req->setMethod(drogon::Get);
+  req->setPath(std::move(path));
+  req->addHeader("Authorization", "Bearer " + std::string(token));
+  return req;
+}
+
+// Anonymous when token is empty
+inline drogon::HttpRequestPtr post_request(std::string path,
+                                           const Json::Value& json,
+                                           std::string_view token = {}) {
+  auto req = drogon::HttpRequest::newHttpJsonRequest(json);
+  req->setMethod(drogon::Post);
+  req->setPath(std::move(path));
+  if (!token.empty()) {
+    req->addHeader("Authorization", "Bearer " + std::string(token));
+  }
+  return req;
+}
+
+struct Account {
+  std::string token;
+  int user_id = 0;
+};
+
+inline std::optional<Account> register_user(
+    const drogon::HttpClientPtr& client, const std::string& username) {
+  Json::Value json;
+  json["username"] = username;
+  json["email"] = username + "@example.com";
+  json["password"] = "password123";
+  Json::Value body;
+  if (send(client, post_request("/api/v1/auth/register", json), &body) !=
+      200) {
+    return std::nullopt;
+  }
+  return Account{.token = body["token"].asString(),
+                 .user_id = body["user_id"].asInt()};
+}
+
+// Connects to /ws/notifications as the token's user and hands every text
+// frame to on_text, on the loop's thread. nullptr when the upgrade fails.
+inline drogon::WebSocketClientPtr open_notifications(
+    const std::string& url, trantor::EventLoop* loop, const std::string& token,
+    std::function<void(std::string&&)> on_text) {
+  auto ws = drogon::WebSocketClient::newWebSocketClient(url, loop);
+  ws->setMessageHandler([on_text = std::move(on_text)](
+                            std::string&& message,
+                            const drogon::WebSocketClientPtr&,
+                            const drogon::WebSocketMessageType& type) {
+    if (type == drogon::WebSocketMessageType::Text) {
+      on_text(std::move(message));
+    }
+  });
+  auto req = drogon::HttpRequest::newHttpRequest();
+  req->setPath("/ws/notifications");
+  req->setParameter("token", token);
+  std::promise<bool> connected;
+  auto done = connected.get_future();
+  ws->connectToServer(
+      req, [&connected](drogon::ReqResult result,
+                        const drogon::HttpResponsePtr&,
+                        const drogon::WebSocketClientPtr&) {
+        connected.set_value(result == drogon::ReqResult::Ok);
+      });
+  return done.get() ? ws : nullptr;
+}
+
+}  // namespace bench_client
+
+#endif  // BENCH_CLIENT_HPP
@@ -0,0 +1,150 @@
+/**
+ * Response compression per endpoint: ratio and CPU time per body for zstd,
+ * br and gzip through compression::compress(), at the per request levels and
+ * at the levels used once for cached bodies. Payloads are JSON pages shaped
+ * like get_posts, get_messages, get_my_offers and get_subscriptions.
+ *
+ * Usage: compression_bench [--iterations N] [--items N]
+ * Needs no database or server. Times are per body on one thread, which is
+ * what a compression worker spends on it.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <format>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../services/compression/body_codecs.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::string media_json(int i) {
+  return std::format(
+      "[{{\"media_id\":{0},\"object_key\":\"uploads/2026/10/{0:08x}.jpg\","
+      "\"filename\":\"IMG_{0:04}.jpg\",\"mime_type\":\"image/jpeg\","
+      "\"size\":2483117,\"variants\":[{{\"object_key\":\"thumbnails/"
+      "2026/10/{0:08x}_320.jpg\",\"width\":320,\"height\":240,\"size\":"
+      "18204}}]}}]",
+      i);
+}
+
+std::string posts_json(int count, bool with_media) {
+  std::string json = "[";
+  for (int i = 0; i < count; ++i) {
+    json += std::format(
+        "{}{{\"id\":{},\"user_id\":{},\"username\":\"member_{}\",\"content\":"
+        "\"Looking for a second hand road bike, size 56, Shimano 105 or "
+        "better, budget around {}, can collect this weekend\",\"created_at\":"
+        "\"2026-10-18 09:{:02}:27.123456\",\"tags\":[\"bikes\",\"cycling\","
+        "\"second-hand\"],\"location\":\"Lagos, Nigeria\","
+        "\"is_product_request\":true,\"request_status\":\"open\","
+        "\"price_range\":\"$300-$450\",\"subscription_count\":{},"
+        "\"is_subscribed\":{}{}}}",
+        i == 0 ? "" : ",", 1000 - i, i % 97 + 1, i % 97, 300 + i * 7, i % 60,
+        i % 13, i % 2 == 0 ? "true" : "false",
+        with_media && i % 3 == 0 ? ",\"media\":" + media_json(i) : "");
+  }
+  return json + "]";
+}
+
+std::string messages_json(int count) {
+  std::string json = "[";
+  for (int i = 0; i < count; ++i) {
+    json += std::format(
+        "{}{{\"id\":{},\"sender_id\":{},\"sender_name\":\"{}\",\"content\":"
+        "\"Is the bike still available? I can pick it up tomorrow after {} "
+        "pm\",\"message_type\":\"text\",\"is_read\":true,\"created_at\":"
+        "\"2026-10-18 09:{:02}:27.123456\",\"metadata\":\"{{}}\"}}",
+        i == 0 ? "" : ",", 5000 + i, i % 2 + 1,
+        i % 2 == 0 ? "buyer_account" : "seller_account", i % 12 + 1, i % 60);
+  }
+  return json + "]";
+}
+
+std::string my_offers_json(int count) {
+  std::string json = "{\"offers\":[";
+  for (int i = 0; i < count; ++i) {
+    json += std::format(
+        "{}{{\"id\":{},\"post_id\":{},\"post_content\":\"Looking for a second "
+        "hand road bike, size 56\",\"post_owner_username\":\"member_{}\","
+        "\"title\":\"Road bike offer {}\",\"description\":\"Shimano 105, new "
+        "tyres, serviced last month\",\"price\":{}.0,\"original_price\":{}.0,"
+        "\"is_public\":true,\"status\":\"pending\",\"created_at\":"
+        "\"2026-10-18 09:{:02}:27.123456\",\"updated_at\":\"2026-10-18 "
+        "09:{:02}:27.123456\",\"media\":{}}}",
+        i == 0 ? "" : ",", 9000 - i, 40 + i % 5, i % 97, i, 350 + i, 350 + i,
+        i % 60, i % 60, media_json(i));
+  }
+  return json + "],\"next_cursor\":\"1792316487123456_8981\"}";
+}
+
+struct Result {
+  std::size_t bytes = 0;
+  double us_per_body = 0;
+};
+
+Result measure(compression::Encoding encoding, const std::string& body,
+               int level, int iterations) {
+  Result result;
+  const auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    auto compressed = compression::compress(encoding, body, level);
+    result.bytes = compressed ? compressed->size() : 0;
+  }
+  result.us_per_body =
+      std::chrono::duration<double, std::micro>(Clock::now() - start).count() /
+      iterations;
+  return result;
+}
+
+void report(std::string_view endpoint, const std::string& body,
+            int iterations) {
+  std::cout << std::format("{}: {} bytes\n", endpoint, body.size());
+  for (const auto encoding : compression::kEncodings) {
+    const auto dynamic = measure(encoding, body,
+                                 compression::dynamic_level(encoding),
+                                 iterations);
+    const auto cached = measure(
+        encoding, body, compression::cached_level(encoding),
+        std::max(1, iterations / 10));
+    auto ratio = [&](const Result& r) {
+      return r.bytes > 0 ? static_cast<double>(body.size()) /
+                               static_cast<double>(r.bytes)
+                         : 0.0;
+    };
+    std::cout << std::format(
+        "  {:<4} per request {:.1f}x, {:.0f}us | cached {:.1f}x, {:.0f}us\n",
+        compression::token(encoding), ratio(dynamic), dynamic.us_per_body,
+        ratio(cached), cached.us_per_body);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int iterations = 500;
+  int items = 20;  // listing page size
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--iterations" && i + 1 < argc) {
+      iterations = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--items" && i + 1 < argc) {
+      items = std::max(1, std::stoi(argv[++i]));
+    } else {
+      std::cerr << std::format("unknown option {}\n", arg);
+      return 1;
+    }
+  }
+
+  report("get_posts", posts_json(items, true), iterations);
+  report("get_messages", messages_json(items), iterations);
+  report("get_my_offers", my_offers_json(items), iterations);
+  report("get_subscriptions", posts_json(items, false), iterations);
+  return 0;
+}
@@ -0,0 +1,203 @@
+/**
+ * Nearby query throughput: GeoGridIndex against the PostGIS query used by
+ * LocationController::find_nearby.
+ *
+ * Usage: geo_index_bench [--points N] [--queries N] [--radius M]
+ *                        [--pg "postgresql://..."]
+ * Points are generated deterministically over a metro sized area
+ * (~110 x 85 km). The PostGIS part only runs when built with libpq and given
+ * --pg, it loads the same points into a temporary table with a GiST index.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../services/location/geo_grid_index.hpp"
+#include "../utilities/latency_histogram.hpp"
+
+#ifdef BENCH_WITH_LIBPQ
+#include <libpq-fe.h>
+#endif
+
+struct Query {
+  double latitude;
+  double longitude;
+};
+
+static void report(std::string_view name, std::size_t queries,
+                   std::chrono::duration<double> elapsed,
+                   const utilities::LatencyHistogram& latency,
+                   std::size_t results) {
+  auto snapshot = latency.snapshot();
+  std::cout << std::format(
+      "{}: {} queries in {:.3f}s -> {:.0f} queries/sec, p50 {:.0f}us, "
+      "p99 {:.0f}us, {} results\n",
+      name, queries, elapsed.count(), queries / elapsed.count(),
+      snapshot.p50_us, snapshot.p99_us, results);
+}
+
+#ifdef BENCH_WITH_LIBPQ
+static bool exec_ok(PGconn* conn, const std::string& sql) {
+  PGresult* result = PQexec(conn, sql.c_str());
+  const auto status = PQresultStatus(result);
+  const bool ok =
+      status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK;
+  if (!ok) {
+    std::cerr << std::format("{} failed: {}", sql, PQerrorMessage(conn));
+  }
+  PQclear(result);
+  return ok;
+}
+
+static void run_postgis(const std::string& conninfo,
+                        const std::vector<GeoPoint>& points,
+                        const std::vector<Query>& queries, double radius) {
+  PGconn* conn = PQconnectdb(conninfo.c_str());
+  if (PQstatus(conn) != CONNECTION_OK) {
+    std::cerr << std::format("connection failed: {}", PQerrorMessage(conn));
+    PQfinish(conn);
+    return;
+  }
+
+  auto load_start = std::chrono::steady_clock::now();
+  if (!exec_ok(conn,
+               "CREATE TEMP TABLE bench_locations (user_id INTEGER, "
+               "latitude DOUBLE PRECISION, longitude DOUBLE PRECISION, "
+               "accuracy FLOAT, geom GEOGRAPHY(POINT, 4326))") ||
+      !exec_ok(conn,
+               "COPY bench_locations (user_id, latitude, longitude, accuracy) "
+               "FROM STDIN")) {
+    PQfinish(conn);
+    return;
+  }
+  std::string buffer;
+  for (const auto& point : points) {
+    buffer += std::format("{}\t{}\t{}\t{}\n", point.user_id, point.latitude,
+                          point.longitude, point.accuracy);
+    if (buffer.size() > (1 << 20)) {
+      PQputCopyData(conn, buffer.data(), static_cast<int>(buffer.size()));
+      buffer.clear();
+    }
+  }
+  PQputCopyData(conn, buffer.data(), static_cast<int>(buffer.size()));
+  PQputCopyEnd(conn, nullptr);
+  PQclear(PQgetResult(conn));
+  exec_ok(conn,
+          "UPDATE bench_locations SET geom = "
+          "ST_SetSRID(ST_MakePoint(longitude, latitude), 4326)");
+  exec_ok(conn, "CREATE INDEX ON bench_locations USING GIST (geom)");
+  exec_ok(conn, "ANALYZE bench_locations");
+  const std::chrono::duration<double> load_elapsed =
+      std::chrono::steady_clock::now() - load_start;
+  std::cout << std::format("PostGIS load + index: {:.3f}s\n",
+                           load_elapsed.count());
+
+  // Same statement as find_nearby, first page
+  const char* sql =
+      "SELECT user_id, latitude, longitude, accuracy, "
+      "ST_Distance(geom, ST_SetSRID(ST_MakePoint($2, $1), 4326)::geography) "
+      "as distance FROM bench_locations "
+      "WHERE ST_DWithin(geom, ST_SetSRID(ST_MakePoint($2, $1), "
+      "4326)::geography, $3) "
+      "ORDER BY distance OFFSET 0 LIMIT 15";
+  PQclear(PQprepare(conn, "nearby", sql, 3, nullptr));
+
+  utilities::LatencyHistogram latency;
+  std::size_t results = 0;
+  const auto radius_str = std::to_string(radius);
+  auto start = std::chrono::steady_clock::now();
+  for (const auto& query : queries) {
+    const auto lat = std::to_string(query.latitude);
+    const auto lon = std::to_string(query.longitude);
+    const char* values[] = {lat.c_str(), lon.c_str(), radius_str.c_str()};
+    utilities::ScopedLatencyTimer timer(latency);
+    PGresult* result =
+        PQexecPrepared(conn, "nearby", 3, values, nullptr, nullptr, 0);
+    results += static_cast<std::size_t>(PQntuples(result));
+    PQclear(result);
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  report("PostGIS", queries.size(), elapsed, latency, results);
+  PQfinish(conn);
+}
+#endif
+
+int main(int argc, char* argv[]) {
+  std::size_t point_count = 1'000'000;
+  std::size_t query_count = 20'000;
+  double radius = 1000.0;  // find_nearby default
+  std::string conninfo;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--points" && i + 1 < argc) {
+      point_count = std::stoul(argv[++i]);
+    } else if (arg == "--queries" && i + 1 < argc) {
+      query_count = std::max(1UL, std::stoul(argv[++i]));
+    } else if (arg == "--radius" && i + 1 < argc) {
+      radius = std::stod(argv[++i]);
+    } else if (arg == "--pg" && i + 1 < argc) {
+      conninfo = argv[++i];
+    } else {
+      std::cerr << std::format("unknown option {}\n", arg);
+      return 1;
+    }
+  }
+
+  std::mt19937_64 rng(42);
+  std::uniform_real_distribution<double> latitude(40.0, 41.0);
+  std::uniform_real_distribution<double> longitude(-74.5, -73.5);
+
+  std::vector<GeoPoint> points;
+  points.reserve(point_count);
+  for (std::size_t i = 0; i < point_count; ++i) {
+    points.push_back(GeoPoint{.user_id = static_cast<int>(i + 1),
+                              .latitude = latitude(rng),
+                              .longitude = longitude(rng),
+                              .accuracy = 10.0});
+  }
+  std::vector<Query> queries;
+  queries.reserve(query_count);
+  for (std::size_t i = 0; i < query_count; ++i) {
+    queries.push_back(
+        Query{.latitude = latitude(rng), .longitude = longitude(rng)});
+  }
+
+  using clock = std::chrono::steady_clock;
+
+  GeoGridIndex index;
+  auto start = clock::now();
+  index.begin_rebuild();
+  index.finish_rebuild(points);
+  const std::chrono::duration<double> build_elapsed = clock::now() - start;
+  std::cout << std::format("GeoGridIndex build: {} points in {:.3f}s\n",
+                           index.size(), build_elapsed.count());
+
+  utilities::LatencyHistogram latency;
+  std::size_t results = 0;
+  start = clock::now();
+  for (const auto& query : queries) {
+    utilities::ScopedLatencyTimer timer(latency);
+    results +=
+        index.query_radius(query.latitude, query.longitude, radius, 0, 15)
+            .size();
+  }
+  const std::chrono::duration<double> elapsed = clock::now() - start;
+  report("GeoGridIndex", queries.size(), elapsed, latency, results);
+
+  if (!conninfo.empty()) {
+#ifdef BENCH_WITH_LIBPQ
+    run_postgis(conninfo, points, queries, radius);
+#else
+    std::cerr << "built without libpq, PostGIS comparison skipped\n";
+#endif
+  }
+  return 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * Response body building: glz::write_json(x).value_or("") as handlers did,
+ * against utilities::write_json_body() (per-thread buffer, exact-size copy)
+ * and, for fixed errors, utilities::error_body(). Payloads are a
+ * Community::get_posts page, a Chats::get_unread_count body and the
+ * "Database error" body. Reports heap allocations per body and p50/p99.
+ *
+ * Usage: json_body_bench [--iterations N] [--posts N]
+ * Needs no database or server. Each body is dropped right away, as the
+ * response holding it would be once sent.
+ */
+#include <glaze/glaze.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../utilities/json_manipulation.hpp"
+
+namespace {
+
+std::size_t allocations = 0;
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Same shapes as the handlers' response structs
+
+struct Post {
+  int id;
+  int user_id;
+  std::string username;
+  std::string content;
+  std::string created_at;
+  std::vector<std::string> tags;
+  std::string location;
+  bool is_product_request;
+  std::string request_status;
+  std::string price_range;
+  int subscription_count;
+  bool is_subscribed;
+};
+
+struct UnreadCountResponse {
+  int unread_count;
+};
+
+struct SimpleError {
+  std::string error;
+};
+
+std::vector<Post> make_posts(int count) {
+  std::vector<Post> posts;
+  for (int i = 0; i < count; ++i) {
+    posts.push_back(
+        {.id = i + 1,
+         .user_id = i % 7 + 1,
+         .username = std::format("member_{}", i % 7),
+         .content = std::format(
+             "Looking for a second hand road bike, size 56, Shimano 105 or "
+             "better, budget around 400, can collect this weekend, post {}",
+             i),
+         .created_at = "2026-10-18 09:41:27.123456",
+         .tags = {"bikes", "cycling", "second-hand"},
+         .location = "Lagos, Nigeria",
+         .is_product_request = true,
+         .request_status = "open",
+         .price_range = "$300-$450",
+         .subscription_count = i % 13,
+         .is_subscribed = i % 2 == 0});
+  }
+  return posts;
+}
+
+struct Measure {
+  double allocations_per_body = 0;
+  double p50_ns = 0;
+  double p99_ns = 0;
+};
+
+template <typename Build>
+Measure measure(int iterations, Build build) {
+  std::vector<double> samples;
+  samples.reserve(static_cast<std::size_t>(iterations));
+  std::size_t bytes = build().size();  // warm up, e.g. the per-thread buffer
+  const auto allocations_before = allocations;
+  for (int i = 0; i < iterations; ++i) {
+    const auto start = Clock::now();
+    {
+      auto body = build();  // destroyed as the sent response would be
+      bytes += body.size();
+    }
+    samples.push_back(
+        std::chrono::duration<double, std::nano>(Clock::now() - start)
+            .count());
+  }
+  const auto allocated = allocations - allocations_before;
+  if (bytes == 0) {
+    std::cerr << "empty bodies\n";
+  }
+  std::sort(samples.begin(), samples.end());
+  auto at = [&](double q) {
+    return samples[std::min(samples.size() - 1,
+                            static_cast<std::size_t>(q * samples.size()))];
+  };
+  return {.allocations_per_body =
+              static_cast<double>(allocated) / static_cast<double>(iterations),
+          .p50_ns = at(0.50),
+          .p99_ns = at(0.99)};
+}
+
+void report(std::string_view name, const Measure& before,
+            const Measure& after) {
+  std::cout << std::format(
+      "{}: value_or {:.1f} allocations, p50 {:.0f}ns, p99 {:.0f}ns | "
+      "helper {:.1f} allocations, p50 {:.0f}ns, p99 {:.0f}ns\n",
+      name, before.allocations_per_body, before.p50_ns, before.p99_ns,
+      after.allocations_per_body, after.p50_ns, after.p99_ns);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int iterations = 100000;
+  int post_count = 10;  // get_posts page size
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--iterations" && i + 1 < argc) {
+      iterations = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--posts" && i + 1 < argc) {
+      post_count = std::max(1, std::stoi(argv[++i]));
+    } else {
+      std::cerr << std::format("unknown option {}\n", arg);
+      return 1;
+    }
+  }
+
+  const auto posts = make_posts(post_count);
+  report("get_posts", measure(iterations, [&] {
+           return glz::write_json(posts).value_or("");
+         }),
+         measure(iterations,
+                 [&] { return utilities::write_json_body(posts); }));
+
+  const UnreadCountResponse unread{.unread_count = 42};
+  report("get_unread_count", measure(iterations, [&] {
+           return glz::write_json(unread).value_or("");
+         }),
+         measure(iterations,
+                 [&] { return utilities::write_json_body(unread); }));
+
+  // error_response() hands the prebuilt body to drogon as pointer and length
+  report("Database error", measure(iterations, [] {
+           return glz::write_json(SimpleError{.error = "Database error"})
+               .value_or("");
+         }),
+         measure(iterations, [] {
+           return std::string_view(utilities::error_body<"Database error">());
+         }));
+  return 0;
+}
@@ -0,0 +1,524 @@
+/**
+ * Load generator replaying a mix of user traffic against a running server.
+ * Synthetic users register, set a location and open a notification
+ * WebSocket, then pair up: one posts a product request, the other makes an
+ * offer on it and starts a conversation. Each user then sends requests drawn
+ * from the endpoint mix for --duration seconds, waiting for every response
+ * before sending the next one (closed loop, so overload shows up as lower
+ * throughput rather than as a growing queue).
+ *
+ * Reports requests per second, errors and latency percentiles per endpoint,
+ * plus the notifications received over the WebSockets. --save writes the
+ * report as a baseline file; --baseline diffs this run against one.
+ *
+ * Usage: load_bench [--url http://127.0.0.1:5555] [--users N]
+ *                   [--duration S] [--warmup S] [--seed N]
+ *                   [--mix get_posts=25,search=15,...] [--no-websockets]
+ *                   [--save FILE] [--baseline FILE]
+ * Needs a server started with test_config.json against the Postgres and
+ * MinIO of docker-compose.test.yml. Users are named load_<seed>_<i>, so use
+ * a new --seed on a database that already ran one. Rows created are left in
+ * place, the test database is disposable.
+ */
+#include <drogon/HttpClient.h>
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <drogon/WebSocketClient.h>
+#include <json/json.h>
+#include <trantor/net/EventLoopThreadPool.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../utilities/latency_histogram.hpp"
+#include "bench_client.hpp"
+
+namespace {
+
+using bench_client::get_request;
+using bench_client::post_request;
+using bench_client::send;
+using Clock = std::chrono::steady_clock;
+
+enum class Endpoint : std::uint8_t {
+  get_posts,
+  filter_posts,
+  create_post,
+  send_message,
+  negotiate_offer,
+  find_nearby,
+  search,
+};
+
+constexpr std::array<std::string_view, 7> kEndpointNames{
+    "get_posts",       "filter_posts", "create_post", "send_message",
+    "negotiate_offer", "find_nearby",  "search"};
+
+// Read heavy, roughly what the app's feed and chat screens send
+constexpr std::array<int, kEndpointNames.size()> kDefaultWeights{
+    25, 15, 10, 15, 5, 15, 15};
+
+// Generated posts use these, so filters and searches have matches
+constexpr std::array<std::string_view, 8> kTags{
+    "electronics", "furniture", "books", "fashion",
+    "sports",      "garden",    "toys",  "music"};
+
+// Users are scattered within ~3 km of this point
+constexpr double kCenterLatitude = 6.5244;
+constexpr double kCenterLongitude = 3.3792;
+
+struct Options {
+  std::string url = "http://127.0.0.1:5555";
+  int users = 50;
+  int duration_s = 30;
+  int warmup_s = 5;
+  std::uint64_t seed = 1;
+  std::array<int, kEndpointNames.size()> weights = kDefaultWeights;
+  bool websockets = true;
+  std::string save_path;
+  std::string baseline_path;
+};
+
+struct EndpointStats {
+  utilities::LatencyHistogram latency;
+  std::atomic<std::uint64_t> errors{0};
+  std::atomic<std::uint64_t> max_us{0};
+};
+
+struct EndpointReport {
+  std::uint64_t requests = 0;
+  std::uint64_t errors = 0;
+  double rps = 0;
+  double p50_us = 0;
+  double p90_us = 0;
+  double p99_us = 0;
+  double p999_us = 0;
+  std::uint64_t max_us = 0;
+};
+
+struct User {
+  std::string token;
+  int id = 0;
+  double latitude = 0;
+  double longitude = 0;
+  int post_id = 0;          // buyers only, the post the pair negotiates on
+  int offer_id = 0;         // the pair's offer, either side can negotiate
+  int conversation_id = 0;  // between the pair
+};
+
+std::string_view random_tag(std::mt19937_64& rng) {
+  return kTags[rng() % kTags.size()];
+}
+
+drogon::HttpRequestPtr build_request(Endpoint endpoint, const User& user,
+                                     std::mt19937_64& rng) {
+  switch (endpoint) {
+    case Endpoint::get_posts:
+      return get_request("/api/v1/posts", user.token);
+    case Endpoint::filter_posts:
+      return get_request(
+          std::format("/api/v1/posts/filter?tags={}", random_tag(rng)),
+          user.token);
+    case Endpoint::create_post: {
+      const auto tag = random_tag(rng);
+      Json::Value json;
+      json["content"] = std::format("Looking for {} in good condition", tag);
+      json["tags"] = Json::Value(Json::arrayValue);
+      json["tags"].append(std::string(tag));
+      json["location"] = "Load test";
+      json["is_product_request"] = rng() % 2 == 0;
+      json["price_range"] = "$50-$200";
+      return post_request("/api/v1/posts", json, user.token);
+    }
+    case Endpoint::send_message: {
+      Json::Value json;
+      json["content"] = std::format("Is it still available? #{}", rng() % 1000);
+      return post_request(std::format("/api/v1/conversations/{}/messages",
+                                      user.conversation_id),
+                          json, user.token);
+    }
+    case Endpoint::negotiate_offer: {
+      Json::Value json;
+      json["price"] = static_cast<double>(50 + rng() % 150);
+      json["message"] = "How about this?";
+      return post_request(
+          std::format("/api/v1/offers/{}/negotiate", user.offer_id), json,
+          user.token);
+    }
+    case Endpoint::find_nearby:
+      return get_request(
+          std::format("/api/v1/location/nearby?lat={:.6f}&lon={:.6f}"
+                      "&radius=5000",
+                      user.latitude, user.longitude),
+          user.token);
+    case Endpoint::search:
+      return get_request(
+          std::format("/api/v1/search?query={}", random_tag(rng)),
+          user.token);
+  }
+  return nullptr;
+}
+
+// Registers the user and reports its location, false on any failure
+bool register_user(const drogon::HttpClientPtr& client,
+                   const Options& options, int index, User& user) {
+  const auto username = std::format("load_{}_{}", options.seed, index);
+  const auto account = bench_client::register_user(client, username);
+  if (!account) {
+    std::cerr << std::format("registering {} failed\n", username);
+    return false;
+  }
+  user.token = account->token;
+  user.id = account->user_id;
+
+  Json::Value location;
+  location["latitude"] = user.latitude;
+  location["longitude"] = user.longitude;
+  return send(client,
+              post_request("/api/v1/location", location, user.token)) == 200;
+}
+
+bool create_post(const drogon::HttpClientPtr& client, User& buyer) {
+  Json::Value json;
+  json["content"] = "Looking for a used bicycle";
+  json["tags"] = Json::Value(Json::arrayValue);
+  json["tags"].append("sports");
+  json["location"] = "Load test";
+  json["is_product_request"] = true;
+  json["price_range"] = "$50-$200";
+  Json::Value body;
+  if (send(client, post_request("/api/v1/posts", json, buyer.token),
+           &body) != 200) {
+    return false;
+  }
+  buyer.post_id = body["post_id"].asInt();
+  return buyer.post_id > 0;
+}
+
+// The seller offers on the buyer's post and opens their conversation
+bool create_offer(const drogon::HttpClientPtr& client, User& seller,
+                  const User& buyer) {
+  Json::Value offer;
+  offer["title"] = "Used bicycle";
+  offer["description"] = "Two years old, new tyres";
+  offer["price"] = 150.0;
+  offer["is_public"] = true;
+  Json::Value body;
+  if (send(client,
+           post_request(std::format("/api/v1/posts/{}/offers", buyer.post_id),
+                        offer, seller.token),
+           &body) != 200) {
+    return false;
+  }
+  seller.offer_id = body["offer_id"].asInt();
+
+  Json::Value conversation;
+  conversation["name"] = std::format("Offer #{}", seller.offer_id);
+  conversation["user_id"] = buyer.id;
+  if (send(client,
+           post_request("/api/v1/conversations", conversation, seller.token),
+           &body) != 200) {
+    return false;
+  }
+  seller.conversation_id = body["conversation_id"].asInt();
+  return seller.offer_id > 0 && seller.conversation_id > 0;
+}
+
+bool parse_mix(std::string_view text,
+               std::array<int, kEndpointNames.size()>& weights) {
+  weights.fill(0);
+  while (!text.empty()) {
+    const auto comma = text.find(',');
+    const auto item = text.substr(0, comma);
+    text = comma == std::string_view::npos ? std::string_view{}
+                                           : text.substr(comma + 1);
+    const auto equals = item.find('=');
+    if (equals == std::string_view::npos) {
+      return false;
+    }
+    const auto name = item.substr(0, equals);
+    const auto it = std::ranges::find(kEndpointNames, name);
+    if (it == kEndpointNames.end()) {
+      return false;
+    }
+    weights[static_cast<std::size_t>(it - kEndpointNames.begin())] =
+        std::max(0, std::stoi(std::string(item.substr(equals + 1))));
+  }
+  return std::ranges::any_of(weights, [](int w) { return w > 0; });
+}
+
+std::string mix_string(const std::array<int, kEndpointNames.size()>& weights) {
+  std::string out;
+  for (std::size_t i = 0; i < weights.size(); ++i) {
+    if (weights[i] > 0) {
+      out += std::format("{}{}={}", out.empty() ? "" : ",", kEndpointNames[i],
+                         weights[i]);
+    }
+  }
+  return out;
+}
+
+void save_baseline(const std::string& path, const Options& options,
+                   const std::map<std::string, EndpointReport>& reports) {
+  std::ofstream out(path);
+  out << std::format("# load_bench users={} duration_s={} mix={}\n",
+                     options.users, options.duration_s,
+                     mix_string(options.weights));
+  out << "# endpoint requests errors rps p50_us p90_us p99_us p999_us max_us\n";
+  for (const auto& [name, r] : reports) {
+    out << std::format("{} {} {} {:.1f} {:.0f} {:.0f} {:.0f} {:.0f} {}\n", name,
+                       r.requests, r.errors, r.rps, r.p50_us, r.p90_us,
+                       r.p99_us, r.p999_us, r.max_us);
+  }
+}
+
+std::map<std::string, EndpointReport> load_baseline(const std::string& path) {
+  std::map<std::string, EndpointReport> reports;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string name;
+    EndpointReport r;
+    if (fields >> name >> r.requests >> r.errors >> r.rps >> r.p50_us >>
+        r.p90_us >> r.p99_us >> r.p999_us >> r.max_us) {
+      reports.emplace(std::move(name), r);
+    }
+  }
+  return reports;
+}
+
+double delta_percent(double now, double before) {
+  return before > 0 ? (now - before) / before * 100.0 : 0.0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--url" && i + 1 < argc) {
+      options.url = argv[++i];
+    } else if (arg == "--users" && i + 1 < argc) {
+      options.users = std::max(2, std::stoi(argv[++i]));
+    } else if (arg == "--duration" && i + 1 < argc) {
+      options.duration_s = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--warmup" && i + 1 < argc) {
+      options.warmup_s = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--seed" && i + 1 < argc) {
+      options.seed = std::stoull(argv[++i]);
+    } else if (arg == "--mix" && i + 1 < argc) {
+      if (!parse_mix(argv[++i], options.weights)) {
+        std::cerr << "--mix takes name=weight pairs, names are get_posts, "
+                     "filter_posts, create_post, send_message, "
+                     "negotiate_offer, find_nearby and search\n";
+        return 1;
+      }
+    } else if (arg == "--no-websockets") {
+      options.websockets = false;
+    } else if (arg == "--save" && i + 1 < argc) {
+      options.save_path = argv[++i];
+    } else if (arg == "--baseline" && i + 1 < argc) {
+      options.baseline_path = argv[++i];
+    } else {
+      std::cerr << std::format("unknown option {}\n", arg);
+      return 1;
+    }
+  }
+  // Users work in buyer/seller pairs
+  options.users += options.users % 2;
+
+  const auto threads = static_cast<std::size_t>(
+      std::clamp(options.users / 8, 1,
+                 static_cast<int>(std::thread::hardware_concurrency())));
+  trantor::EventLoopThreadPool loops(threads, "LoadBenchLoop");
+  loops.start();
+
+  std::vector<User> users(static_cast<std::size_t>(options.users));
+  std::array<EndpointStats, kEndpointNames.size()> stats;
+  std::atomic<std::uint64_t> notifications{0};
+  std::atomic<int> setup_failures{0};
+  std::atomic<int> websockets_open{0};
+  std::atomic<bool> measuring{false};
+  std::atomic<bool> stop{false};
+  std::barrier sync(options.users + 1);
+  const std::discrete_distribution<int> mix(options.weights.begin(),
+                                            options.weights.end());
+
+  std::vector<std::thread> workers;
+  for (int i = 0; i < options.users; ++i) {
+    workers.emplace_back([&, i]() {
+      auto& user = users[static_cast<std::size_t>(i)];
+      std::mt19937_64 rng(options.seed * 1'000'003 +
+                          static_cast<std::uint64_t>(i));
+      std::uniform_real_distribution<double> offset(-0.03, 0.03);
+      user.latitude = kCenterLatitude + offset(rng);
+      user.longitude = kCenterLongitude + offset(rng);
+      auto* loop = loops.getNextLoop();
+      auto client = drogon::HttpClient::newHttpClient(options.url, loop);
+      drogon::WebSocketClientPtr ws;
+      auto endpoint_mix = mix;
+
+      // Setup, the pair's buyer is the even index
+      const bool buyer = i % 2 == 0;
+      auto& partner = users[static_cast<std::size_t>(buyer ? i + 1 : i - 1)];
+      bool ok = register_user(client, options, i, user);
+      if (ok && options.websockets) {
+        ws = bench_client::open_notifications(
+            options.url, loop, user.token, [&notifications](std::string&&) {
+              notifications.fetch_add(1, std::memory_order_relaxed);
+            });
+        ok = ws != nullptr;
+        websockets_open += ok ? 1 : 0;
+      }
+      setup_failures += ok ? 0 : 1;
+      sync.arrive_and_wait();
+      if (setup_failures == 0 && buyer && !create_post(client, user)) {
+        ++setup_failures;
+      }
+      sync.arrive_and_wait();
+      if (setup_failures == 0 && !buyer &&
+          !create_offer(client, user, partner)) {
+        ++setup_failures;
+      }
+      sync.arrive_and_wait();
+      if (buyer) {
+        user.offer_id = partner.offer_id;
+        user.conversation_id = partner.conversation_id;
+      }
+      sync.arrive_and_wait();
+
+      while (setup_failures == 0 && !stop.load(std::memory_order_relaxed)) {
+        const auto endpoint = static_cast<Endpoint>(endpoint_mix(rng));
+        auto req = build_request(endpoint, user, rng);
+        const auto start = Clock::now();
+        const int status = send(client, req);
+        const auto elapsed = Clock::now() - start;
+        if (!measuring.load(std::memory_order_relaxed)) {
+          continue;
+        }
+        auto& s = stats[static_cast<std::size_t>(endpoint)];
+        s.latency.record(elapsed);
+        const auto us = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+                .count());
+        auto max = s.max_us.load(std::memory_order_relaxed);
+        while (us > max && !s.max_us.compare_exchange_weak(max, us)) {
+        }
+        if (status < 200 || status >= 300) {
+          s.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+      if (ws) {
+        ws->stop();
+      }
+    });
+  }
+
+  sync.arrive_and_wait();
+  sync.arrive_and_wait();
+  sync.arrive_and_wait();
+  sync.arrive_and_wait();
+  if (setup_failures > 0) {
+    std::cerr << std::format("setup failed for {} users, is the server up?\n",
+                             setup_failures.load());
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    return 1;
+  }
+  std::cout << std::format("{} users, {} WebSockets, mix {}\n", options.users,
+                           websockets_open.load(),
+                           mix_string(options.weights));
+
+  std::this_thread::sleep_for(std::chrono::seconds(options.warmup_s));
+  const auto notifications_before = notifications.load();
+  measuring = true;
+  const auto started = Clock::now();
+  std::this_thread::sleep_for(std::chrono::seconds(options.duration_s));
+  measuring = false;
+  const double elapsed_s =
+      std::chrono::duration<double>(Clock::now() - started).count();
+  const auto received = notifications.load() - notifications_before;
+  stop = true;
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  std::map<std::string, EndpointReport> reports;
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i < stats.size(); ++i) {
+    const auto& latency = stats[i].latency;
+    if (latency.count() == 0) {
+      continue;
+    }
+    total += latency.count();
+    reports.emplace(std::string(kEndpointNames[i]),
+                    EndpointReport{.requests = latency.count(),
+                                   .errors = stats[i].errors.load(),
+                                   .rps = latency.count() / elapsed_s,
+                                   .p50_us = latency.percentile(0.50),
+                                   .p90_us = latency.percentile(0.90),
+                                   .p99_us = latency.percentile(0.99),
+                                   .p999_us = latency.percentile(0.999),
+                                   .max_us = stats[i].max_us.load()});
+  }
+
+  std::cout << std::format("{:<16} {:>9} {:>7} {:>9} {:>9} {:>9} {:>9} {:>9}\n",
+                           "endpoint", "requests", "errors", "req/s",
+                           "p50 ms", "p90 ms", "p99 ms", "max ms");
+  for (const auto& [name, r] : reports) {
+    std::cout << std::format(
+        "{:<16} {:>9} {:>7} {:>9.1f} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f}\n",
+        name, r.requests, r.errors, r.rps, r.p50_us / 1000.0,
+        r.p90_us / 1000.0, r.p99_us / 1000.0, r.max_us / 1000.0);
+  }
+  std::cout << std::format(
+      "total {:.1f} req/s over {:.1f} s, {} notifications received "
+      "({:.1f}/s)\n",
+      total / elapsed_s, elapsed_s, received, received / elapsed_s);
+
+  if (!options.baseline_path.empty()) {
+    const auto baseline = load_baseline(options.baseline_path);
+    std::cout << std::format("\nagainst {}\n{:<16} {:>9} {:>9} {:>9}\n",
+                             options.baseline_path, "endpoint", "req/s %",
+                             "p99 %", "errors");
+    for (const auto& [name, r] : reports) {
+      const auto it = baseline.find(name);
+      if (it == baseline.end()) {
+        std::cout << std::format("{:<16} {:>9}\n", name, "new");
+        continue;
+      }
+      const auto errors = static_cast<std::int64_t>(r.errors) -
+                          static_cast<std::int64_t>(it->second.errors);
+      std::cout << std::format("{:<16} {:>+9.1f} {:>+9.1f} {:>+9}\n", name,
+                               delta_percent(r.rps, it->second.rps),
+                               delta_percent(r.p99_us, it->second.p99_us),
+                               errors);
+    }
+  }
+  if (!options.save_path.empty()) {
+    save_baseline(options.save_path, options, reports);
+    std::cout << std::format("baseline saved to {}\n", options.save_path);
+  }
+  return 0;
+}
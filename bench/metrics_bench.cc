@@ -0,0 +1,114 @@
+/**
+ * Hot path cost of the metrics in utilities/metrics.hpp: ns per recording
+ * on 1 to N threads hammering the same series. Columns:
+ * - atomic: fetch_add on one shared counter, the contended baseline
+ * - local: LocalCounter::add on a per-thread counter
+ * - shared histogram: LatencyHistogram::record_us on one shared histogram
+ * - record: RequestBlock::record() into the thread's block, latency and
+ *   status class
+ * - route: what main.cc does per response, the Metrics::route() lookup
+ *   plus record
+ *
+ * Usage: metrics_bench [--iterations N] [--threads N]
+ * Needs no database or server.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../utilities/metrics.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// ns per operation, averaged over every thread
+template <typename Operation>
+double measure(int threads, int iterations, const Operation& operation) {
+  std::atomic<bool> start{false};
+  std::vector<std::thread> workers;
+  std::vector<double> elapsed_ns(static_cast<std::size_t>(threads));
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      while (!start.load(std::memory_order_acquire)) {
+      }
+      const auto begin = Clock::now();
+      for (int i = 0; i < iterations; ++i) {
+        operation(i);
+      }
+      elapsed_ns[static_cast<std::size_t>(t)] =
+          std::chrono::duration<double, std::nano>(Clock::now() - begin)
+              .count();
+    });
+  }
+  start.store(true, std::memory_order_release);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  double total = 0;
+  for (const double ns : elapsed_ns) {
+    total += ns;
+  }
+  return total / threads / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int iterations = 5'000'000;
+  int max_threads =
+      static_cast<int>(std::max(1U, std::thread::hardware_concurrency()));
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--iterations" && i + 1 < argc) {
+      iterations = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--threads" && i + 1 < argc) {
+      max_threads = std::max(1, std::stoi(argv[++i]));
+    } else {
+      std::cerr << std::format("unknown option {}\n", arg);
+      return 1;
+    }
+  }
+
+  auto& metrics = utilities::Metrics::get_instance();
+  std::cout << std::format("{:>7} {:>10} {:>10} {:>20} {:>10} {:>10}\n",
+                           "threads", "atomic ns", "local ns",
+                           "shared histogram ns", "record ns", "route ns");
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    std::atomic<std::uint64_t> shared{0};
+    utilities::LatencyHistogram histogram;
+
+    const double atomic_ns = measure(threads, iterations, [&](int) {
+      shared.fetch_add(1, std::memory_order_relaxed);
+    });
+    const double local_ns = measure(threads, iterations, [](int) {
+      thread_local utilities::LocalCounter counter;
+      counter.add();
+    });
+    const double histogram_ns = measure(threads, iterations, [&](int i) {
+      histogram.record_us(static_cast<std::uint64_t>(100 + (i & 1023)));
+    });
+    const double record_ns = measure(threads, iterations, [&](int i) {
+      thread_local auto& block =
+          metrics.route("GET", "/api/v1/posts/{post_id}");
+      block.record(std::chrono::microseconds(100 + (i & 1023)), 200);
+    });
+    // What the post-handling advice in main.cc does for every response
+    const double route_ns = measure(threads, iterations, [&](int i) {
+      metrics.route("GET", "/api/v1/posts/{post_id}")
+          .record(std::chrono::microseconds(100 + (i & 1023)), 200);
+    });
+    std::cout << std::format(
+        "{:>7} {:>10.1f} {:>10.1f} {:>20.1f} {:>10.1f} {:>10.1f}\n", threads,
+        atomic_ns, local_ns, histogram_ns, record_ns, route_ns);
+  }
+  return 0;
+}
@@ -0,0 +1,413 @@
+/**
+ * End to end notification latency: from PubManager::publish to the frame
+ * arriving at a subscribed WebSocket client.
+ *
+ * Synthetic users register and subscribe, through
+ * /api/v1/entity/{name}/subscribe, to one of --shared-topics shared topics
+ * and to a private topic of their own. Each then opens
+ * --connections-per-user notification WebSockets. Probes are published at
+ * --rate per second for --duration seconds through the admin listener's
+ * POST /publish, which stamps each probe with the server clock right before
+ * PubManager::publish. --private-share of them go to a random user's private
+ * topic and the rest to a random shared topic.
+ *
+ * Reports delivery latency percentiles per kind of topic, frames dropped
+ * (expected from the subscriptions but not received --grace seconds after
+ * the last publish) and duplicated, and the server's resident memory per
+ * connection, from the admin /metrics before and after connecting.
+ *
+ * Usage: notification_bench [--url http://127.0.0.1:5555]
+ *                           [--admin-url http://127.0.0.1:9465]
+ *                           [--users N] [--connections-per-user N]
+ *                           [--shared-topics N] [--rate N]
+ *                           [--private-share F] [--duration S] [--grace S]
+ *                           [--seed N]
+ * Needs a server as for load_bench, on this host: the admin listener only
+ * accepts loopback connections, which also keeps both clocks the same.
+ * Thousands of connections need a higher open files limit (ulimit -n) on
+ * both sides. Users are named notify_<seed>_<i>.
+ */
+#include <drogon/HttpClient.h>
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <drogon/WebSocketClient.h>
+#include <json/json.h>
+#include <trantor/net/EventLoopThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../utilities/latency_histogram.hpp"
+#include "bench_client.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class TopicKind : std::uint8_t { shared, user };
+
+struct Options {
+  std::string url = "http://127.0.0.1:5555";
+  std::string admin_url = "http://127.0.0.1:9465";
+  int users = 2000;
+  int connections_per_user = 1;
+  int shared_topics = 10;
+  int rate = 200;
+  double private_share = 0.5;
+  int duration_s = 30;
+  int grace_s = 5;
+  std::uint64_t seed = 1;
+};
+
+// ZMQ subscriptions match by prefix, the trailing '-' keeps topic 1 from
+// also receiving topic 10
+std::string shared_topic(const Options& options, int index) {
+  return std::format("bench-{}-shared-{}-", options.seed, index);
+}
+
+std::string user_topic(const Options& options, int user) {
+  return std::format("bench-{}-user-{}-", options.seed, user);
+}
+
+struct LatencyStats {
+  utilities::LatencyHistogram latency;
+  std::atomic<std::uint64_t> max_us{0};
+
+  void record(std::uint64_t us) {
+    latency.record_us(us);
+    auto max = max_us.load(std::memory_order_relaxed);
+    while (us > max && !max_us.compare_exchange_weak(max, us)) {
+    }
+  }
+};
+
+// Probe bookkeeping, indexed by seq
+struct Probes {
+  explicit Probes(std::size_t capacity)
+      : expected(capacity), received(capacity), kind(capacity) {}
+
+  std::vector<std::atomic<std::uint32_t>> expected;
+  std::vector<std::atomic<std::uint32_t>> received;
+  std::vector<std::atomic<TopicKind>> kind;
+  std::atomic<std::uint64_t> unknown{0};  // seq out of range
+  LatencyStats shared;
+  LatencyStats user;
+};
+
+// Integer value following field (e.g. "\"seq\":") in compact JSON
+std::optional<std::int64_t> integer_field(std::string_view json,
+                                          std::string_view field) {
+  const auto at = json.find(field);
+  if (at == std::string_view::npos) {
+    return std::nullopt;
+  }
+  const char* begin = json.data() + at + field.size();
+  std::int64_t value = 0;
+  const auto [end, ec] = std::from_chars(begin, json.data() + json.size(),
+                                         value);
+  return ec == std::errc{} ? std::optional(value) : std::nullopt;
+}
+
+std::int64_t system_now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// Called on the client loops for every text frame
+void on_frame(Probes& probes, std::string_view frame) {
+  if (frame.find("\"type\":\"probe\"") == std::string_view::npos) {
+    return;  // welcome message and the like
+  }
+  const auto seq = integer_field(frame, "\"seq\":");
+  const auto published_at = integer_field(frame, "\"published_at_us\":");
+  if (!seq || !published_at || *seq < 0 ||
+      static_cast<std::size_t>(*seq) >= probes.received.size()) {
+    probes.unknown.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  const auto index = static_cast<std::size_t>(*seq);
+  probes.received[index].fetch_add(1, std::memory_order_relaxed);
+  const auto us = static_cast<std::uint64_t>(
+      std::max<std::int64_t>(system_now_us() - *published_at, 0));
+  auto& stats =
+      probes.kind[index].load(std::memory_order_relaxed) == TopicKind::shared
+          ? probes.shared
+          : probes.user;
+  stats.record(us);
+}
+
+// Runs task(index, client) for every index on `workers` threads, each with
+// its own client
+void parallel_for(int count, int workers, trantor::EventLoopThreadPool& loops,
+                  const std::string& url,
+                  const std::function<void(int, const drogon::HttpClientPtr&)>&
+                      task) {
+  std::atomic<int> next{0};
+  std::vector<std::thread> threads;
+  for (int w = 0; w < std::min(workers, count); ++w) {
+    threads.emplace_back([&]() {
+      auto client = drogon::HttpClient::newHttpClient(url, loops.getNextLoop());
+      for (int i = next++; i < count; i = next++) {
+        task(i, client);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+// buyer_process_resident_bytes from the admin /metrics, 0 when unavailable
+std::uint64_t server_resident_bytes(const drogon::HttpClientPtr& admin) {
+  auto req = drogon::HttpRequest::newHttpRequest();
+  req->setMethod(drogon::Get);
+  req->setPath("/metrics");
+  auto [result, resp] = admin->sendRequest(req, bench_client::kTimeoutSeconds);
+  if (result != drogon::ReqResult::Ok || !resp) {
+    return 0;
+  }
+  const std::string_view body = resp->body();
+  constexpr std::string_view kSample = "\nbuyer_process_resident_bytes ";
+  const auto value = integer_field(body, kSample);
+  return value ? static_cast<std::uint64_t>(*value) : 0;
+}
+
+void print_latency(std::string_view name, const LatencyStats& stats) {
+  const auto& latency = stats.latency;
+  std::cout << std::format(
+      "{:<8} {:>10} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f}\n", name,
+      latency.count(), latency.percentile(0.50) / 1000.0,
+      latency.percentile(0.90) / 1000.0, latency.percentile(0.99) / 1000.0,
+      latency.percentile(0.999) / 1000.0, stats.max_us.load() / 1000.0);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--url" && i + 1 < argc) {
+      options.url = argv[++i];
+    } else if (arg == "--admin-url" && i + 1 < argc) {
+      options.admin_url = argv[++i];
+    } else if (arg == "--users" && i + 1 < argc) {
+      options.users = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--connections-per-user" && i + 1 < argc) {
+      options.connections_per_user = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--shared-topics" && i + 1 < argc) {
+      options.shared_topics = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--rate" && i + 1 < argc) {
+      options.rate = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--private-share" && i + 1 < argc) {
+      options.private_share = std::clamp(std::stod(argv[++i]), 0.0, 1.0);
+    } else if (arg == "--duration" && i + 1 < argc) {
+      options.duration_s = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--grace" && i + 1 < argc) {
+      options.grace_s = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--seed" && i + 1 < argc) {
+      options.seed = std::stoull(argv[++i]);
+    } else {
+      std::cerr << std::format("unknown option {}\n", arg);
+      return 1;
+    }
+  }
+
+  const int loop_count = static_cast<int>(
+      std::clamp(std::thread::hardware_concurrency(), 1U, 16U));
+  trantor::EventLoopThreadPool loops(static_cast<std::size_t>(loop_count),
+                                     "NotificationBenchLoop");
+  loops.start();
+  constexpr int kSetupWorkers = 64;
+
+  // Register and subscribe
+  std::vector<bench_client::Account> accounts(
+      static_cast<std::size_t>(options.users));
+  std::vector<int> shared_subscribers(
+      static_cast<std::size_t>(options.shared_topics));
+  for (int i = 0; i < options.users; ++i) {
+    ++shared_subscribers[static_cast<std::size_t>(i % options.shared_topics)];
+  }
+  std::atomic<int> setup_failures{0};
+  auto setup_start = Clock::now();
+  parallel_for(
+      options.users, kSetupWorkers, loops, options.url,
+      [&](int i, const drogon::HttpClientPtr& client) {
+        auto account = bench_client::register_user(
+            client, std::format("notify_{}_{}", options.seed, i));
+        if (!account) {
+          ++setup_failures;
+          return;
+        }
+        for (const auto& topic :
+             {shared_topic(options, i % options.shared_topics),
+              user_topic(options, i)}) {
+          const auto req = bench_client::post_request(
+              std::format("/api/v1/entity/{}/subscribe", topic),
+              Json::Value(Json::objectValue), account->token);
+          if (bench_client::send(client, req) != 200) {
+            ++setup_failures;
+            return;
+          }
+        }
+        accounts[static_cast<std::size_t>(i)] = std::move(*account);
+      });
+  if (setup_failures > 0) {
+    std::cerr << std::format(
+        "registering or subscribing failed for {} users, is the server up?\n",
+        setup_failures.load());
+    return 1;
+  }
+  std::cout << std::format(
+      "{} users registered and subscribed in {:.1f} s\n", options.users,
+      std::chrono::duration<double>(Clock::now() - setup_start).count());
+
+  // Connect, measuring the server's memory around it
+  std::vector<drogon::HttpClientPtr> admin_clients;
+  for (int i = 0; i < loop_count; ++i) {
+    admin_clients.push_back(
+        drogon::HttpClient::newHttpClient(options.admin_url,
+                                          loops.getNextLoop()));
+  }
+  const auto rss_before = server_resident_bytes(admin_clients.front());
+
+  const std::size_t capacity =
+      static_cast<std::size_t>(options.rate) *
+          static_cast<std::size_t>(options.duration_s) +
+      static_cast<std::size_t>(options.rate);
+  Probes probes(capacity);
+  const int connection_count = options.users * options.connections_per_user;
+  std::vector<drogon::WebSocketClientPtr> connections(
+      static_cast<std::size_t>(connection_count));
+  std::atomic<int> connect_failures{0};
+  setup_start = Clock::now();
+  parallel_for(connection_count, kSetupWorkers, loops, options.url,
+               [&](int c, const drogon::HttpClientPtr&) {
+                 const auto& account = accounts[static_cast<std::size_t>(
+                     c / options.connections_per_user)];
+                 auto ws = bench_client::open_notifications(
+                     options.url, loops.getNextLoop(), account.token,
+                     [&probes](std::string&& frame) {
+                       on_frame(probes, frame);
+                     });
+                 if (!ws) {
+                   ++connect_failures;
+                 }
+                 connections[static_cast<std::size_t>(c)] = std::move(ws);
+               });
+  const double connect_s =
+      std::chrono::duration<double>(Clock::now() - setup_start).count();
+  // Let subscribe_user_to_existing_subs and buffers settle before sampling
+  std::this_thread::sleep_for(std::chrono::seconds(2));
+  const auto rss_after = server_resident_bytes(admin_clients.front());
+  const int open = connection_count - connect_failures.load();
+  std::cout << std::format("{} of {} WebSockets open in {:.1f} s\n", open,
+                           connection_count, connect_s);
+  if (rss_before > 0 && rss_after > rss_before && open > 0) {
+    std::cout << std::format(
+        "server resident memory {:.1f} MiB -> {:.1f} MiB, {:.1f} KiB per "
+        "connection\n",
+        rss_before / 1048576.0, rss_after / 1048576.0,
+        static_cast<double>(rss_after - rss_before) / open / 1024.0);
+  }
+
+  // Publish at a fixed rate, on schedule even when responses are slow
+  std::mt19937_64 rng(options.seed);
+  std::bernoulli_distribution pick_private(options.private_share);
+  std::uniform_int_distribution<int> pick_user(0, options.users - 1);
+  std::uniform_int_distribution<int> pick_shared(0, options.shared_topics - 1);
+  std::atomic<std::uint64_t> publish_failures{0};
+  const auto interval = std::chrono::nanoseconds(1'000'000'000) / options.rate;
+  const auto publish_start = Clock::now();
+  const auto publish_end =
+      publish_start + std::chrono::seconds(options.duration_s);
+  std::size_t published = 0;
+  for (auto next = publish_start; next < publish_end && published < capacity;
+       next += interval, ++published) {
+    std::this_thread::sleep_until(next);
+    std::string topic;
+    std::uint32_t expected = 0;
+    if (pick_private(rng)) {
+      topic = user_topic(options, pick_user(rng));
+      expected = static_cast<std::uint32_t>(options.connections_per_user);
+      probes.kind[published] = TopicKind::user;
+    } else {
+      const int shared = pick_shared(rng);
+      topic = shared_topic(options, shared);
+      expected = static_cast<std::uint32_t>(
+          shared_subscribers[static_cast<std::size_t>(shared)] *
+          options.connections_per_user);
+      probes.kind[published] = TopicKind::shared;
+    }
+    probes.expected[published] = expected;
+
+    auto req = drogon::HttpRequest::newHttpRequest();
+    req->setMethod(drogon::Post);
+    req->setPath("/publish");
+    req->setParameter("topic", topic);
+    req->setParameter("seq", std::to_string(published));
+    admin_clients[published % admin_clients.size()]->sendRequest(
+        req,
+        [&probes, &publish_failures, seq = published](
+            drogon::ReqResult result, const drogon::HttpResponsePtr& resp) {
+          if (result != drogon::ReqResult::Ok || !resp ||
+              resp->statusCode() != drogon::k200OK) {
+            // Not published, nothing to deliver
+            probes.expected[seq] = 0;
+            publish_failures.fetch_add(1, std::memory_order_relaxed);
+          }
+        },
+        bench_client::kTimeoutSeconds);
+  }
+  const double publish_s =
+      std::chrono::duration<double>(Clock::now() - publish_start).count();
+  std::this_thread::sleep_for(std::chrono::seconds(options.grace_s));
+
+  std::uint64_t expected_total = 0;
+  std::uint64_t received_total = 0;
+  std::uint64_t dropped = 0;
+  std::uint64_t duplicated = 0;
+  for (std::size_t seq = 0; seq < published; ++seq) {
+    const std::uint64_t expected = probes.expected[seq].load();
+    const std::uint64_t received = probes.received[seq].load();
+    expected_total += expected;
+    received_total += received;
+    dropped += expected > received ? expected - received : 0;
+    duplicated += received > expected ? received - expected : 0;
+  }
+
+  std::cout << std::format(
+      "{} probes in {:.1f} s ({:.1f}/s), {} failed to publish\n", published,
+      publish_s, published / publish_s, publish_failures.load());
+  std::cout << std::format(
+      "{} deliveries expected, {} received, {} dropped ({:.3f}%), {} "
+      "duplicated, {} unknown\n",
+      expected_total, received_total, dropped,
+      expected_total > 0 ? 100.0 * dropped / expected_total : 0.0, duplicated,
+      probes.unknown.load());
+  std::cout << std::format("{:<8} {:>10} {:>9} {:>9} {:>9} {:>9} {:>9}\n",
+                           "topics", "frames", "p50 ms", "p90 ms", "p99 ms",
+                           "p99.9 ms", "max ms");
+  print_latency("shared", probes.shared);
+  print_latency("private", probes.user);
+
+  for (auto& ws : connections) {
+    if (ws) {
+      ws->stop();
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,339 @@
+/**
+ * Offer acceptance under contention: many concurrent acceptances of
+ * different offers on one post, the previous multi statement transaction
+ * against offer_statements::ACCEPT_OFFER.
+ *
+ * Usage: offer_accept_bench --pg "postgresql://..." [--offers N]
+ *                           [--rounds N] [--negotiations N]
+ * Needs a database with migrations/001_complete_schema.sql applied (the
+ * test database works). Every round resets one post to N pending offers with
+ * pending negotiations, then N connections try to accept one offer each at
+ * the same time. Exactly one acceptance per round is correct; the report
+ * counts rounds where more than one went through and the transactions
+ * aborted by deadlocks. The rows created are deleted on exit.
+ */
+#include <libpq-fe.h>
+
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../controllers/offer_statements.hpp"
+#include "../utilities/latency_histogram.hpp"
+
+namespace {
+
+using Connection = std::unique_ptr<PGconn, decltype(&PQfinish)>;
+using ResultPtr = std::unique_ptr<PGresult, decltype(&PQclear)>;
+
+enum class Outcome : std::uint8_t { accepted, refused, failed };
+
+struct RoundStats {
+  std::uint64_t accepted = 0;
+  std::uint64_t refused = 0;
+  std::uint64_t failed = 0;  // deadlocks and other errors
+  std::uint64_t double_accepts = 0;  // rounds with more than one acceptance
+};
+
+Connection connect(const std::string& conninfo) {
+  Connection conn(PQconnectdb(conninfo.c_str()), &PQfinish);
+  if (PQstatus(conn.get()) != CONNECTION_OK) {
+    throw std::runtime_error(
+        std::format("connection failed: {}", PQerrorMessage(conn.get())));
+  }
+  return conn;
+}
+
+ResultPtr exec(PGconn* conn, std::string_view sql,
+               const std::vector<std::string>& params = {}) {
+  std::vector<const char*> values;
+  values.reserve(params.size());
+  for (const auto& param : params) {
+    values.push_back(param.c_str());
+  }
+  return ResultPtr(
+      PQexecParams(conn, std::string(sql).c_str(),
+                   static_cast<int>(values.size()), nullptr, values.data(),
+                   nullptr, nullptr, 0),
+      &PQclear);
+}
+
+bool ok(const ResultPtr& result) {
+  const auto status = PQresultStatus(result.get());
+  return status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK;
+}
+
+ResultPtr exec_checked(PGconn* conn, std::string_view sql,
+                       const std::vector<std::string>& params = {}) {
+  auto result = exec(conn, sql, params);
+  if (!ok(result)) {
+    throw std::runtime_error(
+        std::format("{} failed: {}", sql, PQerrorMessage(conn)));
+  }
+  return result;
+}
+
+// The statement sequence Offers::accept_offer used to run, one round trip
+// each, with the status check outside the transaction
+Outcome accept_multi_statement(PGconn* conn, const std::string& offer_id,
+                               const std::string& owner_id) {
+  auto check = exec(conn,
+                    "SELECT o.post_id, p.user_id AS post_owner_id, o.status "
+                    "FROM offers o JOIN posts p ON o.post_id = p.id "
+                    "WHERE o.id = $1",
+                    {offer_id});
+  if (!ok(check) || PQntuples(check.get()) == 0) {
+    return Outcome::failed;
+  }
+  const std::string post_id = PQgetvalue(check.get(), 0, 0);
+  if (std::string_view(PQgetvalue(check.get(), 0, 1)) != owner_id ||
+      std::string_view(PQgetvalue(check.get(), 0, 2)) != "pending") {
+    return Outcome::refused;
+  }
+
+  auto step = [&](std::string_view sql, std::vector<std::string> params) {
+    auto result = exec(conn, sql, params);
+    if (!ok(result)) {
+      throw std::runtime_error(PQerrorMessage(conn));
+    }
+    return result;
+  };
+  try {
+    step("BEGIN", {});
+    step("UPDATE offers SET status = 'accepted', negotiation_status = "
+         "'completed', updated_at = NOW() WHERE id = $1 RETURNING updated_at",
+         {offer_id});
+    auto negotiation =
+        step("SELECT id FROM price_negotiations WHERE offer_id = $1 AND "
+             "status = 'pending' ORDER BY created_at DESC LIMIT 1",
+             {offer_id});
+    if (PQntuples(negotiation.get()) > 0) {
+      const std::string negotiation_id = PQgetvalue(negotiation.get(), 0, 0);
+      step("UPDATE price_negotiations SET status = 'accepted', updated_at = "
+           "NOW() WHERE id = $1",
+           {negotiation_id});
+      step("UPDATE messages SET metadata = jsonb_set(metadata, "
+           "'{offer_status}', '\"accepted\"') WHERE context_id = $1 AND "
+           "context_type = 'negotiation'",
+           {negotiation_id});
+      step("UPDATE price_negotiations SET status = 'rejected', updated_at = "
+           "NOW() WHERE offer_id = $1 AND id != $2 AND status = 'pending' "
+           "RETURNING id",
+           {offer_id, negotiation_id});
+    }
+    auto rejected = step(
+        "UPDATE offers SET status = 'rejected', negotiation_status = "
+        "'completed', updated_at = NOW() WHERE post_id = $1 AND id != $2 "
+        "AND status = 'pending' RETURNING id, updated_at",
+        {post_id, offer_id});
+    for (int i = 0; i < PQntuples(rejected.get()); ++i) {
+      step("UPDATE messages SET metadata = jsonb_set(metadata, "
+           "'{offer_status}', '\"rejected\"') WHERE metadata->>'offer_id' = "
+           "$1 AND context_type = 'negotiation'",
+           {PQgetvalue(rejected.get(), i, 0)});
+    }
+    step("UPDATE price_negotiations pn SET status = 'rejected', updated_at = "
+         "NOW() FROM offers o WHERE pn.offer_id = o.id AND o.post_id = $1 "
+         "AND o.id != $2 AND pn.status = 'pending' RETURNING pn.id",
+         {post_id, offer_id});
+    step("UPDATE posts SET request_status = 'fulfilled' WHERE id = $1",
+         {post_id});
+    step("COMMIT", {});
+    return Outcome::accepted;
+  } catch (const std::runtime_error&) {
+    exec(conn, "ROLLBACK");
+    return Outcome::failed;
+  }
+}
+
+Outcome accept_single_statement(PGconn* conn, const std::string& offer_id,
+                                const std::string& owner_id) {
+  auto result =
+      exec(conn, offer_statements::ACCEPT_OFFER, {offer_id, owner_id});
+  if (!ok(result) || PQntuples(result.get()) == 0) {
+    return Outcome::failed;
+  }
+  return PQgetisnull(result.get(), 0, 2) ? Outcome::refused
+                                         : Outcome::accepted;
+}
+
+struct Fixture {
+  std::string owner_id;
+  std::string bidder_id;
+  std::string post_id;
+  std::vector<std::string> offer_ids;
+};
+
+Fixture create_fixture(PGconn* conn, int offers) {
+  Fixture fixture;
+  const auto suffix = std::to_string(
+      std::chrono::steady_clock::now().time_since_epoch().count());
+  auto user = [&](std::string_view role) {
+    auto result = exec_checked(
+        conn,
+        "INSERT INTO users (username, email, password_hash) "
+        "VALUES ($1, $1::text || '@bench.local', 'x') RETURNING id",
+        {std::format("bench_{}_{}", role, suffix)});
+    return std::string(PQgetvalue(result.get(), 0, 0));
+  };
+  fixture.owner_id = user("owner");
+  fixture.bidder_id = user("bidder");
+  auto post = exec_checked(conn,
+                           "INSERT INTO posts (user_id, content, "
+                           "is_product_request) VALUES ($1, 'bench', true) "
+                           "RETURNING id",
+                           {fixture.owner_id});
+  fixture.post_id = PQgetvalue(post.get(), 0, 0);
+  auto created = exec_checked(
+      conn,
+      "INSERT INTO offers (post_id, user_id, title, description, price, "
+      "original_price) SELECT $1, $2, 'bench', 'bench', 10, 10 "
+      "FROM generate_series(1, $3) RETURNING id",
+      {fixture.post_id, fixture.bidder_id, std::to_string(offers)});
+  for (int i = 0; i < PQntuples(created.get()); ++i) {
+    fixture.offer_ids.emplace_back(PQgetvalue(created.get(), i, 0));
+  }
+  return fixture;
+}
+
+void reset_fixture(PGconn* conn, const Fixture& fixture, int negotiations) {
+  exec_checked(conn,
+               "UPDATE offers SET status = 'pending', negotiation_status = "
+               "'in_progress' WHERE post_id = $1",
+               {fixture.post_id});
+  exec_checked(conn,
+               "DELETE FROM price_negotiations WHERE offer_id IN "
+               "(SELECT id FROM offers WHERE post_id = $1)",
+               {fixture.post_id});
+  exec_checked(conn,
+               "INSERT INTO price_negotiations (offer_id, user_id, "
+               "proposed_price) SELECT o.id, $2, 9 FROM offers o, "
+               "generate_series(1, $3) WHERE o.post_id = $1",
+               {fixture.post_id, fixture.bidder_id,
+                std::to_string(negotiations)});
+  exec_checked(conn,
+               "UPDATE posts SET request_status = 'open' WHERE id = $1",
+               {fixture.post_id});
+}
+
+void drop_fixture(PGconn* conn, const Fixture& fixture) {
+  exec(conn, "DELETE FROM posts WHERE id = $1", {fixture.post_id});
+  exec(conn, "DELETE FROM users WHERE id = $1 OR id = $2",
+       {fixture.owner_id, fixture.bidder_id});
+}
+
+template <typename Accept>
+void run(std::string_view name, Accept accept, const std::string& conninfo,
+         PGconn* admin, const Fixture& fixture, int rounds,
+         int negotiations) {
+  const auto workers = fixture.offer_ids.size();
+  std::vector<Connection> connections;
+  connections.reserve(workers);
+  for (std::size_t i = 0; i < workers; ++i) {
+    connections.push_back(connect(conninfo));
+  }
+
+  utilities::LatencyHistogram latency;
+  RoundStats stats;
+  std::chrono::duration<double> busy{0};
+  for (int round = 0; round < rounds; ++round) {
+    reset_fixture(admin, fixture, negotiations);
+
+    std::atomic<std::uint64_t> accepted{0};
+    std::atomic<std::uint64_t> refused{0};
+    std::atomic<std::uint64_t> failed{0};
+    std::barrier start(static_cast<std::ptrdiff_t>(workers));
+    const auto round_start = std::chrono::steady_clock::now();
+    std::vector<std::jthread> threads;
+    threads.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i) {
+      threads.emplace_back([&, i]() {
+        start.arrive_and_wait();
+        Outcome outcome;
+        {
+          utilities::ScopedLatencyTimer timer(latency);
+          outcome = accept(connections[i].get(), fixture.offer_ids[i],
+                           fixture.owner_id);
+        }
+        auto& counter = outcome == Outcome::accepted  ? accepted
+                        : outcome == Outcome::refused ? refused
+                                                      : failed;
+        counter.fetch_add(1, std::memory_order_relaxed);
+      });
+    }
+    threads.clear();  // joins
+    busy += std::chrono::steady_clock::now() - round_start;
+
+    stats.accepted += accepted;
+    stats.refused += refused;
+    stats.failed += failed;
+    stats.double_accepts += accepted > 1 ? 1 : 0;
+  }
+
+  const auto snapshot = latency.snapshot();
+  std::cout << std::format(
+      "{}: {} rounds x {} acceptances, {:.2f}ms per round, p50 {:.0f}us, "
+      "p99 {:.0f}us, accepted {}, refused {}, failed {}, rounds with more "
+      "than one acceptance {}\n",
+      name, rounds, workers, busy.count() * 1000.0 / rounds, snapshot.p50_us,
+      snapshot.p99_us, stats.accepted, stats.refused, stats.failed,
+      stats.double_accepts);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string conninfo;
+  int offers = 32;
+  int rounds = 50;
+  int negotiations = 2;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--pg" && i + 1 < argc) {
+      conninfo = argv[++i];
+    } else if (arg == "--offers" && i + 1 < argc) {
+      offers = std::max(2, std::stoi(argv[++i]));
+    } else if (arg == "--rounds" && i + 1 < argc) {
+      rounds = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--negotiations" && i + 1 < argc) {
+      negotiations = std::max(0, std::stoi(argv[++i]));
+    } else {
+      std::cerr << std::format("unknown option {}\n", arg);
+      return 1;
+    }
+  }
+  if (conninfo.empty()) {
+    std::cerr << "--pg is required\n";
+    return 1;
+  }
+
+  try {
+    auto admin = connect(conninfo);
+    auto fixture = create_fixture(admin.get(), offers);
+    try {
+      run("multi statement", accept_multi_statement, conninfo, admin.get(),
+          fixture, rounds, negotiations);
+      run("single statement", accept_single_statement, conninfo,
+          admin.get(), fixture, rounds, negotiations);
+    } catch (const std::exception&) {
+      drop_fixture(admin.get(), fixture);
+      throw;
+    }
+    drop_fixture(admin.get(), fixture);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,324 @@
+/**
+ * Offer listings of a power seller: the previous unpaginated
+ * Offers::get_my_offers (every offer, then one media query per offer)
+ * against keyset pages of offer_statements::MY_OFFERS_PAGE with the media of
+ * a page resolved in one query, as the handler now does. The buyer side,
+ * RECEIVED_OFFERS_PAGE, is measured on the same offers.
+ *
+ * Usage: offer_listing_bench --pg "postgresql://..." [--offers N]
+ *                            [--posts N] [--limit N] [--repeats N]
+ *                            [--legacy-runs N]
+ * Needs a database with migrations/001_complete_schema.sql and
+ * migrations/003_offer_listing_indexes.sql applied (the test database
+ * works). Creates one seller with N offers (default 50000) spread over the
+ * posts of one buyer, updated a second apart, with statuses cycling through
+ * pending, accepted and rejected and every tenth offer carrying a media
+ * attachment. The rows created are deleted on exit.
+ */
+#include <libpq-fe.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../controllers/offer_statements.hpp"
+#include "../utilities/latency_histogram.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Connection = std::unique_ptr<PGconn, decltype(&PQfinish)>;
+using ResultPtr = std::unique_ptr<PGresult, decltype(&PQclear)>;
+
+// The queries Offers::get_my_offers and get_media_attachments used to run
+constexpr std::string_view kLegacyMyOffers =
+    "SELECT o.*, p.content as post_content, u.username as "
+    "post_owner_username "
+    "FROM offers o "
+    "JOIN posts p ON o.post_id = p.id "
+    "JOIN users u ON p.user_id = u.id "
+    "WHERE o.user_id = $1 "
+    "ORDER BY o.updated_at DESC";
+
+constexpr std::string_view kLegacyMedia =
+    "SELECT med.id, med.storage_key, med.file_name, med.mime_type, "
+    "med.size, med.metadata -> 'variants' AS variants "
+    "FROM offer_media om "
+    "INNER JOIN media med ON om.media_id = med.id "
+    "WHERE om.offer_id = $1";
+
+// media_attachments_batch_sql("offer")
+constexpr std::string_view kBatchMedia =
+    "SELECT om.offer_id AS owner_id, med.id, med.storage_key, med.file_name, "
+    "med.mime_type, med.size, med.metadata -> 'variants' AS variants "
+    "FROM offer_media om "
+    "INNER JOIN media med ON om.media_id = med.id "
+    "WHERE om.offer_id = ANY($1::int[])";
+
+Connection connect(const std::string& conninfo) {
+  Connection conn(PQconnectdb(conninfo.c_str()), &PQfinish);
+  if (PQstatus(conn.get()) != CONNECTION_OK) {
+    throw std::runtime_error(
+        std::format("connection failed: {}", PQerrorMessage(conn.get())));
+  }
+  return conn;
+}
+
+ResultPtr exec(PGconn* conn, std::string_view sql,
+               const std::vector<std::string>& params = {}) {
+  std::vector<const char*> values;
+  values.reserve(params.size());
+  for (const auto& param : params) {
+    values.push_back(param.c_str());
+  }
+  return ResultPtr(
+      PQexecParams(conn, std::string(sql).c_str(),
+                   static_cast<int>(values.size()), nullptr, values.data(),
+                   nullptr, nullptr, 0),
+      &PQclear);
+}
+
+ResultPtr exec_checked(PGconn* conn, std::string_view sql,
+                       const std::vector<std::string>& params = {}) {
+  auto result = exec(conn, sql, params);
+  const auto status = PQresultStatus(result.get());
+  if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+    throw std::runtime_error(
+        std::format("{} failed: {}", sql, PQerrorMessage(conn)));
+  }
+  return result;
+}
+
+struct Fixture {
+  std::string seller_id;
+  std::string buyer_id;
+};
+
+Fixture create_fixture(PGconn* conn, int offers, int posts) {
+  Fixture fixture;
+  const auto suffix =
+      std::to_string(Clock::now().time_since_epoch().count());
+  auto user = [&](std::string_view role) {
+    auto result = exec_checked(
+        conn,
+        "INSERT INTO users (username, email, password_hash) "
+        "VALUES ($1, $1::text || '@bench.local', 'x') RETURNING id",
+        {std::format("bench_{}_{}", role, suffix)});
+    return std::string(PQgetvalue(result.get(), 0, 0));
+  };
+  fixture.seller_id = user("seller");
+  fixture.buyer_id = user("buyer");
+
+  exec_checked(conn,
+               "INSERT INTO posts (user_id, content, is_product_request) "
+               "SELECT $1, 'bench request ' || g, true "
+               "FROM generate_series(1, $2) g",
+               {fixture.buyer_id, std::to_string(posts)});
+  exec_checked(
+      conn,
+      "WITH post_ids AS ("
+      "  SELECT array_agg(id ORDER BY id) AS ids FROM posts WHERE user_id = $1"
+      ") "
+      "INSERT INTO offers (post_id, user_id, title, description, price, "
+      "original_price, status, created_at, updated_at) "
+      "SELECT ids[g % cardinality(ids) + 1], $2, 'bench offer ' || g, "
+      "'bench', 10, 10, (ARRAY['pending', 'accepted', 'rejected'])[g % 3 + 1], "
+      "NOW() - g * INTERVAL '1 second', NOW() - g * INTERVAL '1 second' "
+      "FROM post_ids, generate_series(1, $3) g",
+      {fixture.buyer_id, fixture.seller_id, std::to_string(offers)});
+  exec_checked(conn,
+               "INSERT INTO media (uploader_id, storage_key, file_name, "
+               "mime_type, size) "
+               "SELECT $1, 'bench/' || $2 || '/' || o.id, 'offer.jpg', "
+               "'image/jpeg', 1024 "
+               "FROM offers o WHERE o.user_id = $1 AND o.id % 10 = 0",
+               {fixture.seller_id, suffix});
+  exec_checked(conn,
+               "INSERT INTO offer_media (offer_id, media_id) "
+               "SELECT split_part(storage_key, '/', 3)::int, id "
+               "FROM media WHERE uploader_id = $1",
+               {fixture.seller_id});
+  exec_checked(conn, "ANALYZE offers");
+  exec_checked(conn, "ANALYZE posts");
+  exec_checked(conn, "ANALYZE offer_media");
+  return fixture;
+}
+
+void drop_fixture(PGconn* conn, const Fixture& fixture) {
+  exec(conn, "DELETE FROM media WHERE uploader_id = $1", {fixture.seller_id});
+  exec(conn, "DELETE FROM posts WHERE user_id = $1", {fixture.buyer_id});
+  exec(conn, "DELETE FROM users WHERE id = $1 OR id = $2",
+       {fixture.seller_id, fixture.buyer_id});
+}
+
+struct Cursor {
+  std::string updated_us =
+      std::to_string(offer_statements::FIRST_PAGE_UPDATED_US);
+  std::string id = std::to_string(INT_MAX);
+};
+
+// One request of the handler: a page one row past the limit, then the
+// media of the page's offers in one query. Returns the next page's cursor,
+// or std::nullopt on the last page.
+std::optional<Cursor> fetch_page(PGconn* conn, std::string_view page_sql,
+                                 const std::string& user_id,
+                                 const Cursor& cursor,
+                                 const std::string& statuses, int limit) {
+  auto page = exec_checked(conn, page_sql,
+                           {user_id, cursor.updated_us, cursor.id, statuses,
+                            std::to_string(limit + 1)});
+  const int rows = std::min(PQntuples(page.get()), limit);
+  const int id_column = PQfnumber(page.get(), "id");
+  const int updated_column = PQfnumber(page.get(), "updated_us");
+  std::string ids = "{";
+  for (int i = 0; i < rows; ++i) {
+    if (i > 0) {
+      ids += ",";
+    }
+    ids += PQgetvalue(page.get(), i, id_column);
+  }
+  ids += "}";
+  if (rows > 0) {
+    exec_checked(conn, kBatchMedia, {ids});
+  }
+  if (PQntuples(page.get()) <= limit) {
+    return std::nullopt;
+  }
+  return Cursor{.updated_us = PQgetvalue(page.get(), rows - 1, updated_column),
+                .id = PQgetvalue(page.get(), rows - 1, id_column)};
+}
+
+void report(std::string_view name, const utilities::LatencyHistogram& latency,
+            std::string_view extra = {}) {
+  const auto snapshot = latency.snapshot();
+  std::cout << std::format(
+      "{}: {} requests, mean {:.0f}us, p50 {:.0f}us, p99 {:.0f}us{}\n", name,
+      snapshot.count,
+      snapshot.count == 0 ? 0.0
+                          : static_cast<double>(snapshot.sum_us) /
+                                static_cast<double>(snapshot.count),
+      snapshot.p50_us, snapshot.p99_us, extra);
+}
+
+void run_legacy(PGconn* conn, const Fixture& fixture, int runs) {
+  utilities::LatencyHistogram latency;
+  std::size_t offers = 0;
+  for (int run = 0; run < runs; ++run) {
+    utilities::ScopedLatencyTimer timer(latency);
+    auto listing = exec_checked(conn, kLegacyMyOffers, {fixture.seller_id});
+    offers = static_cast<std::size_t>(PQntuples(listing.get()));
+    const int id_column = PQfnumber(listing.get(), "id");
+    for (int i = 0; i < PQntuples(listing.get()); ++i) {
+      exec_checked(conn, kLegacyMedia,
+                   {PQgetvalue(listing.get(), i, id_column)});
+    }
+  }
+  report("my offers, unpaginated + media per offer", latency,
+         std::format(", {} offers and {} queries per request", offers,
+                     offers + 1));
+}
+
+void run_first_page(std::string_view name, PGconn* conn,
+                    std::string_view page_sql, const std::string& user_id,
+                    const std::string& statuses, int limit, int repeats) {
+  utilities::LatencyHistogram latency;
+  for (int i = 0; i < repeats; ++i) {
+    utilities::ScopedLatencyTimer timer(latency);
+    fetch_page(conn, page_sql, user_id, Cursor{}, statuses, limit);
+  }
+  report(name, latency);
+}
+
+// Follows next cursors to the end, the deepest pages cost the same as the
+// first with keyset pagination
+void run_walk(std::string_view name, PGconn* conn, std::string_view page_sql,
+              const std::string& user_id, int limit) {
+  utilities::LatencyHistogram latency;
+  const auto start = Clock::now();
+  std::optional<Cursor> cursor = Cursor{};
+  while (cursor) {
+    utilities::ScopedLatencyTimer timer(latency);
+    cursor = fetch_page(conn, page_sql, user_id, *cursor, "{}", limit);
+  }
+  const std::chrono::duration<double, std::milli> total = Clock::now() - start;
+  report(name, latency,
+         std::format(", {:.0f}ms for every page", total.count()));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string conninfo;
+  int offers = 50000;
+  int posts = 200;
+  int limit = 20;
+  int repeats = 200;
+  int legacy_runs = 1;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--pg" && i + 1 < argc) {
+      conninfo = argv[++i];
+    } else if (arg == "--offers" && i + 1 < argc) {
+      offers = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--posts" && i + 1 < argc) {
+      posts = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--limit" && i + 1 < argc) {
+      limit = std::clamp(std::stoi(argv[++i]), 1, 100);
+    } else if (arg == "--repeats" && i + 1 < argc) {
+      repeats = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--legacy-runs" && i + 1 < argc) {
+      legacy_runs = std::max(0, std::stoi(argv[++i]));
+    } else {
+      std::cerr << std::format("unknown option {}\n", arg);
+      return 1;
+    }
+  }
+  if (conninfo.empty()) {
+    std::cerr << "--pg is required\n";
+    return 1;
+  }
+
+  try {
+    auto conn = connect(conninfo);
+    auto fixture = create_fixture(conn.get(), offers, posts);
+    try {
+      std::cout << std::format("{} offers over {} posts, pages of {}\n",
+                               offers, posts, limit);
+      if (legacy_runs > 0) {
+        run_legacy(conn.get(), fixture, legacy_runs);
+      }
+      run_first_page("my offers, first page", conn.get(),
+                     offer_statements::MY_OFFERS_PAGE, fixture.seller_id,
+                     "{}", limit, repeats);
+      run_first_page("my offers, first accepted page", conn.get(),
+                     offer_statements::MY_OFFERS_PAGE, fixture.seller_id,
+                     "{accepted}", limit, repeats);
+      run_walk("my offers, every page", conn.get(),
+               offer_statements::MY_OFFERS_PAGE, fixture.seller_id, limit);
+      run_first_page("received offers, first page", conn.get(),
+                     offer_statements::RECEIVED_OFFERS_PAGE,
+                     fixture.buyer_id, "{}", limit, repeats);
+      run_walk("received offers, every page", conn.get(),
+               offer_statements::RECEIVED_OFFERS_PAGE, fixture.buyer_id,
+               limit);
+    } catch (const std::exception&) {
+      drop_fixture(conn.get(), fixture);
+      throw;
+    }
+    drop_fixture(conn.get(), fixture);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,524 @@
+/**
+ * Handler latency under network round trip time: the statements of
+ * Offers::get_offer, Chats::get_conversation_by_offer (existing
+ * conversation) and Offers::create_offer (no media) sent one at a time, as
+ * the handlers used to, against the same work sent as one pipeline, as
+ * utilities::pipeline() does with auto_batch.
+ *
+ * Usage: pipeline_bench --pg "postgresql://..." [--rtt-ms N]
+ *                       [--iterations N]
+ * Needs a database with migrations/001_complete_schema.sql applied (the
+ * test database works) reachable over TCP. Connections go through an
+ * in-process proxy that holds every chunk for half the RTT in each
+ * direction. The rows created are deleted on exit.
+ */
+#include <arpa/inet.h>
+#include <libpq-fe.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../controllers/offer_statements.hpp"
+#include "../utilities/latency_histogram.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Connection = std::unique_ptr<PGconn, decltype(&PQfinish)>;
+using ResultPtr = std::unique_ptr<PGresult, decltype(&PQclear)>;
+
+struct Query {
+  std::string_view sql;
+  std::vector<std::string> params;
+};
+
+// Forwards TCP connections to the database, delaying each direction
+class DelayProxy {
+ public:
+  DelayProxy(const std::string& host, const std::string& port,
+             std::chrono::microseconds one_way)
+      : one_way_(one_way) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0 ||
+        found == nullptr) {
+      throw std::runtime_error(std::format("cannot resolve {}", host));
+    }
+    upstream_.assign(reinterpret_cast<const char*>(found->ai_addr),
+                     found->ai_addrlen);
+    upstream_family_ = found->ai_family;
+    freeaddrinfo(found);
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if (listen_fd_ < 0 ||
+        bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), len) != 0 ||
+        listen(listen_fd_, 16) != 0 ||
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len) !=
+            0) {
+      throw std::runtime_error("cannot listen on the loopback interface");
+    }
+    port_ = ntohs(addr.sin_port);
+    acceptor_ = std::jthread([this]() { accept_loop(); });
+  }
+
+  DelayProxy(const DelayProxy&) = delete;
+  DelayProxy& operator=(const DelayProxy&) = delete;
+
+  ~DelayProxy() {
+    shutdown(listen_fd_, SHUT_RDWR);
+    acceptor_ = {};  // joins
+    close(listen_fd_);
+    std::lock_guard<std::mutex> lock(links_mutex_);
+    links_.clear();
+  }
+
+  std::uint16_t port() const { return port_; }
+
+ private:
+  // Chunks read from one side, sent to the other once due
+  struct Direction {
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::pair<Clock::time_point, std::string>> chunks;
+    bool closed = false;
+  };
+
+  struct Link {
+    Link(int client, int server) : client_fd(client), server_fd(server) {}
+    ~Link() {
+      shutdown(client_fd, SHUT_RDWR);
+      shutdown(server_fd, SHUT_RDWR);
+      threads.clear();  // joins
+      close(client_fd);
+      close(server_fd);
+    }
+
+    int client_fd;
+    int server_fd;
+    Direction to_server;
+    Direction to_client;
+    std::vector<std::jthread> threads;
+  };
+
+  static void read_side(int from, Direction& direction,
+                        std::chrono::microseconds delay) {
+    std::array<char, 16384> buffer;
+    while (true) {
+      const auto n = recv(from, buffer.data(), buffer.size(), 0);
+      std::lock_guard<std::mutex> lock(direction.mutex);
+      if (n <= 0) {
+        direction.closed = true;
+        direction.ready.notify_one();
+        return;
+      }
+      direction.chunks.emplace_back(
+          Clock::now() + delay,
+          std::string(buffer.data(), static_cast<std::size_t>(n)));
+      direction.ready.notify_one();
+    }
+  }
+
+  static void write_side(int to, Direction& direction) {
+    std::unique_lock<std::mutex> lock(direction.mutex);
+    while (true) {
+      direction.ready.wait(lock, [&direction]() {
+        return direction.closed || !direction.chunks.empty();
+      });
+      if (direction.chunks.empty()) {
+        shutdown(to, SHUT_WR);
+        return;
+      }
+      auto [due, data] = std::move(direction.chunks.front());
+      direction.chunks.pop_front();
+      lock.unlock();
+      std::this_thread::sleep_until(due);
+      std::size_t sent = 0;
+      while (sent < data.size()) {
+        const auto n =
+            send(to, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+          break;
+        }
+        sent += static_cast<std::size_t>(n);
+      }
+      lock.lock();
+    }
+  }
+
+  void accept_loop() {
+    while (true) {
+      const int client = accept(listen_fd_, nullptr, nullptr);
+      if (client < 0) {
+        return;  // closed by the destructor
+      }
+      const int server = socket(upstream_family_, SOCK_STREAM, 0);
+      if (server < 0 ||
+          connect(server, reinterpret_cast<const sockaddr*>(upstream_.data()),
+                  static_cast<socklen_t>(upstream_.size())) != 0) {
+        close(client);
+        if (server >= 0) {
+          close(server);
+        }
+        continue;
+      }
+      const int one = 1;
+      setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      setsockopt(server, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+      auto link = std::make_unique<Link>(client, server);
+      auto& ref = *link;
+      ref.threads.emplace_back([&ref, this]() {
+        read_side(ref.client_fd, ref.to_server, one_way_);
+      });
+      ref.threads.emplace_back(
+          [&ref]() { write_side(ref.server_fd, ref.to_server); });
+      ref.threads.emplace_back([&ref, this]() {
+        read_side(ref.server_fd, ref.to_client, one_way_);
+      });
+      ref.threads.emplace_back(
+          [&ref]() { write_side(ref.client_fd, ref.to_client); });
+      std::lock_guard<std::mutex> lock(links_mutex_);
+      links_.push_back(std::move(link));
+    }
+  }
+
+  const std::chrono::microseconds one_way_;
+  std::string upstream_;  // sockaddr bytes
+  int upstream_family_ = AF_INET;
+  int listen_fd_ = -1;
+  std::uint16_t port_ = 0;
+  std::mutex links_mutex_;
+  std::vector<std::unique_ptr<Link>> links_;
+  std::jthread acceptor_;
+};
+
+Connection connect(const std::string& conninfo) {
+  Connection conn(PQconnectdb(conninfo.c_str()), &PQfinish);
+  if (PQstatus(conn.get()) != CONNECTION_OK) {
+    throw std::runtime_error(
+        std::format("connection failed: {}", PQerrorMessage(conn.get())));
+  }
+  return conn;
+}
+
+// Same database and credentials, through the proxy
+Connection connect_through(const std::string& conninfo, std::uint16_t port) {
+  const std::string port_string = std::to_string(port);
+  const char* keywords[] = {"dbname", "host", "hostaddr", "port", nullptr};
+  const char* values[] = {conninfo.c_str(), "127.0.0.1", "127.0.0.1",
+                          port_string.c_str(), nullptr};
+  Connection conn(PQconnectdbParams(keywords, values, 1), &PQfinish);
+  if (PQstatus(conn.get()) != CONNECTION_OK) {
+    throw std::runtime_error(std::format("proxied connection failed: {}",
+                                         PQerrorMessage(conn.get())));
+  }
+  return conn;
+}
+
+bool ok(const PGresult* result) {
+  const auto status = PQresultStatus(result);
+  return status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK;
+}
+
+std::vector<const char*> param_values(const Query& query) {
+  std::vector<const char*> values;
+  values.reserve(query.params.size());
+  for (const auto& param : query.params) {
+    values.push_back(param.c_str());
+  }
+  return values;
+}
+
+// One round trip
+ResultPtr exec(PGconn* conn, const Query& query) {
+  const auto values = param_values(query);
+  ResultPtr result(
+      PQexecParams(conn, std::string(query.sql).c_str(),
+                   static_cast<int>(values.size()), nullptr, values.data(),
+                   nullptr, nullptr, 0),
+      &PQclear);
+  if (!ok(result.get())) {
+    throw std::runtime_error(
+        std::format("{} failed: {}", query.sql, PQerrorMessage(conn)));
+  }
+  return result;
+}
+
+// All queries, then a single sync: one round trip for the lot
+std::vector<ResultPtr> exec_pipelined(PGconn* conn,
+                                      const std::vector<Query>& queries) {
+  if (PQenterPipelineMode(conn) != 1) {
+    throw std::runtime_error("cannot enter pipeline mode");
+  }
+  for (const auto& query : queries) {
+    const auto values = param_values(query);
+    if (PQsendQueryParams(conn, std::string(query.sql).c_str(),
+                          static_cast<int>(values.size()), nullptr,
+                          values.data(), nullptr, nullptr, 0) != 1) {
+      throw std::runtime_error(PQerrorMessage(conn));
+    }
+  }
+  PQpipelineSync(conn);
+
+  std::vector<ResultPtr> results;
+  results.reserve(queries.size());
+  std::string error;
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    ResultPtr result(PQgetResult(conn), &PQclear);
+    if (error.empty() && (!result || !ok(result.get()))) {
+      error = PQerrorMessage(conn);
+    }
+    results.push_back(std::move(result));
+    while (PGresult* rest = PQgetResult(conn)) {
+      PQclear(rest);
+    }
+  }
+  // PGRES_PIPELINE_SYNC
+  ResultPtr sync(PQgetResult(conn), &PQclear);
+  PQexitPipelineMode(conn);
+  if (!error.empty()) {
+    throw std::runtime_error(error);
+  }
+  return results;
+}
+
+struct Fixture {
+  std::string owner_id;
+  std::string bidder_id;
+  std::string post_id;
+  std::string offer_id;
+};
+
+Fixture create_fixture(PGconn* conn) {
+  Fixture fixture;
+  const auto suffix =
+      std::to_string(Clock::now().time_since_epoch().count());
+  auto user = [&](std::string_view role) {
+    auto result = exec(conn, {"INSERT INTO users (username, email, "
+                              "password_hash) VALUES ($1, $1::text || "
+                              "'@bench.local', 'x') RETURNING id",
+                              {std::format("bench_{}_{}", role, suffix)}});
+    return std::string(PQgetvalue(result.get(), 0, 0));
+  };
+  fixture.owner_id = user("owner");
+  fixture.bidder_id = user("bidder");
+  auto post = exec(conn, {"INSERT INTO posts (user_id, content, "
+                          "is_product_request) VALUES ($1, 'bench', true) "
+                          "RETURNING id",
+                          {fixture.owner_id}});
+  fixture.post_id = PQgetvalue(post.get(), 0, 0);
+  auto offer = exec(conn, {"INSERT INTO offers (post_id, user_id, title, "
+                           "description, price, original_price) VALUES "
+                           "($1, $2, 'bench', 'bench', 10, 10) RETURNING id",
+                           {fixture.post_id, fixture.bidder_id}});
+  fixture.offer_id = PQgetvalue(offer.get(), 0, 0);
+  exec(conn, {"WITH c AS (INSERT INTO conversations (name) VALUES "
+              "('bench') RETURNING id) "
+              "INSERT INTO conversation_participants (conversation_id, "
+              "user_id) SELECT c.id, u FROM c, unnest(ARRAY[$1::int, "
+              "$2::int]) AS u",
+              {fixture.owner_id, fixture.bidder_id}});
+  return fixture;
+}
+
+void drop_fixture(PGconn* conn, const Fixture& fixture) {
+  PQclear(PQexecParams(
+      conn,
+      "DELETE FROM conversations WHERE id IN (SELECT conversation_id FROM "
+      "conversation_participants WHERE user_id = $1::int)",
+      1, nullptr, std::array{fixture.bidder_id.c_str()}.data(), nullptr,
+      nullptr, 0));
+  PQclear(PQexecParams(conn, "DELETE FROM posts WHERE id = $1::int", 1,
+                       nullptr, std::array{fixture.post_id.c_str()}.data(),
+                       nullptr, nullptr, 0));
+  PQclear(PQexecParams(
+      conn, "DELETE FROM users WHERE id = $1::int OR id = $2::int", 2,
+      nullptr,
+      std::array{fixture.owner_id.c_str(), fixture.bidder_id.c_str()}.data(),
+      nullptr, nullptr, 0));
+}
+
+constexpr std::string_view OFFER_SQL =
+    "SELECT o.*, u.username, p.user_id as post_owner_id FROM offers o "
+    "JOIN users u ON o.user_id = u.id JOIN posts p ON o.post_id = p.id "
+    "WHERE o.id = $1";
+constexpr std::string_view OFFER_MEDIA_SQL =
+    "SELECT med.id, med.storage_key, med.file_name, med.mime_type, "
+    "med.size, med.metadata -> 'variants' AS variants FROM offer_media om "
+    "INNER JOIN media med ON om.media_id = med.id WHERE om.offer_id = $1";
+constexpr std::string_view OFFER_PARTIES_SQL =
+    "SELECT o.user_id, p.user_id AS post_user_id FROM offers o "
+    "JOIN posts p ON o.post_id = p.id WHERE o.id = $1";
+constexpr std::string_view PREVIOUS_CONVERSATION_SQL =
+    "SELECT c.id FROM conversations c "
+    "JOIN conversation_participants cp1 ON c.id = cp1.conversation_id "
+    "JOIN conversation_participants cp2 ON c.id = cp2.conversation_id "
+    "WHERE cp1.user_id = $1 AND cp2.user_id = $2 LIMIT 1";
+constexpr std::string_view OFFER_CONVERSATION_SQL =
+    "SELECT cp1.conversation_id AS id FROM offers o "
+    "JOIN posts p ON o.post_id = p.id "
+    "JOIN conversation_participants cp1 ON cp1.user_id = $2 "
+    "JOIN conversation_participants cp2 "
+    "ON cp2.conversation_id = cp1.conversation_id "
+    "AND cp2.user_id = CASE WHEN o.user_id = $2 "
+    "THEN p.user_id ELSE o.user_id END "
+    "WHERE o.id = $1 LIMIT 1";
+constexpr std::string_view POST_OWNER_SQL =
+    "SELECT user_id FROM posts WHERE id = $1";
+
+struct Scenario {
+  std::string_view name;
+  std::function<void(PGconn*, const Fixture&)> sequential;
+  std::function<void(PGconn*, const Fixture&)> pipelined;
+};
+
+std::vector<Scenario> scenarios() {
+  return {
+      {"get_offer",
+       [](PGconn* conn, const Fixture& f) {
+         exec(conn, {OFFER_SQL, {f.offer_id}});
+         exec(conn, {OFFER_MEDIA_SQL, {f.offer_id}});
+       },
+       [](PGconn* conn, const Fixture& f) {
+         exec_pipelined(conn, {{OFFER_SQL, {f.offer_id}},
+                               {OFFER_MEDIA_SQL, {f.offer_id}}});
+       }},
+      {"get_conversation_by_offer",
+       [](PGconn* conn, const Fixture& f) {
+         auto parties = exec(conn, {OFFER_PARTIES_SQL, {f.offer_id}});
+         exec(conn, {PREVIOUS_CONVERSATION_SQL,
+                     {f.bidder_id, PQgetvalue(parties.get(), 0, 1)}});
+       },
+       [](PGconn* conn, const Fixture& f) {
+         exec_pipelined(conn,
+                        {{OFFER_PARTIES_SQL, {f.offer_id}},
+                         {OFFER_CONVERSATION_SQL, {f.offer_id, f.bidder_id}}});
+       }},
+      {"create_offer",
+       [](PGconn* conn, const Fixture& f) {
+         exec(conn, {POST_OWNER_SQL, {f.post_id}});
+         exec(conn, {"BEGIN", {}});
+         auto offer = exec(
+             conn, {"INSERT INTO offers (post_id, user_id, title, "
+                    "description, price, original_price, is_public, status) "
+                    "VALUES ($1, $2, 'bench', 'bench', 10, 10, true, "
+                    "'pending') RETURNING id, created_at",
+                    {f.post_id, f.bidder_id}});
+         exec(conn, {"INSERT INTO offer_notifications (offer_id, user_id, "
+                     "is_read) VALUES ($1, $2, FALSE)",
+                     {PQgetvalue(offer.get(), 0, 0), f.owner_id}});
+         exec(conn, {"COMMIT", {}});
+       },
+       [](PGconn* conn, const Fixture& f) {
+         exec_pipelined(
+             conn, {{POST_OWNER_SQL, {f.post_id}},
+                    {offer_statements::CREATE_OFFER,
+                     {f.post_id, f.bidder_id, "bench", "bench", "10", "t"}}});
+       }},
+  };
+}
+
+void run(const Scenario& scenario, PGconn* conn, const Fixture& fixture,
+         int iterations) {
+  utilities::LatencyHistogram sequential;
+  utilities::LatencyHistogram pipelined;
+  // Interleaved so drift in the server affects both alike
+  for (int i = 0; i < iterations; ++i) {
+    {
+      utilities::ScopedLatencyTimer timer(sequential);
+      scenario.sequential(conn, fixture);
+    }
+    {
+      utilities::ScopedLatencyTimer timer(pipelined);
+      scenario.pipelined(conn, fixture);
+    }
+  }
+  const auto before = sequential.snapshot();
+  const auto after = pipelined.snapshot();
+  std::cout << std::format(
+      "{}: sequential p50 {:.2f}ms p99 {:.2f}ms, pipelined p50 {:.2f}ms "
+      "p99 {:.2f}ms, {:.1f}x\n",
+      scenario.name, before.p50_us / 1000.0, before.p99_us / 1000.0,
+      after.p50_us / 1000.0, after.p99_us / 1000.0,
+      after.p50_us > 0 ? before.p50_us / after.p50_us : 0.0);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string conninfo;
+  int rtt_ms = 10;
+  int iterations = 100;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--pg" && i + 1 < argc) {
+      conninfo = argv[++i];
+    } else if (arg == "--rtt-ms" && i + 1 < argc) {
+      rtt_ms = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--iterations" && i + 1 < argc) {
+      iterations = std::max(1, std::stoi(argv[++i]));
+    } else {
+      std::cerr << std::format("unknown option {}\n", arg);
+      return 1;
+    }
+  }
+  if (conninfo.empty()) {
+    std::cerr << "--pg is required\n";
+    return 1;
+  }
+
+  try {
+    auto admin = connect(conninfo);
+    const std::string host = PQhost(admin.get());
+    if (host.empty() || host.front() == '/') {
+      throw std::runtime_error("--pg must connect over TCP, e.g. host=...");
+    }
+    auto fixture = create_fixture(admin.get());
+    try {
+      DelayProxy proxy(host, PQport(admin.get()),
+                       std::chrono::microseconds(rtt_ms * 500));
+      auto conn = connect_through(conninfo, proxy.port());
+      std::cout << std::format("simulated RTT {}ms, {} iterations\n", rtt_ms,
+                               iterations);
+      for (const auto& scenario : scenarios()) {
+        run(scenario, conn.get(), fixture, iterations);
+      }
+    } catch (const std::exception&) {
+      drop_fixture(admin.get(), fixture);
+      throw;
+    }
+    drop_fixture(admin.get(), fixture);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,380 @@
+/**
+ * Row to JSON cost of Community::get_posts and Chats::get_messages: the
+ * previous per handler copies (row["column"].as<std::string>() into owning
+ * structs) against utilities::RowMapper views, both serialized with
+ * glz::write_json. Reports heap allocations and time per row.
+ *
+ * Usage: row_mapping_bench [--rows N] [--iterations N]
+ * Needs no database: rows live in an in-memory result with the interface of
+ * drogon::orm::Result. Field::as<T>() mirrors drogon's text format reads
+ * (std::stringstream for numbers) and name lookups scan the column names
+ * like PQfnumber. Media lists are left out, they are the same either way.
+ */
+#include <glaze/glaze.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../utilities/conversion.hpp"
+#include "../utilities/row_mapping.hpp"
+
+namespace {
+
+std::size_t allocations = 0;
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+class MemoryResult;
+
+class MemoryField {
+ public:
+  MemoryField(const std::optional<std::string>* value) : value_(value) {}
+
+  bool isNull() const { return !value_->has_value(); }
+
+  template <typename T>
+  T as() const {
+    if constexpr (std::same_as<T, std::string>) {
+      return isNull() ? std::string() : **value_;
+    } else if constexpr (std::same_as<T, std::string_view>) {
+      return isNull() ? std::string_view() : std::string_view(**value_);
+    } else if constexpr (std::same_as<T, bool>) {
+      return !isNull() && (**value_ == "t" || **value_ == "1");
+    } else {
+      T value{};
+      if (!isNull()) {
+        std::stringstream ss(**value_);
+        ss >> value;
+      }
+      return value;
+    }
+  }
+
+ private:
+  const std::optional<std::string>* value_;
+};
+
+class MemoryRow {
+ public:
+  MemoryRow(const MemoryResult& result, std::size_t row)
+      : result_(result), row_(row) {}
+
+  MemoryField operator[](std::size_t column) const;
+  MemoryField operator[](const char* name) const;
+
+ private:
+  const MemoryResult& result_;
+  std::size_t row_;
+};
+
+class MemoryResult {
+ public:
+  std::vector<std::string> columns;
+  std::vector<std::vector<std::optional<std::string>>> rows;
+
+  std::size_t columnNumber(const char* name) const {
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+      if (columns[i] == name) {
+        return i;
+      }
+    }
+    throw std::out_of_range(name);
+  }
+
+  std::size_t size() const { return rows.size(); }
+  MemoryRow operator[](std::size_t row) const { return {*this, row}; }
+};
+
+MemoryField MemoryRow::operator[](std::size_t column) const {
+  return {&result_.rows[row_][column]};
+}
+
+MemoryField MemoryRow::operator[](const char* name) const {
+  return (*this)[result_.columnNumber(name)];
+}
+
+// Community::get_posts before and after
+
+struct LegacyPost {
+  int id;
+  int user_id;
+  std::string username;
+  std::string content;
+  std::string created_at;
+  std::vector<std::string> tags;
+  std::string location;
+  bool is_product_request;
+  std::string request_status;
+  std::string price_range;
+  int subscription_count;
+  bool is_subscribed;
+};
+
+struct PostView {
+  int id;
+  int user_id;
+  std::string_view username;
+  std::string_view content;
+  std::string_view created_at;
+  std::vector<std::string_view> tags;
+  std::string_view location;
+  bool is_product_request;
+  std::string_view request_status;
+  std::string_view price_range;
+  int subscription_count;
+  bool is_subscribed;
+
+  static constexpr auto columns = std::tuple{
+      utilities::column("id", &PostView::id),
+      utilities::column("user_id", &PostView::user_id),
+      utilities::column("username", &PostView::username),
+      utilities::column("content", &PostView::content),
+      utilities::column("created_at", &PostView::created_at),
+      utilities::column("tags", &PostView::tags),
+      utilities::column("location", &PostView::location),
+      utilities::column("is_product_request", &PostView::is_product_request),
+      utilities::column("request_status", &PostView::request_status),
+      utilities::column("price_range", &PostView::price_range),
+      utilities::column("subscription_count", &PostView::subscription_count),
+      utilities::column("is_subscribed", &PostView::is_subscribed)};
+};
+
+LegacyPost legacy_post(const MemoryRow& row) {
+  return {.id = row["id"].as<int>(),
+          .user_id = row["user_id"].as<int>(),
+          .username = row["username"].as<std::string>(),
+          .content = row["content"].as<std::string>(),
+          .created_at = row["created_at"].as<std::string>(),
+          .tags = convert::pgsql_array_string_to_vector(
+              row["tags"].as<std::string>()),
+          .location = row["location"].isNull()
+                          ? ""
+                          : row["location"].as<std::string>(),
+          .is_product_request = row["is_product_request"].as<bool>(),
+          .request_status = row["request_status"].as<std::string>(),
+          .price_range = row["price_range"].isNull()
+                             ? ""
+                             : row["price_range"].as<std::string>(),
+          .subscription_count = row["subscription_count"].as<int>(),
+          .is_subscribed = row["is_subscribed"].as<bool>()};
+}
+
+// Chats::get_messages before and after
+
+struct LegacyMessage {
+  int id;
+  int sender_id;
+  std::string sender_name;
+  std::string content;
+  std::string message_type;
+  bool is_read;
+  std::string created_at;
+  std::string metadata;
+};
+
+struct MessageView {
+  int id;
+  int sender_id;
+  std::string_view sender_name;
+  std::string_view content;
+  std::string_view message_type;
+  bool is_read;
+  std::string_view created_at;
+  std::string_view metadata;
+
+  static constexpr auto columns = std::tuple{
+      utilities::column("id", &MessageView::id),
+      utilities::column("sender_id", &MessageView::sender_id),
+      utilities::column("sender_name", &MessageView::sender_name),
+      utilities::column("content", &MessageView::content),
+      utilities::column("message_type", &MessageView::message_type),
+      utilities::column("is_read", &MessageView::is_read),
+      utilities::column("created_at", &MessageView::created_at),
+      utilities::column("metadata", &MessageView::metadata)};
+};
+
+LegacyMessage legacy_message(const MemoryRow& row) {
+  return {.id = row["id"].as<int>(),
+          .sender_id = row["sender_id"].as<int>(),
+          .sender_name = row["sender_name"].as<std::string>(),
+          .content = row["content"].as<std::string>(),
+          .message_type = row["message_type"].as<std::string>(),
+          .is_read = row["is_read"].as<bool>(),
+          .created_at = row["created_at"].as<std::string>(),
+          .metadata = row["metadata"].as<std::string>()};
+}
+
+// Columns in the order of the handlers' queries
+MemoryResult make_posts(std::size_t rows) {
+  MemoryResult result;
+  result.columns = {"id",
+                    "user_id",
+                    "content",
+                    "created_at",
+                    "tags",
+                    "location",
+                    "is_product_request",
+                    "request_status",
+                    "price_range",
+                    "username",
+                    "subscription_count",
+                    "is_subscribed"};
+  for (std::size_t i = 0; i < rows; ++i) {
+    result.rows.push_back(
+        {std::to_string(i + 1), std::to_string(i % 97 + 1),
+         std::format("Looking for a second hand road bike, size 56, budget "
+                     "around 400, post {}",
+                     i),
+         "2026-10-18 09:41:27.123456", "{bikes,cycling,second-hand}",
+         i % 3 == 0 ? std::optional<std::string>()
+                    : std::optional<std::string>("Lagos, Nigeria"),
+         "t", "open", "$300-$450", std::format("member_{}", i % 97),
+         std::to_string(i % 13), i % 2 == 0 ? "t" : "f"});
+  }
+  return result;
+}
+
+MemoryResult make_messages(std::size_t rows) {
+  MemoryResult result;
+  result.columns = {"id",           "sender_id", "sender_name", "content",
+                    "message_type", "is_read",   "created_at",  "metadata"};
+  for (std::size_t i = 0; i < rows; ++i) {
+    result.rows.push_back(
+        {std::to_string(i + 1), std::to_string(i % 2 + 1),
+         i % 2 == 0 ? "buyer_account" : "seller_account",
+         std::format("Is the bike still available? I can pick it up "
+                     "tomorrow, message {}",
+                     i),
+         "text", "t", "2026-10-18 09:41:27.123456", "{}"});
+  }
+  return result;
+}
+
+struct Measure {
+  double allocations_per_row = 0;
+  double ns_per_row = 0;
+  std::size_t bytes = 0;
+};
+
+template <typename Run>
+Measure measure(const MemoryResult& result, int iterations, Run run) {
+  std::string json;
+  run(result, json);  // warm up
+  const auto allocations_before = allocations;
+  const auto start = Clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    run(result, json);
+  }
+  const auto elapsed = Clock::now() - start;
+  const double rows = static_cast<double>(result.size()) * iterations;
+  return {.allocations_per_row =
+              static_cast<double>(allocations - allocations_before) / rows,
+          .ns_per_row =
+              std::chrono::duration<double, std::nano>(elapsed).count() / rows,
+          .bytes = json.size()};
+}
+
+void report(std::string_view name, const Measure& legacy,
+            const Measure& mapped) {
+  std::cout << std::format(
+      "{}: copies {:.1f} allocations and {:.0f}ns per row, mapper {:.1f} "
+      "allocations and {:.0f}ns per row ({} bytes of JSON, {})\n",
+      name, legacy.allocations_per_row, legacy.ns_per_row,
+      mapped.allocations_per_row, mapped.ns_per_row, mapped.bytes,
+      legacy.bytes == mapped.bytes ? "same size" : "SIZE MISMATCH");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::size_t rows = 1000;
+  int iterations = 200;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--rows" && i + 1 < argc) {
+      rows = static_cast<std::size_t>(std::max(1, std::stoi(argv[++i])));
+    } else if (arg == "--iterations" && i + 1 < argc) {
+      iterations = std::max(1, std::stoi(argv[++i]));
+    } else {
+      std::cerr << std::format("unknown option {}\n", arg);
+      return 1;
+    }
+  }
+
+  // Each run builds the response body the way the handler does
+  const auto posts = make_posts(rows);
+  report(
+      "get_posts",
+      measure(posts, iterations,
+              [](const MemoryResult& result, std::string& json) {
+                std::vector<LegacyPost> list;
+                list.reserve(result.size());
+                for (std::size_t i = 0; i < result.size(); ++i) {
+                  list.push_back(legacy_post(result[i]));
+                }
+                json = glz::write_json(list).value_or("");
+              }),
+      measure(posts, iterations,
+              [](const MemoryResult& result, std::string& json) {
+                utilities::RowMapper<PostView> to_post(result);
+                std::vector<PostView> list;
+                list.reserve(result.size());
+                for (std::size_t i = 0; i < result.size(); ++i) {
+                  list.push_back(to_post(result[i]));
+                }
+                json = glz::write_json(list).value_or("");
+              }));
+
+  const auto messages = make_messages(rows);
+  report(
+      "get_messages",
+      measure(messages, iterations,
+              [](const MemoryResult& result, std::string& json) {
+                std::vector<LegacyMessage> list;
+                list.reserve(result.size());
+                for (std::size_t i = 0; i < result.size(); ++i) {
+                  list.push_back(legacy_message(result[i]));
+                }
+                json = glz::write_json(list).value_or("");
+              }),
+      measure(messages, iterations,
+              [](const MemoryResult& result, std::string& json) {
+                utilities::RowMapper<MessageView> to_message(result);
+                std::vector<MessageView> list;
+                list.reserve(result.size());
+                for (std::size_t i = 0; i < result.size(); ++i) {
+                  list.push_back(to_message(result[i]));
+                }
+                json = glz::write_json(list).value_or("");
+              }));
+  return 0;
+}
@@ -0,0 +1,1081 @@
+/**
+ * Deterministic seed data for running the benches and the server against
+ * production sized tables: users, posts with a long tailed tag
+ * distribution, offers, price negotiations and their conversations, direct
+ * chats, messages, media rows, post and notification subscriptions and user
+ * locations, bulk loaded with COPY in one transaction.
+ *
+ * Usage: seed_generator [--scale F] [--seed N] [--truncate]
+ *                       (--pg "postgresql://..." | --out DIR)
+ * Scale 1 is 100k users, 300k posts, ~480k offers and ~1.5M messages, every
+ * count grows linearly with it. The same scale and seed always produce the
+ * same rows, ids and timestamps included: draws come from one xoshiro256**
+ * stream per table and only use IEEE exact arithmetic, so results do not
+ * depend on the standard library or libm.
+ *
+ * Needs the schema (migrations 001 to 003) and refuses to load into a
+ * database that already has users unless --truncate is given, which empties
+ * every seeded table first. All users are user<id> with password
+ * "password123". Media rows reference objects that do not exist in storage.
+ * Location clusters and tiles are left to the server, which materializes
+ * them on start when location_tiles is empty. --out writes one COPY text
+ * file per table instead of connecting, for inspection or \copy.
+ */
+#include <argon2.h>
+#include <libpq-fe.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// xoshiro256** seeded through splitmix64. The <random> engines are portable
+// but its distributions are not, so every draw below is built on raw bits.
+class Rng {
+ public:
+  Rng(std::uint64_t seed, std::uint64_t stream) {
+    std::uint64_t x = seed ^ (stream * 0x9e3779b97f4a7c15ULL);
+    for (auto& word : state_) {
+      x += 0x9e3779b97f4a7c15ULL;
+      std::uint64_t z = x;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  std::uint64_t next() {
+    const std::uint64_t result = std::rotl(state_[1] * 5, 7) * 9;
+    const std::uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = std::rotl(state_[3], 45);
+    return result;
+  }
+
+  // Uniform in [0, n), 0 < n < 2^32: the high 32 bits scaled by n
+  std::int64_t below(std::int64_t n) {
+    return static_cast<std::int64_t>(
+        ((next() >> 32) * static_cast<std::uint64_t>(n)) >> 32);
+  }
+
+  // Uniform in [low, high]
+  std::int64_t between(std::int64_t low, std::int64_t high) {
+    return low + below(high - low + 1);
+  }
+
+  // Uniform in [0, 1)
+  double unit() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+  bool chance(double p) { return unit() < p; }
+
+  template <typename T, std::size_t N>
+  const T& pick(const std::array<T, N>& values) {
+    return values[static_cast<std::size_t>(below(N))];
+  }
+
+ private:
+  std::array<std::uint64_t, 4> state_{};
+};
+
+// One stream per table, so changing how one table is generated leaves the
+// others untouched
+enum class Stream : std::uint64_t {
+  users = 1,
+  posts,
+  offers,
+  negotiations,
+  conversations,
+  messages,
+  media,
+  locations,
+};
+
+// Id in [1, n] skewed towards low ids (u^2.5): a few users author most
+// posts and offers, like real marketplaces. sqrt is correctly rounded,
+// std::pow is not guaranteed to be.
+int skewed_id(Rng& rng, int n) {
+  const double u = rng.unit();
+  return 1 + static_cast<int>(n * (u * u * std::sqrt(u)));
+}
+
+// Rows are dated within the year after kEpoch, in seconds since kEpoch
+constexpr std::chrono::sys_days kEpoch{std::chrono::year{2024} /
+                                       std::chrono::January / 1};
+constexpr std::int64_t kHour = 3600;
+constexpr std::int64_t kDay = 24 * kHour;
+constexpr std::int64_t kSpan = 365 * kDay;
+
+// A moment within `window` after `start`, clamped to the seeded year
+std::int64_t after(Rng& rng, std::int64_t start, std::int64_t window) {
+  return std::min(kSpan - 1, start + 1 + rng.below(window));
+}
+
+std::string timestamp(std::int64_t seconds, std::string_view separator = " ",
+                      std::string_view suffix = {}) {
+  const auto days =
+      std::chrono::floor<std::chrono::days>(std::chrono::seconds(seconds));
+  const std::chrono::year_month_day date{kEpoch + days};
+  const std::chrono::hh_mm_ss time{std::chrono::seconds(seconds) - days};
+  return std::format("{:04}-{:02}-{:02}{}{:02}:{:02}:{:02}{}",
+                     static_cast<int>(date.year()),
+                     static_cast<unsigned>(date.month()),
+                     static_cast<unsigned>(date.day()), separator,
+                     time.hours().count(), time.minutes().count(),
+                     time.seconds().count(), suffix);
+}
+
+std::string price(std::int64_t cents) {
+  return std::format("{}.{:02}", cents / 100, cents % 100);
+}
+
+std::string hex(Rng& rng, int words) {
+  std::string out;
+  for (int i = 0; i < words; ++i) {
+    out += std::format("{:016x}", rng.next());
+  }
+  return out;
+}
+
+// Ranked by popularity, drawn with weights 1 / rank (Zipf, s = 1)
+constexpr std::array<std::string_view, 40> kTags = {
+    "electronics", "phones",   "fashion",     "furniture",  "books",
+    "laptops",     "shoes",    "home",        "gaming",     "sports",
+    "beauty",      "kids",     "groceries",   "cars",       "music",
+    "art",         "cameras",  "jewelry",     "tools",      "garden",
+    "pets",        "bikes",    "watches",     "kitchen",    "vintage",
+    "handmade",    "office",   "outdoor",     "toys",       "health",
+    "audio",       "tv",       "appliances",  "bags",       "collectibles",
+    "software",    "tickets",  "services",    "rentals",    "other"};
+
+constexpr std::array<std::string_view, 20> kItems = {
+    "iPhone 13",     "gaming laptop",     "office chair",   "road bike",
+    "sofa",          "air fryer",         "DSLR camera",    "smart watch",
+    "sneakers",      "textbooks",         "PS5 controller", "standing desk",
+    "winter jacket", "bluetooth speaker", "baby stroller",  "electric guitar",
+    "fridge",        "drill set",         "handbag",        "4K TV"};
+
+constexpr std::array<std::string_view, 4> kRequestOpeners = {
+    "Looking for", "Need", "Anyone selling", "Searching for"};
+constexpr std::array<std::string_view, 4> kPostOpeners = {
+    "Just got a", "Thoughts on this", "Recommendations for a",
+    "Selling my old"};
+constexpr std::array<std::string_view, 4> kConditions = {
+    "Brand new", "Like new", "Lightly used", "Refurbished"};
+
+constexpr std::array<std::string_view, 12> kChatLines = {
+    "Hi, is this still available?",
+    "Yes it is.",
+    "Can you send more pictures?",
+    "Sure, sending them now.",
+    "What is the lowest you can do?",
+    "That is already a good price.",
+    "Where can we meet?",
+    "I can deliver tomorrow afternoon.",
+    "Does it come with a warranty?",
+    "Thanks, let me think about it.",
+    "Deal, see you then.",
+    "Payment sent."};
+
+struct City {
+  std::string_view name;
+  double latitude;
+  double longitude;
+  int weight;
+};
+
+// Weights sum to 100
+constexpr std::array<City, 10> kCities = {{
+    {"Lagos", 6.5244, 3.3792, 30},
+    {"Abuja", 9.0765, 7.3986, 10},
+    {"Port Harcourt", 4.8156, 7.0498, 6},
+    {"Ibadan", 7.3775, 3.9470, 6},
+    {"Kano", 12.0022, 8.5920, 5},
+    {"Enugu", 6.4584, 7.5464, 4},
+    {"Accra", 5.6037, -0.1870, 8},
+    {"Nairobi", -1.2921, 36.8219, 8},
+    {"London", 51.5072, -0.1276, 12},
+    {"New York", 40.7128, -74.0060, 11},
+}};
+
+const City& pick_city(Rng& rng) {
+  auto roll = static_cast<int>(rng.below(100));
+  for (const auto& city : kCities) {
+    if (roll < city.weight) {
+      return city;
+    }
+    roll -= city.weight;
+  }
+  return kCities[0];
+}
+
+// Cumulative 1 / rank weights of kTags
+std::array<double, kTags.size()> tag_weights() {
+  std::array<double, kTags.size()> cumulative{};
+  double total = 0;
+  for (std::size_t i = 0; i < kTags.size(); ++i) {
+    total += 1.0 / static_cast<double>(i + 1);
+    cumulative[i] = total;
+  }
+  return cumulative;
+}
+
+// Postgres array literal of 1 to 4 distinct tags
+std::string draw_tags(Rng& rng, const std::array<double, kTags.size()>& cdf,
+                      std::string_view* first) {
+  const auto count = rng.between(1, 4);
+  std::array<std::size_t, 4> picked{};
+  std::size_t n = 0;
+  for (int attempt = 0; attempt < 16 && n < static_cast<std::size_t>(count);
+       ++attempt) {
+    const double roll = rng.unit() * cdf.back();
+    const auto tag = static_cast<std::size_t>(
+        std::upper_bound(cdf.begin(), cdf.end(), roll) - cdf.begin());
+    const auto index = std::min(tag, kTags.size() - 1);
+    if (std::find(picked.begin(), picked.begin() + n, index) ==
+        picked.begin() + n) {
+      picked[n++] = index;
+    }
+  }
+  *first = kTags[picked[0]];
+  std::string out = "{";
+  for (std::size_t i = 0; i < n; ++i) {
+    out += (i ? "," : "");
+    out += kTags[picked[i]];
+  }
+  out += "}";
+  return out;
+}
+
+template <typename T>
+struct is_optional : std::false_type {};
+template <typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+// Rows of one table in COPY text format, streamed to the server or to
+// <out>/<table>.copy. Throws std::runtime_error when the server rejects
+// them.
+class CopyWriter {
+ public:
+  CopyWriter(PGconn* conn, const std::filesystem::path& out,
+             std::string_view table, std::string_view columns)
+      : conn_(conn), table_(table), start_(Clock::now()) {
+    if (conn_) {
+      PGresult* result = PQexec(
+          conn_, std::format("COPY {} ({}) FROM STDIN", table, columns)
+                     .c_str());
+      const bool ok = PQresultStatus(result) == PGRES_COPY_IN;
+      PQclear(result);
+      if (!ok) {
+        throw std::runtime_error(std::format("COPY {} failed: {}", table,
+                                             PQerrorMessage(conn_)));
+      }
+    } else {
+      file_.open(out / std::format("{}.copy", table), std::ios::binary);
+      if (!file_) {
+        throw std::runtime_error(
+            std::format("cannot write {}", (out / table).string()));
+      }
+    }
+  }
+
+  template <typename... Fields>
+  void row(const Fields&... fields) {
+    bool first = true;
+    (field(fields, first), ...);
+    buffer_ += '\n';
+    ++rows_;
+    if (buffer_.size() > (1 << 20)) {
+      flush();
+    }
+  }
+
+  void finish() {
+    flush();
+    if (conn_) {
+      if (PQputCopyEnd(conn_, nullptr) != 1) {
+        throw std::runtime_error(std::format("COPY {} failed: {}", table_,
+                                             PQerrorMessage(conn_)));
+      }
+      bool ok = true;
+      while (PGresult* result = PQgetResult(conn_)) {
+        ok = ok && PQresultStatus(result) == PGRES_COMMAND_OK;
+        PQclear(result);
+      }
+      if (!ok) {
+        throw std::runtime_error(std::format("COPY {} failed: {}", table_,
+                                             PQerrorMessage(conn_)));
+      }
+    }
+    const std::chrono::duration<double> elapsed = Clock::now() - start_;
+    std::cout << std::format("{:<26} {:>10} rows {:>8.2f}s\n", table_, rows_,
+                             elapsed.count());
+  }
+
+ private:
+  template <typename T>
+  void field(const T& value, bool& first) {
+    if (!first) {
+      buffer_ += '\t';
+    }
+    first = false;
+    add(value);
+  }
+
+  template <typename T>
+  void add(const T& value) {
+    if constexpr (is_optional<T>::value) {
+      if (value) {
+        add(*value);
+      } else {
+        add(std::nullopt);
+      }
+    } else if constexpr (std::is_same_v<T, std::nullopt_t>) {
+      buffer_ += "\\N";
+    } else if constexpr (std::is_same_v<T, bool>) {
+      buffer_ += value ? 't' : 'f';
+    } else if constexpr (std::is_integral_v<T>) {
+      std::format_to(std::back_inserter(buffer_), "{}", value);
+    } else {
+      for (const char c : std::string_view(value)) {
+        switch (c) {
+          case '\\':
+            buffer_ += "\\\\";
+            break;
+          case '\t':
+            buffer_ += "\\t";
+            break;
+          case '\n':
+            buffer_ += "\\n";
+            break;
+          case '\r':
+            buffer_ += "\\r";
+            break;
+          default:
+            buffer_ += c;
+        }
+      }
+    }
+  }
+
+  void flush() {
+    if (conn_) {
+      if (PQputCopyData(conn_, buffer_.data(),
+                        static_cast<int>(buffer_.size())) != 1) {
+        throw std::runtime_error(std::format("COPY {} failed: {}", table_,
+                                             PQerrorMessage(conn_)));
+      }
+    } else {
+      file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    }
+    buffer_.clear();
+  }
+
+  PGconn* conn_;
+  std::ofstream file_;
+  std::string table_;
+  std::string buffer_;
+  std::int64_t rows_ = 0;
+  Clock::time_point start_;
+};
+
+void exec(PGconn* conn, const std::string& sql) {
+  PGresult* result = PQexec(conn, sql.c_str());
+  const auto status = PQresultStatus(result);
+  PQclear(result);
+  if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+    throw std::runtime_error(
+        std::format("{} failed: {}", sql, PQerrorMessage(conn)));
+  }
+}
+
+bool has_users(PGconn* conn) {
+  PGresult* result = PQexec(conn, "SELECT EXISTS (SELECT 1 FROM users)");
+  const bool ok = PQresultStatus(result) == PGRES_TUPLES_OK;
+  const bool found = ok && std::string_view(PQgetvalue(result, 0, 0)) == "t";
+  PQclear(result);
+  if (!ok) {
+    throw std::runtime_error(
+        std::format("checking users failed: {}", PQerrorMessage(conn)));
+  }
+  return found;
+}
+
+// Every table the generator loads, plus the aggregates the server derives
+// from locations
+constexpr std::string_view kTruncate =
+    "TRUNCATE users, media, posts, post_media, post_subscriptions, "
+    "conversations, conversation_participants, messages, message_media, "
+    "offers, offer_media, price_negotiations, user_subscriptions, locations, "
+    "location_clusters, location_tiles RESTART IDENTITY CASCADE";
+
+// Tables loaded with explicit ids, their sequences continue after them
+constexpr std::array<std::string_view, 10> kSerialTables = {
+    "users", "media", "posts", "post_subscriptions", "conversations",
+    "messages", "offers", "price_negotiations", "user_subscriptions",
+    "locations"};
+
+// The encoded argon2id hash of "password123" with the parameters of
+// hash_password_with_argon2 in controllers/authentication.cc and a fixed
+// salt, so logins work and the hash is the same on every run
+std::string password_hash() {
+  constexpr std::uint32_t salt_length = 16;
+  constexpr std::uint32_t hash_length = 32;
+  constexpr std::uint32_t t_cost = 3;
+  constexpr std::uint32_t m_cost = 1 << 16;
+  constexpr std::uint32_t parallelism = 1;
+  constexpr std::string_view password = "password123";
+  std::array<std::uint8_t, salt_length> salt{};
+  for (std::size_t i = 0; i < salt.size(); ++i) {
+    salt[i] = static_cast<std::uint8_t>(i);
+  }
+  std::string encoded(
+      argon2_encodedlen(t_cost, m_cost, parallelism, salt_length, hash_length,
+                        Argon2_id),
+      '\0');
+  const int result = argon2id_hash_encoded(
+      t_cost, m_cost, parallelism, password.data(), password.size(),
+      salt.data(), salt.size(), hash_length, encoded.data(),
+      encoded.size());
+  if (result != ARGON2_OK) {
+    throw std::runtime_error(std::format("hashing the password failed: {}",
+                                         argon2_error_message(result)));
+  }
+  encoded.resize(std::char_traits<char>::length(encoded.c_str()));
+  return encoded;
+}
+
+struct Options {
+  double scale = 1.0;
+  std::uint64_t seed = 1;
+  bool truncate = false;
+  std::string pg;
+  std::filesystem::path out;
+};
+
+// Posts, offers or messages with attached media, written to media and the
+// link table after their owners
+struct MediaOwner {
+  int owner_id;
+  int uploader_id;
+  int count;
+  std::int64_t at;
+};
+
+struct Request {
+  int post_id;
+  int author;
+  std::int64_t at;
+  std::int64_t min_cents;
+  std::int64_t max_cents;
+  int offers;
+  bool fulfilled;
+};
+
+struct Subscription {
+  int user_id;
+  int post_id;
+  std::int64_t at;
+};
+
+enum class OfferStatus { pending, accepted, rejected };
+
+// Rounds alternate between the buyer (post author) and the seller, the
+// buyer opens
+struct Negotiation {
+  int offer_id;
+  int buyer;
+  int seller;
+  std::int64_t at;
+  int rounds;
+  std::array<std::int64_t, 3> cents;
+  OfferStatus offer_status;
+  int conversation_id = 0;
+};
+
+// Offer conversations are named like create_or_get_conversation names them
+struct Conversation {
+  int user1;
+  int user2;
+  std::int64_t at;
+  int offer_id;  // 0 for direct chats
+};
+
+std::string_view status_name(OfferStatus status) {
+  switch (status) {
+    case OfferStatus::accepted:
+      return "accepted";
+    case OfferStatus::rejected:
+      return "rejected";
+    default:
+      return "pending";
+  }
+}
+
+class SeedGenerator {
+ public:
+  SeedGenerator(const Options& options, PGconn* conn)
+      : options_(options),
+        conn_(conn),
+        users_(std::max(2, static_cast<int>(std::llround(
+                               100'000 * options.scale)))) {}
+
+  void run() {
+    users();
+    posts();
+    post_subscriptions();
+    offers();
+    negotiations();
+    conversations();
+    messages();
+    media();
+    media_links();
+    user_subscriptions();
+    locations();
+  }
+
+ private:
+  Rng stream(Stream table) const {
+    return Rng(options_.seed, static_cast<std::uint64_t>(table));
+  }
+
+  std::int64_t joined(int user) const {
+    return user_at_[static_cast<std::size_t>(user)];
+  }
+
+  CopyWriter writer(std::string_view table, std::string_view columns) const {
+    return CopyWriter(conn_, options_.out, table, columns);
+  }
+
+  void users() {
+    auto rng = stream(Stream::users);
+    const std::string hash = password_hash();
+    auto copy = writer("users",
+                       "id, username, email, password_hash, created_at, "
+                       "updated_at");
+    user_at_.resize(static_cast<std::size_t>(users_) + 1);
+    for (int id = 1; id <= users_; ++id) {
+      // Sign ups spread over the first half of the year
+      const std::int64_t at =
+          (id - 1) * (kSpan / 2) / users_ + rng.below(kHour);
+      user_at_[static_cast<std::size_t>(id)] = at;
+      const auto created = timestamp(at);
+      copy.row(id, std::format("user{}", id),
+               std::format("user{}@example.com", id), hash, created, created);
+    }
+    copy.finish();
+  }
+
+  void posts() {
+    auto rng = stream(Stream::posts);
+    const auto cdf = tag_weights();
+    auto copy = writer("posts",
+                       "id, user_id, content, created_at, tags, location, "
+                       "is_product_request, request_status, price_range");
+    const int posts = users_ * 3;
+    post_author_.resize(static_cast<std::size_t>(posts) + 1);
+    for (int id = 1; id <= posts; ++id) {
+      const int author = skewed_id(rng, users_);
+      const std::int64_t at =
+          after(rng, joined(author), kSpan - joined(author));
+      post_author_[static_cast<std::size_t>(id)] = author;
+
+      std::string_view tag;
+      const std::string tags = draw_tags(rng, cdf, &tag);
+      const auto& item = rng.pick(kItems);
+      const auto& city = pick_city(rng);
+      const bool request = rng.chance(0.4);
+      std::string status = "open";
+      std::optional<std::string> price_range;
+      if (request) {
+        const std::int64_t low = 10 * rng.between(1, 100);
+        const std::int64_t high = low * rng.between(2, 4);
+        price_range = std::format("${}-${}", low, high);
+        const int offers = static_cast<int>(rng.below(9));
+        const bool fulfilled = offers > 0 && rng.chance(0.25);
+        status = fulfilled ? "fulfilled" : "open";
+        requests_.push_back({.post_id = id,
+                             .author = author,
+                             .at = at,
+                             .min_cents = low * 80,
+                             .max_cents = high * 100,
+                             .offers = offers,
+                             .fulfilled = fulfilled});
+      }
+      const auto content =
+          std::format("{} {} in {} #{}",
+                      request ? rng.pick(kRequestOpeners)
+                              : rng.pick(kPostOpeners),
+                      item, city.name, tag);
+      if (rng.chance(0.3)) {
+        post_media_.push_back({.owner_id = id,
+                               .uploader_id = author,
+                               .count = static_cast<int>(rng.between(1, 3)),
+                               .at = at});
+      }
+      // A fifth of the posts collect followers, skewed towards active users
+      if (rng.chance(0.2)) {
+        const auto first = subscriptions_.size();
+        for (auto i = rng.between(1, 5); i > 0; --i) {
+          const int user = skewed_id(rng, users_);
+          const bool seen =
+              user == author ||
+              std::any_of(subscriptions_.begin() + first, subscriptions_.end(),
+                          [&](const Subscription& s) {
+                            return s.user_id == user;
+                          });
+          if (!seen) {
+            subscriptions_.push_back(
+                {.user_id = user,
+                 .post_id = id,
+                 .at = after(rng, std::max(at, joined(user)), 7 * kDay)});
+          }
+        }
+      }
+      copy.row(id, author, content, timestamp(at), tags, city.name, request,
+               status, price_range);
+    }
+    copy.finish();
+  }
+
+  void post_subscriptions() {
+    auto copy = writer("post_subscriptions",
+                       "id, user_id, post_id, created_at");
+    int id = 0;
+    for (const auto& subscription : subscriptions_) {
+      copy.row(++id, subscription.user_id, subscription.post_id,
+               timestamp(subscription.at));
+    }
+    copy.finish();
+  }
+
+  void offers() {
+    auto rng = stream(Stream::offers);
+    auto copy = writer("offers",
+                       "id, post_id, user_id, title, description, price, "
+                       "is_public, status, created_at, updated_at, "
+                       "negotiation_status, original_price");
+    offer_seller_.push_back(0);
+    int id = 0;
+    for (const auto& request : requests_) {
+      const int accepted =
+          request.fulfilled ? static_cast<int>(rng.below(request.offers)) : -1;
+      for (int i = 0; i < request.offers; ++i) {
+        ++id;
+        int seller = skewed_id(rng, users_);
+        if (seller == request.author) {
+          seller = seller % users_ + 1;
+        }
+        offer_seller_.push_back(seller);
+        const std::int64_t at = after(
+            rng, std::max(request.at, joined(seller)), 14 * kDay);
+        const std::int64_t original =
+            rng.between(request.min_cents, request.max_cents);
+        OfferStatus status = OfferStatus::pending;
+        if (request.fulfilled) {
+          status = i == accepted ? OfferStatus::accepted
+                                 : OfferStatus::rejected;
+        } else if (rng.chance(0.15)) {
+          status = OfferStatus::rejected;
+        }
+
+        std::int64_t final_price = original;
+        std::string_view negotiation = "none";
+        std::int64_t updated = at;
+        if (rng.chance(0.3)) {
+          Negotiation entry{.offer_id = id,
+                            .buyer = request.author,
+                            .seller = seller,
+                            .at = after(rng, at, 2 * kDay),
+                            .rounds = static_cast<int>(rng.between(1, 3)),
+                            .cents = {},
+                            .offer_status = status};
+          // The buyer asks 70-95% of the price, the seller meets halfway
+          std::int64_t asked = original * rng.between(70, 95) / 100;
+          for (int round = 0; round < entry.rounds; ++round) {
+            entry.cents[static_cast<std::size_t>(round)] = asked;
+            asked = round % 2 == 0 ? (asked + original) / 2
+                                   : asked * rng.between(100, 105) / 100;
+          }
+          if (status == OfferStatus::accepted) {
+            final_price =
+                entry.cents[static_cast<std::size_t>(entry.rounds - 1)];
+          }
+          negotiation =
+              status == OfferStatus::pending ? "in_progress" : "completed";
+          updated = entry.at + entry.rounds * kDay;
+          negotiations_.push_back(entry);
+        } else if (status != OfferStatus::pending) {
+          updated = after(rng, at, 7 * kDay);
+        }
+        if (rng.chance(0.4)) {
+          offer_media_.push_back({.owner_id = id,
+                                  .uploader_id = seller,
+                                  .count = static_cast<int>(rng.between(1, 3)),
+                                  .at = at});
+        }
+        const auto& item = rng.pick(kItems);
+        const auto& condition = rng.pick(kConditions);
+        copy.row(id, request.post_id, seller,
+                 std::format("{} {}", condition, item),
+                 std::format("{} {}, available for pickup or delivery.",
+                             condition, item),
+                 price(final_price), rng.chance(0.9), status_name(status),
+                 timestamp(at), timestamp(std::min(updated, kSpan - 1)),
+                 negotiation, price(original));
+      }
+    }
+    copy.finish();
+  }
+
+  static std::uint64_t pair_key(int a, int b) {
+    return (static_cast<std::uint64_t>(std::min(a, b)) << 32) |
+           static_cast<std::uint32_t>(std::max(a, b));
+  }
+
+  // Conversation id of the pair, created at `at` when they have none, the
+  // way create_or_get_conversation reuses a pair's conversation
+  int conversation_for(int a, int b, std::int64_t at, int offer_id) {
+    auto [it, created] = conversation_ids_.try_emplace(
+        pair_key(a, b), static_cast<int>(conversations_.size()) + 1);
+    if (created) {
+      conversations_.push_back(
+          {.user1 = a, .user2 = b, .at = at, .offer_id = offer_id});
+    }
+    return it->second;
+  }
+
+  void negotiations() {
+    auto rng = stream(Stream::negotiations);
+    auto copy = writer("price_negotiations",
+                       "id, offer_id, user_id, proposed_price, status, "
+                       "message, created_at, updated_at");
+    constexpr std::array<std::string_view, 4> notes = {
+        "Can you do a bit better?", "This is my best offer.",
+        "Happy to pick it up today.", ""};
+    int id = 0;
+    for (auto& entry : negotiations_) {
+      entry.conversation_id =
+          conversation_for(entry.buyer, entry.seller, entry.at, entry.offer_id);
+      for (int round = 0; round < entry.rounds; ++round) {
+        const bool last = round == entry.rounds - 1;
+        const std::int64_t at = entry.at + round * kDay;
+        const auto status =
+            last ? status_name(entry.offer_status) : "rejected";
+        const auto& note = rng.pick(notes);
+        const auto created = timestamp(std::min(at, kSpan - 1));
+        const auto cents = entry.cents[static_cast<std::size_t>(round)];
+        const int user = round % 2 == 0 ? entry.buyer : entry.seller;
+        copy.row(++id, entry.offer_id, user, price(cents), status,
+                 note.empty() ? std::nullopt : std::optional(note), created,
+                 created);
+      }
+    }
+    copy.finish();
+  }
+
+  void conversations() {
+    auto rng = stream(Stream::conversations);
+    // Direct chats between users, skewed towards active ones; pairs that
+    // already talk are skipped
+    const int direct = users_ * 3 / 10;
+    for (int i = 0; i < direct; ++i) {
+      const int a = skewed_id(rng, users_);
+      const int b = static_cast<int>(rng.between(1, users_));
+      if (a != b) {
+        const auto since = std::max(joined(a), joined(b));
+        conversation_for(a, b, after(rng, since, kSpan - since), 0);
+      }
+    }
+
+    auto copy = writer("conversations", "id, name, created_at");
+    int id = 0;
+    for (const auto& conversation : conversations_) {
+      const auto name =
+          conversation.offer_id
+              ? std::format("Offer #{} Negotiation", conversation.offer_id)
+              : std::format("user{} & user{}", conversation.user1,
+                            conversation.user2);
+      copy.row(++id, name, timestamp(conversation.at));
+    }
+    copy.finish();
+
+    auto participants = writer("conversation_participants",
+                               "conversation_id, user_id");
+    id = 0;
+    for (const auto& conversation : conversations_) {
+      ++id;
+      participants.row(id, conversation.user1);
+      participants.row(id, conversation.user2);
+    }
+    participants.finish();
+  }
+
+  void messages() {
+    auto rng = stream(Stream::messages);
+    auto copy = writer("messages",
+                       "id, conversation_id, sender_id, content, "
+                       "message_type, is_read, created_at, context_type, "
+                       "context_id, metadata");
+    int id = 0;
+    // One per negotiation round, as negotiate_offer writes them
+    int negotiation_id = 0;
+    for (const auto& entry : negotiations_) {
+      for (int round = 0; round < entry.rounds; ++round) {
+        const std::int64_t at = std::min(entry.at + round * kDay, kSpan - 1);
+        copy.row(++id, entry.conversation_id,
+                 round % 2 == 0 ? entry.buyer : entry.seller,
+                 std::format("Proposed new price: ${}",
+                             price(entry.cents[static_cast<std::size_t>(
+                                 round)])),
+                 "text", rng.chance(0.9), timestamp(at), "negotiation",
+                 ++negotiation_id,
+                 std::format(R"({{"offer_id":"{}","offer_status":"pending"}})",
+                             entry.offer_id));
+      }
+    }
+
+    int conversation_id = 0;
+    for (const auto& conversation : conversations_) {
+      ++conversation_id;
+      const auto count = rng.between(2, 12);
+      std::int64_t at = conversation.at;
+      for (int i = 0; i < count; ++i) {
+        at = after(rng, at, 6 * kHour);
+        const int sender = i % 2 == 0 ? conversation.user1 : conversation.user2;
+        // Older messages have been read
+        const bool read = i < count - 2 || rng.chance(0.5);
+        std::string_view type = "text";
+        if (rng.chance(0.03)) {
+          type = rng.chance(0.5) ? "media" : "mixed";
+          message_media_.push_back({.owner_id = id + 1,
+                                    .uploader_id = sender,
+                                    .count = 1,
+                                    .at = at});
+        }
+        copy.row(++id, conversation_id, sender,
+                 type == "media" ? std::string_view("[image]")
+                                 : rng.pick(kChatLines),
+                 type, read, timestamp(at), std::nullopt, std::nullopt,
+                 "{}");
+      }
+    }
+    copy.finish();
+  }
+
+  void media() {
+    auto rng = stream(Stream::media);
+    auto copy = writer("media",
+                       "id, uploader_id, storage_key, file_name, mime_type, "
+                       "size, metadata, created_at");
+    int id = 0;
+    for (const auto* owners : {&post_media_, &offer_media_, &message_media_}) {
+      for (const auto& owner : *owners) {
+        for (int i = 0; i < owner.count; ++i) {
+          const bool png = rng.chance(0.1);
+          const auto file_name =
+              std::format("photo_{}.{}", id + 1, png ? "png" : "jpg");
+          const auto uuid = hex(rng, 2);
+          const auto storage_key = std::format(
+              "uploads/{}-{}-{}-{}-{}_{}", uuid.substr(0, 8),
+              uuid.substr(8, 4), uuid.substr(12, 4), uuid.substr(16, 4),
+              uuid.substr(20), file_name);
+          const auto metadata = std::format(
+              R"({{"etag":"\"{}\"","last_modified":"{}"}})", hex(rng, 2),
+              timestamp(owner.at, "T", "Z"));
+          copy.row(++id, owner.uploader_id, storage_key, file_name,
+                   png ? "image/png" : "image/jpeg",
+                   rng.between(50'000, 5'000'000), metadata,
+                   timestamp(owner.at));
+        }
+      }
+    }
+    copy.finish();
+  }
+
+  // Media ids follow the order media() wrote them in
+  void media_links() {
+    int media_id = 0;
+    const std::array<std::pair<std::string_view, std::string_view>, 3> links =
+        {{{"post_media", "post_id, media_id"},
+          {"offer_media", "offer_id, media_id"},
+          {"message_media", "message_id, media_id"}}};
+    const std::array<const std::vector<MediaOwner>*, 3> owners = {
+        &post_media_, &offer_media_, &message_media_};
+    for (std::size_t i = 0; i < links.size(); ++i) {
+      auto copy = writer(links[i].first, links[i].second);
+      for (const auto& owner : *owners[i]) {
+        for (int n = 0; n < owner.count; ++n) {
+          copy.row(owner.owner_id, ++media_id);
+        }
+      }
+      copy.finish();
+    }
+  }
+
+  // The topics the controllers subscribe users to: their posts, their
+  // offers, followed posts and their conversations (create_topic format)
+  void user_subscriptions() {
+    auto copy = writer("user_subscriptions", "id, user_id, subscription");
+    int id = 0;
+    for (std::size_t post = 1; post < post_author_.size(); ++post) {
+      copy.row(++id, post_author_[post], std::format("post:{}", post));
+    }
+    for (const auto& subscription : subscriptions_) {
+      copy.row(++id, subscription.user_id,
+               std::format("post:{}", subscription.post_id));
+    }
+    for (std::size_t offer = 1; offer < offer_seller_.size(); ++offer) {
+      copy.row(++id, offer_seller_[offer], std::format("offer:{}", offer));
+    }
+    int conversation_id = 0;
+    for (const auto& conversation : conversations_) {
+      const auto topic = std::format("chat:{}", ++conversation_id);
+      copy.row(++id, conversation.user1, topic);
+      copy.row(++id, conversation.user2, topic);
+    }
+    copy.finish();
+  }
+
+  void locations() {
+    auto rng = stream(Stream::locations);
+    auto copy = writer("locations",
+                       "id, user_id, latitude, longitude, accuracy, "
+                       "device_id, created_at, updated_at, geom");
+    int id = 0;
+    for (int user = 1; user <= users_; ++user) {
+      if (!rng.chance(0.8)) {
+        continue;
+      }
+      const auto& city = pick_city(rng);
+      // Irwin-Hall (sum of 3 uniforms) around the centre, within 0.15
+      // degrees
+      const double latitude =
+          city.latitude +
+          (rng.unit() + rng.unit() + rng.unit() - 1.5) * 0.1;
+      const double longitude =
+          city.longitude +
+          (rng.unit() + rng.unit() + rng.unit() - 1.5) * 0.1;
+      const auto at = timestamp(after(rng, joined(user), 30 * kDay));
+      copy.row(++id, user, std::format("{:.6f}", latitude),
+               std::format("{:.6f}", longitude),
+               rng.between(5, 50),
+               std::format("{}_device", user), at, at,
+               std::format("SRID=4326;POINT({:.6f} {:.6f})", longitude,
+                           latitude));
+    }
+    copy.finish();
+  }
+
+  const Options& options_;
+  PGconn* conn_;
+  int users_;
+  std::vector<std::int64_t> user_at_;
+  std::vector<int> post_author_;
+  std::vector<int> offer_seller_;
+  std::vector<Request> requests_;
+  std::vector<Subscription> subscriptions_;
+  std::vector<Negotiation> negotiations_;
+  std::vector<Conversation> conversations_;
+  std::unordered_map<std::uint64_t, int> conversation_ids_;
+  std::vector<MediaOwner> post_media_;
+  std::vector<MediaOwner> offer_media_;
+  std::vector<MediaOwner> message_media_;
+};
+
+void load(const Options& options) {
+  PGconn* conn = PQconnectdb(options.pg.c_str());
+  if (PQstatus(conn) != CONNECTION_OK) {
+    const std::string error = PQerrorMessage(conn);
+    PQfinish(conn);
+    throw std::runtime_error("connection failed: " + error);
+  }
+  try {
+    exec(conn, "BEGIN");
+    if (options.truncate) {
+      exec(conn, std::string(kTruncate));
+    } else if (has_users(conn)) {
+      throw std::runtime_error(
+          "the database already has users, pass --truncate to replace them");
+    }
+    SeedGenerator(options, conn).run();
+    for (const auto table : kSerialTables) {
+      exec(conn, std::format("SELECT setval(pg_get_serial_sequence('{0}', "
+                             "'id'), COALESCE(MAX(id), 0) + 1, false) "
+                             "FROM {0}",
+                             table));
+    }
+    exec(conn, "COMMIT");
+    exec(conn, "ANALYZE");
+  } catch (...) {
+    PQfinish(conn);
+    throw;
+  }
+  PQfinish(conn);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--scale" && i + 1 < argc) {
+      options.scale = std::max(0.0, std::stod(argv[++i]));
+    } else if (arg == "--seed" && i + 1 < argc) {
+      options.seed = std::stoull(argv[++i]);
+    } else if (arg == "--truncate") {
+      options.truncate = true;
+    } else if (arg == "--pg" && i + 1 < argc) {
+      options.pg = argv[++i];
+    } else if (arg == "--out" && i + 1 < argc) {
+      options.out = argv[++i];
+    } else {
+      std::cerr << std::format("unknown option {}\n", arg);
+      return 1;
+    }
+  }
+  if (options.pg.empty() == options.out.empty()) {
+    std::cerr << "pass one of --pg or --out\n";
+    return 1;
+  }
+
+  const auto start = Clock::now();
+  try {
+    if (!options.pg.empty()) {
+      load(options);
+    } else {
+      std::filesystem::create_directories(options.out);
+      SeedGenerator(options, nullptr).run();
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  const std::chrono::duration<double> elapsed = Clock::now() - start;
+  std::cout << std::format("seeded scale {} with seed {} in {:.2f}s\n",
+                           options.scale, options.seed, elapsed.count());
+  return 0;
+}
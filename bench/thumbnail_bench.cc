@@ -0,0 +1,140 @@
+/**
+ * Thumbnail pipeline throughput: decode + resize to every ThumbnailService
+ * size + JPEG encode, the CPU part of a thumbnail job.
+ *
+ * Usage: thumbnail_bench [--iterations N] [--threads N] [files or dirs...]
+ * Defaults to the images in the repository images/ directory.
+ * Reports images/sec for one core and for N threads (images/sec/core).
+ */
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../services/media_server/image_processing.hpp"
+
+namespace fs = std::filesystem;
+
+// Keep in sync with ThumbnailService::SIZES
+constexpr std::array<int, 3> SIZES = {640, 320, 160};
+
+struct Sample {
+  std::string name;
+  std::string bytes;
+};
+
+static bool is_image(const fs::path& path) {
+  auto ext = path.extension().string();
+  std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+  return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".gif";
+}
+
+static void load(const fs::path& path, std::vector<Sample>& samples) {
+  if (fs::is_directory(path)) {
+    for (const auto& entry : fs::directory_iterator(path)) {
+      if (entry.is_regular_file() && is_image(entry.path())) {
+        load(entry.path(), samples);
+      }
+    }
+    return;
+  }
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << std::format("cannot read {}\n", path.string());
+    return;
+  }
+  samples.push_back(Sample{
+      .name = path.filename().string(),
+      .bytes = std::string(std::istreambuf_iterator<char>(file), {})});
+}
+
+// Processes every sample `iterations` times, returns images processed
+static std::size_t run(const std::vector<Sample>& samples, int iterations) {
+  std::size_t processed = 0;
+  for (int i = 0; i < iterations; ++i) {
+    for (const auto& sample : samples) {
+      auto thumbnails = imaging::make_thumbnails(sample.bytes, SIZES);
+      processed += thumbnails.empty() ? 0 : 1;
+    }
+  }
+  return processed;
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = 20;
+  int threads = static_cast<int>(
+      std::max(1U, std::thread::hardware_concurrency()));
+  std::vector<fs::path> inputs;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--iterations" && i + 1 < argc) {
+      iterations = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = std::max(1, std::stoi(argv[++i]));
+    } else {
+      inputs.emplace_back(arg);
+    }
+  }
+  if (inputs.empty()) {
+    inputs.emplace_back(BENCH_SAMPLE_DIR);
+  }
+
+  std::vector<Sample> samples;
+  for (const auto& input : inputs) {
+    load(input, samples);
+  }
+  if (samples.empty()) {
+    std::cerr << "no sample images found\n";
+    return 1;
+  }
+
+  for (const auto& sample : samples) {
+    auto thumbnails = imaging::make_thumbnails(sample.bytes, SIZES);
+    std::cout << std::format("{} ({} bytes):", sample.name,
+                             sample.bytes.size());
+    for (const auto& thumbnail : thumbnails) {
+      std::cout << std::format(" {}x{} {}B", thumbnail.width, thumbnail.height,
+                               thumbnail.jpeg.size());
+    }
+    std::cout << (thumbnails.empty() ? " unsupported\n" : "\n");
+  }
+
+  using clock = std::chrono::steady_clock;
+
+  // Single core
+  auto start = clock::now();
+  const std::size_t single = run(samples, iterations);
+  const std::chrono::duration<double> single_elapsed = clock::now() - start;
+  const double single_rate = single / single_elapsed.count();
+  std::cout << std::format(
+      "1 thread:  {} images in {:.3f}s -> {:.1f} images/sec/core\n", single,
+      single_elapsed.count(), single_rate);
+
+  // All threads, each processing the full sample set
+  std::atomic<std::size_t> total{0};
+  start = clock::now();
+  {
+    std::vector<std::jthread> workers;
+    workers.reserve(threads);
+    for (int t = 0; t < threads; ++t) {
+      workers.emplace_back([&]() { total += run(samples, iterations); });
+    }
+  }
+  const std::chrono::duration<double> multi_elapsed = clock::now() - start;
+  const double multi_rate = total.load() / multi_elapsed.count();
+  std::cout << std::format(
+      "{} threads: {} images in {:.3f}s -> {:.1f} images/sec, "
+      "{:.1f} images/sec/core\n",
+      threads, total.load(), multi_elapsed.count(), multi_rate,
+      multi_rate / threads);
+  return 0;
+}
@@ -0,0 +1,278 @@
+/**
+ * Response encodings of the read endpoints: JSON against BEVE (and
+ * MessagePack when the glaze build has it) for a Community::get_posts page,
+ * a Chats::get_messages page and an Offers::get_received_offers page.
+ * Reports payload size, encode time through utilities::write_wire_body() and
+ * decode time back into the same structs, the cost a client pays.
+ *
+ * Usage: wire_format_bench [--iterations N] [--items N]
+ * Needs no database or server.
+ */
+#include <glaze/glaze.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../utilities/wire_format.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using utilities::WireFormat;
+
+// Same shapes as the handlers' response structs, owning so they can be read
+// back
+
+struct MediaVariant {
+  std::string object_key;
+  int width = 0;
+  int height = 0;
+  std::int64_t size = 0;
+};
+
+struct MediaQuickInfo {
+  int media_id;
+  std::string object_key;
+  std::string filename;
+  std::string mime_type;
+  std::int64_t size = 0;
+  std::vector<MediaVariant> variants;
+};
+
+struct Post {
+  int id;
+  int user_id;
+  std::string username;
+  std::string content;
+  std::string created_at;
+  std::vector<std::string> tags;
+  std::string location;
+  bool is_product_request;
+  std::string request_status;
+  std::string price_range;
+  int subscription_count;
+  bool is_subscribed;
+  std::vector<MediaQuickInfo> media;
+};
+
+struct Message {
+  int id;
+  int sender_id;
+  std::string sender_name;
+  std::string content;
+  std::string message_type;
+  bool is_read;
+  std::string created_at;
+  std::string metadata;
+  std::optional<std::vector<MediaQuickInfo>> media;
+};
+
+struct ReceivedOfferInfo {
+  int id;
+  int post_id;
+  std::string post_content;
+  int user_id;
+  std::string offer_username;
+  std::string title;
+  std::string description;
+  double price;
+  double original_price;
+  bool is_public;
+  std::string status;
+  std::string created_at;
+  std::string updated_at;
+  std::vector<MediaQuickInfo> media;
+};
+
+struct ReceivedOffersPage {
+  std::vector<ReceivedOfferInfo> offers;
+  std::optional<std::string> next_cursor;
+};
+
+MediaQuickInfo make_media(int i) {
+  auto key = std::format("uploads/2026/10/{:08x}", i);
+  return {.media_id = i + 1,
+          .object_key = key + ".jpg",
+          .filename = std::format("IMG_{:04}.jpg", i),
+          .mime_type = "image/jpeg",
+          .size = 2'483'117,
+          .variants = {{.object_key = key + "_thumb.webp",
+                        .width = 320,
+                        .height = 240,
+                        .size = 18'204}}};
+}
+
+std::vector<Post> make_posts(int count) {
+  std::vector<Post> posts;
+  for (int i = 0; i < count; ++i) {
+    posts.push_back(
+        {.id = i + 1,
+         .user_id = i % 7 + 1,
+         .username = std::format("member_{}", i % 7),
+         .content = std::format(
+             "Looking for a second hand road bike, size 56, Shimano 105 or "
+             "better, budget around 400, can collect this weekend, post {}",
+             i),
+         .created_at = "2026-10-18 09:41:27.123456",
+         .tags = {"bikes", "cycling", "second-hand"},
+         .location = "Lagos, Nigeria",
+         .is_product_request = true,
+         .request_status = "open",
+         .price_range = "$300-$450",
+         .subscription_count = i % 13,
+         .is_subscribed = i % 2 == 0,
+         .media = i % 3 == 0 ? std::vector<MediaQuickInfo>{make_media(i)}
+                             : std::vector<MediaQuickInfo>{}});
+  }
+  return posts;
+}
+
+std::vector<Message> make_messages(int count) {
+  std::vector<Message> messages;
+  for (int i = 0; i < count; ++i) {
+    messages.push_back(
+        {.id = i + 1,
+         .sender_id = i % 2 + 1,
+         .sender_name = i % 2 == 0 ? "buyer_account" : "seller_account",
+         .content = std::format("Is the bike still available? I can pick it "
+                                "up tomorrow, message {}",
+                                i),
+         .message_type = "text",
+         .is_read = true,
+         .created_at = "2026-10-18 09:41:27.123456",
+         .metadata = "{}",
+         .media = std::nullopt});
+  }
+  return messages;
+}
+
+ReceivedOffersPage make_offers(int count) {
+  ReceivedOffersPage page{.offers = {}, .next_cursor = "1792316487123456_4711"};
+  for (int i = 0; i < count; ++i) {
+    page.offers.push_back(
+        {.id = i + 1,
+         .post_id = 42,
+         .post_content = "Looking for a second hand road bike, size 56",
+         .user_id = i + 100,
+         .offer_username = std::format("seller_{}", i),
+         .title = std::format("Road bike offer {}", i),
+         .description = "Shimano 105, new tyres, serviced last month",
+         .price = 350.0 + i,
+         .original_price = 350.0 + i,
+         .is_public = true,
+         .status = "pending",
+         .created_at = "2026-10-18 09:41:27.123456",
+         .updated_at = "2026-10-18 09:41:27.123456",
+         .media = {make_media(i)}});
+  }
+  return page;
+}
+
+template <typename T>
+bool read_body(WireFormat format, T& value, const std::string& body) {
+  switch (format) {
+    case WireFormat::beve:
+      return !glz::read_beve(value, body);
+    case WireFormat::msgpack:
+#if UTILITIES_HAS_MSGPACK
+      return !glz::read_msgpack(value, body);
+#else
+      break;
+#endif
+    case WireFormat::json:
+      break;
+  }
+  return !glz::read_json(value, body);
+}
+
+std::string_view format_name(WireFormat format) {
+  switch (format) {
+    case WireFormat::beve:
+      return "BEVE";
+    case WireFormat::msgpack:
+      return "MessagePack";
+    case WireFormat::json:
+      break;
+  }
+  return "JSON";
+}
+
+double median(std::vector<double>& samples) {
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+template <typename T>
+void report(std::string_view name, const T& value, int iterations) {
+  std::vector<WireFormat> formats = {WireFormat::json, WireFormat::beve};
+  if (utilities::kMsgpackAvailable) {
+    formats.push_back(WireFormat::msgpack);
+  }
+
+  std::size_t json_size = 0;
+  for (const auto format : formats) {
+    std::string body = utilities::write_wire_body(format, value);
+    std::vector<double> encode_ns;
+    std::vector<double> decode_ns;
+    encode_ns.reserve(static_cast<std::size_t>(iterations));
+    decode_ns.reserve(static_cast<std::size_t>(iterations));
+    bool decoded = true;
+    for (int i = 0; i < iterations; ++i) {
+      auto start = Clock::now();
+      body = utilities::write_wire_body(format, value);
+      encode_ns.push_back(
+          std::chrono::duration<double, std::nano>(Clock::now() - start)
+              .count());
+
+      T back{};
+      start = Clock::now();
+      decoded = read_body(format, back, body) && decoded;
+      decode_ns.push_back(
+          std::chrono::duration<double, std::nano>(Clock::now() - start)
+              .count());
+    }
+    if (format == WireFormat::json) {
+      json_size = body.size();
+    }
+    std::cout << std::format(
+        "{} {}: {} bytes ({:.0f}% of JSON), encode p50 {:.1f}us, decode p50 "
+        "{:.1f}us{}\n",
+        name, format_name(format), body.size(),
+        100.0 * static_cast<double>(body.size()) /
+            static_cast<double>(std::max<std::size_t>(json_size, 1)),
+        median(encode_ns) / 1000, median(decode_ns) / 1000,
+        decoded ? "" : " DECODE FAILED");
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int iterations = 2000;
+  int items = 50;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--iterations" && i + 1 < argc) {
+      iterations = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--items" && i + 1 < argc) {
+      items = std::max(1, std::stoi(argv[++i]));
+    } else {
+      std::cerr << std::format("unknown option {}\n", arg);
+      return 1;
+    }
+  }
+
+  report("get_posts", make_posts(items), iterations);
+  report("get_messages", make_messages(items), iterations);
+  report("get_received_offers", make_offers(items), iterations);
+  return 0;
+}
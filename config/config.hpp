@@ -13,6 +13,22 @@ inline std::string get_config_value(const std::string &key,
   return default_value;
 }
 
+inline int get_config_int(const std::string &key, int default_value) {
+  const Json::Value &config = drogon::app().getCustomConfig();
+  if (config.isMember(key) && config[key].isInt()) {
+    return config[key].asInt();
+  }
+  return default_value;
+}
+
+inline bool get_config_bool(const std::string &key, bool default_value) {
+  const Json::Value &config = drogon::app().getCustomConfig();
+  if (config.isMember(key) && config[key].isBool()) {
+    return config[key].asBool();
+  }
+  return default_value;
+}
+
 // Only fetch once
 static inline const std::string JWT_SECRET =
     get_config_value("jwt_secret", "default_secret");
@@ -0,0 +1,162 @@
+#include "admin.hpp"
+
+#include <drogon/HttpResponse.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../config/config.hpp"
+#include "../services/service_manager.hpp"
+#include "../utilities/conversion.hpp"
+#include "../utilities/db_tracing.hpp"
+#include "../utilities/json_manipulation.hpp"
+#include "../utilities/metrics.hpp"
+#include "common_req_n_resp.hpp"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+using api::v1::Admin;
+
+namespace {
+
+// Frame published by publish_probe, published_at_us is system_clock time
+struct ProbeMessage {
+  std::string type = "probe";
+  std::uint64_t seq = 0;
+  std::int64_t published_at_us = 0;
+};
+
+struct TracesResponse {
+  std::vector<utilities::RequestTraceRecord> slow;
+  std::vector<utilities::RequestTraceRecord> sampled;
+};
+
+bool on_admin_listener(const drogon::HttpRequestPtr& req) {
+  static const int admin_port = config::get_config_int("admin_port", 9464);
+  return admin_port > 0 && req->getLocalAddr().toPort() == admin_port;
+}
+
+// 0 where not supported
+std::size_t resident_bytes() {
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  std::size_t total_pages = 0;
+  std::size_t resident_pages = 0;
+  if (statm >> total_pages >> resident_pages) {
+    return resident_pages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  }
+#endif
+  return 0;
+}
+
+void append_gauge(std::string& out, std::string_view name,
+                  std::string_view help, std::size_t value) {
+  utilities::prometheus::append_family(out, name, "gauge", help);
+  utilities::prometheus::append_sample(out, name, "", value);
+}
+
+}  // namespace
+
+drogon::Task<> Admin::get_metrics(
+    drogon::HttpRequestPtr req,
+    std::function<void(const drogon::HttpResponsePtr&)> callback) {
+  if (!on_admin_listener(req)) {
+    callback(drogon::HttpResponse::newNotFoundResponse(req));
+    co_return;
+  }
+
+  std::string body;
+  body.reserve(64 * 1024);
+  utilities::Metrics::get_instance().render(body);
+
+  auto& services = ServiceManager::get_instance();
+  utilities::prometheus::append_family(
+      body, "buyer_s3_operation_duration_seconds", "histogram",
+      "S3 request time from dispatch to SDK completion.");
+  for (std::size_t i = 0; i < S3_OPERATION_NAMES.size(); ++i) {
+    utilities::prometheus::append_histogram(
+        body, "buyer_s3_operation_duration_seconds",
+        std::format("operation=\"{}\"", S3_OPERATION_NAMES[i]),
+        services.get_s3_service().get_latency(static_cast<S3Operation>(i)));
+  }
+
+  const auto ws = services.get_connection_manager().stats();
+  append_gauge(body, "buyer_ws_connections", "Open notification WebSockets.",
+               ws.connections);
+  append_gauge(body, "buyer_ws_users",
+               "Users with at least one open notification WebSocket.",
+               ws.users);
+  append_gauge(body, "buyer_ws_topics", "Topics with at least one subscriber.",
+               ws.topics);
+  append_gauge(body, "buyer_ws_subscriptions",
+               "Connection ids subscribed, summed over topics.",
+               ws.subscriptions);
+  if (const auto rss = resident_bytes(); rss > 0) {
+    append_gauge(body, "buyer_process_resident_bytes",
+                 "Resident memory of the server process.", rss);
+  }
+
+  auto resp = drogon::HttpResponse::newHttpResponse();
+  resp->setContentTypeString("text/plain; version=0.0.4; charset=utf-8");
+  resp->setBody(std::move(body));
+  callback(resp);
+  co_return;
+}
+
+drogon::Task<> Admin::get_traces(
+    drogon::HttpRequestPtr req,
+    std::function<void(const drogon::HttpResponsePtr&)> callback) {
+  if (!on_admin_listener(req)) {
+    callback(drogon::HttpResponse::newNotFoundResponse(req));
+    co_return;
+  }
+
+  auto& traces = utilities::TraceStore::get_instance();
+  TracesResponse ret{.slow = traces.slow(), .sampled = traces.sampled()};
+  auto resp = drogon::HttpResponse::newHttpResponse(
+      drogon::k200OK, drogon::CT_APPLICATION_JSON);
+  resp->setBody(glz::write_json(ret).value_or(""));
+  callback(resp);
+  co_return;
+}
+
+drogon::Task<> Admin::publish_probe(
+    drogon::HttpRequestPtr req,
+    std::function<void(const drogon::HttpResponsePtr&)> callback) {
+  if (!on_admin_listener(req)) {
+    callback(drogon::HttpResponse::newNotFoundResponse(req));
+    co_return;
+  }
+
+  const auto& topic = req->getParameter("topic");
+  const auto seq =
+      convert::string_to_number<std::uint64_t>(req->getParameter("seq"));
+  if (topic.empty() || !seq) {
+    SimpleError error{.error = "topic and seq are required"};
+    auto resp = drogon::HttpResponse::newHttpResponse(
+        drogon::k400BadRequest, drogon::CT_APPLICATION_JSON);
+    resp->setBody(glz::write_json(error).value_or(""));
+    callback(resp);
+    co_return;
+  }
+
+  // Stamped last, so the bench measures from publish to the frame
+  ProbeMessage probe{.seq = *seq};
+  probe.published_at_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  ServiceManager::get_instance().get_publisher().publish(
+      topic, glz::write_json(probe).value_or(""));
+
+  callback(drogon::HttpResponse::newHttpResponse());
+  co_return;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <drogon/HttpController.h>
+
+namespace api {
+namespace v1 {
+/**
+ * @brief Operational endpoints, only served on the loopback admin listener
+ * (custom_config admin_port, default 9464, 0 disables it). On the public
+ * listener they answer 404.
+ */
+class Admin : public drogon::HttpController<Admin> {
+ public:
+  METHOD_LIST_BEGIN
+  // Prometheus text format, see utilities/metrics.hpp
+  ADD_METHOD_TO(Admin::get_metrics, "/metrics", drogon::Get);
+  // Kept DB traces as JSON, see utilities/db_tracing.hpp
+  ADD_METHOD_TO(Admin::get_traces, "/traces", drogon::Get);
+  // Timestamped probe through PubManager, see bench/notification_bench.cc
+  ADD_METHOD_TO(Admin::publish_probe, "/publish", drogon::Post);
+  METHOD_LIST_END
+
+  static drogon::Task<> get_metrics(
+      drogon::HttpRequestPtr req,
+      std::function<void(const drogon::HttpResponsePtr&)> callback);
+
+  static drogon::Task<> get_traces(
+      drogon::HttpRequestPtr req,
+      std::function<void(const drogon::HttpResponsePtr&)> callback);
+
+  static drogon::Task<> publish_probe(
+      drogon::HttpRequestPtr req,
+      std::function<void(const drogon::HttpResponsePtr&)> callback);
+};
+}  // namespace v1
+}  // namespace api
@@ -16,6 +16,7 @@
 #include <sstream>
 
 #include "../config/config.hpp"
+#include "../utilities/db_tracing.hpp"
 #include "../utilities/json_manipulation.hpp"
 #include "../utilities/validation.hpp"
 #include "common_req_n_resp.hpp"
@@ -191,7 +192,7 @@ drogon::Task<> Authentication::login(
   // LOG_INFO << "Password hash:" << hash_password_with_argon2(password) <<
   // std::endl;
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
   try {
     auto result = co_await db->execSqlCoro(
         "SELECT id, username, password_hash FROM users WHERE username = $1",
@@ -277,7 +278,7 @@ drogon::Task<> Authentication::logout(
   if (!auth_header.empty() && auth_header.substr(0, 7) == "Bearer ") {
     std::string token = auth_header.substr(7);
 
-    auto db = app().getDbClient();
+    auto db = utilities::traced_db_client(req);
     try {
       co_await db->execSqlCoro("DELETE FROM user_sessions WHERE token = $1",
                                token);
@@ -322,7 +323,7 @@ drogon::Task<> Authentication::refresh(
     co_return;
   }
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
   try {
     auto result = co_await db->execSqlCoro(
         "SELECT user_id, expires_at FROM user_sessions WHERE refresh_token ="
@@ -475,7 +476,7 @@ drogon::Task<> Authentication::register_user(
     co_return;
   }
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -16,7 +16,11 @@
 
 #include "../services/service_manager.hpp"
 #include "../utilities/conversion.hpp"
+#include "../utilities/db_routing.hpp"
 #include "../utilities/json_manipulation.hpp"
+#include "../utilities/json_response.hpp"
+#include "../utilities/row_mapping.hpp"
+#include "../utilities/sql_pipeline.hpp"
 #include "common_req_n_resp.hpp"
 #include "scenario_specific_utils.hpp"
 
@@ -56,16 +60,27 @@ struct CreateConversationResponse {
   std::string message;
 };
 
+// Views into the messages query Result, see utilities::RowMapper
 struct Message {
   int id;
   int sender_id;
-  std::string sender_name;
-  std::string content;
-  std::string message_type;
+  std::string_view sender_name;
+  std::string_view content;
+  std::string_view message_type;
   bool is_read;
-  std::string created_at;
-  std::string metadata;  // json content
+  std::string_view created_at;
+  std::string_view metadata;  // json content
   std::optional<std::vector<MediaQuickInfo>> media;
+
+  static constexpr auto columns = std::tuple{
+      utilities::column("id", &Message::id),
+      utilities::column("sender_id", &Message::sender_id),
+      utilities::column("sender_name", &Message::sender_name),
+      utilities::column("content", &Message::content),
+      utilities::column("message_type", &Message::message_type),
+      utilities::column("is_read", &Message::is_read),
+      utilities::column("created_at", &Message::created_at),
+      utilities::column("metadata", &Message::metadata)};
 };
 
 struct SendMessageRequest {
@@ -101,7 +116,7 @@ Task<> Chats::get_conversations(
   std::string user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
-  auto db = app().getDbClient();
+  auto db = utilities::read_db_client(req);
 
   try {
     // Get all conversations where the current user is a participant
@@ -137,16 +152,11 @@ Task<> Chats::get_conversations(
           .modified_at = row["created_at"].as<std::string>()});
     }
 
-    auto resp = HttpResponse::newHttpResponse(k200OK, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(data).value_or(""));
-    callback(resp);
+    callback(utilities::negotiated_response(req, data));
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
-    SimpleError ret{.error = "Database error"};
-    auto resp = HttpResponse::newHttpResponse(k500InternalServerError,
-                                              CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(ret).value_or(""));
-    callback(resp);
+    callback(
+        utilities::error_response<"Database error">(k500InternalServerError));
   }
 
   co_return;
@@ -174,7 +184,7 @@ Task<> Chats::create_conversation(
   std::string user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -281,15 +291,12 @@ Task<> Chats::get_messages(HttpRequestPtr req,
 
   auto conv_id_optional = convert::string_to_int(conversation_id);
   if (!conv_id_optional || conv_id_optional.value() < 0) {
-    SimpleError ret{.error = "Invalid conversation_id"};
-    auto resp =
-        HttpResponse::newHttpResponse(k400BadRequest, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(ret).value_or(""));
-    callback(resp);
+    callback(
+        utilities::error_response<"Invalid conversation_id">(k400BadRequest));
     co_return;
   }
   int conv_id = conv_id_optional.value();
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -299,11 +306,9 @@ Task<> Chats::get_messages(HttpRequestPtr req,
         conv_id, convert::string_to_int(user_id).value());
 
     if (result.empty()) {
-      SimpleError ret{.error = "Unauthorized access to conversation"};
-      auto resp =
-          HttpResponse::newHttpResponse(k403Forbidden, CT_APPLICATION_JSON);
-      resp->setBody(glz::write_json(ret).value_or(""));
-      callback(resp);
+      callback(
+          utilities::error_response<"Unauthorized access to conversation">(
+              k403Forbidden));
       co_return;
     }
 
@@ -316,35 +321,25 @@ Task<> Chats::get_messages(HttpRequestPtr req,
         "ORDER BY m.created_at ASC",
         conv_id);
 
+    utilities::RowMapper<Message> to_message(messages_result);
     std::vector<Message> messages_list;
     messages_list.reserve(messages_result.size());
     for (const auto& row : messages_result) {
-      int message_id = row["id"].as<int>();
+      auto& message = messages_list.emplace_back(to_message(row));
       auto media_attachments =
-          row["message_type"].as<std::string>() != "text"
-              ? co_await get_media_attachments("message", message_id)
+          message.message_type != "text"
+              ? co_await get_media_attachments("message", message.id)
               : std::unexpected<std::string>("failed");
-      messages_list.emplace_back(
-          Message{.id = message_id,
-                  .sender_id = row["sender_id"].as<int>(),
-                  .sender_name = row["sender_name"].as<std::string>(),
-                  .content = row["content"].as<std::string>(),
-                  .message_type = row["message_type"].as<std::string>(),
-                  .is_read = row["is_read"].as<bool>(),
-                  .created_at = row["created_at"].as<std::string>(),
-                  .metadata = row["metadata"].as<std::string>(),
-                  .media = media_attachments.value_or({})});
+      message.media = media_attachments.value_or({});
     }
-    auto resp = HttpResponse::newHttpResponse(k200OK, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(messages_list).value_or(""));
-    callback(resp);
+    auto& compressor = ServiceManager::get_instance().get_response_compressor();
+    callback(co_await compressor.compress(
+        req, utilities::negotiated_response(req, messages_list),
+        "get_messages"));
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
-    SimpleError ret{.error = "Database error"};
-    auto resp = HttpResponse::newHttpResponse(k500InternalServerError,
-                                              CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(ret).value_or(""));
-    callback(resp);
+    callback(
+        utilities::error_response<"Database error">(k500InternalServerError));
   }
 
   co_return;
@@ -398,7 +393,7 @@ Task<> Chats::send_message(HttpRequestPtr req,
     message_type = content.empty() ? "media" : "mixed";
   }
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     int current_user_id = convert::string_to_int(user_id).value();
@@ -513,7 +508,7 @@ Task<> Chats::get_conversation_by_offer(
     std::string offer_id) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   auto offer_id_optional = convert::string_to_int(offer_id);
   if (!offer_id_optional || offer_id_optional.value() < 0) {
@@ -527,12 +522,27 @@ Task<> Chats::get_conversation_by_offer(
   int offer_id_int = offer_id_optional.value();
 
   try {
-    auto result = co_await db->execSqlCoro(
-        "SELECT o.*, p.user_id AS post_user_id "
-        "FROM offers o "
-        "JOIN posts p ON o.post_id = p.id "
-        "WHERE o.id = $1",
-        offer_id_int);
+    // The conversation lookup finds the other participant through the offer,
+    // so it goes out with the offer lookup instead of after it
+    auto [result, conv_result] = co_await utilities::pipeline(
+        db,
+        utilities::statement("SELECT o.user_id, p.user_id AS post_user_id "
+                             "FROM offers o "
+                             "JOIN posts p ON o.post_id = p.id "
+                             "WHERE o.id = $1",
+                             offer_id_int),
+        utilities::statement(
+            "SELECT cp1.conversation_id AS id "
+            "FROM offers o "
+            "JOIN posts p ON o.post_id = p.id "
+            "JOIN conversation_participants cp1 ON cp1.user_id = $2 "
+            "JOIN conversation_participants cp2 "
+            "ON cp2.conversation_id = cp1.conversation_id "
+            "AND cp2.user_id = CASE WHEN o.user_id = $2 "
+            "THEN p.user_id ELSE o.user_id END "
+            "WHERE o.id = $1 "
+            "LIMIT 1",
+            offer_id_int, convert::string_to_int(current_user_id).value()));
 
     if (result.empty()) {
       SimpleError ret{.error = "Offer not found"};
@@ -556,21 +566,23 @@ Task<> Chats::get_conversation_by_offer(
       co_return;
     }
 
-    auto conv_result = co_await db->execSqlCoro(
-        "SELECT c.id FROM conversations c "
-        "JOIN conversation_participants cp1 ON c.id = cp1.conversation_id "
-        "JOIN conversation_participants cp2 ON c.id = cp2.conversation_id "
-        "WHERE cp1.user_id = $1 AND cp2.user_id = $2 "
-        "LIMIT 1",
-        convert::string_to_int(current_user_id).value(),
-        (convert::string_to_int(current_user_id).value() == offer_user_id
-             ? post_user_id
-             : offer_user_id));
-
     if (conv_result.empty()) {
+      // Conversation and participants in one statement, one round trip and
+      // no conversation left without participants
       auto new_conv_result = co_await db->execSqlCoro(
-          "INSERT INTO conversations (name) VALUES ($1) RETURNING id",
-          "Offer #" + offer_id + " Conversation");
+          "WITH conversation AS ("
+          "  INSERT INTO conversations (name) VALUES ($1) RETURNING id"
+          "), participants AS ("
+          "  INSERT INTO conversation_participants (conversation_id, user_id) "
+          "  SELECT c.id, u.user_id FROM conversation c, "
+          "  unnest(ARRAY[$2::int, $3::int]) AS u(user_id)"
+          ") "
+          "SELECT id FROM conversation",
+          "Offer #" + offer_id + " Conversation",
+          convert::string_to_int(current_user_id).value(),
+          (convert::string_to_int(current_user_id).value() == offer_user_id
+               ? post_user_id
+               : offer_user_id));
 
       if (new_conv_result.empty()) {
         SimpleError ret{.error = "Failed to create conversation"};
@@ -581,33 +593,14 @@ Task<> Chats::get_conversation_by_offer(
         co_return;
       }
 
-      int conversation_id = new_conv_result[0]["id"].as<int>();
-
-      try {
-        co_await db->execSqlCoro(
-            "INSERT INTO conversation_participants "
-            "(conversation_id, user_id) VALUES ($1, $2), ($1, $3)",
-            conversation_id, convert::string_to_int(current_user_id).value(),
-            (convert::string_to_int(current_user_id).value() == offer_user_id
-                 ? post_user_id
-                 : offer_user_id));
-
-        GetConversationByOfferResponse response{
-            .status = "success",
-            .conversation_id = conversation_id,
-            .is_new = true};
+      GetConversationByOfferResponse response{
+          .status = "success",
+          .conversation_id = new_conv_result[0]["id"].as<int>(),
+          .is_new = true};
 
-        auto resp = HttpResponse::newHttpResponse(k200OK, CT_APPLICATION_JSON);
-        resp->setBody(glz::write_json(response).value_or(""));
-        callback(resp);
-      } catch (const DrogonDbException& e) {
-        LOG_ERROR << "Database error adding participants: " << e.base().what();
-        SimpleError ret{.error = "Database error"};
-        auto resp = HttpResponse::newHttpResponse(k500InternalServerError,
-                                                  CT_APPLICATION_JSON);
-        resp->setBody(glz::write_json(ret).value_or(""));
-        callback(resp);
-      }
+      auto resp = HttpResponse::newHttpResponse(k200OK, CT_APPLICATION_JSON);
+      resp->setBody(glz::write_json(response).value_or(""));
+      callback(resp);
     } else {
       GetConversationByOfferResponse response{
           .status = "success",
@@ -647,7 +640,7 @@ Task<> Chats::mark_messages_as_read(
   }
   int conv_id = conv_id_optional.value();
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -693,7 +686,7 @@ Task<> Chats::get_unread_count(
   std::string user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -706,16 +699,11 @@ Task<> Chats::get_unread_count(
 
     UnreadCountResponse ret{.unread_count =
                                 result[0]["unread_count"].as<int>()};
-    auto resp = HttpResponse::newHttpResponse(k200OK, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(ret).value_or(""));
-    callback(resp);
+    callback(utilities::json_response(ret));
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
-    SimpleError ret{.error = "Database error"};
-    auto resp = HttpResponse::newHttpResponse(k500InternalServerError,
-                                              CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(ret).value_or(""));
-    callback(resp);
+    callback(
+        utilities::error_response<"Database error">(k500InternalServerError));
   }
 
   co_return;
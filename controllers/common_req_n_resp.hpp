@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 
+#include "../services/media_server/media_variant.hpp"
+
 struct StatusResponse {
   std::string status;
   std::string message;
@@ -23,7 +25,7 @@ struct MediaQuickInfo {
   std::string filename;
   std::string mime_type;
   int64_t size = 0;
-  // No metadata for now
+  std::vector<MediaVariant> variants;  // empty until processed
 };
 
 struct MediaInput {
@@ -14,14 +14,21 @@
 #include <drogon/orm/SqlBinder.h>
 
 #include <algorithm>
+#include <chrono>
 #include <format>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <string>
 #include <vector>
 
 #include "../services/service_manager.hpp"
 #include "../utilities/conversion.hpp"
+#include "../utilities/db_routing.hpp"
 #include "../utilities/json_manipulation.hpp"
+#include "../utilities/json_response.hpp"
+#include "../utilities/row_mapping.hpp"
+#include "../utilities/sql_pipeline.hpp"
 #include "../utilities/time_manipulation.hpp"
 #include "common_req_n_resp.hpp"
 #include "scenario_specific_utils.hpp"
@@ -41,20 +48,38 @@ using drogon::orm::DrogonDbException;
 
 using api::v1::Community;
 
+// Views into a posts query Result (p.*, username, subscription_count and
+// is_subscribed), see utilities::RowMapper. media is set by the handlers.
 struct CommunityPost {
   int id;
   int user_id;
-  std::string username;
-  std::string content;
-  std::string created_at;
-  std::vector<std::string> tags;
-  std::string location;
+  std::string_view username;
+  std::string_view content;
+  std::string_view created_at;
+  std::vector<std::string_view> tags;
+  std::string_view location;
   bool is_product_request;
-  std::string request_status;
-  std::string price_range;
+  std::string_view request_status;
+  std::string_view price_range;
   int subscription_count;
   bool is_subscribed;
   std::optional<std::vector<MediaQuickInfo>> media;
+
+  static constexpr auto columns = std::tuple{
+      utilities::column("id", &CommunityPost::id),
+      utilities::column("user_id", &CommunityPost::user_id),
+      utilities::column("username", &CommunityPost::username),
+      utilities::column("content", &CommunityPost::content),
+      utilities::column("created_at", &CommunityPost::created_at),
+      utilities::column("tags", &CommunityPost::tags),
+      utilities::column("location", &CommunityPost::location),
+      utilities::column("is_product_request",
+                        &CommunityPost::is_product_request),
+      utilities::column("request_status", &CommunityPost::request_status),
+      utilities::column("price_range", &CommunityPost::price_range),
+      utilities::column("subscription_count",
+                        &CommunityPost::subscription_count),
+      utilities::column("is_subscribed", &CommunityPost::is_subscribed)};
 };
 
 struct CreatePostRequest {
@@ -93,9 +118,24 @@ struct Tag {
   int count;
 };
 
+// Popular tags are the same for every user and cost a scan of all posts.
+// The body is kept for popular_tags_cache_ttl_ms along with its compressed
+// variants, see CachedBody. With 0 every request queries and compresses at
+// the dynamic levels.
+struct PopularTagsCache {
+  std::mutex mutex;
+  std::shared_ptr<CachedBody> body;
+  std::chrono::steady_clock::time_point expires_at;
+};
+
+static PopularTagsCache& popular_tags_cache() {
+  static PopularTagsCache cache;
+  return cache;
+}
+
 Task<> Community::get_posts(
     HttpRequestPtr req, std::function<void(const HttpResponsePtr&)> callback) {
-  auto db = app().getDbClient();
+  auto db = utilities::read_db_client(req);
 
   int page = 1;
   auto page_param = req->getParameter("page");
@@ -124,42 +164,22 @@ Task<> Community::get_posts(
         "ORDER BY p.created_at DESC LIMIT $1 OFFSET $2",
         page_size, offset, convert::string_to_int(current_user_id).value());
 
+    utilities::RowMapper<CommunityPost> to_post(result);
     std::vector<CommunityPost> posts_list;
+    posts_list.reserve(result.size());
     for (const auto& row : result) {
-      int post_id = row["id"].as<int>();
-      auto media_attachments = co_await get_media_attachments("post", post_id);
-
-      posts_list.push_back(
-          {.id = post_id,
-           .user_id = row["user_id"].as<int>(),
-           .username = row["username"].as<std::string>(),
-           .content = row["content"].as<std::string>(),
-           .created_at = row["created_at"].as<std::string>(),
-           .tags = convert::pgsql_array_string_to_vector(
-               row["tags"].as<std::string>()),
-           .location = row["location"].isNull()
-                           ? ""
-                           : row["location"].as<std::string>(),
-           .is_product_request = row["is_product_request"].as<bool>(),
-           .request_status = row["request_status"].as<std::string>(),
-           .price_range = row["price_range"].isNull()
-                              ? ""
-                              : row["price_range"].as<std::string>(),
-           .subscription_count = row["subscription_count"].as<int>(),
-           .is_subscribed = row["is_subscribed"].as<bool>(),
-           .media = media_attachments.value_or({})});
+      auto& post = posts_list.emplace_back(to_post(row));
+      auto media_attachments = co_await get_media_attachments("post", post.id);
+      post.media = media_attachments.value_or({});
     }
 
-    auto resp = HttpResponse::newHttpResponse(k200OK, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(posts_list).value_or(""));
-    callback(resp);
+    auto& compressor = ServiceManager::get_instance().get_response_compressor();
+    callback(co_await compressor.compress(
+        req, utilities::negotiated_response(req, posts_list), "get_posts"));
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
-    SimpleError ret{.error = "Database error"};
-    auto resp = HttpResponse::newHttpResponse(k500InternalServerError,
-                                              CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(ret).value_or(""));
-    callback(resp);
+    callback(
+        utilities::error_response<"Database error">(k500InternalServerError));
   }
 
   co_return;
@@ -204,11 +224,20 @@ Task<> Community::create_post(
     co_return;
   }
 
-  auto db = app().getDbClient();
-  auto transaction = co_await db->newTransactionCoro();
+  const bool has_media =
+      create_post_req.media.has_value() && !create_post_req.media->empty();
+  auto db = utilities::traced_db_client(req);
+  // Without media the post is a single statement and needs no transaction,
+  // saving the BEGIN and COMMIT round trips
+  utilities::TracedDbPtr transaction;
+  utilities::TracedDbPtr writer = db;
+  if (has_media) {
+    transaction = co_await db->newTransactionCoro();
+    writer = transaction;
+  }
 
   try {
-    auto result = co_await transaction->execSqlCoro(
+    auto result = co_await writer->execSqlCoro(
         "INSERT INTO posts (user_id, content, tags, location, "
         "is_product_request, request_status, price_range) "
         "VALUES ($1, $2, $3, $4, $5, $6, $7) RETURNING id, created_at",
@@ -221,7 +250,7 @@ Task<> Community::create_post(
     int post_id = result[0]["id"].as<int>();
     std::string created_at = result[0]["created_at"].as<std::string>();
 
-    if (create_post_req.media.has_value() && !create_post_req.media->empty()) {
+    if (has_media) {
       std::size_t media_array_size = create_post_req.media->size();
       auto processed_media = co_await process_media_attachments(
           std::move(*create_post_req.media), transaction,
@@ -290,7 +319,9 @@ Task<> Community::create_post(
     resp->setBody(glz::write_json(ret).value_or(""));
     callback(resp);
   } catch (const std::exception& e) {
-    transaction->rollback();
+    if (transaction) {
+      transaction->rollback();
+    }
     LOG_ERROR << "Failed to create post" << e.what();
     SimpleError ret{.error = std::format("Failed to create post {}", e.what())};
     auto resp = HttpResponse::newHttpResponse(k500InternalServerError,
@@ -298,7 +329,9 @@ Task<> Community::create_post(
     resp->setBody(glz::write_json(ret).value_or(""));
     callback(resp);
   } catch (const DrogonDbException& e) {
-    transaction->rollback();
+    if (transaction) {
+      transaction->rollback();
+    }
     LOG_ERROR << "Database error: " << e.base().what();
     SimpleError ret{.error = "Database error"};
     auto resp = HttpResponse::newHttpResponse(k500InternalServerError,
@@ -314,7 +347,7 @@ Task<> Community::create_post(
 Task<> Community::get_post_by_id(
     HttpRequestPtr req, std::function<void(const HttpResponsePtr&)> callback,
     std::string id) {
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
@@ -330,16 +363,20 @@ Task<> Community::get_post_by_id(
   int post_id = post_id_optional.value();
 
   try {
-    auto result = co_await db->execSqlCoro(
-        "SELECT p.*, u.username, "
-        "(SELECT COUNT(*) FROM post_subscriptions WHERE post_id = p.id) AS "
-        "subscription_count, "
-        "EXISTS(SELECT 1 FROM post_subscriptions WHERE post_id = p.id AND "
-        "user_id = $2) AS is_subscribed "
-        "FROM posts p "
-        "JOIN users u ON p.user_id = u.id "
-        "WHERE p.id = $1",
-        post_id, convert::string_to_int(current_user_id).value());
+    // The media list doesn't depend on the post row, one round trip for both
+    auto [result, media_result] = co_await utilities::pipeline(
+        db,
+        utilities::statement(
+            "SELECT p.*, u.username, "
+            "(SELECT COUNT(*) FROM post_subscriptions WHERE post_id = p.id) "
+            "AS subscription_count, "
+            "EXISTS(SELECT 1 FROM post_subscriptions WHERE post_id = p.id "
+            "AND user_id = $2) AS is_subscribed "
+            "FROM posts p "
+            "JOIN users u ON p.user_id = u.id "
+            "WHERE p.id = $1",
+            post_id, convert::string_to_int(current_user_id).value()),
+        utilities::statement(media_attachments_sql("post"), post_id));
 
     if (result.empty()) {
       SimpleError ret{.error = "Post not found"};
@@ -350,30 +387,10 @@ Task<> Community::get_post_by_id(
       co_return;
     }
 
-    const auto& row = result[0];
-    auto media_attachments = co_await get_media_attachments("post", post_id);
-    CommunityPost post_obj{
-        .id = post_id,
-        .user_id = row["user_id"].as<int>(),
-        .username = row["username"].as<std::string>(),
-        .content = row["content"].as<std::string>(),
-        .created_at = row["created_at"].as<std::string>(),
-        .tags = convert::pgsql_array_string_to_vector(
-            row["tags"].as<std::string>()),
-        .location =
-            row["location"].isNull() ? "" : row["location"].as<std::string>(),
-        .is_product_request = row["is_product_request"].as<bool>(),
-        .request_status = row["request_status"].as<std::string>(),
-        .price_range = row["price_range"].isNull()
-                           ? ""
-                           : row["price_range"].as<std::string>(),
-        .subscription_count = row["subscription_count"].as<int>(),
-        .is_subscribed = row["is_subscribed"].as<bool>(),
-        .media = media_attachments.value_or({})};
+    auto post_obj = utilities::RowMapper<CommunityPost>(result)(result[0]);
+    post_obj.media = read_media_attachments(media_result);
 
-    auto resp = HttpResponse::newHttpResponse(k200OK, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(post_obj).value_or(""));
-    callback(resp);
+    callback(utilities::negotiated_response(req, post_obj));
 
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
@@ -431,7 +448,7 @@ Task<> Community::update_post(
     co_return;
   }
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto check_result = co_await db->execSqlCoro(
@@ -571,7 +588,7 @@ Task<> Community::update_post(
 // Filter posts by tags, location, and status
 Task<> Community::filter_posts(
     HttpRequestPtr req, std::function<void(const HttpResponsePtr&)> callback) {
-  auto db = app().getDbClient();
+  auto db = utilities::read_db_client(req);
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
@@ -672,32 +689,15 @@ Task<> Community::filter_posts(
         query, convert::string_to_int(current_user_id).value(), page_size,
         offset);
 
+    utilities::RowMapper<CommunityPost> to_post(result);
     std::vector<CommunityPost> posts_list;
+    posts_list.reserve(result.size());
     for (const auto& row : result) {
-      int post_id = row["id"].as<int>();
-      auto media_attachments = co_await get_media_attachments("post", post_id);
-      posts_list.emplace_back(CommunityPost{
-          .id = post_id,
-          .user_id = row["user_id"].as<int>(),
-          .username = row["username"].as<std::string>(),
-          .content = row["content"].as<std::string>(),
-          .created_at = row["created_at"].as<std::string>(),
-          .tags = convert::pgsql_array_string_to_vector(
-              row["tags"].as<std::string>()),
-          .location =
-              row["location"].isNull() ? "" : row["location"].as<std::string>(),
-          .is_product_request = row["is_product_request"].as<bool>(),
-          .request_status = row["request_status"].as<std::string>(),
-          .price_range = row["price_range"].isNull()
-                             ? ""
-                             : row["price_range"].as<std::string>(),
-          .subscription_count = row["subscription_count"].as<int>(),
-          .is_subscribed = row["is_subscribed"].as<bool>(),
-          .media = media_attachments.value_or({})});
+      auto& post = posts_list.emplace_back(to_post(row));
+      auto media_attachments = co_await get_media_attachments("post", post.id);
+      post.media = media_attachments.value_or({});
     }
-    auto resp = HttpResponse::newHttpResponse(k200OK, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(posts_list).value_or(""));
-    callback(resp);
+    callback(utilities::negotiated_response(req, posts_list));
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
     SimpleError ret{.error = "Database error"};
@@ -728,7 +728,7 @@ Task<> Community::subscribe_to_post(
   }
   int post_id_int = post_id_optional.value();
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -780,7 +780,7 @@ Task<> Community::unsubscribe_from_post(
   }
   int post_id_int = post_id_optional.value();
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -875,7 +875,7 @@ Task<> Community::get_subscriptions(
     HttpRequestPtr req, std::function<void(const HttpResponsePtr&)> callback) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -890,34 +890,17 @@ Task<> Community::get_subscriptions(
         "ORDER BY p.created_at DESC",
         convert::string_to_int(current_user_id).value());
 
+    utilities::RowMapper<CommunityPost> to_post(result);
     std::vector<CommunityPost> posts_list;
     posts_list.reserve(result.size());
     for (const auto& row : result) {
-      std::optional<std::vector<MediaQuickInfo>> media_attachments =
-          std::nullopt;
-      posts_list.emplace_back(CommunityPost{
-          .id = row["id"].as<int>(),
-          .user_id = row["user_id"].as<int>(),
-          .username = row["username"].as<std::string>(),
-          .content = row["content"].as<std::string>(),
-          .created_at = row["created_at"].as<std::string>(),
-          .tags = convert::pgsql_array_string_to_vector(
-              row["tags"].as<std::string>()),
-          .location =
-              row["location"].isNull() ? "" : row["location"].as<std::string>(),
-          .is_product_request = row["is_product_request"].as<bool>(),
-          .request_status = row["request_status"].as<std::string>(),
-          .price_range = row["price_range"].isNull()
-                             ? ""
-                             : row["price_range"].as<std::string>(),
-          .subscription_count = row["subscription_count"].as<int>(),
-          .is_subscribed = row["is_subscribed"].as<bool>(),
-          .media = media_attachments});
+      posts_list.emplace_back(to_post(row));  // no media in this listing
     }
 
-    auto resp = HttpResponse::newHttpResponse(k200OK, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(posts_list).value_or(""));
-    callback(resp);
+    auto& compressor = ServiceManager::get_instance().get_response_compressor();
+    callback(co_await compressor.compress(
+        req, utilities::negotiated_response(req, posts_list),
+        "get_subscriptions"));
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
     SimpleError ret{.error = "Database error"};
@@ -933,7 +916,24 @@ Task<> Community::get_subscriptions(
 // Get popular tags
 Task<> Community::get_popular_tags(
     HttpRequestPtr req, std::function<void(const HttpResponsePtr&)> callback) {
-  auto db = app().getDbClient();
+  static const std::chrono::milliseconds ttl(
+      std::max(config::get_config_int("popular_tags_cache_ttl_ms", 30000), 0));
+  auto& cache = popular_tags_cache();
+  auto& compressor = ServiceManager::get_instance().get_response_compressor();
+
+  std::shared_ptr<CachedBody> body;
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.body && std::chrono::steady_clock::now() < cache.expires_at) {
+      body = cache.body;
+    }
+  }
+  if (body) {
+    callback(co_await compressor.respond(req, body, "get_popular_tags"));
+    co_return;
+  }
+
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -951,16 +951,26 @@ Task<> Community::get_popular_tags(
                                .count = row["count"].as<int>()});
     }
 
-    auto resp = HttpResponse::newHttpResponse(k200OK, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(tags_response).value_or(""));
-    callback(resp);
+    if (ttl == std::chrono::milliseconds::zero()) {
+      // Built for this request only, the cached levels would not pay off
+      callback(co_await compressor.compress(
+          req, utilities::json_response(tags_response), "get_popular_tags"));
+      co_return;
+    }
+
+    body = std::make_shared<CachedBody>(
+        utilities::write_json_body(tags_response),
+        "application/json; charset=utf-8");
+    {
+      std::lock_guard<std::mutex> lock(cache.mutex);
+      cache.body = body;
+      cache.expires_at = std::chrono::steady_clock::now() + ttl;
+    }
+    callback(co_await compressor.respond(req, body, "get_popular_tags"));
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
-    SimpleError ret{.error = "Database error"};
-    auto resp = HttpResponse::newHttpResponse(k500InternalServerError,
-                                              CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(ret).value_or(""));
-    callback(resp);
+    callback(
+        utilities::error_response<"Database error">(k500InternalServerError));
   }
 
   co_return;
@@ -2,7 +2,9 @@
 
 #include <drogon/HttpResponse.h>
 
+#include "../services/service_manager.hpp"
 #include "../utilities/conversion.hpp"
+#include "../utilities/db_tracing.hpp"
 #include "../utilities/json_manipulation.hpp"
 #include "common_req_n_resp.hpp"
 
@@ -23,7 +25,7 @@ struct OrdersData {
 drogon::Task<> Dashboard::get_dashboard_data(
     drogon::HttpRequestPtr req,
     std::function<void(const drogon::HttpResponsePtr&)> callback) {
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   // Pagination parameters
   std::size_t page = 1;
@@ -67,3 +69,15 @@ drogon::Task<> Dashboard::get_dashboard_data(
 
   co_return;
 }
+
+drogon::Task<> Dashboard::get_compression_stats(
+    drogon::HttpRequestPtr req,
+    std::function<void(const drogon::HttpResponsePtr&)> callback) {
+  auto stats =
+      ServiceManager::get_instance().get_response_compressor().stats();
+  auto resp =
+      HttpResponse::newHttpResponse(drogon::k200OK, CT_APPLICATION_JSON);
+  resp->setBody(glz::write_json(stats).value_or(""));
+  callback(resp);
+  co_return;
+}
@@ -10,11 +10,18 @@ class Dashboard : public drogon::HttpController<Dashboard> {
   METHOD_LIST_BEGIN
   ADD_METHOD_TO(Dashboard::get_dashboard_data, "/api/v1/dashboard", drogon::Get,
                 drogon::Options, "CorsMiddleware", "AuthMiddleware");
+  // Per endpoint compression ratio and worker time, see ResponseCompressor
+  ADD_METHOD_TO(Dashboard::get_compression_stats,
+                "/api/v1/dashboard/compression-stats", drogon::Get,
+                drogon::Options, "CorsMiddleware", "AuthMiddleware");
   METHOD_LIST_END
 
   static drogon::Task<> get_dashboard_data(
       drogon::HttpRequestPtr req,
       std::function<void(const drogon::HttpResponsePtr&)> callback);
+  static drogon::Task<> get_compression_stats(
+      drogon::HttpRequestPtr req,
+      std::function<void(const drogon::HttpResponsePtr&)> callback);
 };
 }  // namespace v1
 }  // namespace api
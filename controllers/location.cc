@@ -12,9 +12,19 @@
 #include <drogon/orm/Row.h>
 #include <drogon/orm/SqlBinder.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <format>
+#include <numbers>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "../services/service_manager.hpp"
 #include "../utilities/conversion.hpp"
+#include "../utilities/db_routing.hpp"
 #include "../utilities/json_manipulation.hpp"
 #include "common_req_n_resp.hpp"
 
@@ -40,10 +50,43 @@ struct AddLocationResponse {
   std::string device_id;
 };
 
+struct BatchLocationRequest {
+  std::vector<AddLocationRequest> readings;
+};
+
+struct BatchLocationResponse {
+  std::string status;
+  std::string device_id;
+  std::size_t accepted;
+};
+
 struct ClusterData {
   std::string id;
   int point_count;
   std::string centroid;  // ST_AsGeoJSON returns a string
+  // [min_longitude, min_latitude, max_longitude, max_latitude]
+  std::array<double, 4> bbox;
+};
+
+struct TileData {
+  int x;
+  int y;
+  int point_count;
+};
+
+struct TilesResponse {
+  int zoom;
+  std::vector<TileData> tiles;
+};
+
+struct ReclusterResponse {
+  std::string status;
+  std::string mode;
+  int64_t rows_evaluated;
+  int64_t rows_changed;
+  int64_t clusters_changed;
+  int64_t tiles_changed;
+  double duration_ms;
 };
 
 struct LocationPointResponse {
@@ -56,6 +99,34 @@ struct LocationPointResponse {
   double distance;
 };
 
+// Same Web Mercator tiling as location_tile_x/location_tile_y in
+// migrations/002_location_aggregates.sql
+static int tile_x(double longitude, int zoom) {
+  const double n = static_cast<double>(1 << zoom);
+  return std::clamp(
+      static_cast<int>(std::floor((longitude + 180.0) / 360.0 * n)), 0,
+      (1 << zoom) - 1);
+}
+
+static int tile_y(double latitude, int zoom) {
+  const double n = static_cast<double>(1 << zoom);
+  const double lat =
+      std::clamp(latitude, -85.05112878, 85.05112878) * std::numbers::pi /
+      180.0;
+  return std::clamp(
+      static_cast<int>(std::floor(
+          (1.0 - std::log(std::tan(lat) + 1.0 / std::cos(lat)) /
+                     std::numbers::pi) /
+          2.0 * n)),
+      0, (1 << zoom) - 1);
+}
+
+// Tiles a single viewport request may cover
+constexpr int64_t MAX_VIEWPORT_TILES = 4096;
+
+// Readings a single batch request may carry
+constexpr std::size_t MAX_BATCH_READINGS = 500;
+
 drogon::Task<> LocationController::add_location(
     const HttpRequestPtr req,
     std::function<void(const HttpResponsePtr&)> callback) {
@@ -81,18 +152,61 @@ drogon::Task<> LocationController::add_location(
     std::string device_id =
         user_id + "_device";  // single device location stored per user_id
 
-    auto client = app().getDbClient();
-    co_await client->execSqlCoro(
+    auto& cluster_service =
+        ServiceManager::get_instance().get_cluster_service();
+
+    // Joins the nearest clustered neighbour within epsilon right away, merges
+    // and splits are left to the incremental clustering pass
+    auto client = utilities::traced_db_client(req);
+    auto result = co_await client->execSqlCoro(
+        "WITH previous AS ("
+        "  SELECT cluster_id, latitude, longitude FROM locations "
+        "  WHERE user_id = $1"
+        "), nearest AS ("
+        "  SELECT cluster_id FROM locations "
+        "  WHERE user_id <> $1 AND cluster_id IS NOT NULL "
+        "  AND ST_DWithin(geom, ST_SetSRID(ST_MakePoint($3, $2), "
+        "4326)::geography, $6) "
+        "  ORDER BY geom <-> ST_SetSRID(ST_MakePoint($3, $2), "
+        "4326)::geography LIMIT 1"
+        ") "
         "INSERT INTO locations (user_id, latitude, longitude, accuracy, "
-        "device_id, geom) "
-        "VALUES ($1, $2, $3, $4, $5, ST_SetSRID(ST_MakePoint($3, $2), 4326)) "
+        "device_id, geom, cluster_id) "
+        "VALUES ($1, $2, $3, $4, $5, ST_SetSRID(ST_MakePoint($3, $2), 4326), "
+        "(SELECT cluster_id FROM nearest)) "
         "ON CONFLICT (user_id) DO UPDATE "
         "SET latitude = EXCLUDED.latitude, longitude = EXCLUDED.longitude, "
         "accuracy = EXCLUDED.accuracy, geom = "
         "ST_SetSRID(ST_MakePoint(EXCLUDED.longitude, EXCLUDED.latitude), "
-        "4326), device_id = EXCLUDED.device_id",
+        "4326), device_id = EXCLUDED.device_id, "
+        "cluster_id = EXCLUDED.cluster_id, updated_at = NOW() "
+        "RETURNING (SELECT cluster_id FROM previous) AS previous_cluster_id, "
+        "(SELECT latitude FROM previous) AS previous_latitude, "
+        "(SELECT longitude FROM previous) AS previous_longitude",
         std::stoi(user_id), add_req.latitude, add_req.longitude,
-        add_req.gps_accuracy.value_or(100.0), device_id);
+        add_req.gps_accuracy.value_or(100.0), device_id,
+        cluster_service.epsilon());
+
+    std::optional<std::string> previous_cluster_id;
+    std::optional<GeoPosition> previous_position;
+    if (!result.empty() && !result[0]["previous_cluster_id"].isNull()) {
+      previous_cluster_id = result[0]["previous_cluster_id"].as<std::string>();
+    }
+    if (!result.empty() && !result[0]["previous_latitude"].isNull()) {
+      previous_position = GeoPosition{
+          .latitude = result[0]["previous_latitude"].as<double>(),
+          .longitude = result[0]["previous_longitude"].as<double>()};
+    }
+    cluster_service.mark_dirty(
+        std::stoi(user_id), std::move(previous_cluster_id), previous_position,
+        GeoPosition{.latitude = add_req.latitude,
+                    .longitude = add_req.longitude});
+
+    ServiceManager::get_instance().get_location_index().upsert(
+        GeoPoint{.user_id = std::stoi(user_id),
+                 .latitude = add_req.latitude,
+                 .longitude = add_req.longitude,
+                 .accuracy = add_req.gps_accuracy.value_or(100.0)});
 
     AddLocationResponse response{.status = "success", .device_id = device_id};
     auto resp =
@@ -111,6 +225,67 @@ drogon::Task<> LocationController::add_location(
   co_return;
 }
 
+// Readings are oldest first, the last one wins. Written by the next flush.
+drogon::Task<> LocationController::add_locations_batch(
+    const HttpRequestPtr req,
+    std::function<void(const HttpResponsePtr&)> callback) {
+  BatchLocationRequest batch_req;
+  auto parse_error = utilities::strict_read_json(batch_req, req->getBody());
+
+  auto invalid = [](const AddLocationRequest& reading) {
+    return (reading.latitude == 0.0 && reading.longitude == 0.0) ||
+           reading.latitude < -90.0 || reading.latitude > 90.0 ||
+           reading.longitude < -180.0 || reading.longitude > 180.0;
+  };
+  if (parse_error || batch_req.readings.empty() ||
+      batch_req.readings.size() > MAX_BATCH_READINGS ||
+      std::ranges::any_of(batch_req.readings, invalid)) {
+    SimpleError error{.error = std::format(
+                          "Expected 1 to {} readings with a valid latitude "
+                          "and longitude",
+                          MAX_BATCH_READINGS)};
+    auto resp =
+        HttpResponse::newHttpResponse(k400BadRequest, CT_APPLICATION_JSON);
+    resp->setBody(glz::write_json(error).value_or(""));
+    callback(resp);
+    co_return;
+  }
+
+  std::string user_id =
+      req->getAttributes()->get<std::string>("current_user_id");
+
+  auto& ingest_service =
+      ServiceManager::get_instance().get_location_ingest_service();
+  for (const auto& reading : batch_req.readings) {
+    ingest_service.submit(
+        GeoPoint{.user_id = std::stoi(user_id),
+                 .latitude = reading.latitude,
+                 .longitude = reading.longitude,
+                 .accuracy = reading.gps_accuracy.value_or(100.0)});
+  }
+
+  BatchLocationResponse response{.status = "accepted",
+                                 .device_id = user_id + "_device",
+                                 .accepted = batch_req.readings.size()};
+  auto resp =
+      HttpResponse::newHttpResponse(drogon::k202Accepted, CT_APPLICATION_JSON);
+  resp->setBody(glz::write_json(response).value_or(""));
+  callback(resp);
+  co_return;
+}
+
+drogon::Task<> LocationController::get_ingest_stats(
+    const HttpRequestPtr req,
+    std::function<void(const HttpResponsePtr&)> callback) {
+  auto stats =
+      ServiceManager::get_instance().get_location_ingest_service().stats();
+  auto resp =
+      HttpResponse::newHttpResponse(drogon::k200OK, CT_APPLICATION_JSON);
+  resp->setBody(glz::write_json(stats).value_or(""));
+  callback(resp);
+  co_return;
+}
+
 // Paginated by offset (15 per page)
 drogon::Task<> LocationController::get_clusters(
     const HttpRequestPtr req,
@@ -123,12 +298,11 @@ drogon::Task<> LocationController::get_clusters(
   }
 
   try {
-    auto client = app().getDbClient();
+    auto client = utilities::read_db_client(req);
     auto result = co_await client->execSqlCoro(
-        "SELECT cluster_id, "
-        "ST_AsGeoJSON(ST_Centroid(ST_Collect(geom::geometry))) as centroid, "
-        "COUNT(*) as point_count FROM locations WHERE cluster_id IS NOT NULL "
-        "GROUP BY cluster_id OFFSET $1 LIMIT 15",
+        "SELECT cluster_id, point_count, ST_AsGeoJSON(centroid) as centroid, "
+        "min_latitude, min_longitude, max_latitude, max_longitude "
+        "FROM location_clusters ORDER BY cluster_id OFFSET $1 LIMIT 15",
         offset);
 
     std::vector<ClusterData> clusters_data;
@@ -137,7 +311,11 @@ drogon::Task<> LocationController::get_clusters(
       clusters_data.push_back(
           ClusterData{.id = row["cluster_id"].as<std::string>(),
                       .point_count = row["point_count"].as<int>(),
-                      .centroid = row["centroid"].as<std::string>()});
+                      .centroid = row["centroid"].as<std::string>(),
+                      .bbox = {row["min_longitude"].as<double>(),
+                               row["min_latitude"].as<double>(),
+                               row["max_longitude"].as<double>(),
+                               row["max_latitude"].as<double>()}});
     }
 
     auto resp =
@@ -155,6 +333,90 @@ drogon::Task<> LocationController::get_clusters(
   co_return;
 }
 
+// Point counts of the non-empty tiles intersecting the viewport, a
+// min_lon greater than max_lon crosses the antimeridian
+drogon::Task<> LocationController::get_tiles(
+    const HttpRequestPtr req,
+    std::function<void(const HttpResponsePtr&)> callback) {
+  auto zoom = convert::string_to_int(req->getParameter("zoom"));
+  auto min_lat =
+      convert::string_to_number<double>(req->getParameter("min_lat"));
+  auto min_lon =
+      convert::string_to_number<double>(req->getParameter("min_lon"));
+  auto max_lat =
+      convert::string_to_number<double>(req->getParameter("max_lat"));
+  auto max_lon =
+      convert::string_to_number<double>(req->getParameter("max_lon"));
+
+  auto bad_request = [&](std::string message) {
+    auto resp =
+        HttpResponse::newHttpResponse(k400BadRequest, CT_APPLICATION_JSON);
+    resp->setBody(glz::write_json(SimpleError{.error = std::move(message)})
+                      .value_or(""));
+    callback(resp);
+  };
+  if (!zoom || *zoom < 0 || !min_lat || !min_lon || !max_lat || !max_lon ||
+      *min_lat > *max_lat) {
+    bad_request("zoom, min_lat, min_lon, max_lat and max_lon are required");
+    co_return;
+  }
+
+  const int z = std::min(*zoom, ClusterService::MAX_TILE_ZOOM);
+  const int y_first = tile_y(*max_lat, z);
+  const int y_last = tile_y(*min_lat, z);
+  int x_first = tile_x(*min_lon, z);
+  int x_last = tile_x(*max_lon, z);
+  // Second x range, empty unless the viewport wraps around
+  int wrap_first = 1;
+  int wrap_last = 0;
+  if (*min_lon > *max_lon) {
+    wrap_first = 0;
+    wrap_last = x_last;
+    x_last = (1 << z) - 1;
+  }
+  const int64_t tile_count =
+      int64_t{y_last - y_first + 1} *
+      (int64_t{x_last - x_first + 1} + std::max(wrap_last - wrap_first + 1, 0));
+  if (tile_count > MAX_VIEWPORT_TILES) {
+    bad_request(std::format(
+        "Viewport covers {} tiles at zoom {}, the limit is {}", tile_count, z,
+        MAX_VIEWPORT_TILES));
+    co_return;
+  }
+
+  try {
+    auto client = utilities::read_db_client(req);
+    auto result = co_await client->execSqlCoro(
+        "SELECT x, y, point_count FROM location_tiles "
+        "WHERE zoom = $1 AND y BETWEEN $2 AND $3 "
+        "AND (x BETWEEN $4 AND $5 OR x BETWEEN $6 AND $7) "
+        "AND point_count > 0 ORDER BY x, y",
+        z, y_first, y_last, x_first, x_last, wrap_first, wrap_last);
+
+    TilesResponse response{.zoom = z, .tiles = {}};
+    response.tiles.reserve(result.size());
+    for (const auto& row : result) {
+      response.tiles.push_back(
+          TileData{.x = row["x"].as<int>(),
+                   .y = row["y"].as<int>(),
+                   .point_count = row["point_count"].as<int>()});
+    }
+
+    auto resp =
+        HttpResponse::newHttpResponse(drogon::k200OK, CT_APPLICATION_JSON);
+    resp->setBody(glz::write_json(response).value_or(""));
+    callback(resp);
+  } catch (const DrogonDbException& e) {
+    LOG_ERROR << "Database error getting tiles: " << e.base().what();
+    SimpleError error{.error = e.base().what()};
+    auto resp = drogon::HttpResponse::newHttpResponse(
+        drogon::k500InternalServerError, CT_APPLICATION_JSON);
+    resp->setBody(glz::write_json(error).value_or(""));
+    callback(resp);
+  }
+  co_return;
+}
+
 // Paginated by offset (15 per page)
 drogon::Task<> LocationController::find_nearby(
     const HttpRequestPtr req,
@@ -187,7 +449,60 @@ drogon::Task<> LocationController::find_nearby(
     double radius =
         convert::string_to_number<double>(radius_str).value_or(1000.0);
 
-    auto client = app().getDbClient();
+    auto client = utilities::read_db_client(req);
+
+    auto& location_index = ServiceManager::get_instance().get_location_index();
+    if (location_index.ready()) {
+      auto hits = location_index.query_radius(lat, lon, radius,
+                                              static_cast<std::size_t>(offset),
+                                              15);
+
+      // The index only answers the spatial part, the page is completed from
+      // the table by primary key
+      std::vector<std::string> user_ids;
+      user_ids.reserve(hits.size());
+      for (const auto& hit : hits) {
+        user_ids.push_back(std::to_string(hit.point.user_id));
+      }
+      ankerl::unordered_dense::map<int, std::pair<std::string, std::string>>
+          details;
+      if (!user_ids.empty()) {
+        auto result = co_await client->execSqlCoro(
+            "SELECT user_id, device_id, cluster_id FROM locations "
+            "WHERE user_id = ANY($1::int[])",
+            convert::array_to_pgsql_array_string(user_ids));
+        details.reserve(result.size());
+        for (const auto& row : result) {
+          details.emplace(row["user_id"].as<int>(),
+                          std::pair{row["device_id"].as<std::string>(),
+                                    row["cluster_id"].as<std::string>()});
+        }
+      }
+
+      std::vector<LocationPointResponse> nearby_points;
+      nearby_points.reserve(hits.size());
+      for (const auto& hit : hits) {
+        auto it = details.find(hit.point.user_id);
+        if (it == details.end()) {
+          continue;
+        }
+        nearby_points.push_back(LocationPointResponse{
+            .latitude = hit.point.latitude,
+            .longitude = hit.point.longitude,
+            .accuracy = hit.point.accuracy,
+            .user_id = std::to_string(hit.point.user_id),
+            .device_id = it->second.first,
+            .cluster_id = it->second.second,
+            .distance = hit.distance});
+      }
+
+      auto resp =
+          HttpResponse::newHttpResponse(drogon::k200OK, CT_APPLICATION_JSON);
+      resp->setBody(glz::write_json(nearby_points).value_or(""));
+      callback(resp);
+      co_return;
+    }
+
     auto result = co_await client->execSqlCoro(
         "SELECT user_id, latitude, longitude, accuracy, device_id, cluster_id, "
         "ST_Distance(geom, ST_SetSRID(ST_MakePoint($2, $1), 4326)::geography) "
@@ -229,46 +544,37 @@ drogon::Task<> LocationController::find_nearby(
 drogon::Task<> LocationController::recluster(
     const HttpRequestPtr req,
     std::function<void(const HttpResponsePtr&)> callback) {
-  double epsilon = 1000.0;  // meters
+  std::optional<double> epsilon;  // meters, configured value by default
   try {
     auto epsilon_str = req->getParameter("epsilon");
     if (!epsilon_str.empty()) {
-      epsilon = convert::string_to_number<double>(epsilon_str).value_or(1000.0);
-      if (epsilon < 0 || epsilon > 10'000'000) epsilon = 1000.0;
+      epsilon = convert::string_to_number<double>(epsilon_str);
+      if (epsilon && (*epsilon <= 0 || *epsilon > 10'000'000)) {
+        epsilon.reset();
+      }
     }
   } catch (...) {
-    epsilon = 1000.0;
+    epsilon.reset();
   }
 
+  // full (default) reclusters the table, incremental only what changed since
+  // the last pass
+  const auto mode = req->getParameter("mode") == "incremental"
+                        ? ClusterMode::incremental
+                        : ClusterMode::full;
+
   try {
-    // other Parameters for DBSCAN
-    int min_points = 2;
-
-    auto client = app().getDbClient();
-    // CTE: Assign cluster numbers using PostGIS DBSCAN
-    // and update the locations table with new cluster_ids
-    auto result = co_await client->execSqlCoro(R"(
-  WITH transformed AS (
-    SELECT id, ST_Transform(geom::geometry, 3857) AS geom_3857
-    FROM locations
-  ),
-  clustered AS (
-    SELECT id,
-           ST_ClusterDBSCAN(geom_3857, $1,$2) OVER () AS cluster_num
-    FROM transformed
-  )
-  UPDATE locations loc
-  SET cluster_id = CASE 
-    WHEN c.cluster_num IS NULL THEN NULL
-    ELSE 'cluster_' || c.cluster_num::text
-  END
-  FROM clustered c
-  WHERE loc.id = c.id
-  RETURNING loc.id, loc.cluster_id
-)",
-                                               epsilon, min_points);
-
-    SimpleStatus response{.status = "clustering completed"};
+    auto pass = co_await ServiceManager::get_instance()
+                    .get_cluster_service()
+                    .run_pass(mode, epsilon);
+
+    ReclusterResponse response{.status = "clustering completed",
+                               .mode = pass->mode,
+                               .rows_evaluated = pass->rows_evaluated,
+                               .rows_changed = pass->rows_changed,
+                               .clusters_changed = pass->clusters_changed,
+                               .tiles_changed = pass->tiles_changed,
+                               .duration_ms = pass->duration_ms};
     auto resp =
         HttpResponse::newHttpResponse(drogon::k200OK, CT_APPLICATION_JSON);
     resp->setBody(glz::write_json(response).value_or(""));
@@ -12,9 +12,18 @@ class LocationController : public drogon::HttpController<LocationController> {
   ADD_METHOD_TO(LocationController::add_location, "/api/v1/location",
                 drogon::Post, drogon::Options, "CorsMiddleware",
                 "AuthMiddleware");
+  ADD_METHOD_TO(LocationController::add_locations_batch,
+                "/api/v1/location/batch", drogon::Post, drogon::Options,
+                "CorsMiddleware", "AuthMiddleware");
+  ADD_METHOD_TO(LocationController::get_ingest_stats,
+                "/api/v1/location/ingest-stats", drogon::Get, drogon::Options,
+                "CorsMiddleware", "AuthMiddleware");
   ADD_METHOD_TO(LocationController::get_clusters, "/api/v1/location/clusters",
                 drogon::Get, drogon::Options, "CorsMiddleware",
                 "AuthMiddleware");
+  ADD_METHOD_TO(LocationController::get_tiles, "/api/v1/location/tiles",
+                drogon::Get, drogon::Options, "CorsMiddleware",
+                "AuthMiddleware");
   ADD_METHOD_TO(LocationController::find_nearby, "/api/v1/location/nearby",
                 drogon::Get, drogon::Options, "CorsMiddleware",
                 "AuthMiddleware");
@@ -26,14 +35,27 @@ class LocationController : public drogon::HttpController<LocationController> {
   static drogon::Task<> add_location(
       const drogon::HttpRequestPtr req,
       std::function<void(const drogon::HttpResponsePtr&)> callback);
+  // Accepts up to 500 readings, coalesced and written asynchronously
+  static drogon::Task<> add_locations_batch(
+      const drogon::HttpRequestPtr req,
+      std::function<void(const drogon::HttpResponsePtr&)> callback);
+  static drogon::Task<> get_ingest_stats(
+      const drogon::HttpRequestPtr req,
+      std::function<void(const drogon::HttpResponsePtr&)> callback);
   // Paginated by offset (15 per page)
   static drogon::Task<> get_clusters(
       const drogon::HttpRequestPtr req,
       std::function<void(const drogon::HttpResponsePtr&)> callback);
+  // ?zoom&min_lat&min_lon&max_lat&max_lon, zoom is capped at 16
+  static drogon::Task<> get_tiles(
+      const drogon::HttpRequestPtr req,
+      std::function<void(const drogon::HttpResponsePtr&)> callback);
   // Paginated by offset (15 per page)
   static drogon::Task<> find_nearby(
       const drogon::HttpRequestPtr req,
       std::function<void(const drogon::HttpResponsePtr&)> callback);
+  // ?mode=full|incremental, reports rows, clusters and tiles changed and
+  // duration
   static drogon::Task<> recluster(
       const drogon::HttpRequestPtr req,
       std::function<void(const drogon::HttpResponsePtr&)> callback);
@@ -4,14 +4,21 @@
 
 #include "media_server.hpp"
 
+#include <algorithm>
 #include <array>
 #include <format>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "../services/media_server/s3_service.hpp"
 #include "../services/service_manager.hpp"
+#include "../config/config.hpp"
+#include "../utilities/http_range.hpp"
 #include "../utilities/json_manipulation.hpp"
+#include "../utilities/media_sniffing.hpp"
+#include "../utilities/when_all.hpp"
 #include "common_req_n_resp.hpp"
 
 using api::v1::MediaController;
@@ -50,10 +57,51 @@ struct GetMediaUrlResponse {
   std::string content_type;
 };
 
-constexpr auto allowed_file_types = std::to_array<std::string_view>({
-    "image/jpeg", "image/png", "image/gif", "image/webp", "video/mp4",
-    "video/webm",  // "video/quicktime",
-});
+struct GetMediaUrlsRequest {
+  std::vector<std::string> object_keys;
+};
+
+struct MediaUrl {
+  std::string object_key;
+  std::string download_url;
+  std::string content_type;
+};
+
+struct GetMediaUrlsResponse {
+  std::vector<MediaUrl> urls;
+};
+
+// Max object keys presigned by a single batch request
+constexpr std::size_t MAX_BATCH_PRESIGN = 100;
+
+// Bytes fetched from S3 per ranged GET when proxying, bounds the memory held
+// per streamed response
+static long long media_proxy_chunk_size() {
+  static const long long chunk_size =
+      std::max(config::get_config_int("media_proxy_chunk_size", 512 * 1024),
+               64 * 1024);
+  return chunk_size;
+}
+
+// Only a guess for objects that were never verified, e.g. not uploaded yet
+static std::string content_type_from_extension(std::string_view object_key) {
+  if (object_key.ends_with(".png")) {
+    return "image/png";
+  } else if (object_key.ends_with(".jpg") || object_key.ends_with(".jpeg")) {
+    return "image/jpeg";
+  } else if (object_key.ends_with(".mp4")) {
+    return "video/mp4";
+  } else if (object_key.ends_with(".webm")) {
+    return "video/webm";
+  } else if (object_key.ends_with(".mp3")) {
+    return "audio/mpeg";
+  } else if (object_key.ends_with(".wav")) {
+    return "audio/wav";
+  } else if (object_key.ends_with(".pdf")) {
+    return "application/pdf";
+  }
+  return "application/octet-stream";
+}
 
 drogon::Task<> MediaController::get_upload_url(
     const drogon::HttpRequestPtr req,
@@ -79,8 +127,8 @@ drogon::Task<> MediaController::get_upload_url(
     auto content_type =
         upload_req.content_type.value_or("application/octet-stream");
 
-    if (std::find(allowed_file_types.begin(), allowed_file_types.end(),
-                  content_type) == allowed_file_types.end()) {
+    // Declared type only, the uploaded bytes are sniffed before use
+    if (!utilities::is_allowed_media_type(content_type)) {
       LOG_ERROR << content_type << " file type not allowed";
       SimpleError error{
           .error = std::format("{} file type not allowed", content_type)};
@@ -145,8 +193,8 @@ drogon::Task<> MediaController::verify_object_key(
     }
 
     MediaInfo info =
-        co_await ServiceManager::get_instance().get_s3_service().get_media_info(
-            "media", object_key);
+        co_await ServiceManager::get_instance().get_media_info_cache().get(
+            std::string(service::BUCKET_NAME), object_key);
 
     VerifyObjectKeyResponse response{.exists =
                                          info.etag.empty() ? false : true};
@@ -183,8 +231,8 @@ drogon::Task<> MediaController::get_media_metadata(
     }
 
     MediaInfo info =
-        co_await ServiceManager::get_instance().get_s3_service().get_media_info(
-            "media", object_key);
+        co_await ServiceManager::get_instance().get_media_info_cache().get(
+            std::string(service::BUCKET_NAME), object_key);
 
     GetMediaMetadataResponse response{.object_key = info.object_key,
                                       .content_type = info.content_type,
@@ -260,27 +308,22 @@ drogon::Task<> MediaController::get_media_url(
       co_return;
     }
 
-    std::string content_type = "application/octet-stream";
-    if (object_key.ends_with(".png")) {
-      content_type = "image/png";
-    } else if (object_key.ends_with(".jpg") || object_key.ends_with(".jpeg")) {
-      content_type = "image/jpeg";
-    } else if (object_key.ends_with(".mp4")) {
-      content_type = "video/mp4";
-    } else if (object_key.ends_with(".webm")) {
-      content_type = "video/webm";
-    } else if (object_key.ends_with(".mp3")) {
-      content_type = "audio/mpeg";
-    } else if (object_key.ends_with(".wav")) {
-      content_type = "audio/wav";
-    } else if (object_key.ends_with(".pdf")) {
-      content_type = "application/pdf";
+    // Verified type recorded for uploads, sniffed at most once. Other keys
+    // are generated by the server (thumbnails/ are JPEG), their extension is
+    // trusted rather than paying an S3 HEAD per call
+    std::string content_type = content_type_from_extension(object_key);
+    if (MediaInfoCache::is_cacheable(object_key)) {
+      MediaInfo info =
+          co_await ServiceManager::get_instance().get_media_info_cache().get(
+              std::string(service::BUCKET_NAME), object_key);
+      if (!info.etag.empty()) {
+        content_type = std::move(info.content_type);
+      }
     }
 
-    auto &s3_service = ServiceManager::get_instance().get_s3_service();
-
-    auto view_url = co_await s3_service.generate_presigned_url(
-        "media", object_key, drogon::HttpMethod::Get);
+    auto view_url =
+        ServiceManager::get_instance().get_s3_service().presign_get_url(
+            service::BUCKET_NAME, object_key);
 
     if (view_url.empty()) {
       LOG_ERROR << "object url not found";
@@ -308,3 +351,210 @@ drogon::Task<> MediaController::get_media_url(
   }
   co_return;
 }
+
+drogon::Task<> MediaController::stream_media(
+    const drogon::HttpRequestPtr req,
+    std::function<void(const drogon::HttpResponsePtr &)> callback) {
+  try {
+    auto object_key = req->getParameter("object_key");
+
+    if (object_key.empty()) {
+      SimpleError error{.error = "object_key is required as a query parameter"};
+      auto resp = drogon::HttpResponse::newHttpResponse(drogon::k400BadRequest,
+                                                        CT_APPLICATION_JSON);
+      resp->setBody(glz::write_json(error).value_or(""));
+      callback(resp);
+      co_return;
+    }
+
+    MediaInfo info =
+        co_await ServiceManager::get_instance().get_media_info_cache().get(
+            std::string(service::BUCKET_NAME), object_key);
+
+    if (info.etag.empty()) {
+      SimpleError error{.error = "media not found"};
+      auto resp = drogon::HttpResponse::newHttpResponse(drogon::k404NotFound,
+                                                        CT_APPLICATION_JSON);
+      resp->setBody(glz::write_json(error).value_or(""));
+      callback(resp);
+      co_return;
+    }
+
+    auto add_cache_headers = [&](const drogon::HttpResponsePtr &resp) {
+      resp->addHeader("ETag", info.etag);
+      // uploads are immutable once written
+      if (object_key.starts_with("uploads/")) {
+        resp->addHeader("Cache-Control",
+                        "private, max-age=31536000, immutable");
+      }
+    };
+
+    const auto &if_none_match = req->getHeader("If-None-Match");
+    if (!if_none_match.empty() &&
+        utilities::etag_matches(if_none_match, info.etag)) {
+      auto resp = drogon::HttpResponse::newHttpResponse();
+      resp->setStatusCode(drogon::k304NotModified);
+      add_cache_headers(resp);
+      callback(resp);
+      co_return;
+    }
+
+    const long long total_size = info.content_length;
+    auto range_req =
+        utilities::parse_range_header(req->getHeader("Range"), total_size);
+
+    if (range_req.status == utilities::RangeStatus::unsatisfiable) {
+      auto resp = drogon::HttpResponse::newHttpResponse();
+      resp->setStatusCode(drogon::k416RequestedRangeNotSatisfiable);
+      resp->addHeader("Content-Range", std::format("bytes */{}", total_size));
+      callback(resp);
+      co_return;
+    }
+
+    const bool partial =
+        range_req.status == utilities::RangeStatus::satisfiable;
+    const long long first = partial ? range_req.range.first : 0;
+    const long long last = partial ? range_req.range.last : total_size - 1;
+
+    // Body is pulled from S3 chunk by chunk and pushed as it arrives
+    auto resp = drogon::HttpResponse::newAsyncStreamResponse(
+        [object_key, first, last](drogon::ResponseStreamPtr stream) {
+          drogon::async_run([stream = std::move(stream), object_key, first,
+                             last]() mutable -> drogon::Task<> {
+            auto &s3_service = ServiceManager::get_instance().get_s3_service();
+            const long long chunk_size = media_proxy_chunk_size();
+            for (long long offset = first; offset <= last;) {
+              const long long chunk_last =
+                  std::min(offset + chunk_size - 1, last);
+              auto chunk = co_await s3_service.get_object_range(
+                  std::string(service::BUCKET_NAME), object_key, offset,
+                  chunk_last);
+              if (!chunk || chunk->data.empty()) {
+                LOG_ERROR << "Media stream aborted for " << object_key
+                          << " at offset " << offset;
+                // close() and the stream's destructor both write the final
+                // chunk, which would pass the truncated body off as
+                // complete. Dropping the stream unclosed leaves the
+                // connection to the idle timeout, which cuts it without one.
+                static_cast<void>(stream.release());
+                co_return;
+              }
+              if (!stream->send(chunk->data)) {
+                LOG_ERROR << "Media stream closed by the client for "
+                          << object_key << " at offset " << offset;
+                break;
+              }
+              offset += static_cast<long long>(chunk->data.size());
+            }
+            stream->close();
+          });
+        });
+
+    if (partial) {
+      resp->setStatusCode(drogon::k206PartialContent);
+      resp->addHeader("Content-Range", std::format("bytes {}-{}/{}", first,
+                                                   last, total_size));
+    }
+    resp->setContentTypeString(!info.content_type.empty()
+                                   ? info.content_type
+                                   : "application/octet-stream");
+    resp->addHeader("Accept-Ranges", "bytes");
+    add_cache_headers(resp);
+    callback(resp);
+  } catch (const std::exception &e) {
+    LOG_ERROR << "Failed to stream media: " << e.what();
+    SimpleError error{.error = "Failed to stream media"};
+    auto resp = drogon::HttpResponse::newHttpResponse(
+        drogon::k500InternalServerError, CT_APPLICATION_JSON);
+    resp->setBody(glz::write_json(error).value_or(""));
+    callback(resp);
+  }
+  co_return;
+}
+
+drogon::Task<> MediaController::get_media_urls(
+    const drogon::HttpRequestPtr req,
+    std::function<void(const drogon::HttpResponsePtr &)> callback) {
+  try {
+    GetMediaUrlsRequest urls_req;
+    auto parse_error = utilities::strict_read_json(urls_req, req->getBody());
+
+    if (parse_error || urls_req.object_keys.empty() ||
+        urls_req.object_keys.size() > MAX_BATCH_PRESIGN) {
+      SimpleError error{
+          .error = std::format("object_keys must contain between 1 and {} keys",
+                               MAX_BATCH_PRESIGN)};
+      auto resp = drogon::HttpResponse::newHttpResponse(drogon::k400BadRequest,
+                                                        CT_APPLICATION_JSON);
+      resp->setBody(glz::write_json(error).value_or(""));
+      callback(resp);
+      co_return;
+    }
+
+    std::erase_if(urls_req.object_keys,
+                  [](const std::string &key) { return key.empty(); });
+
+    auto &s3_service = ServiceManager::get_instance().get_s3_service();
+    auto &media_info_cache =
+        ServiceManager::get_instance().get_media_info_cache();
+    // Only uploads are looked up, as in get_media_url
+    std::vector<size_t> looked_up;
+    std::vector<drogon::Task<MediaInfo>> lookups;
+    for (size_t i = 0; i < urls_req.object_keys.size(); ++i) {
+      if (MediaInfoCache::is_cacheable(urls_req.object_keys[i])) {
+        looked_up.push_back(i);
+        lookups.emplace_back(media_info_cache.get(
+            std::string(service::BUCKET_NAME), urls_req.object_keys[i]));
+      }
+    }
+    auto infos = co_await utilities::when_all(std::move(lookups));
+
+    std::vector<std::string> content_types;
+    content_types.reserve(urls_req.object_keys.size());
+    for (const auto &object_key : urls_req.object_keys) {
+      content_types.push_back(content_type_from_extension(object_key));
+    }
+    for (size_t j = 0; j < looked_up.size(); ++j) {
+      if (!infos[j].etag.empty()) {
+        content_types[looked_up[j]] = std::move(infos[j].content_type);
+      }
+    }
+
+    GetMediaUrlsResponse response;
+    response.urls.reserve(urls_req.object_keys.size());
+    for (size_t i = 0; i < urls_req.object_keys.size(); ++i) {
+      auto &object_key = urls_req.object_keys[i];
+      auto download_url =
+          s3_service.presign_get_url(service::BUCKET_NAME, object_key);
+      auto &content_type = content_types[i];
+      response.urls.emplace_back(
+          MediaUrl{.object_key = std::move(object_key),
+                   .download_url = std::move(download_url),
+                   .content_type = std::move(content_type)});
+    }
+
+    auto resp = drogon::HttpResponse::newHttpResponse(drogon::k200OK,
+                                                      CT_APPLICATION_JSON);
+    resp->setBody(glz::write_json(response).value_or(""));
+    callback(resp);
+  } catch (const std::exception &e) {
+    LOG_ERROR << "Failed to get media urls: " << e.what();
+    SimpleError error{.error = "Failed to retrieve media urls"};
+    auto resp = drogon::HttpResponse::newHttpResponse(
+        drogon::k500InternalServerError, CT_APPLICATION_JSON);
+    resp->setBody(glz::write_json(error).value_or(""));
+    callback(resp);
+  }
+  co_return;
+}
+
+drogon::Task<> MediaController::get_cache_stats(
+    const drogon::HttpRequestPtr req,
+    std::function<void(const drogon::HttpResponsePtr &)> callback) {
+  auto stats = ServiceManager::get_instance().get_media_info_cache().stats();
+  auto resp = drogon::HttpResponse::newHttpResponse(drogon::k200OK,
+                                                    CT_APPLICATION_JSON);
+  resp->setBody(glz::write_json(stats).value_or(""));
+  callback(resp);
+  co_return;
+}
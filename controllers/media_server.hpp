@@ -21,12 +21,21 @@ class MediaController : public drogon::HttpController<MediaController> {
                 "AuthMiddleware");
   ADD_METHOD_TO(MediaController::get_media_url, "/api/v1/media", drogon::Get,
                 drogon::Options, "CorsMiddleware", "AuthMiddleware");
+  ADD_METHOD_TO(MediaController::stream_media, "/api/v1/media/stream",
+                drogon::Get, drogon::Options, "CorsMiddleware",
+                "AuthMiddleware");
+  ADD_METHOD_TO(MediaController::get_media_urls, "/api/v1/media/urls",
+                drogon::Post, drogon::Options, "CorsMiddleware",
+                "AuthMiddleware");
   ADD_METHOD_TO(MediaController::verify_object_key, "/api/v1/media/verify",
                 drogon::Get, drogon::Options, "CorsMiddleware",
                 "AuthMiddleware");
   ADD_METHOD_TO(MediaController::get_media_metadata, "/api/v1/media/metadata",
                 drogon::Get, drogon::Options, "CorsMiddleware",
                 "AuthMiddleware");
+  ADD_METHOD_TO(MediaController::get_cache_stats, "/api/v1/media/cache-stats",
+                drogon::Get, drogon::Options, "CorsMiddleware",
+                "AuthMiddleware");
   METHOD_LIST_END
 
   static drogon::Task<> get_upload_url(
@@ -41,6 +50,16 @@ class MediaController : public drogon::HttpController<MediaController> {
       const drogon::HttpRequestPtr req,
       std::function<void(const drogon::HttpResponsePtr &)> callback);
 
+  // Proxies an object through the backend, supports Range and If-None-Match
+  static drogon::Task<> stream_media(
+      const drogon::HttpRequestPtr req,
+      std::function<void(const drogon::HttpResponsePtr &)> callback);
+
+  // Presigns a batch of object keys, e.g. all images of a feed page
+  static drogon::Task<> get_media_urls(
+      const drogon::HttpRequestPtr req,
+      std::function<void(const drogon::HttpResponsePtr &)> callback);
+
   static drogon::Task<> verify_object_key(
       const drogon::HttpRequestPtr req,
       std::function<void(const drogon::HttpResponsePtr &)> callback);
@@ -48,6 +67,10 @@ class MediaController : public drogon::HttpController<MediaController> {
   static drogon::Task<> get_media_metadata(
       const drogon::HttpRequestPtr req,
       std::function<void(const drogon::HttpResponsePtr &)> callback);
+
+  static drogon::Task<> get_cache_stats(
+      const drogon::HttpRequestPtr req,
+      std::function<void(const drogon::HttpResponsePtr &)> callback);
 };
 
 }  // namespace v1
@@ -0,0 +1,168 @@
+#ifndef OFFER_STATEMENTS_HPP
+#define OFFER_STATEMENTS_HPP
+
+#include <cstdint>
+#include <string_view>
+
+// SQL shared by the offers controller and the benchmarks in bench/
+namespace offer_statements {
+
+/**
+ * @brief Accepts offer $1 on behalf of user $2 in a single statement.
+ * - Locks the post first, so concurrent acceptances on one post queue up
+ *   instead of deadlocking on each other's offers. Once the lock is granted
+ *   the pending check sees the winner's changes and fails.
+ * - Only accepts a pending offer of a post owned by $2. When it does not,
+ *   nothing else is written.
+ * - Accepts the offer's latest pending negotiation and rejects every other
+ *   pending negotiation on the post.
+ * - Rejects the other pending offers and fulfils the post.
+ * - Mirrors the new statuses in the negotiation chat messages' metadata.
+ * Returns no row when the offer does not exist, otherwise one row with the
+ * owner and status read before the update, accepted_at (NULL when not
+ * accepted), and the rejected offer ids with their rejected_at.
+ */
+inline constexpr std::string_view ACCEPT_OFFER = R"(
+  WITH target AS (
+    SELECT o.id, o.post_id, o.status, p.user_id AS post_owner_id
+    FROM offers o JOIN posts p ON p.id = o.post_id
+    WHERE o.id = $1
+    FOR UPDATE OF p
+  ),
+  accepted AS (
+    UPDATE offers o
+    SET status = 'accepted', negotiation_status = 'completed',
+        updated_at = NOW()
+    FROM target t
+    WHERE o.id = t.id AND t.post_owner_id = $2 AND o.status = 'pending'
+    RETURNING o.id, o.post_id, o.updated_at
+  ),
+  latest_negotiation AS (
+    SELECT pn.id FROM price_negotiations pn
+    JOIN accepted a ON pn.offer_id = a.id
+    WHERE pn.status = 'pending'
+    ORDER BY pn.created_at DESC, pn.id DESC
+    LIMIT 1
+  ),
+  negotiations AS (
+    UPDATE price_negotiations pn
+    SET status = CASE WHEN pn.id = (SELECT id FROM latest_negotiation)
+                      THEN 'accepted' ELSE 'rejected' END,
+        updated_at = NOW()
+    FROM offers o JOIN accepted a ON o.post_id = a.post_id
+    WHERE pn.offer_id = o.id AND pn.status = 'pending'
+    RETURNING pn.id, pn.status
+  ),
+  rejected_offers AS (
+    UPDATE offers o
+    SET status = 'rejected',
+        negotiation_status =
+          CASE WHEN EXISTS (SELECT 1 FROM latest_negotiation)
+               THEN 'completed' ELSE o.negotiation_status END,
+        updated_at = NOW()
+    FROM accepted a
+    WHERE o.post_id = a.post_id AND o.id <> a.id AND o.status = 'pending'
+    RETURNING o.id, o.updated_at
+  ),
+  negotiation_messages AS (
+    UPDATE messages m
+    SET metadata = jsonb_set(m.metadata, '{offer_status}', to_jsonb(n.status))
+    FROM negotiations n
+    WHERE m.context_type = 'negotiation' AND m.context_id = n.id
+    RETURNING 1
+  ),
+  offer_messages AS (
+    UPDATE messages m
+    SET metadata = jsonb_set(m.metadata, '{offer_status}', '"rejected"')
+    FROM rejected_offers r
+    WHERE m.context_type = 'negotiation'
+      AND m.metadata->>'offer_id' = r.id::text
+    RETURNING 1
+  ),
+  fulfilled AS (
+    UPDATE posts p SET request_status = 'fulfilled'
+    FROM accepted a
+    WHERE p.id = a.post_id
+    RETURNING 1
+  )
+  SELECT t.post_owner_id, t.status,
+         (SELECT updated_at FROM accepted) AS accepted_at,
+         (SELECT COALESCE(array_agg(id ORDER BY id), '{}')
+          FROM rejected_offers) AS rejected_offer_ids,
+         (SELECT MAX(updated_at) FROM rejected_offers) AS rejected_at
+  FROM target t
+)";
+
+/**
+ * @brief Creates offer $3..$6 (title, description, price, is_public) by user
+ * $2 on post $1 and notifies the post owner.
+ * Checks the post itself, so it can be sent without waiting for the post
+ * lookup: nothing is written when the post does not exist or is owned by $2.
+ * Returns the new offer's id and created_at, or no row.
+ */
+inline constexpr std::string_view CREATE_OFFER = R"(
+  WITH inserted AS (
+    INSERT INTO offers (post_id, user_id, title, description, price,
+                        original_price, is_public, status)
+    SELECT p.id, $2, $3, $4, $5, $5, $6, 'pending'
+    FROM posts p
+    WHERE p.id = $1 AND p.user_id <> $2
+    RETURNING id, post_id, created_at
+  ),
+  notified AS (
+    INSERT INTO offer_notifications (offer_id, user_id, is_read)
+    SELECT i.id, p.user_id, FALSE
+    FROM inserted i JOIN posts p ON p.id = i.post_id
+  )
+  SELECT id, created_at FROM inserted
+)";
+
+/**
+ * @brief Keyset pages of offers, newest activity first.
+ * A page starts after the (updated_at, id) of the previous page's last row,
+ * given as $2 microseconds since the epoch and $3 offer id. The first page
+ * passes FIRST_PAGE_UPDATED_US and INT_MAX. $4 is a text[] of statuses to
+ * keep, '{}' keeps all, $5 the row limit. updated_us of the last row is the
+ * next page's $2.
+ */
+inline constexpr std::int64_t FIRST_PAGE_UPDATED_US =
+    253402300799999999;  // 9999-12-31 23:59:59.999999
+
+// Offers made by user $1, walks offers_user_updated_idx
+inline constexpr std::string_view MY_OFFERS_PAGE = R"(
+  SELECT o.id, o.post_id, o.title, o.description, o.price, o.original_price,
+         o.is_public, o.status, o.created_at, o.updated_at,
+         (EXTRACT(EPOCH FROM o.updated_at) * 1000000)::bigint AS updated_us,
+         p.content AS post_content, u.username AS post_owner_username
+  FROM offers o
+  JOIN posts p ON o.post_id = p.id
+  JOIN users u ON p.user_id = u.id
+  WHERE o.user_id = $1
+    AND (o.updated_at, o.id) <
+        ('epoch'::timestamp + $2::bigint * INTERVAL '1 microsecond', $3)
+    AND (cardinality($4::text[]) = 0 OR o.status = ANY($4::text[]))
+  ORDER BY o.updated_at DESC, o.id DESC
+  LIMIT $5
+)";
+
+// Offers received on the posts of user $1, walks posts_user_id_idx then
+// offers_post_updated_idx per post
+inline constexpr std::string_view RECEIVED_OFFERS_PAGE = R"(
+  SELECT o.id, o.post_id, o.user_id, o.title, o.description, o.price,
+         o.original_price, o.is_public, o.status, o.created_at, o.updated_at,
+         (EXTRACT(EPOCH FROM o.updated_at) * 1000000)::bigint AS updated_us,
+         p.content AS post_content, u.username AS offer_username
+  FROM offers o
+  JOIN posts p ON o.post_id = p.id
+  JOIN users u ON o.user_id = u.id
+  WHERE p.user_id = $1
+    AND (o.updated_at, o.id) <
+        ('epoch'::timestamp + $2::bigint * INTERVAL '1 microsecond', $3)
+    AND (cardinality($4::text[]) = 0 OR o.status = ANY($4::text[]))
+  ORDER BY o.updated_at DESC, o.id DESC
+  LIMIT $5
+)";
+
+}  // namespace offer_statements
+
+#endif  // OFFER_STATEMENTS_HPP
@@ -17,8 +17,12 @@
 
 #include "../services/service_manager.hpp"
 #include "../utilities/conversion.hpp"
+#include "../utilities/db_tracing.hpp"
 #include "../utilities/json_manipulation.hpp"
+#include "../utilities/json_response.hpp"
+#include "../utilities/sql_pipeline.hpp"
 #include "common_req_n_resp.hpp"
+#include "offer_statements.hpp"
 #include "scenario_specific_utils.hpp"
 
 using api::v1::Offers;
@@ -33,7 +37,6 @@ using drogon::k500InternalServerError;
 using drogon::Task;
 using drogon::orm::DrogonDbException;
 using drogon::orm::Result;
-using drogon::orm::Transaction;
 struct OfferInfo {
   int id;
   int post_id;
@@ -130,6 +133,76 @@ struct ReceivedOfferInfo {
   std::vector<MediaQuickInfo> media;
 };
 
+struct MyOffersPage {
+  std::vector<MyOfferInfo> offers;
+  std::optional<std::string> next_cursor;  // absent on the last page
+};
+
+struct ReceivedOffersPage {
+  std::vector<ReceivedOfferInfo> offers;
+  std::optional<std::string> next_cursor;  // absent on the last page
+};
+
+// Query parameters of the offer listings
+struct OfferListingParams {
+  int limit = 20;
+  std::int64_t after_updated_us = offer_statements::FIRST_PAGE_UPDATED_US;
+  int after_id = std::numeric_limits<int>::max();
+  std::string statuses = "{}";  // text[] of statuses to keep, all if empty
+};
+
+// Reads limit (1 to 100, default 20), cursor (next_cursor of the previous
+// page) and status (comma separated pending, accepted or rejected).
+// std::nullopt when the cursor or a status is invalid.
+static std::optional<OfferListingParams> read_offer_listing_params(
+    const HttpRequestPtr& req) {
+  OfferListingParams params;
+  if (!req->getParameter("limit").empty()) {
+    params.limit = std::max(
+        1, std::min(100, convert::string_to_int(req->getParameter("limit"))
+                             .value_or(20)));
+  }
+
+  const auto& cursor = req->getParameter("cursor");
+  if (!cursor.empty()) {
+    auto separator = cursor.find('_');
+    if (separator == std::string::npos) {
+      return std::nullopt;
+    }
+    auto updated_us = convert::string_to_number<std::int64_t>(
+        std::string_view(cursor).substr(0, separator));
+    auto id = convert::string_to_int(
+        std::string_view(cursor).substr(separator + 1));
+    if (!updated_us || !id) {
+      return std::nullopt;
+    }
+    params.after_updated_us = *updated_us;
+    params.after_id = *id;
+  }
+
+  const auto& status = req->getParameter("status");
+  if (!status.empty()) {
+    std::vector<std::string> statuses;
+    std::string_view rest = status;
+    while (!rest.empty()) {
+      auto token = rest.substr(0, rest.find(','));
+      rest.remove_prefix(std::min(rest.size(), token.size() + 1));
+      if (token != "pending" && token != "accepted" && token != "rejected") {
+        return std::nullopt;
+      }
+      statuses.emplace_back(token);
+    }
+    params.statuses = convert::array_to_pgsql_array_string(statuses);
+  }
+  return params;
+}
+
+// next_cursor of a page ending at row
+static std::string offer_listing_cursor(const drogon::orm::Row& row) {
+  return std::format("{}_{}", row["updated_us"].as<std::int64_t>(),
+                     row["id"].as<int>());
+}
+
 struct NotificationInfo {
   int id;
   int offer_id;
@@ -145,7 +218,7 @@ struct NotificationInfo {
 Task<> Offers::get_offers_for_post(
     HttpRequestPtr req, std::function<void(const HttpResponsePtr&)> callback,
     std::string post_id) {
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
@@ -218,10 +291,7 @@ Task<> Offers::get_offers_for_post(
                     .media = media_attachments.value_or({})});
     }
 
-    auto resp =
-        HttpResponse::newHttpResponse(drogon::k200OK, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(offers_data).value_or(""));
-    callback(resp);
+    callback(utilities::negotiated_response(req, offers_data));
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
     SimpleError error{.error = "Database error"};
@@ -274,46 +344,53 @@ Task<> Offers::create_offer(
     co_return;
   }
 
-  auto db = app().getDbClient();
+  const bool has_media =
+      create_req.media.has_value() && !create_req.media->empty();
+  auto db = utilities::traced_db_client(req);
 
   try {
-    // First check if the post exists and get the post owner
-    auto result =
-        co_await db->execSqlCoro("SELECT user_id FROM posts WHERE id = $1",
-                                 convert::string_to_int(post_id).value());
-
-    if (result.empty()) {
-      SimpleError error{.error = "Post not found"};
-      auto resp =
-          HttpResponse::newHttpResponse(k404NotFound, CT_APPLICATION_JSON);
-      resp->setBody(glz::write_json(error).value_or(""));
-      callback(resp);
-      co_return;
-    }
-
-    int post_user_id = result[0]["user_id"].as<int>();
-
-    // Don't allow users to make offers on their own posts
-    if (post_user_id == convert::string_to_int(current_user_id).value()) {
-      SimpleError error{.error = "You cannot make offers on your own posts"};
-      auto resp =
-          HttpResponse::newHttpResponse(k400BadRequest, CT_APPLICATION_JSON);
-      resp->setBody(glz::write_json(error).value_or(""));
-      callback(resp);
-      co_return;
+    // Without media the offer is a single statement and needs no
+    // transaction, saving the BEGIN and COMMIT round trips
+    utilities::TracedDbPtr transaction;
+    utilities::TracedDbPtr writer = db;
+    if (has_media) {
+      transaction = co_await db->newTransactionCoro();
+      writer = transaction;
     }
 
-    auto transaction = co_await db->newTransactionCoro();
     try {
-      auto insert_result = co_await transaction->execSqlCoro(
-          "INSERT INTO offers (post_id, user_id, title, description, price, "
-          "original_price, is_public, status) "
-          "VALUES ($1, $2, $3, $4, $5, $5, $6, 'pending') "
-          "RETURNING id, created_at",
-          convert::string_to_int(post_id).value(),
-          convert::string_to_int(current_user_id).value(), create_req.title,
-          create_req.description, create_req.price,
-          create_req.is_public.value_or(true));
+      // The insert checks the post itself, so both go out together and the
+      // lookup only explains why nothing was inserted
+      auto [result, insert_result] = co_await utilities::pipeline(
+          writer,
+          utilities::statement("SELECT user_id FROM posts WHERE id = $1",
+                               convert::string_to_int(post_id).value()),
+          utilities::statement(
+              std::string(offer_statements::CREATE_OFFER),
+              convert::string_to_int(post_id).value(),
+              convert::string_to_int(current_user_id).value(),
+              create_req.title, create_req.description, create_req.price,
+              create_req.is_public.value_or(true)));
+
+      if (result.empty()) {
+        SimpleError error{.error = "Post not found"};
+        auto resp =
+            HttpResponse::newHttpResponse(k404NotFound, CT_APPLICATION_JSON);
+        resp->setBody(glz::write_json(error).value_or(""));
+        callback(resp);
+        co_return;
+      }
+
+      // Don't allow users to make offers on their own posts
+      if (result[0]["user_id"].as<int>() ==
+          convert::string_to_int(current_user_id).value()) {
+        SimpleError error{.error = "You cannot make offers on your own posts"};
+        auto resp =
+            HttpResponse::newHttpResponse(k400BadRequest, CT_APPLICATION_JSON);
+        resp->setBody(glz::write_json(error).value_or(""));
+        callback(resp);
+        co_return;
+      }
 
       if (insert_result.empty()) {
         throw std::runtime_error("Initial insert failed");
@@ -323,7 +400,7 @@ Task<> Offers::create_offer(
       std::string created_at = insert_result[0]["created_at"].as<std::string>();
       std::expected<std::vector<MediaQuickInfo>, std::string> processed_media;
 
-      if (create_req.media.has_value()) {
+      if (has_media) {
         std::size_t media_array_size = create_req.media->size();
         processed_media = (co_await process_media_attachments(
             std::move(create_req.media.value()), transaction,
@@ -349,13 +426,6 @@ Task<> Offers::create_offer(
         }
       }
 
-      // notification:
-      // post owner
-      co_await transaction->execSqlCoro(
-          "INSERT INTO offer_notifications (offer_id, user_id, is_read) "
-          "VALUES ($1, $2, FALSE)",
-          offer_id, post_user_id);
-
       // Auto-subscribe offer owner to their offer
       std::string offer_topic = create_topic("offer", std::to_string(offer_id));
       ServiceManager::get_instance().get_subscriber().subscribe(offer_topic);
@@ -383,7 +453,9 @@ Task<> Offers::create_offer(
       resp->setBody(glz::write_json(response).value_or(""));
       callback(resp);
     } catch (const std::exception& e) {
-      transaction->rollback();
+      if (transaction) {
+        transaction->rollback();
+      }
       LOG_ERROR << "Error creating offer: " << e.what();
       SimpleError error{.error =
                             std::format("Error creating offer: {}", e.what())};
@@ -408,7 +480,7 @@ Task<> Offers::create_offer(
 Task<> Offers::get_offer(HttpRequestPtr req,
                          std::function<void(const HttpResponsePtr&)> callback,
                          std::string id) {
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
@@ -424,13 +496,18 @@ Task<> Offers::get_offer(HttpRequestPtr req,
 
   try {
     int current_user = convert::string_to_int(current_user_id).value();
-    auto result = co_await db->execSqlCoro(
-        "SELECT o.*, u.username, p.user_id as post_owner_id "
-        "FROM offers o "
-        "JOIN users u ON o.user_id = u.id "
-        "JOIN posts p ON o.post_id = p.id "
-        "WHERE o.id = $1",
-        convert::string_to_int(id).value());
+    // The media list doesn't depend on the offer row, one round trip for both
+    auto [result, media_result] = co_await utilities::pipeline(
+        db,
+        utilities::statement("SELECT o.*, u.username, "
+                             "p.user_id as post_owner_id "
+                             "FROM offers o "
+                             "JOIN users u ON o.user_id = u.id "
+                             "JOIN posts p ON o.post_id = p.id "
+                             "WHERE o.id = $1",
+                             convert::string_to_int(id).value()),
+        utilities::statement(media_attachments_sql("offer"),
+                             convert::string_to_int(id).value()));
 
     if (result.empty()) {
       SimpleError error{.error = "Offer not found"};
@@ -459,8 +536,6 @@ Task<> Offers::get_offer(HttpRequestPtr req,
       callback(resp);
       co_return;
     }
-    auto media_attachments =
-        co_await get_media_attachments("offer", *convert::string_to_int(id));
     GetOfferResponse response{
         .id = row["id"].as<int>(),
         .post_id = row["post_id"].as<int>(),
@@ -476,12 +551,9 @@ Task<> Offers::get_offer(HttpRequestPtr req,
         .updated_at = row["updated_at"].as<std::string>(),
         .is_owner = (current_user == offer_user_id),
         .is_post_owner = (current_user == post_owner_id),
-        .media = media_attachments.value_or({})};
+        .media = read_media_attachments(media_result)};
 
-    auto resp =
-        HttpResponse::newHttpResponse(drogon::k200OK, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(response).value_or(""));
-    callback(resp);
+    callback(utilities::negotiated_response(req, response));
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
     SimpleError error{.error = "Database error"};
@@ -533,7 +605,7 @@ Task<> Offers::update_offer(
     co_return;
   }
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     // First check if the user is the owner of the offer
@@ -679,7 +751,7 @@ Task<> Offers::update_offer(
 
 // Helper function to update message metadata when an offer or negotiation
 // status changes
-void update_message_metadata(std::shared_ptr<Transaction> transaction,
+void update_message_metadata(utilities::TracedDbPtr transaction,
                              std::string id, std::string new_status,
                              bool is_negotiation = false) {
   if (is_negotiation) {
@@ -732,15 +804,15 @@ Task<> Offers::accept_offer(
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
+    // Checks and the whole acceptance in one round trip, see
+    // offer_statements::ACCEPT_OFFER
     auto result = co_await db->execSqlCoro(
-        "SELECT o.post_id, p.user_id as post_owner_id, o.status "
-        "FROM offers o "
-        "JOIN posts p ON o.post_id = p.id "
-        "WHERE o.id = $1",
-        convert::string_to_int(id).value());
+        std::string(offer_statements::ACCEPT_OFFER),
+        convert::string_to_int(id).value(),
+        convert::string_to_int(current_user_id).value());
 
     if (result.empty()) {
       SimpleError error{.error = "Offer not found"};
@@ -751,11 +823,8 @@ Task<> Offers::accept_offer(
       co_return;
     }
 
-    int post_owner_id = result[0]["post_owner_id"].as<int>();
-    int post_id = result[0]["post_id"].as<int>();
-    std::string status = result[0]["status"].as<std::string>();
-
-    if (post_owner_id != convert::string_to_int(current_user_id).value()) {
+    if (result[0]["post_owner_id"].as<int>() !=
+        convert::string_to_int(current_user_id).value()) {
       SimpleError error{.error = "Only the post owner can accept offers"};
       auto resp =
           HttpResponse::newHttpResponse(k403Forbidden, CT_APPLICATION_JSON);
@@ -764,7 +833,8 @@ Task<> Offers::accept_offer(
       co_return;
     }
 
-    if (status != "pending") {
+    // Also covers losing a race against another acceptance on the post
+    if (result[0]["accepted_at"].isNull()) {
       SimpleError error{.error = "Only pending offers can be accepted"};
       auto resp =
           HttpResponse::newHttpResponse(k400BadRequest, CT_APPLICATION_JSON);
@@ -773,174 +843,46 @@ Task<> Offers::accept_offer(
       co_return;
     }
 
-    auto trans = co_await db->newTransactionCoro();
-
-    try {
-      auto update_result = co_await trans->execSqlCoro(
-          "UPDATE offers SET status = 'accepted', negotiation_status = "
-          "'completed', updated_at = NOW() WHERE id = $1 "
-          "RETURNING updated_at",
-          convert::string_to_int(id).value());
-
-      // Get the latest price negotiation for this offer (if any) and accept it
-      auto negotiation_result = co_await trans->execSqlCoro(
-          "SELECT id FROM price_negotiations "
-          "WHERE offer_id = $1 AND status = 'pending' "
-          "ORDER BY created_at DESC LIMIT 1",
-          convert::string_to_int(id).value());
-
-      drogon::orm::Result
-          rejected_offers_result;  // nullptr, always inited in both branches
-
-      // For pending negotiations, accept the latest one and reject others
-      if (!negotiation_result.empty()) {
-        int latest_negotiation_id = negotiation_result[0]["id"].as<int>();
-        std::string negotiation_id_str = std::to_string(latest_negotiation_id);
-
-        // Accept the latest negotiation
-        co_await trans->execSqlCoro(
-            "UPDATE price_negotiations "
-            "SET status = 'accepted', updated_at = NOW() "
-            "WHERE id = $1",
-            latest_negotiation_id);
-
-        // Update message metadata for the accepted negotiation
-        update_message_metadata(trans, negotiation_id_str, "accepted", true);
-
-        // Reject all other negotiations for this offer
-        auto other_negotiations_result = co_await trans->execSqlCoro(
-            "UPDATE price_negotiations "
-            "SET status = 'rejected', updated_at = NOW() "
-            "WHERE offer_id = $1 AND id != $2 AND status = 'pending' "
-            "RETURNING id",
-            convert::string_to_int(id).value(), latest_negotiation_id);
-
-        LOG_INFO << "other_negotiations_result: "
-                 << other_negotiations_result.size() << "\n";
-
-        // Update message metadata for rejected negotiations
-        for (const auto& row : other_negotiations_result) {
-          std::string rejected_negotiation_id = row["id"].as<std::string>();
-          update_message_metadata(trans, rejected_negotiation_id, "rejected",
-                                  true);
-        }
-
-        // Continue with rejecting other offers
-        rejected_offers_result = co_await trans->execSqlCoro(
-            "UPDATE offers SET status = 'rejected', negotiation_status = "
-            "'completed', updated_at = NOW() WHERE post_id = $1 AND id != $2 "
-            "AND status = 'pending' RETURNING id, updated_at",
-            post_id, convert::string_to_int(id).value());
-
-        // Update message metadata for all rejected offers
-        for (const auto& row : rejected_offers_result) {
-          std::string rejected_offer_id = row["id"].as<std::string>();
-          update_message_metadata(trans, rejected_offer_id, "rejected");
-        }
-
-        // Reject all pending price negotiations for other offers
-        auto rejected_negotiations_result = co_await trans->execSqlCoro(
-            "UPDATE price_negotiations pn "
-            "SET status = 'rejected', updated_at = NOW() "
-            "FROM offers o "
-            "WHERE pn.offer_id = o.id AND o.post_id = $1 AND "
-            "o.id != $2 AND pn.status = 'pending' "
-            "RETURNING pn.id",
-            post_id, convert::string_to_int(id).value());
-
-        // Update message metadata for rejected negotiations from other offers
-        for (const auto& row : rejected_negotiations_result) {
-          std::string rejected_negotiation_id = row["id"].as<std::string>();
-          update_message_metadata(trans, rejected_negotiation_id, "rejected",
-                                  true);
-        }
-
-        // Update post status to reflect that an offer was accepted
-        co_await trans->execSqlCoro(
-            "UPDATE posts SET request_status = 'fulfilled' WHERE id = $1",
-            post_id);
-      } else {
-        // No pending negotiations, just reject other offers
-        rejected_offers_result = co_await trans->execSqlCoro(
-            "UPDATE offers SET status = 'rejected', updated_at = NOW() "
-            "WHERE post_id = $1 AND id != $2 AND status = 'pending' "
-            "RETURNING id, updated_at",
-            post_id, convert::string_to_int(id).value());
-
-        // Update message metadata for all rejected offers
-        for (const auto& row : rejected_offers_result) {
-          std::string rejected_offer_id = row["id"].as<std::string>();
-          update_message_metadata(trans, rejected_offer_id, "rejected");
-        }
+    auto& access_cache =
+        ServiceManager::get_instance().get_offer_access_cache();
+    access_cache.invalidate(convert::string_to_int(id).value());
 
-        // Reject all pending price negotiations for other offers
-        auto rejected_negotiations_result = co_await trans->execSqlCoro(
-            "UPDATE price_negotiations pn "
-            "SET status = 'rejected', updated_at = NOW() "
-            "FROM offers o "
-            "WHERE pn.offer_id = o.id AND o.post_id = $1 AND "
-            "o.id != $2 AND pn.status = 'pending' "
-            "RETURNING pn.id",
-            post_id, convert::string_to_int(id).value());
-
-        // Update message metadata for rejected negotiations
-        for (const auto& row : rejected_negotiations_result) {
-          std::string rejected_negotiation_id =
-              std::to_string(row["id"].as<int>());
-          update_message_metadata(trans, rejected_negotiation_id, "rejected",
-                                  true);
-        }
-
-        // Update post status to reflect that an offer was accepted
-        co_await trans->execSqlCoro(
-            "UPDATE posts SET request_status = 'fulfilled' WHERE id = $1",
-            post_id);
-      }
+    // notify the accepted offer
+    std::string offer_topic = create_topic("offer", id);
+    NotificationMessage msg{
+        .type = "offer_accepted",
+        .id = id,
+        .message = "Offer was accepted",
+        .modified_at = result[0]["accepted_at"].as<std::string>()};
 
-      // notify the accepted offer
-      std::string offer_topic = create_topic("offer", id);
-      NotificationMessage msg{
-          .type = "offer_accepted",
-          .id = id,
-          .message = "Offer was accepted",
-          .modified_at = update_result[0]["updated_at"].as<std::string>()};
+    ServiceManager::get_instance().get_publisher().publish(
+        offer_topic, glz::write_json(msg).value_or(""));
 
+    // notify rejected offers
+    auto rejected_offer_ids = convert::pgsql_array_string_to_vector(
+        result[0]["rejected_offer_ids"].as<std::string>());
+    for (const auto& rejected_offer_id : rejected_offer_ids) {
+      access_cache.invalidate(
+          convert::string_to_int(rejected_offer_id).value_or(0));
+      offer_topic = create_topic("offer", rejected_offer_id);
+
+      msg = NotificationMessage{
+          .type = "offer_rejected",
+          .id = rejected_offer_id,
+          .message = "Offer was rejected",
+          .modified_at = result[0]["rejected_at"].as<std::string>()};
       ServiceManager::get_instance().get_publisher().publish(
           offer_topic, glz::write_json(msg).value_or(""));
+    }
 
-      // notify rejected offers
-      for (const auto& row : rejected_offers_result) {
-        std::string rejected_offer_id = row["id"].as<std::string>();
-
-        offer_topic = create_topic("offer", rejected_offer_id);
-
-        msg = NotificationMessage{
-            .type = "offer_rejected",
-            .id = rejected_offer_id,
-            .message = "Offer was rejected",
-            .modified_at =
-                rejected_offers_result[0]["updated_at"].as<std::string>()};
-        ServiceManager::get_instance().get_publisher().publish(
-            offer_topic, glz::write_json(msg).value_or(""));
-      }
-
-      // Delete all offer and subscriptions for that post?
+    // Delete all offer and subscriptions for that post?
 
-      StatusResponse response{.status = "success",
-                              .message = "Offer accepted successfully"};
-      auto resp =
-          HttpResponse::newHttpResponse(drogon::k200OK, CT_APPLICATION_JSON);
-      resp->setBody(glz::write_json(response).value_or(""));
-      callback(resp);
-    } catch (const DrogonDbException& e) {
-      LOG_ERROR << "Database error: " << e.base().what();
-      trans->rollback();
-      SimpleError error{.error = "Database error"};
-      auto resp = HttpResponse::newHttpResponse(k500InternalServerError,
-                                                CT_APPLICATION_JSON);
-      resp->setBody(glz::write_json(error).value_or(""));
-      callback(resp);
-    }
+    StatusResponse response{.status = "success",
+                            .message = "Offer accepted successfully"};
+    auto resp =
+        HttpResponse::newHttpResponse(drogon::k200OK, CT_APPLICATION_JSON);
+    resp->setBody(glz::write_json(response).value_or(""));
+    callback(resp);
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
     SimpleError error{.error = "Database error"};
@@ -967,7 +909,7 @@ Task<> Offers::accept_counter_offer(
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -1103,6 +1045,23 @@ Task<> Offers::accept_counter_offer(
           "UPDATE posts SET request_status = 'fulfilled' WHERE id = $1",
           post_id);
 
+      // Only once committed, a load in between would cache the old status
+      std::vector<int> changed_offers{convert::string_to_int(id).value()};
+      for (const auto& row : rejected_offers_result) {
+        changed_offers.push_back(row["id"].as<int>());
+      }
+      trans->setCommitCallback(
+          [changed_offers = std::move(changed_offers)](bool committed) {
+            if (!committed) {
+              return;
+            }
+            auto& access_cache =
+                ServiceManager::get_instance().get_offer_access_cache();
+            for (int offer_id : changed_offers) {
+              access_cache.invalidate(offer_id);
+            }
+          });
+
       // notify accepted offer only after a successful commit
       std::string offer_topic = create_topic("offer", id);
       NotificationMessage msg{
@@ -1169,7 +1128,7 @@ Task<> Offers::reject_offer(
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -1215,6 +1174,9 @@ Task<> Offers::reject_offer(
         "RETURNING updated_at",
         convert::string_to_int(id).value());
 
+    ServiceManager::get_instance().get_offer_access_cache().invalidate(
+        convert::string_to_int(id).value());
+
     // notify the rejected offer
     std::string offer_topic = create_topic("offer", id);
     NotificationMessage msg{
@@ -1246,33 +1208,47 @@ Task<> Offers::reject_offer(
   co_return;
 }
 
-// Get all offers made by the current user
+// Get a page of the offers made by the current user
 Task<> Offers::get_my_offers(
     HttpRequestPtr req, std::function<void(const HttpResponsePtr&)> callback) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
-  auto db = app().getDbClient();
+  auto params = read_offer_listing_params(req);
+  if (!params) {
+    SimpleError error{.error = "Invalid cursor or status"};
+    auto resp = HttpResponse::newHttpResponse(drogon::k400BadRequest,
+                                              CT_APPLICATION_JSON);
+    resp->setBody(glz::write_json(error).value_or(""));
+    callback(resp);
+    co_return;
+  }
+
+  auto db = utilities::traced_db_client(req);
 
   try {
+    // One row past the limit tells whether there is a next page
     auto result = co_await db->execSqlCoro(
-        "SELECT o.*, p.content as post_content, u.username as "
-        "post_owner_username "
-        "FROM offers o "
-        "JOIN posts p ON o.post_id = p.id "
-        "JOIN users u ON p.user_id = u.id "
-        "WHERE o.user_id = $1 "
-        "ORDER BY o.updated_at DESC",
-        convert::string_to_int(current_user_id).value());
-
-    std::vector<MyOfferInfo> my_offers_data;
-    my_offers_data.reserve(result.size());
-    for (const auto& row : result) {
-      int offer_id = row["id"].as<int>();
-      auto media_attachments =
-          co_await get_media_attachments("offer", offer_id);
-      my_offers_data.emplace_back(MyOfferInfo{
-          .id = offer_id,
+        std::string(offer_statements::MY_OFFERS_PAGE),
+        convert::string_to_int(current_user_id).value(),
+        params->after_updated_us, params->after_id, params->statuses,
+        params->limit + 1);
+
+    const auto rows = std::min<std::size_t>(result.size(), params->limit);
+    std::vector<int> offer_ids;
+    offer_ids.reserve(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+      offer_ids.push_back(result[i]["id"].as<int>());
+    }
+    auto media = co_await get_media_attachments_batch("offer", offer_ids);
+
+    MyOffersPage page;
+    page.offers.reserve(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+      const auto& row = result[i];
+      auto media_it = media.find(offer_ids[i]);
+      page.offers.emplace_back(MyOfferInfo{
+          .id = offer_ids[i],
           .post_id = row["post_id"].as<int>(),
           .post_content = row["post_content"].as<std::string>(),
           .post_owner_username = row["post_owner_username"].as<std::string>(),
@@ -1284,13 +1260,16 @@ Task<> Offers::get_my_offers(
           .status = row["status"].as<std::string>(),
           .created_at = row["created_at"].as<std::string>(),
           .updated_at = row["updated_at"].as<std::string>(),
-          .media = media_attachments.value_or({})});
+          .media = media_it != media.end() ? std::move(media_it->second)
+                                           : std::vector<MediaQuickInfo>{}});
+    }
+    if (result.size() > rows) {
+      page.next_cursor = offer_listing_cursor(result[rows - 1]);
     }
 
-    auto resp =
-        HttpResponse::newHttpResponse(drogon::k200OK, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(my_offers_data).value_or(""));
-    callback(resp);
+    auto& compressor = ServiceManager::get_instance().get_response_compressor();
+    callback(co_await compressor.compress(
+        req, utilities::negotiated_response(req, page), "get_my_offers"));
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
     SimpleError error{.error = "Database error"};
@@ -1303,32 +1282,47 @@ Task<> Offers::get_my_offers(
   co_return;
 }
 
-// Get all offers received for the current user's posts
+// Get a page of the offers received for the current user's posts
 Task<> Offers::get_received_offers(
     HttpRequestPtr req, std::function<void(const HttpResponsePtr&)> callback) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
-  auto db = app().getDbClient();
+  auto params = read_offer_listing_params(req);
+  if (!params) {
+    SimpleError error{.error = "Invalid cursor or status"};
+    auto resp = HttpResponse::newHttpResponse(drogon::k400BadRequest,
+                                              CT_APPLICATION_JSON);
+    resp->setBody(glz::write_json(error).value_or(""));
+    callback(resp);
+    co_return;
+  }
+
+  auto db = utilities::traced_db_client(req);
 
   try {
+    // One row past the limit tells whether there is a next page
     auto result = co_await db->execSqlCoro(
-        "SELECT o.*, p.content as post_content, u.username as offer_username "
-        "FROM offers o "
-        "JOIN posts p ON o.post_id = p.id "
-        "JOIN users u ON o.user_id = u.id "
-        "WHERE p.user_id = $1 "
-        "ORDER BY o.updated_at DESC",
-        convert::string_to_int(current_user_id).value());
-
-    std::vector<ReceivedOfferInfo> received_offers_data;
-    received_offers_data.reserve(result.size());
-    for (const auto& row : result) {
-      int offer_id = row["id"].as<int>();
-      auto media_attachments =
-          co_await get_media_attachments("offer", offer_id);
-      received_offers_data.emplace_back(ReceivedOfferInfo{
-          .id = offer_id,
+        std::string(offer_statements::RECEIVED_OFFERS_PAGE),
+        convert::string_to_int(current_user_id).value(),
+        params->after_updated_us, params->after_id, params->statuses,
+        params->limit + 1);
+
+    const auto rows = std::min<std::size_t>(result.size(), params->limit);
+    std::vector<int> offer_ids;
+    offer_ids.reserve(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+      offer_ids.push_back(result[i]["id"].as<int>());
+    }
+    auto media = co_await get_media_attachments_batch("offer", offer_ids);
+
+    ReceivedOffersPage page;
+    page.offers.reserve(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+      const auto& row = result[i];
+      auto media_it = media.find(offer_ids[i]);
+      page.offers.emplace_back(ReceivedOfferInfo{
+          .id = offer_ids[i],
           .post_id = row["post_id"].as<int>(),
           .post_content = row["post_content"].as<std::string>(),
           .user_id = row["user_id"].as<int>(),
@@ -1341,13 +1335,14 @@ Task<> Offers::get_received_offers(
           .status = row["status"].as<std::string>(),
           .created_at = row["created_at"].as<std::string>(),
           .updated_at = row["updated_at"].as<std::string>(),
-          .media = media_attachments.value_or({})});
+          .media = media_it != media.end() ? std::move(media_it->second)
+                                           : std::vector<MediaQuickInfo>{}});
+    }
+    if (result.size() > rows) {
+      page.next_cursor = offer_listing_cursor(result[rows - 1]);
     }
 
-    auto resp =
-        HttpResponse::newHttpResponse(drogon::k200OK, CT_APPLICATION_JSON);
-    resp->setBody(glz::write_json(received_offers_data).value_or(""));
-    callback(resp);
+    callback(utilities::negotiated_response(req, page));
   } catch (const DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
     SimpleError error{.error = "Database error"};
@@ -1366,7 +1361,7 @@ Task<> Offers::get_notifications(
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -1418,7 +1413,7 @@ Task<> Offers::mark_notification_read(
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     auto result = co_await db->execSqlCoro(
@@ -1462,7 +1457,7 @@ Task<> Offers::mark_all_notifications_read(
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
 
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
     co_await db->execSqlCoro(
@@ -40,11 +40,14 @@ class Offers : public drogon::HttpController<Offers> {
   ADD_METHOD_TO(Offers::reject_offer, "/api/v1/offers/{id}/reject", Post,
                 Options, "CorsMiddleware", "AuthMiddleware");
 
-  // Get all offers made by the current user
+  // Get a page of the offers made by the current user, newest activity first.
+  // ?limit=(1-100, default 20)&cursor=(previous next_cursor)
+  // &status=(comma separated pending, accepted, rejected)
   ADD_METHOD_TO(Offers::get_my_offers, "/api/v1/offers/my-offers", Get, Options,
                 "CorsMiddleware", "AuthMiddleware");
 
-  // Get all offers received for the current user's posts
+  // Get a page of the offers received for the current user's posts, same
+  // parameters as my-offers
   ADD_METHOD_TO(Offers::get_received_offers, "/api/v1/offers/received", Get,
                 Options, "CorsMiddleware", "AuthMiddleware");
 
@@ -18,6 +18,7 @@
 
 #include "../services/service_manager.hpp"
 #include "../utilities/conversion.hpp"
+#include "../utilities/db_tracing.hpp"
 #include "../utilities/json_manipulation.hpp"
 #include "common_req_n_resp.hpp"
 #include "offers.hpp"
@@ -32,7 +33,6 @@ using drogon::k404NotFound;
 using drogon::k500InternalServerError;
 using drogon::Task;
 using drogon::orm::DrogonDbException;
-using drogon::orm::Transaction;
 
 using api::v1::Offers;
 
@@ -71,11 +71,10 @@ struct MessageMetadata {
 };
 
 // Helper function to create a conversation between two users
-Task<std::string> create_or_get_conversation(std::string user1_id,
+Task<std::string> create_or_get_conversation(const utilities::TracedDbPtr& db,
+                                             std::string user1_id,
                                              std::string user2_id,
                                              std::string offer_id) {
-  auto db = app().getDbClient();
-
   // Check if a conversation already exists between these users
   try {
     auto result = co_await db->execSqlCoro(
@@ -120,7 +119,7 @@ Task<std::string> create_or_get_conversation(std::string user1_id,
 
 // Create/get conversations during a transaction
 Task<std::string> create_or_get_conversation_transaction(
-    const std::shared_ptr<Transaction>& transaction, std::string user1_id,
+    const utilities::TracedDbPtr& transaction, std::string user1_id,
     std::string user2_id, std::string offer_id) {
   try {
     auto result = co_await transaction->execSqlCoro(
@@ -166,7 +165,7 @@ Task<std::string> create_or_get_conversation_transaction(
 
 // Dead code: Helper function to add a negotiation message to a conversation
 void add_negotiation_message(
-    std::shared_ptr<Transaction> transaction, std::string conversation_id,
+    utilities::TracedDbPtr transaction, std::string conversation_id,
     std::string sender_id, double proposed_price, std::string message,
     int negotiation_id, std::string offer_id,
     std::function<void(const HttpResponsePtr&)> callback) {
@@ -217,7 +216,7 @@ Task<> Offers::negotiate_offer(
     std::string id) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   NegotiateOfferRequest negotiate_req;
   auto parse_error = utilities::strict_read_json(negotiate_req, req->getBody());
@@ -237,47 +236,52 @@ Task<> Offers::negotiate_offer(
   LOG_INFO << "Starting negotiate_offer for offer ID: " << id;
 
   try {
-    auto transaction = co_await db->newTransactionCoro();
+    // Check if the offer exists and get the other user's ID before opening
+    // the transaction
+    auto participants = co_await ServiceManager::get_instance()
+                            .get_offer_access_cache()
+                            .get(convert::string_to_int(id).value());
 
-    try {
-      // First, check if the offer exists and get the other user's ID
-      auto result = co_await transaction->execSqlCoro(
-          "SELECT o.*, p.user_id AS post_user_id "
-          "FROM offers o "
-          "JOIN posts p ON o.post_id = p.id "
-          "WHERE o.id = $1",
-          convert::string_to_int(id).value());
+    if (!participants) {
+      SimpleError error{.error = "Offer not found"};
+      auto resp =
+          HttpResponse::newHttpResponse(k404NotFound, CT_APPLICATION_JSON);
+      resp->setBody(glz::write_json(error).value_or(""));
+      callback(resp);
+      co_return;
+    }
 
-      if (result.empty()) {
-        SimpleError error{.error = "Offer not found"};
-        auto resp =
-            HttpResponse::newHttpResponse(k404NotFound, CT_APPLICATION_JSON);
-        resp->setBody(glz::write_json(error).value_or(""));
-        callback(resp);
-        transaction->rollback();
-        co_return;
-      }
+    // Check if user is authorized (must be either offer creator or post
+    // owner)
+    int offer_user_id = participants->seller_id;
+    int post_user_id = participants->buyer_id;
 
-      // Check if user is authorized (must be either offer creator or post
-      // owner)
-      int offer_user_id = result[0]["user_id"].as<int>();
-      int post_user_id = result[0]["post_user_id"].as<int>();
+    LOG_INFO << "offer_user_id: " << offer_user_id;
+    LOG_INFO << "current_user_id: " << current_user_id;
+    LOG_INFO << "post_user_id: " << post_user_id;
 
-      LOG_INFO << "offer_user_id: " << offer_user_id;
-      LOG_INFO << "current_user_id: " << current_user_id;
-      LOG_INFO << "post_user_id: " << post_user_id;
+    if (!participants->is_participant(
+            convert::string_to_int(current_user_id).value())) {
+      SimpleError error{.error = "Unauthorized"};
+      auto resp =
+          HttpResponse::newHttpResponse(k403Forbidden, CT_APPLICATION_JSON);
+      resp->setBody(glz::write_json(error).value_or(""));
+      callback(resp);
+      co_return;
+    }
 
-      if (convert::string_to_int(current_user_id).value() != offer_user_id &&
-          convert::string_to_int(current_user_id).value() != post_user_id) {
-        SimpleError error{.error = "Unauthorized"};
-        auto resp =
-            HttpResponse::newHttpResponse(k403Forbidden, CT_APPLICATION_JSON);
-        resp->setBody(glz::write_json(error).value_or(""));
-        callback(resp);
-        transaction->rollback();
-        co_return;
-      }
+    if (participants->status != "pending") {
+      SimpleError error{.error = "Only pending offers can be negotiated"};
+      auto resp =
+          HttpResponse::newHttpResponse(k400BadRequest, CT_APPLICATION_JSON);
+      resp->setBody(glz::write_json(error).value_or(""));
+      callback(resp);
+      co_return;
+    }
+
+    auto transaction = co_await db->newTransactionCoro();
 
+    try {
       co_await transaction->execSqlCoro(
           "UPDATE offers SET negotiation_status = 'in_progress' WHERE id = $1",
           convert::string_to_int(id).value());
@@ -373,6 +377,14 @@ Task<> Offers::negotiate_offer(
       resp->setBody(glz::write_json(error).value_or(""));
       callback(resp);
     }
+  } catch (const DrogonDbException& e) {
+    LOG_ERROR << "Database error: " << e.base().what();
+    SimpleError error{.error =
+                          "Database error: " + std::string(e.base().what())};
+    auto resp = HttpResponse::newHttpResponse(k500InternalServerError,
+                                              CT_APPLICATION_JSON);
+    resp->setBody(glz::write_json(error).value_or(""));
+    callback(resp);
   } catch (const std::exception& e) {
     LOG_ERROR << "Exception: " << e.what();
     SimpleError error{.error = "Error: " + std::string(e.what())};
@@ -391,17 +403,14 @@ Task<> Offers::get_negotiations(
     std::string id) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
-    auto result = co_await db->execSqlCoro(
-        "SELECT o.*, p.user_id AS post_user_id "
-        "FROM offers o "
-        "JOIN posts p ON o.post_id = p.id "
-        "WHERE o.id = $1",
-        convert::string_to_int(id).value());
+    auto participants = co_await ServiceManager::get_instance()
+                            .get_offer_access_cache()
+                            .get(convert::string_to_int(id).value());
 
-    if (result.empty()) {
+    if (!participants) {
       SimpleError error{.error = "Offer not found"};
       auto resp =
           HttpResponse::newHttpResponse(k404NotFound, CT_APPLICATION_JSON);
@@ -410,11 +419,8 @@ Task<> Offers::get_negotiations(
       co_return;
     }
 
-    int offer_user_id = result[0]["user_id"].as<int>();
-    int post_user_id = result[0]["post_user_id"].as<int>();
-
-    if (convert::string_to_int(current_user_id).value() != offer_user_id &&
-        convert::string_to_int(current_user_id).value() != post_user_id) {
+    if (!participants->is_participant(
+            convert::string_to_int(current_user_id).value())) {
       SimpleError error{.error = "Unauthorized"};
       auto resp =
           HttpResponse::newHttpResponse(k403Forbidden, CT_APPLICATION_JSON);
@@ -547,7 +553,7 @@ Task<> Offers::request_proof(
     std::string id) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   RequestProofRequest proof_req;
   auto parse_error = utilities::strict_read_json(proof_req, req->getBody());
@@ -564,14 +570,11 @@ Task<> Offers::request_proof(
   std::string message = proof_req.message.value_or("");
 
   try {
-    auto result = co_await db->execSqlCoro(
-        "SELECT o.*, p.user_id AS post_user_id "
-        "FROM offers o "
-        "JOIN posts p ON o.post_id = p.id "
-        "WHERE o.id = $1",
-        convert::string_to_int(id).value());
+    auto participants = co_await ServiceManager::get_instance()
+                            .get_offer_access_cache()
+                            .get(convert::string_to_int(id).value());
 
-    if (result.empty()) {
+    if (!participants) {
       SimpleError error{.error = "Offer not found"};
       auto resp =
           HttpResponse::newHttpResponse(k404NotFound, CT_APPLICATION_JSON);
@@ -580,8 +583,8 @@ Task<> Offers::request_proof(
       co_return;
     }
 
-    int offer_user_id = result[0]["user_id"].as<int>();
-    int post_user_id = result[0]["post_user_id"].as<int>();
+    int offer_user_id = participants->seller_id;
+    int post_user_id = participants->buyer_id;
 
     if (convert::string_to_int(current_user_id).value() != post_user_id) {
       SimpleError error{.error = "Only the post owner can request proof"};
@@ -593,7 +596,7 @@ Task<> Offers::request_proof(
     }
 
     std::string conversation_id = co_await create_or_get_conversation(
-        current_user_id, std::to_string(offer_user_id), id);
+        db, current_user_id, std::to_string(offer_user_id), id);
 
     if (conversation_id.empty()) {
       SimpleError error{.error = "Failed to create conversation"};
@@ -652,7 +655,7 @@ Task<> Offers::submit_proof(
     std::string id) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   SubmitProofRequest submit_proof_req;
   auto parse_error =
@@ -671,14 +674,11 @@ Task<> Offers::submit_proof(
   std::string description = submit_proof_req.description.value_or("");
 
   try {
-    auto result = co_await db->execSqlCoro(
-        "SELECT o.*, p.user_id AS post_user_id "
-        "FROM offers o "
-        "JOIN posts p ON o.post_id = p.id "
-        "WHERE o.id = $1",
-        convert::string_to_int(id).value());
+    auto participants = co_await ServiceManager::get_instance()
+                            .get_offer_access_cache()
+                            .get(convert::string_to_int(id).value());
 
-    if (result.empty()) {
+    if (!participants) {
       SimpleError error{.error = "Offer not found"};
       auto resp =
           HttpResponse::newHttpResponse(k404NotFound, CT_APPLICATION_JSON);
@@ -687,8 +687,8 @@ Task<> Offers::submit_proof(
       co_return;
     }
 
-    int offer_user_id = result[0]["user_id"].as<int>();
-    int post_user_id = result[0]["post_user_id"].as<int>();
+    int offer_user_id = participants->seller_id;
+    int post_user_id = participants->buyer_id;
 
     if (convert::string_to_int(current_user_id).value() != offer_user_id) {
       SimpleError error{.error = "Only the offer creator can submit proof"};
@@ -720,7 +720,7 @@ Task<> Offers::submit_proof(
     int proof_id = proof_result[0]["id"].as<int>();
 
     std::string conversation_id = co_await create_or_get_conversation(
-        current_user_id, std::to_string(post_user_id), id);
+        db, current_user_id, std::to_string(post_user_id), id);
 
     if (conversation_id.empty()) {
       SimpleError error{.error = "Failed to create conversation"};
@@ -781,17 +781,14 @@ Task<> Offers::get_proofs(HttpRequestPtr req,
                           std::string id) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
-    auto result = co_await db->execSqlCoro(
-        "SELECT o.*, p.user_id AS post_user_id "
-        "FROM offers o "
-        "JOIN posts p ON o.post_id = p.id "
-        "WHERE o.id = $1",
-        convert::string_to_int(id).value());
+    auto participants = co_await ServiceManager::get_instance()
+                            .get_offer_access_cache()
+                            .get(convert::string_to_int(id).value());
 
-    if (result.empty()) {
+    if (!participants) {
       SimpleError error{.error = "Offer not found"};
       auto resp =
           HttpResponse::newHttpResponse(k404NotFound, CT_APPLICATION_JSON);
@@ -800,11 +797,8 @@ Task<> Offers::get_proofs(HttpRequestPtr req,
       co_return;
     }
 
-    int offer_user_id = result[0]["user_id"].as<int>();
-    int post_user_id = result[0]["post_user_id"].as<int>();
-
-    if (convert::string_to_int(current_user_id).value() != offer_user_id &&
-        convert::string_to_int(current_user_id).value() != post_user_id) {
+    if (!participants->is_participant(
+            convert::string_to_int(current_user_id).value())) {
       SimpleError error{.error = "Unauthorized"};
       auto resp =
           HttpResponse::newHttpResponse(k403Forbidden, CT_APPLICATION_JSON);
@@ -863,17 +857,14 @@ Task<> Offers::approve_proof(
     std::string id, std::string proof_id) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
-    auto result = co_await db->execSqlCoro(
-        "SELECT o.*, p.user_id AS post_user_id "
-        "FROM offers o "
-        "JOIN posts p ON o.post_id = p.id "
-        "WHERE o.id = $1",
-        convert::string_to_int(id).value());
+    auto participants = co_await ServiceManager::get_instance()
+                            .get_offer_access_cache()
+                            .get(convert::string_to_int(id).value());
 
-    if (result.empty()) {
+    if (!participants) {
       SimpleError error{.error = "Offer not found"};
       auto resp =
           HttpResponse::newHttpResponse(k404NotFound, CT_APPLICATION_JSON);
@@ -882,8 +873,8 @@ Task<> Offers::approve_proof(
       co_return;
     }
 
-    int offer_user_id = result[0]["user_id"].as<int>();
-    int post_user_id = result[0]["post_user_id"].as<int>();
+    int offer_user_id = participants->seller_id;
+    int post_user_id = participants->buyer_id;
 
     if (convert::string_to_int(current_user_id).value() != post_user_id) {
       SimpleError error{.error = "Only the post owner can approve proof"};
@@ -910,7 +901,7 @@ Task<> Offers::approve_proof(
     }
 
     std::string conversation_id = co_await create_or_get_conversation(
-        current_user_id, std::to_string(offer_user_id), id);
+        db, current_user_id, std::to_string(offer_user_id), id);
 
     if (conversation_id.empty()) {
       SimpleError error{.error = "Failed to create conversation"};
@@ -964,7 +955,7 @@ Task<> Offers::reject_proof(
     std::string id, std::string proof_id) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   RejectProofRequest reject_req;
   auto parse_error = utilities::strict_read_json(reject_req, req->getBody());
@@ -972,14 +963,11 @@ Task<> Offers::reject_proof(
   std::string reason = parse_error ? "" : reject_req.reason.value_or("");
 
   try {
-    auto result = co_await db->execSqlCoro(
-        "SELECT o.*, p.user_id AS post_user_id "
-        "FROM offers o "
-        "JOIN posts p ON o.post_id = p.id "
-        "WHERE o.id = $1",
-        convert::string_to_int(id).value());
+    auto participants = co_await ServiceManager::get_instance()
+                            .get_offer_access_cache()
+                            .get(convert::string_to_int(id).value());
 
-    if (result.empty()) {
+    if (!participants) {
       SimpleError error{.error = "Offer not found"};
       auto resp =
           HttpResponse::newHttpResponse(k404NotFound, CT_APPLICATION_JSON);
@@ -988,8 +976,8 @@ Task<> Offers::reject_proof(
       co_return;
     }
 
-    int offer_user_id = result[0]["user_id"].as<int>();
-    int post_user_id = result[0]["post_user_id"].as<int>();
+    int offer_user_id = participants->seller_id;
+    int post_user_id = participants->buyer_id;
 
     if (convert::string_to_int(current_user_id).value() != post_user_id) {
       SimpleError error{.error = "Only the post owner can reject proof"};
@@ -1016,7 +1004,7 @@ Task<> Offers::reject_proof(
     }
 
     std::string conversation_id = co_await create_or_get_conversation(
-        current_user_id, std::to_string(offer_user_id), id);
+        db, current_user_id, std::to_string(offer_user_id), id);
 
     if (conversation_id.empty()) {
       SimpleError error{.error = "Failed to create conversation"};
@@ -1073,7 +1061,7 @@ Task<> Offers::create_escrow(
     std::string id) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   CreateEscrowRequest escrow_req;
   auto parse_error = utilities::strict_read_json(escrow_req, req->getBody());
@@ -1090,14 +1078,11 @@ Task<> Offers::create_escrow(
   double amount = escrow_req.amount;
 
   try {
-    auto result = co_await db->execSqlCoro(
-        "SELECT o.*, p.user_id AS post_user_id "
-        "FROM offers o "
-        "JOIN posts p ON o.post_id = p.id "
-        "WHERE o.id = $1",
-        convert::string_to_int(id).value());
+    auto participants = co_await ServiceManager::get_instance()
+                            .get_offer_access_cache()
+                            .get(convert::string_to_int(id).value());
 
-    if (result.empty()) {
+    if (!participants) {
       SimpleError error{.error = "Offer not found"};
       auto resp =
           HttpResponse::newHttpResponse(k404NotFound, CT_APPLICATION_JSON);
@@ -1106,8 +1091,8 @@ Task<> Offers::create_escrow(
       co_return;
     }
 
-    int offer_user_id = result[0]["user_id"].as<int>();
-    int post_user_id = result[0]["post_user_id"].as<int>();
+    int offer_user_id = participants->seller_id;
+    int post_user_id = participants->buyer_id;
 
     if (convert::string_to_int(current_user_id).value() != post_user_id) {
       SimpleError error{.error = "Only the post owner can create escrow"};
@@ -1138,7 +1123,7 @@ Task<> Offers::create_escrow(
     int escrow_id = escrow_result[0]["id"].as<int>();
 
     std::string conversation_id = co_await create_or_get_conversation(
-        current_user_id, std::to_string(offer_user_id), id);
+        db, current_user_id, std::to_string(offer_user_id), id);
 
     if (conversation_id.empty()) {
       SimpleError error{.error = "Failed to create conversation"};
@@ -1196,17 +1181,14 @@ Task<> Offers::get_escrow(HttpRequestPtr req,
                           std::string id) {
   std::string current_user_id =
       req->getAttributes()->get<std::string>("current_user_id");
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   try {
-    auto result = co_await db->execSqlCoro(
-        "SELECT o.*, p.user_id AS post_user_id "
-        "FROM offers o "
-        "JOIN posts p ON o.post_id = p.id "
-        "WHERE o.id = $1",
-        convert::string_to_int(id).value());
+    auto participants = co_await ServiceManager::get_instance()
+                            .get_offer_access_cache()
+                            .get(convert::string_to_int(id).value());
 
-    if (result.empty()) {
+    if (!participants) {
       SimpleError error{.error = "Offer not found"};
       auto resp =
           HttpResponse::newHttpResponse(k404NotFound, CT_APPLICATION_JSON);
@@ -1215,11 +1197,8 @@ Task<> Offers::get_escrow(HttpRequestPtr req,
       co_return;
     }
 
-    int offer_user_id = result[0]["user_id"].as<int>();
-    int post_user_id = result[0]["post_user_id"].as<int>();
-
-    if (convert::string_to_int(current_user_id).value() != offer_user_id &&
-        convert::string_to_int(current_user_id).value() != post_user_id) {
+    if (!participants->is_participant(
+            convert::string_to_int(current_user_id).value())) {
       SimpleError error{.error = "Unauthorized"};
       auto resp =
           HttpResponse::newHttpResponse(k403Forbidden, CT_APPLICATION_JSON);
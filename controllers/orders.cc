@@ -13,6 +13,7 @@
 #include <drogon/orm/SqlBinder.h>
 
 #include "../utilities/conversion.hpp"
+#include "../utilities/db_tracing.hpp"
 #include "../utilities/json_manipulation.hpp"
 #include "common_req_n_resp.hpp"
 
@@ -46,7 +47,7 @@ struct CreateOrderResponse {
 
 Task<> Orders::get_orders(
     HttpRequestPtr req, std::function<void(const HttpResponsePtr&)> callback) {
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   // Pagination parameters
   std::size_t page = 1;
@@ -96,7 +97,7 @@ Task<> Orders::get_orders(
 
 Task<> Orders::create_order(
     HttpRequestPtr req, std::function<void(const HttpResponsePtr&)> callback) {
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   CreateOrderRequest create_req;
   auto parse_error = utilities::strict_read_json(create_req, req->getBody());
@@ -1,11 +1,20 @@
 #ifndef SCENARIO_SPECIFIC_UTILS_HPP
 #define SCENARIO_SPECIFIC_UTILS_HPP
 
+#include <ankerl/unordered_dense.h>
 #include <drogon/drogon.h>
 #include <drogon/orm/DbClient.h>
 
+#include <algorithm>
+#include <set>
+#include <tuple>
+
 #include "../services/service_manager.hpp"
+#include "../utilities/conversion.hpp"
+#include "../utilities/db_tracing.hpp"
 #include "../utilities/json_manipulation.hpp"
+#include "../utilities/media_sniffing.hpp"
+#include "../utilities/when_all.hpp"
 #include "common_req_n_resp.hpp"
 
 /**
@@ -20,53 +29,268 @@
  *
  */
 
+namespace detail {
+
+// Object that passed the S3 existence and content checks, ready to insert
+struct ValidatedMedia {
+  std::string object_key;
+  std::string filename;
+  std::string mime_type;
+  int64_t size = 0;
+  std::string etag;
+  std::string last_modified;
+};
+
+/**
+ * @brief Checks all object keys against S3 concurrently.
+ * Duplicate keys are checked once. Keys without an object, or whose sniffed
+ * content is not an allowed media type, are dropped, otherwise input order
+ * is kept.
+ */
+inline drogon::Task<std::vector<ValidatedMedia>> validate_media_objects(
+    const std::vector<std::string>& object_keys) {
+  std::vector<std::string> unique_keys;
+  unique_keys.reserve(object_keys.size());
+  for (const auto& object_key : object_keys) {
+    if (std::ranges::find(unique_keys, object_key) == unique_keys.end()) {
+      unique_keys.push_back(object_key);
+    }
+  }
+
+  auto& media_info_cache =
+      ServiceManager::get_instance().get_media_info_cache();
+  std::vector<drogon::Task<MediaInfo>> lookups;
+  lookups.reserve(unique_keys.size());
+  for (const auto& object_key : unique_keys) {
+    lookups.emplace_back(media_info_cache.get(
+        std::string(service::BUCKET_NAME), object_key));
+  }
+  auto infos = co_await utilities::when_all(std::move(lookups));
+
+  std::vector<ValidatedMedia> validated;
+  validated.reserve(infos.size());
+  for (size_t i = 0; i < infos.size(); ++i) {
+    auto& info = infos[i];
+    if (info.etag.empty()) {
+      LOG_ERROR << "Media info not found for " << unique_keys[i];
+      continue;
+    }
+    if (!utilities::is_allowed_media_type(info.content_type)) {
+      LOG_ERROR << "Rejected " << unique_keys[i] << " with content type "
+                << info.content_type;
+      continue;
+    }
+    const auto& object_key = unique_keys[i];
+    validated.emplace_back(ValidatedMedia{
+        .object_key = object_key,
+        .filename = object_key.substr(object_key.find('_') + 1),
+        .mime_type = std::move(info.content_type),
+        .size = info.content_length,
+        .etag = std::move(info.etag),
+        .last_modified = std::move(info.last_modified)});
+  }
+  co_return validated;
+}
+
+/**
+ * @brief Upserts the media rows and links them to "prefix"_media in a single
+ * statement, one round trip regardless of the number of attachments.
+ * @return inserted media in input order.
+ */
+template <typename UploaderId, typename PrefixId>
+inline drogon::Task<std::vector<MediaQuickInfo>> insert_media_attachments(
+    std::vector<ValidatedMedia> media,
+    const utilities::TracedDbPtr& transaction,
+    UploaderId uploader_id, std::string media_table_prefix,
+    PrefixId media_table_prefix_id) {
+  std::vector<MediaQuickInfo> inserted;
+  if (media.empty()) {
+    co_return inserted;
+  }
+
+  std::vector<std::string> keys, filenames, mime_types, sizes, etags,
+      last_modified;
+  keys.reserve(media.size());
+  filenames.reserve(media.size());
+  mime_types.reserve(media.size());
+  sizes.reserve(media.size());
+  etags.reserve(media.size());
+  last_modified.reserve(media.size());
+  for (const auto& item : media) {
+    keys.push_back(item.object_key);
+    filenames.push_back(item.filename);
+    mime_types.push_back(item.mime_type);
+    sizes.push_back(std::to_string(item.size));
+    etags.push_back(item.etag);
+    last_modified.push_back(item.last_modified);
+  }
+
+  auto result = co_await transaction->execSqlCoro(
+      std::format(
+          "WITH input AS ("
+          "  SELECT * FROM unnest($2::text[], $3::text[], $4::text[], "
+          "  $5::bigint[], $7::text[], $8::text[]) WITH ORDINALITY "
+          "  AS t(storage_key, file_name, mime_type, size, etag, "
+          "  last_modified, ord)"
+          "), upserted AS ("
+          "  INSERT INTO media (uploader_id, storage_key, file_name, "
+          "  mime_type, size, metadata) "
+          "  SELECT $1::int, storage_key, file_name, mime_type, size, "
+          "  jsonb_build_object('etag', etag, 'last_modified', last_modified) "
+          "  FROM input ORDER BY ord "
+          "  ON CONFLICT (storage_key) DO UPDATE SET "
+          "  file_name = EXCLUDED.file_name, "
+          "  mime_type = EXCLUDED.mime_type, "
+          "  size = EXCLUDED.size, "
+          "  metadata = media.metadata || EXCLUDED.metadata "
+          "  RETURNING id, storage_key, "
+          "  (metadata -> 'variants') IS NOT NULL AS has_variants"
+          "), linked AS ("
+          "  INSERT INTO {}_media ({}_id, media_id) "
+          "  SELECT $6::int, id FROM upserted"
+          ") "
+          "SELECT u.id, i.storage_key, u.has_variants FROM upserted u "
+          "JOIN input i ON i.storage_key = u.storage_key "
+          "ORDER BY i.ord",
+          media_table_prefix, media_table_prefix),
+      uploader_id, convert::array_to_quoted_pgsql_array_string(keys),
+      convert::array_to_quoted_pgsql_array_string(filenames),
+      convert::array_to_quoted_pgsql_array_string(mime_types),
+      convert::array_to_quoted_pgsql_array_string(sizes),
+      media_table_prefix_id,
+      convert::array_to_quoted_pgsql_array_string(etags),
+      convert::array_to_quoted_pgsql_array_string(last_modified));
+
+  // Rows come back in input order, with the same keys
+  std::vector<std::tuple<std::string, int64_t, std::string>> thumbnail_jobs;
+  inserted.reserve(result.size());
+  for (size_t i = 0; i < result.size() && i < media.size(); ++i) {
+    auto& item = media[i];
+    if (!result[i]["has_variants"].as<bool>() &&
+        ThumbnailService::is_supported(item.mime_type)) {
+      thumbnail_jobs.emplace_back(item.object_key, item.size, item.mime_type);
+    }
+    inserted.emplace_back(
+        MediaQuickInfo{.media_id = result[i]["id"].as<int>(),
+                       .object_key = std::move(item.object_key),
+                       .filename = std::move(item.filename),
+                       .mime_type = std::move(item.mime_type),
+                       .size = item.size,
+                       .variants = {}});
+  }
+
+  // Thumbnails are generated in the background once the rows are committed
+  if (!thumbnail_jobs.empty()) {
+    transaction->setCommitCallback(
+        [jobs = std::move(thumbnail_jobs)](bool committed) mutable {
+          if (!committed) {
+            return;
+          }
+          auto& thumbnails =
+              ServiceManager::get_instance().get_thumbnail_service();
+          for (auto& [object_key, size, mime_type] : jobs) {
+            thumbnails.enqueue(std::move(object_key), size, mime_type);
+          }
+        });
+  }
+  co_return inserted;
+}
+
+}  // namespace detail
+
+// Parses media.metadata->'variants', empty if there are none (yet)
+inline std::vector<MediaVariant> read_media_variants(
+    const drogon::orm::Field& field) {
+  std::vector<MediaVariant> variants;
+  if (!field.isNull()) {
+    if (utilities::relaxed_read_json(variants, field.as<std::string>())) {
+      variants.clear();
+    }
+  }
+  return variants;
+}
+
+// Lists the media attached through "prefix"_media, $1 is the prefix id
+inline std::string media_attachments_sql(std::string_view media_table_prefix) {
+  return std::format(
+      "SELECT med.id, med.storage_key, med.file_name, med.mime_type, "
+      "med.size, med.metadata -> 'variants' AS variants "
+      "FROM {}_media om "
+      "INNER JOIN media med ON om.media_id = med.id "
+      "WHERE om.{}_id = $1",  // ORDER BY med.created_at DESC
+      media_table_prefix, media_table_prefix);
+}
+
+// Lists the media attached to several "prefix" ids in one statement, $1 is
+// an int[] of prefix ids and owner_id the prefix id of each row
+inline std::string media_attachments_batch_sql(
+    std::string_view media_table_prefix) {
+  return std::format(
+      "SELECT om.{}_id AS owner_id, med.id, med.storage_key, med.file_name, "
+      "med.mime_type, med.size, med.metadata -> 'variants' AS variants "
+      "FROM {}_media om "
+      "INNER JOIN media med ON om.media_id = med.id "
+      "WHERE om.{}_id = ANY($1::int[])",
+      media_table_prefix, media_table_prefix, media_table_prefix);
+}
+
+// One row of media_attachments_sql() or media_attachments_batch_sql()
+inline MediaQuickInfo read_media_row(const drogon::orm::Row& media_row) {
+  return MediaQuickInfo{
+      .media_id = media_row["id"].as<int>(),
+      .object_key = media_row["storage_key"].as<std::string>(),
+      .filename = media_row["file_name"].as<std::string>(),
+      .mime_type = media_row["mime_type"].as<std::string>(),
+      .size = media_row["size"].as<int64_t>(),
+      .variants = read_media_variants(media_row["variants"])};
+}
+
+// Rows of media_attachments_sql()
+inline std::vector<MediaQuickInfo> read_media_attachments(
+    const drogon::orm::Result& media_result) {
+  std::vector<MediaQuickInfo> media_array;
+  media_array.reserve(media_result.size());
+  for (const auto& media_row : media_result) {
+    media_array.emplace_back(read_media_row(media_row));
+    // alternatively Generate presigned URL for viewing
+    // std::string object_key =
+    // media_row["storage_key"].as<std::string>();
+    // std::string mime_type = media_row["mime_type"].as<std::string>();
+
+    // try {
+    //   auto presigned_url = co_await ServiceManager::get_instance()
+    //                        .get_s3_service()
+    //                        .generate_presigned_url(service::BUCKET_NAME,
+    //                         object_key,
+    //                         drogon::HttpMethod::Get,
+    //                         mime_type);
+    //   media_item["presigned_url"] = presigned_url;
+    // } catch (const std::exception& e) {
+    //   LOG_ERROR << "Failed to generate presigned URL: " << e.what();
+    //   media_item["presigned_url"] = "";
+    // }
+  }
+  return media_array;
+}
+
 /**
  * @brief Naive processing of available media.
  * It runs using an existing db transaction.
  * Processing involves checks for validity of object key making necessary
- * media attachment inserts.
+ * media attachment inserts. Object keys are checked concurrently and all rows
+ * are inserted with a single statement.
  * @return boolean. false means there was an error,
  * true if processing is successful even if it didn't process all.
  */
 inline drogon::Task<bool> quick_process_media_attachments(
     std::vector<std::string>&& object_keys,
-    const std::shared_ptr<drogon::orm::Transaction>& transaction,
+    const utilities::TracedDbPtr& transaction,
     std::string current_user_id, std::string media_table_prefix,
     std::string media_table_prefix_id) {
-  for (const auto& object_key : object_keys) {
-    MediaInfo info =
-        co_await ServiceManager::get_instance().get_s3_service().get_media_info(
-            service::BUCKET_NAME, object_key);
-    if (info.etag.empty()) {
-      LOG_ERROR << "Media info not found for " << object_key;
-      continue;
-    }
-
-    std::string file_name = object_key.substr(object_key.find('_') + 1);
-    std::string mime_type = !info.content_type.empty()
-                                ? info.content_type
-                                : "application/octet-stream";
-
-    auto media_result = co_await transaction->execSqlCoro(
-        "INSERT INTO media (uploader_id, storage_key, file_name, "
-        "mime_type, size) "
-        "VALUES ($1, $2, $3, $4, $5) "
-        "ON CONFLICT (storage_key) DO UPDATE SET "
-        "file_name = EXCLUDED.file_name, "
-        "mime_type = EXCLUDED.mime_type, "
-        "size = EXCLUDED.size "
-        "RETURNING id",
-        current_user_id, object_key, file_name, mime_type, info.content_length);
-
-    if (!media_result.empty()) {
-      int media_id = media_result[0]["id"].as<int>();
-      std::string query =
-          std::format("INSERT INTO {}_media ({}_id, media_id) VALUES ($1, $2)",
-                      media_table_prefix, media_table_prefix);
-      // Link media to particular table
-      co_await transaction->execSqlCoro(query, media_table_prefix_id, media_id);
-    }
-  }
+  auto validated = co_await detail::validate_media_objects(object_keys);
+  co_await detail::insert_media_attachments(
+      std::move(validated), transaction, std::move(current_user_id),
+      std::move(media_table_prefix), std::move(media_table_prefix_id));
   co_return true;
 }
 
@@ -74,7 +298,8 @@ inline drogon::Task<bool> quick_process_media_attachments(
  * @brief Full processing of available media, returning processed media.
  * It runs using an existing db transaction.
  * Processing involves checks for validity of object key making necessary
- * media attachment inserts.
+ * media attachment inserts. Object keys are checked concurrently and all rows
+ * are inserted with a single statement.
  * @return std::vector<MediaQuickInfo> containing the fetched media
  * if successful or an error string.
  * @note Parameters passed by value/moved to avoid dangling references.
@@ -82,77 +307,14 @@ inline drogon::Task<bool> quick_process_media_attachments(
 inline drogon::Task<std::expected<std::vector<MediaQuickInfo>, std::string>>
 process_media_attachments(
     std::vector<std::string>&& object_keys,
-    const std::shared_ptr<drogon::orm::Transaction>& transaction,
+    const utilities::TracedDbPtr& transaction,
     int current_user_id, std::string media_table_prefix,
     int media_table_prefix_id) {
   try {
-    std::vector<MediaQuickInfo> processed_media;
-    processed_media.reserve(object_keys.size());
-    for (const auto& object_key : object_keys) {
-      MediaInfo info = co_await ServiceManager::get_instance()
-                           .get_s3_service()
-                           .get_media_info(service::BUCKET_NAME, object_key);
-      if (info.etag.empty()) {
-        continue;
-      }
-
-      std::string filename = object_key.substr(object_key.find('_') + 1);
-      std::string mime_type = !info.content_type.empty()
-                                  ? info.content_type
-                                  : "application/octet-stream";
-      int64_t& size = info.content_length;
-
-      auto media_result = co_await transaction->execSqlCoro(
-          "INSERT INTO media (uploader_id, storage_key, file_name, "
-          "mime_type, size) "
-          "VALUES ($1, $2, $3, $4, $5) "
-          "ON CONFLICT (storage_key) DO UPDATE SET "
-          "file_name = EXCLUDED.file_name, "
-          "mime_type = EXCLUDED.mime_type, "
-          "size = EXCLUDED.size "
-          "RETURNING id",
-          current_user_id, object_key, filename, mime_type, size);
-
-      if (!media_result.empty()) {
-        auto media_id = media_result[0]["id"].as<int>();
-        std::string query = std::format(
-            "INSERT INTO {}_media ({}_id, media_id) VALUES ($1, $2)",
-            media_table_prefix, media_table_prefix);
-        // Link media to particular table
-        co_await transaction->execSqlCoro(query, media_table_prefix_id,
-                                          media_id);
-
-        processed_media.emplace_back(MediaQuickInfo{.media_id = media_id,
-                                                    .object_key = object_key,
-                                                    .filename = filename,
-                                                    .mime_type = mime_type,
-                                                    .size = size});
-
-        // Alternatively Generate presigned URL for viewing
-        // try {
-        //   auto presigned_url = co_await ServiceManager::get_instance()
-        //                         .get_s3_service()
-        //                         .generate_presigned_url(service::BUCKET_NAME,
-        //                         object_key,
-        //                         drogon::HttpMethod::Get,
-        //                         mime_type);
-        //   processed_media.emplace_back(MediaQuickInfo{.media_id = media_id,
-        //       .object_key = object_key,
-        //       .filename = filename,
-        //       .mime_type = mime_type,
-        //       .size = size,
-        //       .presigned_url = presigned_url});
-        // } catch (const std::exception& e) {
-        //   LOG_ERROR << "Failed to generate presigned URL: " << e.what();
-        // processed_media.emplace_back(MediaQuickInfo{.media_id = media_id,
-        //                                             .object_key = object_key,
-        //                                             .filename = filename,
-        //                                             .mime_type = mime_type,
-        //                                             .size = size});
-        // }
-      }
-    }
-    co_return processed_media;
+    auto validated = co_await detail::validate_media_objects(object_keys);
+    co_return co_await detail::insert_media_attachments(
+        std::move(validated), transaction, current_user_id,
+        std::move(media_table_prefix), media_table_prefix_id);
 
   } catch (const drogon::orm::DrogonDbException& e) {
     LOG_ERROR << "Database error: " << e.base().what();
@@ -174,52 +336,27 @@ process_media_attachments(
 inline drogon::Task<> process_media_attachments_with_response(
     std::function<void(const drogon::HttpResponsePtr&)> callback,
     std::vector<std::string>&& object_keys,
-    const std::shared_ptr<drogon::orm::Transaction>& transaction,
+    const utilities::TracedDbPtr& transaction,
     std::string current_user_id, std::string media_table_prefix,
     std::string media_table_prefix_id) {
   try {
+    auto validated = co_await detail::validate_media_objects(object_keys);
+    const size_t found = validated.size();
+    auto inserted = co_await detail::insert_media_attachments(
+        std::move(validated), transaction, std::move(current_user_id),
+        std::move(media_table_prefix), std::move(media_table_prefix_id));
+
     MediaResponse media_resp;
-    media_resp.media_ids.reserve(object_keys.size());
+    media_resp.media_ids.reserve(inserted.size());
     auto& processed_media = media_resp.media_ids;
-    for (const auto& object_key : object_keys) {
-      MediaInfo info = co_await ServiceManager::get_instance()
-                           .get_s3_service()
-                           .get_media_info(service::BUCKET_NAME, object_key);
-      if (info.etag.empty()) {
-        continue;
-      }
-
-      std::string filename = object_key.substr(object_key.find('_') + 1);
-      std::string mime_type = !info.content_type.empty()
-                                  ? info.content_type
-                                  : "application/octet-stream";
-      int64_t& size = info.content_length;
-
-      auto media_result = co_await transaction->execSqlCoro(
-          "INSERT INTO media (uploader_id, storage_key, file_name, "
-          "mime_type, size) "
-          "VALUES ($1, $2, $3, $4, $5) "
-          "ON CONFLICT (storage_key) DO UPDATE SET "
-          "file_name = EXCLUDED.file_name, "
-          "mime_type = EXCLUDED.mime_type, "
-          "size = EXCLUDED.size "
-          "RETURNING id",
-          current_user_id, object_key, filename, mime_type, size);
-
-      if (!media_result.empty()) {
-        auto media_id = media_result[0]["id"].as<int>();
-        std::string query = std::format(
-            "INSERT INTO {}_media ({}_id, media_id) VALUES ($1, $2)",
-            media_table_prefix, media_table_prefix);
-        // Link media to particular table
-        co_await transaction->execSqlCoro(query, media_table_prefix_id,
-                                          media_id);
-
-        processed_media.emplace_back(media_id);
-      }
+    for (const auto& media : inserted) {
+      processed_media.emplace_back(media.media_id);
     }
 
-    if (processed_media.size() < object_keys.size()) {
+    // Every distinct key must have resolved to an object
+    if (found < std::set<std::string>(object_keys.begin(), object_keys.end())
+                    .size() ||
+        processed_media.size() < found) {
       LOG_ERROR << " Some Media info was not found";
       transaction->rollback();
       std::string error_string;
@@ -276,45 +413,9 @@ get_media_attachments(std::string media_table_prefix,
   auto db = drogon::app().getDbClient();
   try {
     auto media_result = co_await db->execSqlCoro(
-        std::format(
-            "SELECT med.id, med.storage_key, med.file_name, med.mime_type, "
-            "med.size, med.metadata "
-            "FROM {}_media om "
-            "INNER JOIN media med ON om.media_id = med.id "
-            "WHERE om.{}_id = $1",  // ORDER BY med.created_at DESC
-            media_table_prefix, media_table_prefix),
-        media_table_prefix_id);
-
-    std::vector<MediaQuickInfo> media_array;
-    if (!media_result.empty()) {
-      media_array.reserve(media_result.size());
-
-      for (const auto& media_row : media_result) {
-        media_array.emplace_back(MediaQuickInfo{
-            .media_id = media_row["id"].as<int>(),
-            .object_key = media_row["storage_key"].as<std::string>(),
-            .filename = media_row["file_name"].as<std::string>(),
-            .mime_type = media_row["mime_type"].as<std::string>(),
-            .size = media_row["size"].as<int64_t>()});
-        // alternatively Generate presigned URL for viewing
-        // std::string object_key =
-        // media_row["storage_key"].as<std::string>();
-        // std::string mime_type = media_row["mime_type"].as<std::string>();
-
-        // try {
-        //   auto presigned_url = co_await ServiceManager::get_instance()
-        //                        .get_s3_service()
-        //                        .generate_presigned_url(service::BUCKET_NAME,
-        //                         object_key,
-        //                         drogon::HttpMethod::Get,
-        //                         mime_type);
-        //   media_item["presigned_url"] = presigned_url;
-        // } catch (const std::exception& e) {
-        //   LOG_ERROR << "Failed to generate presigned URL: " << e.what();
-        //   media_item["presigned_url"] = "";
-        // }
-      }
-    }
+        media_attachments_sql(media_table_prefix), media_table_prefix_id);
+
+    auto media_array = read_media_attachments(media_result);
     co_return media_array;
   } catch (const drogon::orm::DrogonDbException& e) {
     LOG_ERROR << std::format("Database error: getting {} media: {}",
@@ -327,6 +428,41 @@ get_media_attachments(std::string media_table_prefix,
   }
 }
 
+// Media per "prefix" id
+using MediaByOwner =
+    ankerl::unordered_dense::map<int, std::vector<MediaQuickInfo>>;
+
+/**
+ * @brief Fetches the media of many "prefix" ids with a single query, instead
+ * of one get_media_attachments() per id.
+ * @return media per prefix id, ids without media are absent.
+ * @throws DrogonDbException on database errors.
+ */
+inline drogon::Task<MediaByOwner> get_media_attachments_batch(
+    std::string media_table_prefix, std::vector<int> media_table_prefix_ids) {
+  MediaByOwner media_by_id;
+  if (media_table_prefix_ids.empty()) {
+    co_return media_by_id;
+  }
+
+  std::string ids = "{";
+  for (size_t i{0}; int id : media_table_prefix_ids) {
+    if (i++ > 0) {
+      ids += ",";
+    }
+    ids += std::to_string(id);
+  }
+  ids += "}";
+
+  auto media_result = co_await drogon::app().getDbClient()->execSqlCoro(
+      media_attachments_batch_sql(media_table_prefix), ids);
+  for (const auto& media_row : media_result) {
+    media_by_id[media_row["owner_id"].as<int>()].emplace_back(
+        read_media_row(media_row));
+  }
+  co_return media_by_id;
+}
+
 /**
  * @brief Fetches available media and continues the response.
  * It runs using an existing db transaction.
@@ -340,45 +476,9 @@ inline drogon::Task<> get_media_attachments_with_response(
   auto db = drogon::app().getDbClient();
   try {
     auto media_result = co_await db->execSqlCoro(
-        std::format(
-            "SELECT med.id, med.storage_key, med.file_name, med.mime_type, "
-            "med.size, med.metadata "
-            "FROM {}_media om "
-            "INNER JOIN media med ON om.media_id = med.id "
-            "WHERE om.{}_id = $1",  // ORDER BY med.created_at DESC
-            media_table_prefix, media_table_prefix),
-        media_table_prefix_id);
-    MediaInfoResponse media_resp;
-    if (!media_result.empty()) {
-      auto& media_array = media_resp.media;
-      media_array.reserve(media_result.size());
-
-      for (const auto& media_row : media_result) {
-        media_array.emplace_back(MediaQuickInfo{
-            .media_id = media_row["id"].as<int>(),
-            .object_key = media_row["storage_key"].as<std::string>(),
-            .filename = media_row["file_name"].as<std::string>(),
-            .mime_type = media_row["mime_type"].as<std::string>(),
-            .size = media_row["size"].as<int64_t>()});
-        // alternatively Generate presigned URL for viewing
-        // std::string object_key =
-        // media_row["storage_key"].as<std::string>();
-        // std::string mime_type = media_row["mime_type"].as<std::string>();
-
-        // try {
-        //   auto presigned_url = co_await ServiceManager::get_instance()
-        //                        .get_s3_service()
-        //                        .generate_presigned_url(service::BUCKET_NAME,
-        //                         object_key,
-        //                         drogon::HttpMethod::Get,
-        //                         mime_type);
-        //   media_item["presigned_url"] = presigned_url;
-        // } catch (const std::exception& e) {
-        //   LOG_ERROR << "Failed to generate presigned URL: " << e.what();
-        //   media_item["presigned_url"] = "";
-        // }
-      }
-    }
+        media_attachments_sql(media_table_prefix), media_table_prefix_id);
+    MediaInfoResponse media_resp{.media =
+                                     read_media_attachments(media_result)};
     auto resp = drogon::HttpResponse::newHttpResponse(
         drogon::k200OK, drogon::CT_APPLICATION_JSON);
     resp->setBody(glz::write_json(media_resp).value_or(""));
@@ -13,6 +13,7 @@
 #include <drogon/orm/SqlBinder.h>
 
 #include "../utilities/conversion.hpp"
+#include "../utilities/db_routing.hpp"
 #include "../utilities/json_manipulation.hpp"
 #include "common_req_n_resp.hpp"
 
@@ -62,7 +63,7 @@ drogon::Task<> Search::search(
     co_return;
   }
 
-  auto db = app().getDbClient();
+  auto db = utilities::read_db_client(req);
   try {
     auto orders_result = co_await db->execSqlCoro(
         "SELECT * FROM orders WHERE CAST(id AS TEXT) ILIKE $1 OR status ILIKE "
@@ -13,6 +13,7 @@
 #include <drogon/orm/SqlBinder.h>
 
 #include "../utilities/conversion.hpp"
+#include "../utilities/db_tracing.hpp"
 #include "../utilities/json_manipulation.hpp"
 #include "common_req_n_resp.hpp"
 
@@ -33,7 +34,7 @@ struct UserInfo {
 drogon::Task<> Users::get_users(
     drogon::HttpRequestPtr req,
     std::function<void(const drogon::HttpResponsePtr&)> callback) {
-  auto db = app().getDbClient();
+  auto db = utilities::traced_db_client(req);
 
   std::size_t page = 1;
   std::size_t pageSize = 20;
@@ -1,12 +1,18 @@
 #include <drogon/drogon.h>
 
 #include <array>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <format>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "services/service_manager.hpp"
+#include "utilities/db_routing.hpp"
+#include "utilities/db_tracing.hpp"
+#include "utilities/metrics.hpp"
 
 void print_help() {
   std::cout << "Usage: buyer-backend [OPTIONS]\n\n"
@@ -96,6 +102,30 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
+  // Loopback only listener for /metrics, see controllers/admin.hpp
+  if (const int admin_port = config::get_config_int("admin_port", 9464);
+      admin_port > 0) {
+    drogon::app().addListener("127.0.0.1",
+                              static_cast<std::uint16_t>(admin_port));
+  }
+
+  // Per route latency and status class, keyed by the ADD_METHOD_TO pattern.
+  // Measured from the request being parsed to the response being handed back.
+  // Also closes the request's DB trace, see utilities/db_tracing.hpp
+  drogon::app().registerPostHandlingAdvice(
+      [](const drogon::HttpRequestPtr& req,
+         const drogon::HttpResponsePtr& resp) {
+        const auto pattern = req->matchedPathPattern();
+        const auto elapsed_us = trantor::Date::now().microSecondsSinceEpoch() -
+                                req->creationDate().microSecondsSinceEpoch();
+        utilities::Metrics::get_instance()
+            .route(req->methodString(),
+                   pattern.empty() ? "unmatched" : pattern)
+            .record(std::chrono::microseconds(elapsed_us),
+                    static_cast<int>(resp->statusCode()));
+        utilities::TraceStore::get_instance().finish(req, resp);
+      });
+
   if (test_mode) {
     drogon::app().getLoop()->queueInLoop([]() {
       std::cout << std::format(
@@ -104,9 +134,9 @@ int main(int argc, char* argv[]) {
     });
   }
 
-  // Create buckets
+  // Create buckets. S3 calls resume on the loop, so this must not block it
   drogon::app().getLoop()->runInLoop([]() {
-    drogon::sync_wait([]() -> drogon::Task<void> {
+    drogon::async_run([]() -> drogon::Task<void> {
       bool bucket_created = co_await ServiceManager::get_instance()
                                 .get_s3_service()
                                 .ensure_bucket_exists("media");
@@ -116,9 +146,63 @@ int main(int argc, char* argv[]) {
       }
       LOG_INFO << "Media bucket is ready";
       co_return;
-    }());
+    });
   });
 
+  // Optional in-process index for nearby queries, rebuilt from the table on
+  // every start and kept current by add_location
+  if (config::get_config_bool("location_index_enabled", false)) {
+    drogon::app().getLoop()->runInLoop([]() {
+      drogon::async_run([]() -> drogon::Task<void> {
+        auto& index = ServiceManager::get_instance().get_location_index();
+        index.begin_rebuild();
+        try {
+          auto result = co_await drogon::app().getDbClient()->execSqlCoro(
+              "SELECT user_id, latitude, longitude, "
+              "COALESCE(accuracy, 100.0) AS accuracy "
+              "FROM locations WHERE user_id IS NOT NULL");
+          std::vector<GeoPoint> points;
+          points.reserve(result.size());
+          for (const auto& row : result) {
+            points.push_back(
+                GeoPoint{.user_id = row["user_id"].as<int>(),
+                         .latitude = row["latitude"].as<double>(),
+                         .longitude = row["longitude"].as<double>(),
+                         .accuracy = row["accuracy"].as<double>()});
+          }
+          index.finish_rebuild(points);
+          LOG_INFO << "Location index built with " << points.size()
+                   << " points";
+        } catch (const drogon::orm::DrogonDbException& e) {
+          index.cancel_rebuild();
+          LOG_ERROR << "Failed to build location index, nearby queries use "
+                       "PostGIS: "
+                    << e.base().what();
+        }
+      });
+    });
+  }
+
+  // Read-your-writes: a successful write pins the user's reads to the
+  // primary for a while
+  if (utilities::DbRouter::get_instance().enabled()) {
+    LOG_INFO << "Routing reads to the "
+             << config::get_config_value("db_read_replica", "")
+             << " db client";
+    drogon::app().registerPostHandlingAdvice(
+        [](const drogon::HttpRequestPtr& req,
+           const drogon::HttpResponsePtr& resp) {
+          const auto method = req->method();
+          if (method == drogon::Get || method == drogon::Head ||
+              method == drogon::Options || resp->statusCode() >= 400 ||
+              !req->getAttributes()->find("current_user_id")) {
+            return;
+          }
+          utilities::DbRouter::get_instance().note_write(
+              req->getAttributes()->get<std::string>("current_user_id"));
+        });
+  }
+
   drogon::app().run();
 
   // Cleanup on shutdown
@@ -0,0 +1,42 @@
+-- Aggregates maintained by the location clustering passes (ClusterService)
+
+-- One row per cluster, refreshed for the clusters a pass touches
+CREATE TABLE location_clusters (
+    cluster_id VARCHAR(64) PRIMARY KEY,
+    point_count INTEGER NOT NULL,
+    centroid GEOMETRY (POINT, 4326) NOT NULL,
+    min_latitude DOUBLE PRECISION NOT NULL,
+    min_longitude DOUBLE PRECISION NOT NULL,
+    max_latitude DOUBLE PRECISION NOT NULL,
+    max_longitude DOUBLE PRECISION NOT NULL,
+    updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+);
+
+CREATE INDEX location_clusters_centroid_idx ON location_clusters USING GIST (centroid);
+
+-- Point count per Web Mercator (XYZ) tile for every zoom level up to the
+-- maximum tile zoom. Rows can reach 0 between full passes, readers filter
+-- them out.
+CREATE TABLE location_tiles (
+    zoom SMALLINT NOT NULL,
+    x INTEGER NOT NULL,
+    y INTEGER NOT NULL,
+    point_count INTEGER NOT NULL,
+    PRIMARY KEY (zoom, x, y)
+);
+
+CREATE FUNCTION location_tile_x (longitude DOUBLE PRECISION, zoom INTEGER)
+RETURNS INTEGER LANGUAGE SQL IMMUTABLE PARALLEL SAFE AS $$
+    SELECT LEAST(GREATEST(
+        FLOOR((longitude + 180.0) / 360.0 * (1 << zoom))::INTEGER, 0),
+        (1 << zoom) - 1)
+$$;
+
+CREATE FUNCTION location_tile_y (latitude DOUBLE PRECISION, zoom INTEGER)
+RETURNS INTEGER LANGUAGE SQL IMMUTABLE PARALLEL SAFE AS $$
+    SELECT LEAST(GREATEST(
+        FLOOR((1.0 - LN(TAN(RADIANS(c)) + 1.0 / COS(RADIANS(c))) / PI())
+              / 2.0 * (1 << zoom))::INTEGER, 0),
+        (1 << zoom) - 1)
+    FROM (SELECT LEAST(GREATEST(latitude, -85.05112878), 85.05112878) AS c) clamped
+$$;
@@ -0,0 +1,10 @@
+-- Indexes behind the keyset pages of /api/v1/offers/my-offers and
+-- /api/v1/offers/received, newest activity first
+
+-- Offers made by a user, in page order
+CREATE INDEX offers_user_updated_idx ON offers (user_id, updated_at DESC, id DESC);
+
+-- Posts of a user, then the offers received on each, in page order
+CREATE INDEX posts_user_id_idx ON posts (user_id);
+
+CREATE INDEX offers_post_updated_idx ON offers (post_id, updated_at DESC, id DESC);
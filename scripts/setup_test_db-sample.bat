@@ -29,6 +29,16 @@ if %ERRORLEVEL% NEQ 0 (
     echo Error: Failed to apply schema
     exit /b %ERRORLEVEL%
 )
+psql -h %DB_HOST% -p %DB_PORT% -U %DB_USER% -d %DB_NAME% -f migrations/002_location_aggregates.sql
+if %ERRORLEVEL% NEQ 0 (
+    echo Error: Failed to apply schema
+    exit /b %ERRORLEVEL%
+)
+psql -h %DB_HOST% -p %DB_PORT% -U %DB_USER% -d %DB_NAME% -f migrations/003_offer_listing_indexes.sql
+if %ERRORLEVEL% NEQ 0 (
+    echo Error: Failed to apply schema
+    exit /b %ERRORLEVEL%
+)
 
 echo Applying seed data...
 psql -h %DB_HOST% -p %DB_PORT% -U %DB_USER% -d %DB_NAME% -f seeds/001_complete_seed_data.sql
@@ -18,6 +18,8 @@ createdb -h $DB_HOST -p $DB_PORT -U $DB_USER $DB_NAME || { echo "Error: Failed t
 
 echo "Applying schema..."
 psql -h $DB_HOST -p $DB_PORT -U $DB_USER -d $DB_NAME -f migrations/001_complete_schema.sql || { echo "Error: Failed to apply schema"; exit 1; }
+psql -h $DB_HOST -p $DB_PORT -U $DB_USER -d $DB_NAME -f migrations/002_location_aggregates.sql || { echo "Error: Failed to apply schema"; exit 1; }
+psql -h $DB_HOST -p $DB_PORT -U $DB_USER -d $DB_NAME -f migrations/003_offer_listing_indexes.sql || { echo "Error: Failed to apply schema"; exit 1; }
 
 echo "Applying seed data..."
 psql -h $DB_HOST -p $DB_PORT -U $DB_USER -d $DB_NAME -f seeds/001_complete_seed_data.sql || { echo "Error: Failed to apply seed data"; exit 1; }
@@ -0,0 +1,6 @@
+#!/bin/sh
+# Runs once on the test primary's first start (docker-entrypoint-initdb.d).
+# Lets the test replica stream WAL without a password, like the test DB
+# itself (POSTGRES_HOST_AUTH_METHOD: trust).
+set -e
+echo "host replication all all trust" >> "$PGDATA/pg_hba.conf"
@@ -0,0 +1,16 @@
+#!/bin/sh
+# Entrypoint of the test replica: clones the primary on first start, then
+# runs as a hot standby.
+set -e
+
+if [ ! -s "$PGDATA/PG_VERSION" ]; then
+  until pg_basebackup -h "$PRIMARY_HOST" -U postgres -D "$PGDATA" \
+      -X stream -R -d "application_name=test_replica"; do
+    echo "Waiting for $PRIMARY_HOST"
+    rm -rf "${PGDATA:?}"/*
+    sleep 1
+  done
+  chmod 0700 "$PGDATA"
+fi
+
+exec postgres -c hot_standby=on
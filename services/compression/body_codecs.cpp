@@ -0,0 +1,161 @@
+#include "body_codecs.hpp"
+
+#include <brotli/encode.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#include <memory>
+
+#include "../../utilities/http_accept.hpp"
+
+namespace compression {
+
+std::string_view token(Encoding encoding) {
+  switch (encoding) {
+    case Encoding::zstd:
+      return "zstd";
+    case Encoding::br:
+      return "br";
+    case Encoding::gzip:
+      return "gzip";
+    case Encoding::identity:
+      break;
+  }
+  return {};
+}
+
+Encoding from_accept_encoding(std::string_view accept_encoding) {
+  // -1 until named in the header
+  std::array<double, kEncodings.size()> weights;
+  weights.fill(-1);
+  double wildcard = 0;
+  utilities::for_each_weighted_value(
+      accept_encoding, [&](std::string_view value, double q) {
+        if (value == "*") {
+          wildcard = q;
+          return;
+        }
+        for (std::size_t i = 0; i < kEncodings.size(); ++i) {
+          if (utilities::iequals(value, token(kEncodings[i]))) {
+            weights[i] = q;
+          }
+        }
+      });
+
+  Encoding best = Encoding::identity;
+  double best_q = 0;
+  for (std::size_t i = 0; i < kEncodings.size(); ++i) {
+    const double q = weights[i] >= 0 ? weights[i] : wildcard;
+    if (q > best_q) {
+      best = kEncodings[i];
+      best_q = q;
+    }
+  }
+  return best;
+}
+
+int dynamic_level(Encoding encoding) {
+  switch (encoding) {
+    case Encoding::zstd:
+      return 3;
+    case Encoding::br:
+      return 4;
+    case Encoding::gzip:
+      return 6;
+    case Encoding::identity:
+      break;
+  }
+  return 0;
+}
+
+int cached_level(Encoding encoding) {
+  switch (encoding) {
+    case Encoding::zstd:
+      return 9;
+    case Encoding::br:
+      return 7;
+    case Encoding::gzip:
+      return 9;
+    case Encoding::identity:
+      break;
+  }
+  return 0;
+}
+
+namespace {
+
+std::optional<std::string> gzip(std::string_view body, int level) {
+  z_stream stream{};
+  // 16 + MAX_WBITS writes a gzip header and trailer instead of zlib's
+  if (deflateInit2(&stream, level, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return std::nullopt;
+  }
+  std::string out(deflateBound(&stream, static_cast<uLong>(body.size())), '\0');
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(body.data()));
+  stream.avail_in = static_cast<uInt>(body.size());
+  stream.next_out = reinterpret_cast<Bytef *>(out.data());
+  stream.avail_out = static_cast<uInt>(out.size());
+  const int rc = deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  if (rc != Z_STREAM_END) {
+    return std::nullopt;
+  }
+  return out;
+}
+
+std::optional<std::string> brotli(std::string_view body, int level) {
+  std::size_t size = BrotliEncoderMaxCompressedSize(body.size());
+  if (size == 0) {
+    return std::nullopt;
+  }
+  std::string out(size, '\0');
+  if (!BrotliEncoderCompress(level, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                             body.size(),
+                             reinterpret_cast<const uint8_t *>(body.data()),
+                             &size, reinterpret_cast<uint8_t *>(out.data()))) {
+    return std::nullopt;
+  }
+  out.resize(size);
+  return out;
+}
+
+std::optional<std::string> zstd(std::string_view body, int level) {
+  struct FreeContext {
+    void operator()(ZSTD_CCtx *context) const { ZSTD_freeCCtx(context); }
+  };
+  thread_local std::unique_ptr<ZSTD_CCtx, FreeContext> context(
+      ZSTD_createCCtx());
+  if (!context) {
+    return std::nullopt;
+  }
+  std::string out(ZSTD_compressBound(body.size()), '\0');
+  const std::size_t size =
+      ZSTD_compressCCtx(context.get(), out.data(), out.size(), body.data(),
+                        body.size(), level);
+  if (ZSTD_isError(size)) {
+    return std::nullopt;
+  }
+  out.resize(size);
+  return out;
+}
+
+}  // namespace
+
+std::optional<std::string> compress(Encoding encoding, std::string_view body,
+                                    int level) {
+  switch (encoding) {
+    case Encoding::zstd:
+      return zstd(body, level);
+    case Encoding::br:
+      return brotli(body, level);
+    case Encoding::gzip:
+      return gzip(body, level);
+    case Encoding::identity:
+      break;
+  }
+  return std::nullopt;
+}
+
+}  // namespace compression
@@ -0,0 +1,45 @@
+#ifndef BODY_CODECS_HPP
+#define BODY_CODECS_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace compression {
+
+// Content codings we produce, in order of preference when a client accepts
+// several at the same q
+enum class Encoding : std::uint8_t { identity, zstd, br, gzip };
+
+inline constexpr std::array<Encoding, 3> kEncodings = {
+    Encoding::zstd, Encoding::br, Encoding::gzip};
+
+// Content-Encoding token, empty for identity
+std::string_view token(Encoding encoding);
+
+/**
+ * @brief Picks the coding for an Accept-Encoding header (RFC 9110 12.5.3).
+ * The highest q wins, ties go to zstd, then br, then gzip. "*" matches any
+ * of them. Identity when the header is missing or names none of them.
+ */
+Encoding from_accept_encoding(std::string_view accept_encoding);
+
+// Per request bodies: fast levels, the CPU is spent on every response
+int dynamic_level(Encoding encoding);
+
+// Cached bodies are compressed once and served many times
+int cached_level(Encoding encoding);
+
+/**
+ * @brief Compresses body with the given coding and level.
+ * Compression contexts are reused per thread.
+ * @return std::nullopt on failure or for identity.
+ */
+std::optional<std::string> compress(Encoding encoding, std::string_view body,
+                                    int level);
+
+}  // namespace compression
+
+#endif  // BODY_CODECS_HPP
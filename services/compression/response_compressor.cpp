@@ -0,0 +1,177 @@
+#include "response_compressor.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "../../config/config.hpp"
+#include "../../utilities/run_on_queue.hpp"
+
+namespace {
+
+// Keeps a Vary set by an earlier layer, e.g. Accept from content negotiation
+void add_vary_accept_encoding(const drogon::HttpResponsePtr& resp) {
+  const auto& vary = resp->getHeader("vary");
+  if (vary.empty()) {
+    resp->addHeader("Vary", "Accept-Encoding");
+  } else if (vary.find("Accept-Encoding") == std::string::npos) {
+    resp->addHeader("Vary", vary + ", Accept-Encoding");
+  }
+}
+
+}  // namespace
+
+CachedBody::CachedBody(std::string body, std::string content_type)
+    : body_(std::move(body)), content_type_(std::move(content_type)) {}
+
+std::shared_ptr<const std::string> CachedBody::variant(
+    compression::Encoding encoding) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return variants_[static_cast<std::size_t>(encoding)];
+}
+
+void CachedBody::set_variant(compression::Encoding encoding,
+                             std::string compressed) {
+  auto stored = std::make_shared<const std::string>(std::move(compressed));
+  std::lock_guard<std::mutex> lock(mutex_);
+  variants_[static_cast<std::size_t>(encoding)] = std::move(stored);
+}
+
+ResponseCompressor::ResponseCompressor()
+    : workers_(static_cast<std::size_t>(std::max(
+                   config::get_config_int("compression_threads", 2), 1)),
+               "CompressionWorkers"),
+      min_bytes_(static_cast<std::size_t>(
+          std::max(config::get_config_int("compression_min_bytes", 1024), 1))) {
+}
+
+drogon::Task<drogon::HttpResponsePtr> ResponseCompressor::compress(
+    const drogon::HttpRequestPtr& req, drogon::HttpResponsePtr resp,
+    std::string_view endpoint) {
+  const std::string_view body = resp->body();
+  if (resp->statusCode() != drogon::k200OK || body.size() < min_bytes_ ||
+      !resp->getHeader("content-encoding").empty()) {
+    record(endpoint, 0, 0, {});
+    co_return resp;
+  }
+
+  add_vary_accept_encoding(resp);
+  const auto encoding =
+      compression::from_accept_encoding(req->getHeader("accept-encoding"));
+  if (encoding == compression::Encoding::identity) {
+    record(endpoint, 0, 0, {});
+    co_return resp;
+  }
+
+  // resp is held across the hop, the view stays valid
+  auto compressed = co_await run_codec(
+      encoding, body, compression::dynamic_level(encoding), endpoint);
+  if (compressed) {
+    resp->setBody(std::move(*compressed));
+    resp->addHeader("Content-Encoding",
+                    std::string(compression::token(encoding)));
+  }
+  co_return resp;
+}
+
+drogon::Task<drogon::HttpResponsePtr> ResponseCompressor::respond(
+    const drogon::HttpRequestPtr& req, std::shared_ptr<CachedBody> body,
+    std::string_view endpoint) {
+  auto resp = drogon::HttpResponse::newHttpResponse();
+  resp->setContentTypeString(body->content_type());
+
+  auto encoding = compression::Encoding::identity;
+  if (body->body().size() >= kMinCachedBytes) {
+    add_vary_accept_encoding(resp);
+    encoding =
+        compression::from_accept_encoding(req->getHeader("accept-encoding"));
+  }
+  if (encoding == compression::Encoding::identity) {
+    record(endpoint, 0, 0, {});
+    resp->setBody(body->body());
+    co_return resp;
+  }
+
+  auto variant = body->variant(encoding);
+  if (!variant) {
+    // Concurrent first requests may both build it, the result is the same
+    auto compressed = co_await run_codec(
+        encoding, body->body(), compression::cached_level(encoding), endpoint);
+    if (!compressed) {
+      resp->setBody(body->body());
+      co_return resp;
+    }
+    body->set_variant(encoding, std::move(*compressed));
+    variant = body->variant(encoding);
+  } else {
+    record(endpoint, body->body().size(), variant->size(), {});
+  }
+  resp->setBody(*variant);
+  resp->addHeader("Content-Encoding",
+                  std::string(compression::token(encoding)));
+  co_return resp;
+}
+
+drogon::Task<std::optional<std::string>> ResponseCompressor::run_codec(
+    compression::Encoding encoding, std::string_view body, int level,
+    std::string_view endpoint) {
+  auto [compressed, worker_time] =
+      co_await utilities::run_on_queue(workers_, [=]() {
+        const auto start = std::chrono::steady_clock::now();
+        auto out = compression::compress(encoding, body, level);
+        return std::pair{std::move(out),
+                         std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - start)};
+      });
+  // Not worth a Content-Encoding when it does not shrink
+  if (compressed && compressed->size() >= body.size()) {
+    compressed.reset();
+  }
+  record(endpoint, compressed ? body.size() : 0,
+         compressed ? compressed->size() : 0, worker_time);
+  co_return std::move(compressed);
+}
+
+void ResponseCompressor::record(std::string_view endpoint,
+                                std::size_t bytes_in, std::size_t bytes_out,
+                                std::chrono::nanoseconds worker_time) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = counters_.find(endpoint);
+  if (it == counters_.end()) {
+    it = counters_.emplace(std::string(endpoint), Counters{}).first;
+  }
+  auto& counters = it->second;
+  ++counters.responses;
+  counters.worker_time += worker_time;
+  if (bytes_out > 0) {
+    ++counters.compressed;
+    counters.bytes_in += bytes_in;
+    counters.bytes_out += bytes_out;
+  }
+}
+
+std::vector<ResponseCompressor::EndpointStats> ResponseCompressor::stats()
+    const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<EndpointStats> stats;
+  stats.reserve(counters_.size());
+  for (const auto& [endpoint, counters] : counters_) {
+    const double worker_us =
+        std::chrono::duration<double, std::micro>(counters.worker_time)
+            .count();
+    stats.push_back(EndpointStats{
+        .endpoint = endpoint,
+        .responses = counters.responses,
+        .compressed = counters.compressed,
+        .bytes_in = counters.bytes_in,
+        .bytes_out = counters.bytes_out,
+        .ratio = counters.bytes_out > 0
+                     ? static_cast<double>(counters.bytes_in) /
+                           static_cast<double>(counters.bytes_out)
+                     : 0.0,
+        .worker_us_per_body =
+            counters.compressed > 0
+                ? worker_us / static_cast<double>(counters.compressed)
+                : 0.0});
+  }
+  return stats;
+}
@@ -0,0 +1,116 @@
+#ifndef RESPONSE_COMPRESSOR_HPP
+#define RESPONSE_COMPRESSOR_HPP
+
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <drogon/utils/coroutine.h>
+#include <trantor/utils/ConcurrentTaskQueue.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "body_codecs.hpp"
+
+/**
+ * @brief A response body held by a cache together with its compressed
+ * variants. Each variant is built once, at compression::cached_level(), by
+ * the first request that asks for it and then served as is.
+ */
+class CachedBody {
+ public:
+  CachedBody(std::string body, std::string content_type);
+
+  const std::string& body() const { return body_; }
+  const std::string& content_type() const { return content_type_; }
+
+  // nullptr until built
+  std::shared_ptr<const std::string> variant(
+      compression::Encoding encoding) const;
+  void set_variant(compression::Encoding encoding, std::string compressed);
+
+ private:
+  std::string body_;
+  std::string content_type_;
+  mutable std::mutex mutex_;
+  std::array<std::shared_ptr<const std::string>, 4> variants_;
+};
+
+/**
+ * @brief Negotiated Content-Encoding (zstd, br or gzip) for API responses.
+ * Bodies are compressed on a dedicated worker pool so the IO threads only
+ * pay for the hop, and drogon's own use_gzip leaves responses that already
+ * carry a Content-Encoding alone.
+ * Configurable through custom_config:
+ * - compression_threads: worker pool size (default 2)
+ * - compression_min_bytes: smaller per request bodies are sent as is, the
+ *   hop and the codec cost more than they save (default 1024)
+ */
+class ResponseCompressor {
+ public:
+  // Cached bodies are compressed once, so smaller ones are still worth it
+  static constexpr std::size_t kMinCachedBytes = 256;
+
+  struct EndpointStats {
+    std::string endpoint;
+    std::uint64_t responses = 0;
+    std::uint64_t compressed = 0;  // sent with a Content-Encoding
+    std::uint64_t bytes_in = 0;    // of the compressed responses
+    std::uint64_t bytes_out = 0;
+    double ratio = 0.0;  // bytes_in / bytes_out
+    // Codec time per compressed response, cached variants cost nothing
+    double worker_us_per_body = 0.0;
+  };
+
+  ResponseCompressor();
+
+  /**
+   * @brief Compresses resp's body in place when the request accepts one of
+   * our codings, the status is 200 and the body is at least
+   * compression_min_bytes long.
+   * @param endpoint name the work is accounted under, see stats()
+   */
+  drogon::Task<drogon::HttpResponsePtr> compress(
+      const drogon::HttpRequestPtr& req, drogon::HttpResponsePtr resp,
+      std::string_view endpoint);
+
+  /**
+   * @brief 200 response for a cached body in the coding the request
+   * accepts, building and storing that variant on the first request.
+   */
+  drogon::Task<drogon::HttpResponsePtr> respond(
+      const drogon::HttpRequestPtr& req, std::shared_ptr<CachedBody> body,
+      std::string_view endpoint);
+
+  std::vector<EndpointStats> stats() const;
+
+ private:
+  struct Counters {
+    std::uint64_t responses = 0;
+    std::uint64_t compressed = 0;
+    std::uint64_t bytes_in = 0;
+    std::uint64_t bytes_out = 0;
+    std::chrono::nanoseconds worker_time{0};
+  };
+
+  // Runs the codec on the pool, timed for the stats
+  drogon::Task<std::optional<std::string>> run_codec(
+      compression::Encoding encoding, std::string_view body, int level,
+      std::string_view endpoint);
+  void record(std::string_view endpoint, std::size_t bytes_in,
+              std::size_t bytes_out, std::chrono::nanoseconds worker_time);
+
+  trantor::ConcurrentTaskQueue workers_;
+  std::size_t min_bytes_;
+  mutable std::mutex mutex_;
+  std::map<std::string, Counters, std::less<>> counters_;
+};
+
+#endif  // RESPONSE_COMPRESSOR_HPP
@@ -0,0 +1,420 @@
+#include "cluster_service.hpp"
+
+#include <drogon/drogon.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "../../config/config.hpp"
+#include "../../utilities/conversion.hpp"
+
+namespace {
+
+// Rows DBSCAN runs over: the whole table
+constexpr std::string_view FULL_REGION = R"(
+  region AS (
+    SELECT id, cluster_id, geom, latitude, longitude FROM locations
+  ),)";
+
+// Rows DBSCAN runs over: dirty points ($3 user ids), every point within
+// epsilon of them, and all members of the clusters they joined, left ($4) or
+// touch. EPSG:3857 distances are never shorter than geodesic ones, so
+// ST_DWithin with the same epsilon covers DBSCAN's reach.
+constexpr std::string_view INCREMENTAL_REGION = R"(
+  dirty AS (
+    SELECT id, geom FROM locations WHERE user_id = ANY($3::int[])
+  ),
+  touched AS (
+    SELECT unnest($4::text[]) AS cluster_id
+    UNION
+    SELECT l.cluster_id FROM locations l
+    JOIN dirty d ON ST_DWithin(l.geom, d.geom, $1)
+    WHERE l.cluster_id IS NOT NULL
+  ),
+  region_ids AS (
+    SELECT id FROM locations
+    WHERE cluster_id IN (SELECT cluster_id FROM touched)
+    UNION
+    SELECT l.id FROM locations l
+    JOIN dirty d ON ST_DWithin(l.geom, d.geom, $1)
+  ),
+  region AS (
+    SELECT l.id, l.cluster_id, l.geom, l.latitude, l.longitude
+    FROM locations l
+    JOIN region_ids r ON r.id = l.id
+  ),)";
+
+// A new cluster keeps the id of the old cluster it shares most members with
+// when that choice is mutual, otherwise it gets a fresh id. Only rows whose
+// id differs are written, the same goes for the summaries of the resulting
+// clusters.
+constexpr std::string_view RECLUSTER = R"(
+  clustered AS (
+    SELECT id, cluster_id AS old_id, geom, latitude, longitude,
+           ST_ClusterDBSCAN(ST_Transform(geom::geometry, 3857), $1, $2)
+             OVER () AS num
+    FROM region
+  ),
+  overlap AS (
+    SELECT num, old_id, COUNT(*) AS members FROM clustered
+    WHERE num IS NOT NULL AND old_id IS NOT NULL
+    GROUP BY num, old_id
+  ),
+  ranked AS (
+    SELECT num, old_id,
+           ROW_NUMBER() OVER (PARTITION BY old_id
+                              ORDER BY members DESC, num) AS old_rank,
+           ROW_NUMBER() OVER (PARTITION BY num
+                              ORDER BY members DESC, old_id) AS new_rank
+    FROM overlap
+  ),
+  named AS MATERIALIZED (
+    SELECT c.num,
+           COALESCE(r.old_id, 'cluster_' || gen_random_uuid()::text)
+             AS cluster_id
+    FROM (SELECT DISTINCT num FROM clustered WHERE num IS NOT NULL) c
+    LEFT JOIN ranked r
+      ON r.num = c.num AND r.old_rank = 1 AND r.new_rank = 1
+  ),
+  updated AS (
+    UPDATE locations loc SET cluster_id = n.cluster_id
+    FROM clustered c LEFT JOIN named n ON n.num = c.num
+    WHERE loc.id = c.id AND loc.cluster_id IS DISTINCT FROM n.cluster_id
+    RETURNING 1
+  ),
+  summaries AS (
+    SELECT n.cluster_id, COUNT(*)::int AS point_count,
+           ST_Centroid(ST_Collect(c.geom::geometry)) AS centroid,
+           MIN(c.latitude) AS min_latitude, MIN(c.longitude) AS min_longitude,
+           MAX(c.latitude) AS max_latitude, MAX(c.longitude) AS max_longitude
+    FROM clustered c JOIN named n ON n.num = c.num
+    GROUP BY n.cluster_id
+  ),
+  upserted_summaries AS (
+    INSERT INTO location_clusters AS lc (cluster_id, point_count, centroid,
+        min_latitude, min_longitude, max_latitude, max_longitude)
+    SELECT cluster_id, point_count, centroid, min_latitude, min_longitude,
+           max_latitude, max_longitude
+    FROM summaries
+    ON CONFLICT (cluster_id) DO UPDATE SET
+      point_count = EXCLUDED.point_count, centroid = EXCLUDED.centroid,
+      min_latitude = EXCLUDED.min_latitude,
+      min_longitude = EXCLUDED.min_longitude,
+      max_latitude = EXCLUDED.max_latitude,
+      max_longitude = EXCLUDED.max_longitude, updated_at = NOW()
+    WHERE (lc.point_count, lc.min_latitude, lc.min_longitude,
+           lc.max_latitude, lc.max_longitude)
+          IS DISTINCT FROM
+          (EXCLUDED.point_count, EXCLUDED.min_latitude,
+           EXCLUDED.min_longitude, EXCLUDED.max_latitude,
+           EXCLUDED.max_longitude)
+       OR NOT ST_Equals(lc.centroid, EXCLUDED.centroid)
+    RETURNING 1
+  ),)";
+
+// Summaries of the clusters that no longer exist. An incremental pass only
+// sees the clusters it touched, a full pass sees all of them.
+constexpr std::string_view REMOVED_SUMMARIES_INCREMENTAL = R"(
+  removed_summaries AS (
+    DELETE FROM location_clusters
+    WHERE cluster_id IN (SELECT cluster_id FROM touched)
+      AND cluster_id NOT IN (SELECT cluster_id FROM named)
+    RETURNING 1
+  ))";
+
+constexpr std::string_view REMOVED_SUMMARIES_FULL = R"(
+  removed_summaries AS (
+    DELETE FROM location_clusters
+    WHERE cluster_id NOT IN (SELECT cluster_id FROM named)
+    RETURNING 1
+  ))";
+
+constexpr std::string_view RECLUSTER_RESULT = R"(
+  SELECT (SELECT COUNT(*) FROM clustered) AS evaluated,
+         (SELECT COUNT(*) FROM updated) AS changed,
+         (SELECT COUNT(*) FROM upserted_summaries) +
+           (SELECT COUNT(*) FROM removed_summaries) AS clusters_changed
+)";
+
+// Applies point moves to location_tiles as count deltas: -1 on the tile a
+// point left ($1, $2, NULL for a new point), +1 on the tile it moved to
+// ($3, $4), on every zoom level up to $5. Moves within a tile cancel out and
+// are not written.
+constexpr std::string_view TILE_DELTAS = R"(
+  WITH moves AS (
+    SELECT * FROM unnest($1::float8[], $2::float8[], $3::float8[],
+                         $4::float8[])
+      AS m(old_latitude, old_longitude, new_latitude, new_longitude)
+  ),
+  deltas AS (
+    SELECT z.zoom, location_tile_x(m.old_longitude, z.zoom) AS x,
+           location_tile_y(m.old_latitude, z.zoom) AS y, -1 AS delta
+    FROM moves m CROSS JOIN generate_series(0, $5) AS z(zoom)
+    WHERE m.old_latitude IS NOT NULL
+    UNION ALL
+    SELECT z.zoom, location_tile_x(m.new_longitude, z.zoom),
+           location_tile_y(m.new_latitude, z.zoom), 1
+    FROM moves m CROSS JOIN generate_series(0, $5) AS z(zoom)
+  ),
+  summed AS (
+    SELECT zoom, x, y, SUM(delta)::int AS delta FROM deltas
+    GROUP BY zoom, x, y
+    HAVING SUM(delta) <> 0
+  ),
+  applied AS (
+    INSERT INTO location_tiles AS t (zoom, x, y, point_count)
+    SELECT zoom, x, y, delta FROM summed
+    ON CONFLICT (zoom, x, y)
+      DO UPDATE SET point_count = t.point_count + EXCLUDED.point_count
+    RETURNING 1
+  )
+  SELECT COUNT(*) AS changed FROM applied
+)";
+
+// Recounts every tile on every zoom level up to $1 from the table
+constexpr std::string_view TILE_RECOUNT = R"(
+  WITH fresh AS (
+    SELECT z.zoom, location_tile_x(l.longitude, z.zoom) AS x,
+           location_tile_y(l.latitude, z.zoom) AS y,
+           COUNT(*)::int AS point_count
+    FROM locations l CROSS JOIN generate_series(0, $1) AS z(zoom)
+    GROUP BY 1, 2, 3
+  ),
+  removed AS (
+    DELETE FROM location_tiles t
+    WHERE NOT EXISTS (SELECT 1 FROM fresh f
+                      WHERE f.zoom = t.zoom AND f.x = t.x AND f.y = t.y)
+    RETURNING 1
+  ),
+  upserted AS (
+    INSERT INTO location_tiles AS t (zoom, x, y, point_count)
+    SELECT zoom, x, y, point_count FROM fresh
+    ON CONFLICT (zoom, x, y) DO UPDATE SET point_count = EXCLUDED.point_count
+    WHERE t.point_count <> EXCLUDED.point_count
+    RETURNING 1
+  )
+  SELECT (SELECT COUNT(*) FROM removed) +
+         (SELECT COUNT(*) FROM upserted) AS changed
+)";
+
+const std::string &full_pass_sql() {
+  static const std::string sql =
+      std::string("WITH") + std::string(FULL_REGION) +
+      std::string(RECLUSTER) + std::string(REMOVED_SUMMARIES_FULL) +
+      std::string(RECLUSTER_RESULT);
+  return sql;
+}
+
+const std::string &incremental_pass_sql() {
+  static const std::string sql =
+      std::string("WITH") + std::string(INCREMENTAL_REGION) +
+      std::string(RECLUSTER) + std::string(REMOVED_SUMMARIES_INCREMENTAL) +
+      std::string(RECLUSTER_RESULT);
+  return sql;
+}
+
+}  // namespace
+
+ClusterService::ClusterService()
+    : epsilon_(std::max(config::get_config_int("cluster_epsilon_m", 1000), 1)),
+      min_points_(std::max(config::get_config_int("cluster_min_points", 2), 1)),
+      incremental_interval_(std::max(
+          config::get_config_int("cluster_incremental_interval_ms", 5000),
+          100)),
+      full_interval_(
+          std::max(config::get_config_int("cluster_full_interval_sec", 3600),
+                   0)) {}
+
+void ClusterService::start() {
+  auto loop = drogon::app().getLoop();
+  loop->runInLoop([this]() {
+    drogon::async_run(
+        [this]() -> drogon::Task<> { co_await materialize_if_empty(); });
+  });
+  loop->runEvery(std::chrono::duration<double>(incremental_interval_),
+                 [this]() {
+                   drogon::async_run([this]() -> drogon::Task<> {
+                     co_await run_background(ClusterMode::incremental);
+                   });
+                 });
+  if (full_interval_.count() > 0) {
+    loop->runEvery(std::chrono::duration<double>(full_interval_), [this]() {
+      drogon::async_run([this]() -> drogon::Task<> {
+        co_await run_background(ClusterMode::full);
+      });
+    });
+  }
+}
+
+void ClusterService::mark_dirty(
+    int user_id, std::optional<std::string> previous_cluster_id,
+    std::optional<GeoPosition> previous, GeoPosition current) {
+  std::lock_guard<std::mutex> lock(dirty_mutex_);
+  // Keeps where the point was at the last pass, the tiles still count it
+  // there
+  auto [it, inserted] = dirty_moves_.try_emplace(
+      user_id, Move{.from = previous, .to = current});
+  if (!inserted) {
+    it->second.to = current;
+  }
+  if (previous_cluster_id && !previous_cluster_id->empty()) {
+    dirty_clusters_.insert(std::move(*previous_cluster_id));
+  }
+}
+
+drogon::Task<std::optional<ClusterPassResult>> ClusterService::run_pass(
+    ClusterMode mode, std::optional<double> epsilon, bool wait) {
+  const auto start = std::chrono::steady_clock::now();
+  ClusterPassResult pass{
+      .mode = mode == ClusterMode::full ? "full" : "incremental",
+      .rows_evaluated = 0,
+      .rows_changed = 0,
+      .clusters_changed = 0,
+      .tiles_changed = 0,
+      .duration_ms = 0.0};
+  const double pass_epsilon =
+      mode == ClusterMode::full ? epsilon.value_or(epsilon_.load())
+                                : epsilon_.load();
+
+  // Taken by an incremental pass now, by a full pass right before its tile
+  // recount. Put back if the pass does not go through.
+  ankerl::unordered_dense::map<int, Move> moves;
+  ankerl::unordered_dense::set<std::string> clusters;
+  auto take = [&]() {
+    std::lock_guard<std::mutex> lock(dirty_mutex_);
+    moves.swap(dirty_moves_);
+    clusters.swap(dirty_clusters_);
+  };
+  auto restore = [&]() {
+    std::lock_guard<std::mutex> lock(dirty_mutex_);
+    for (auto &[user_id, move] : moves) {
+      // A later move keeps its destination but starts where this one did
+      auto [it, inserted] = dirty_moves_.try_emplace(user_id, move);
+      if (!inserted) {
+        it->second.from = move.from;
+      }
+    }
+    dirty_clusters_.insert(clusters.begin(), clusters.end());
+  };
+  if (mode == ClusterMode::incremental) {
+    take();
+    if (moves.empty()) {
+      co_return pass;
+    }
+  }
+
+  try {
+    auto transaction =
+        co_await drogon::app().getDbClient()->newTransactionCoro();
+    auto lock = co_await transaction->execSqlCoro(
+        wait ? "SELECT true AS locked "
+               "FROM pg_advisory_xact_lock(hashtext('location_clusters'))"
+             : "SELECT pg_try_advisory_xact_lock(hashtext('location_clusters'))"
+               " AS locked");
+    if (!lock[0]["locked"].as<bool>()) {
+      restore();
+      co_return std::nullopt;
+    }
+
+    if (mode == ClusterMode::full) {
+      auto recluster = co_await transaction->execSqlCoro(
+          full_pass_sql(), pass_epsilon, min_points_);
+      // Moves recorded from here on may postdate the recount's snapshot,
+      // they stay dirty for the next incremental pass
+      take();
+      auto tiles =
+          co_await transaction->execSqlCoro(std::string(TILE_RECOUNT),
+                                            MAX_TILE_ZOOM);
+      pass.rows_evaluated = recluster[0]["evaluated"].as<int64_t>();
+      pass.rows_changed = recluster[0]["changed"].as<int64_t>();
+      pass.clusters_changed = recluster[0]["clusters_changed"].as<int64_t>();
+      pass.tiles_changed = tiles[0]["changed"].as<int64_t>();
+    } else {
+      std::vector<std::string> user_ids;
+      std::vector<std::string> old_latitudes;
+      std::vector<std::string> old_longitudes;
+      std::vector<std::string> new_latitudes;
+      std::vector<std::string> new_longitudes;
+      user_ids.reserve(moves.size());
+      old_latitudes.reserve(moves.size());
+      old_longitudes.reserve(moves.size());
+      new_latitudes.reserve(moves.size());
+      new_longitudes.reserve(moves.size());
+      for (const auto &[user_id, move] : moves) {
+        user_ids.push_back(std::to_string(user_id));
+        old_latitudes.push_back(move.from ? convert::double_to_string(
+                                                move.from->latitude)
+                                          : "NULL");
+        old_longitudes.push_back(move.from ? convert::double_to_string(
+                                                 move.from->longitude)
+                                           : "NULL");
+        new_latitudes.push_back(convert::double_to_string(move.to.latitude));
+        new_longitudes.push_back(convert::double_to_string(move.to.longitude));
+      }
+      std::vector<std::string> cluster_ids(clusters.begin(), clusters.end());
+
+      auto recluster = co_await transaction->execSqlCoro(
+          incremental_pass_sql(), pass_epsilon, min_points_,
+          convert::array_to_pgsql_array_string(user_ids),
+          convert::array_to_quoted_pgsql_array_string(cluster_ids));
+      auto tiles = co_await transaction->execSqlCoro(
+          std::string(TILE_DELTAS),
+          convert::array_to_pgsql_array_string(old_latitudes),
+          convert::array_to_pgsql_array_string(old_longitudes),
+          convert::array_to_pgsql_array_string(new_latitudes),
+          convert::array_to_pgsql_array_string(new_longitudes),
+          MAX_TILE_ZOOM);
+      pass.rows_evaluated = recluster[0]["evaluated"].as<int64_t>();
+      pass.rows_changed = recluster[0]["changed"].as<int64_t>();
+      pass.clusters_changed = recluster[0]["clusters_changed"].as<int64_t>();
+      pass.tiles_changed = tiles[0]["changed"].as<int64_t>();
+    }
+  } catch (...) {
+    restore();
+    throw;
+  }
+  if (mode == ClusterMode::full && epsilon) {
+    // The clusters now follow the override, later passes and add_location
+    // have to keep using it
+    epsilon_.store(*epsilon);
+  }
+
+  pass.duration_ms = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  co_return pass;
+}
+
+drogon::Task<> ClusterService::run_background(ClusterMode mode) {
+  try {
+    auto pass = co_await run_pass(mode, std::nullopt, false);
+    if (pass && pass->rows_evaluated > 0) {
+      LOG_DEBUG << "Location " << pass->mode << " clustering: "
+                << pass->rows_changed << " of " << pass->rows_evaluated
+                << " rows, " << pass->clusters_changed << " clusters, "
+                << pass->tiles_changed << " tiles changed in "
+                << pass->duration_ms << "ms";
+    }
+  } catch (const drogon::orm::DrogonDbException &e) {
+    LOG_ERROR << "Location clustering failed: " << e.base().what();
+  }
+}
+
+drogon::Task<> ClusterService::materialize_if_empty() {
+  try {
+    auto result = co_await drogon::app().getDbClient()->execSqlCoro(
+        "SELECT NOT EXISTS (SELECT 1 FROM location_tiles) "
+        "AND EXISTS (SELECT 1 FROM locations) AS empty");
+    if (!result[0]["empty"].as<bool>()) {
+      co_return;
+    }
+    LOG_INFO << "Materializing location clusters and tiles";
+    auto pass = co_await run_pass(ClusterMode::full);
+    LOG_INFO << "Materialized " << pass->clusters_changed << " clusters and "
+             << pass->tiles_changed << " tiles in " << pass->duration_ms
+             << "ms";
+  } catch (const drogon::orm::DrogonDbException &e) {
+    LOG_ERROR << "Location aggregate check failed: " << e.base().what();
+  }
+}
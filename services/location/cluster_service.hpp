@@ -0,0 +1,103 @@
+#ifndef CLUSTER_SERVICE_HPP
+#define CLUSTER_SERVICE_HPP
+
+#include <ankerl/unordered_dense.h>
+#include <drogon/utils/coroutine.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+enum class ClusterMode : std::uint8_t { incremental, full };
+
+struct ClusterPassResult {
+  std::string mode;
+  int64_t rows_evaluated = 0;     // rows DBSCAN ran over
+  int64_t rows_changed = 0;       // rows whose cluster_id was written
+  int64_t clusters_changed = 0;   // location_clusters rows written/removed
+  int64_t tiles_changed = 0;      // location_tiles rows written/removed
+  double duration_ms = 0.0;
+};
+
+struct GeoPosition {
+  double latitude = 0.0;
+  double longitude = 0.0;
+};
+
+/**
+ * @brief Keeps locations.cluster_id and the location aggregates current
+ * without rewriting the table.
+ * - add_location assigns the nearest clustered neighbour within epsilon in
+ *   the upsert itself and reports the move.
+ * - An incremental pass periodically reruns DBSCAN over the affected
+ *   neighbourhoods only: the clusters moved points left or joined, plus every
+ *   point within epsilon of them. That is where merges and splits happen.
+ *   The same pass refreshes location_clusters for those clusters and applies
+ *   the moves to location_tiles as count deltas.
+ * - A full pass bounds the drift the incremental pass can leave at the edges
+ *   of those neighbourhoods and recomputes every aggregate.
+ * Both passes keep existing cluster ids where a cluster survives (matched
+ * by member overlap) and only write rows that actually change.
+ * Passes hold a transaction level advisory lock, so only one runs at a time
+ * across instances.
+ * Configurable through custom_config:
+ * - cluster_epsilon_m: DBSCAN distance, EPSG:3857 meters (default 1000)
+ * - cluster_min_points: DBSCAN density (default 2)
+ * - cluster_incremental_interval_ms: incremental pass period (default 5000)
+ * - cluster_full_interval_sec: full pass period, 0 disables (default 3600)
+ */
+class ClusterService {
+ public:
+  // Deepest zoom level materialized in location_tiles
+  static constexpr int MAX_TILE_ZOOM = 16;
+
+  ClusterService();
+
+  // Schedules the background passes, call once the config is loaded
+  void start();
+
+  double epsilon() const { return epsilon_.load(); }
+
+  // Records a point written by add_location, previous is empty for a new
+  // point
+  void mark_dirty(int user_id, std::optional<std::string> previous_cluster_id,
+                  std::optional<GeoPosition> previous, GeoPosition current);
+
+  /**
+   * @brief Runs a pass now.
+   * @param epsilon replaces cluster_epsilon_m from a full pass on, for every
+   * later pass and add_location on this instance. Ignored by an incremental
+   * pass, which has to match the clusters around it.
+   * @param wait waits for a running pass instead of skipping.
+   * @return std::nullopt if skipped because another pass held the lock.
+   * @throws drogon::orm::DrogonDbException
+   */
+  drogon::Task<std::optional<ClusterPassResult>> run_pass(
+      ClusterMode mode, std::optional<double> epsilon = std::nullopt,
+      bool wait = true);
+
+ private:
+  // Position at the last pass and latest position of a moved point
+  struct Move {
+    std::optional<GeoPosition> from;
+    GeoPosition to;
+  };
+
+  drogon::Task<> run_background(ClusterMode mode);
+  // Full pass on startup when the aggregates were never materialized
+  drogon::Task<> materialize_if_empty();
+
+  std::atomic<double> epsilon_;
+  int min_points_;
+  std::chrono::milliseconds incremental_interval_;
+  std::chrono::seconds full_interval_;
+
+  std::mutex dirty_mutex_;
+  ankerl::unordered_dense::map<int, Move> dirty_moves_;  // by user id
+  ankerl::unordered_dense::set<std::string> dirty_clusters_;
+};
+
+#endif  // CLUSTER_SERVICE_HPP
@@ -0,0 +1,283 @@
+#include "geo_grid_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <numbers>
+#include <utility>
+
+namespace {
+
+constexpr double DEG_TO_RAD = std::numbers::pi / 180.0;
+constexpr double METERS_PER_DEG = GeoGridIndex::EARTH_RADIUS_M * DEG_TO_RAD;
+
+struct UnitVector {
+  double x, y, z;
+};
+
+UnitVector to_unit_vector(double latitude, double longitude) {
+  const double lat = latitude * DEG_TO_RAD;
+  const double lon = longitude * DEG_TO_RAD;
+  return {.x = std::cos(lat) * std::cos(lon),
+          .y = std::cos(lat) * std::sin(lon),
+          .z = std::sin(lat)};
+}
+
+// Columns divide 360 degrees evenly, so wrapping at the antimeridian always
+// lands on full width cells
+double cell_degrees(double cell_size_m) {
+  const double requested = std::max(cell_size_m, 10.0) / METERS_PER_DEG;
+  return 360.0 / std::ceil(360.0 / requested);
+}
+
+}  // namespace
+
+GeoGridIndex::GeoGridIndex(double cell_size_m)
+    : cell_deg_(cell_degrees(cell_size_m)),
+      rows_(static_cast<std::int64_t>(std::ceil(180.0 / cell_deg_))),
+      cols_(static_cast<std::int64_t>(std::llround(360.0 / cell_deg_))) {}
+
+bool GeoGridIndex::ready() const {
+  std::shared_lock lock(mutex_);
+  return ready_;
+}
+
+std::size_t GeoGridIndex::size() const {
+  std::shared_lock lock(mutex_);
+  return grid_.slots.size();
+}
+
+void GeoGridIndex::begin_rebuild() {
+  std::unique_lock lock(mutex_);
+  building_ = true;
+  pending_.clear();
+}
+
+void GeoGridIndex::finish_rebuild(const std::vector<GeoPoint>& points) {
+  // Built aside, queries keep being served from the current grid meanwhile
+  Grid rebuilt;
+  rebuilt.slots.reserve(points.size());
+  for (const auto& point : points) {
+    upsert_into(rebuilt, point);
+  }
+
+  std::unique_lock lock(mutex_);
+  for (const auto& point : pending_) {
+    upsert_into(rebuilt, point);
+  }
+  grid_ = std::move(rebuilt);
+  pending_.clear();
+  pending_.shrink_to_fit();
+  building_ = false;
+  ready_ = true;
+}
+
+void GeoGridIndex::cancel_rebuild() {
+  std::unique_lock lock(mutex_);
+  building_ = false;
+  pending_.clear();
+  pending_.shrink_to_fit();
+}
+
+void GeoGridIndex::upsert(const GeoPoint& point) {
+  std::unique_lock lock(mutex_);
+  if (!ready_ && !building_) {
+    return;
+  }
+  if (building_) {
+    pending_.push_back(point);
+  }
+  upsert_into(grid_, point);
+}
+
+GeoGridIndex::CellKey GeoGridIndex::cell_of(double latitude,
+                                            double longitude) const {
+  const auto row = std::clamp(
+      static_cast<std::int64_t>(std::floor((latitude + 90.0) / cell_deg_)),
+      std::int64_t{0}, rows_ - 1);
+  auto col =
+      static_cast<std::int64_t>(std::floor((longitude + 180.0) / cell_deg_)) %
+      cols_;
+  if (col < 0) {
+    col += cols_;
+  }
+  return static_cast<CellKey>(row * cols_ + col);
+}
+
+void GeoGridIndex::upsert_into(Grid& grid, const GeoPoint& point) const {
+  const auto key = cell_of(point.latitude, point.longitude);
+  const auto unit = to_unit_vector(point.latitude, point.longitude);
+
+  if (auto it = grid.slots.find(point.user_id); it != grid.slots.end()) {
+    if (it->second.cell == key) {
+      auto& cell = grid.cells[key];
+      const auto i = it->second.index;
+      cell.x[i] = unit.x;
+      cell.y[i] = unit.y;
+      cell.z[i] = unit.z;
+      cell.latitude[i] = point.latitude;
+      cell.longitude[i] = point.longitude;
+      cell.accuracy[i] = point.accuracy;
+      return;
+    }
+    erase_from(grid, point.user_id);
+  }
+
+  auto& cell = grid.cells[key];
+  grid.slots.insert_or_assign(
+      point.user_id, Slot{.cell = key, .index = static_cast<std::uint32_t>(
+                                           cell.user_id.size())});
+  cell.x.push_back(unit.x);
+  cell.y.push_back(unit.y);
+  cell.z.push_back(unit.z);
+  cell.latitude.push_back(point.latitude);
+  cell.longitude.push_back(point.longitude);
+  cell.accuracy.push_back(point.accuracy);
+  cell.user_id.push_back(point.user_id);
+}
+
+// Swap with the last point of the cell so the arrays stay dense
+void GeoGridIndex::erase_from(Grid& grid, int user_id) {
+  auto slot_it = grid.slots.find(user_id);
+  if (slot_it == grid.slots.end()) {
+    return;
+  }
+  const auto [key, index] = slot_it->second;
+  grid.slots.erase(slot_it);
+
+  auto cell_it = grid.cells.find(key);
+  auto& cell = cell_it->second;
+  const auto last = cell.user_id.size() - 1;
+  if (index != last) {
+    cell.x[index] = cell.x[last];
+    cell.y[index] = cell.y[last];
+    cell.z[index] = cell.z[last];
+    cell.latitude[index] = cell.latitude[last];
+    cell.longitude[index] = cell.longitude[last];
+    cell.accuracy[index] = cell.accuracy[last];
+    cell.user_id[index] = cell.user_id[last];
+    grid.slots[cell.user_id[index]].index = index;
+  }
+  if (last == 0) {
+    grid.cells.erase(cell_it);
+    return;
+  }
+  cell.x.pop_back();
+  cell.y.pop_back();
+  cell.z.pop_back();
+  cell.latitude.pop_back();
+  cell.longitude.pop_back();
+  cell.accuracy.pop_back();
+  cell.user_id.pop_back();
+}
+
+void GeoGridIndex::scan_cell(const Cell& cell, double qx, double qy, double qz,
+                             double max_chord2, std::vector<GeoHit>& hits) {
+  thread_local std::vector<double> chord2;
+  const std::size_t n = cell.user_id.size();
+  chord2.resize(n);
+
+  // Vectorized: squared chord length between the query and every point
+  const double* __restrict x = cell.x.data();
+  const double* __restrict y = cell.y.data();
+  const double* __restrict z = cell.z.data();
+  double* __restrict out = chord2.data();
+  for (std::size_t i = 0; i < n; ++i) {
+    const double dx = x[i] - qx;
+    const double dy = y[i] - qy;
+    const double dz = z[i] - qz;
+    out[i] = dx * dx + dy * dy + dz * dz;
+  }
+
+  for (std::size_t i = 0; i < n; ++i) {
+    if (out[i] <= max_chord2) {
+      hits.push_back(GeoHit{
+          .point = {.user_id = cell.user_id[i],
+                    .latitude = cell.latitude[i],
+                    .longitude = cell.longitude[i],
+                    .accuracy = cell.accuracy[i]},
+          .distance = 2.0 * EARTH_RADIUS_M *
+                      std::asin(std::min(std::sqrt(out[i]) / 2.0, 1.0))});
+    }
+  }
+}
+
+std::vector<GeoHit> GeoGridIndex::query_radius(double latitude,
+                                               double longitude,
+                                               double radius_m,
+                                               std::size_t offset,
+                                               std::size_t limit) const {
+  std::vector<GeoHit> hits;
+  if (!(radius_m > 0.0) || limit == 0) {
+    return hits;
+  }
+
+  const double angle = std::min(radius_m / EARTH_RADIUS_M, std::numbers::pi);
+  const double half_chord = std::sin(angle / 2.0);
+  const double max_chord2 = 4.0 * half_chord * half_chord;
+  const auto query = to_unit_vector(latitude, longitude);
+
+  // Bounding box of the circle in cells
+  const double angle_deg = angle / DEG_TO_RAD;
+  const double lat_lo = latitude - angle_deg;
+  const double lat_hi = latitude + angle_deg;
+  std::int64_t col_first = 0;
+  std::int64_t col_count = cols_;
+  if (lat_lo > -90.0 && lat_hi < 90.0) {
+    const double ratio =
+        std::sin(angle) / std::cos(latitude * DEG_TO_RAD);
+    if (ratio < 1.0) {
+      const double lon_deg = std::asin(ratio) / DEG_TO_RAD;
+      col_first = static_cast<std::int64_t>(
+          std::floor((longitude - lon_deg + 180.0) / cell_deg_));
+      const auto col_last = static_cast<std::int64_t>(
+          std::floor((longitude + lon_deg + 180.0) / cell_deg_));
+      col_count = std::min(col_last - col_first + 1, cols_);
+    }
+  }
+  const auto row_first = std::clamp(
+      static_cast<std::int64_t>(std::floor((lat_lo + 90.0) / cell_deg_)),
+      std::int64_t{0}, rows_ - 1);
+  const auto row_last = std::clamp(
+      static_cast<std::int64_t>(std::floor((lat_hi + 90.0) / cell_deg_)),
+      std::int64_t{0}, rows_ - 1);
+
+  std::shared_lock lock(mutex_);
+  const auto box_cells =
+      static_cast<std::size_t>((row_last - row_first + 1) * col_count);
+  if (box_cells > grid_.cells.size()) {
+    // Large radius, cheaper to visit the occupied cells
+    for (const auto& [key, cell] : grid_.cells) {
+      scan_cell(cell, query.x, query.y, query.z, max_chord2, hits);
+    }
+  } else {
+    for (auto row = row_first; row <= row_last; ++row) {
+      for (std::int64_t c = 0; c < col_count; ++c) {
+        auto col = (col_first + c) % cols_;
+        if (col < 0) {
+          col += cols_;
+        }
+        auto it = grid_.cells.find(static_cast<CellKey>(row * cols_ + col));
+        if (it != grid_.cells.end()) {
+          scan_cell(it->second, query.x, query.y, query.z, max_chord2, hits);
+        }
+      }
+    }
+  }
+  lock.unlock();
+
+  if (offset >= hits.size()) {
+    return {};
+  }
+  const auto page_end = std::min(hits.size(), offset + limit);
+  auto by_distance = [](const GeoHit& a, const GeoHit& b) {
+    return a.distance != b.distance ? a.distance < b.distance
+                                    : a.point.user_id < b.point.user_id;
+  };
+  std::partial_sort(hits.begin(),
+                    hits.begin() + static_cast<std::ptrdiff_t>(page_end),
+                    hits.end(), by_distance);
+  hits.erase(hits.begin() + static_cast<std::ptrdiff_t>(page_end), hits.end());
+  hits.erase(hits.begin(), hits.begin() + static_cast<std::ptrdiff_t>(offset));
+  return hits;
+}
@@ -0,0 +1,106 @@
+#ifndef GEO_GRID_INDEX_HPP
+#define GEO_GRID_INDEX_HPP
+
+#include <ankerl/unordered_dense.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <vector>
+
+// A user's last reported position, one per user like the locations table
+struct GeoPoint {
+  int user_id = 0;
+  double latitude = 0.0;
+  double longitude = 0.0;
+  double accuracy = 0.0;
+};
+
+struct GeoHit {
+  GeoPoint point;
+  double distance = 0.0;  // meters
+};
+
+/**
+ * @brief In-process spatial index over the locations table for radius
+ * queries.
+ * Points are bucketed into a fixed lat/lon cell grid. Every cell stores its
+ * points as separate arrays (SoA) including the unit vector of each point, so
+ * the distance filter is a branch free multiply-add loop over contiguous
+ * doubles that the compiler vectorizes. On a sphere the haversine of the
+ * central angle is chord^2 / 4, which makes comparing chord lengths an exact
+ * haversine test without a trigonometric call per point; asin is only taken
+ * for matches.
+ * Distances are spherical (mean earth radius), PostGIS geography uses the
+ * spheroid, so results can differ by up to ~0.5% near the radius.
+ * Thread safe: queries share a lock, updates are exclusive.
+ */
+class GeoGridIndex {
+ public:
+  static constexpr double EARTH_RADIUS_M = 6371008.8;
+
+  explicit GeoGridIndex(double cell_size_m = 1000.0);
+
+  // Index is only used once it has been built at least once
+  bool ready() const;
+  std::size_t size() const;
+
+  /**
+   * @brief Marks the start of a rebuild. Updates received from now on are
+   * replayed over the rebuilt grid, so positions written while the snapshot
+   * was being read are not lost.
+   */
+  void begin_rebuild();
+  // Replaces the content with a snapshot taken after begin_rebuild
+  void finish_rebuild(const std::vector<GeoPoint>& points);
+  // Snapshot could not be read, keeps the current content
+  void cancel_rebuild();
+
+  // No-op until begin_rebuild has been called
+  void upsert(const GeoPoint& point);
+
+  /**
+   * @brief Points within radius_m of (latitude, longitude), nearest first.
+   * @param offset, limit page of the sorted result.
+   */
+  std::vector<GeoHit> query_radius(double latitude, double longitude,
+                                   double radius_m, std::size_t offset,
+                                   std::size_t limit) const;
+
+ private:
+  using CellKey = std::uint64_t;
+
+  struct Cell {
+    std::vector<double> x, y, z;  // unit vector
+    std::vector<double> latitude, longitude, accuracy;
+    std::vector<int> user_id;
+  };
+
+  struct Slot {
+    CellKey cell;
+    std::uint32_t index;
+  };
+
+  struct Grid {
+    ankerl::unordered_dense::map<CellKey, Cell> cells;
+    ankerl::unordered_dense::map<int, Slot> slots;  // by user_id
+  };
+
+  CellKey cell_of(double latitude, double longitude) const;
+  void upsert_into(Grid& grid, const GeoPoint& point) const;
+  static void erase_from(Grid& grid, int user_id);
+  static void scan_cell(const Cell& cell, double qx, double qy, double qz,
+                        double max_chord2, std::vector<GeoHit>& hits);
+
+  const double cell_deg_;
+  const std::int64_t rows_;
+  const std::int64_t cols_;
+
+  mutable std::shared_mutex mutex_;
+  Grid grid_;
+  bool ready_ = false;
+  bool building_ = false;
+  std::vector<GeoPoint> pending_;  // upserts received while building
+};
+
+#endif  // GEO_GRID_INDEX_HPP
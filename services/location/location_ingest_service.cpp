@@ -0,0 +1,221 @@
+#include "location_ingest_service.hpp"
+
+#include <drogon/drogon.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../config/config.hpp"
+#include "../../utilities/conversion.hpp"
+
+namespace {
+
+// Multi-row form of the add_location upsert. Input rows are unique per user
+// and sorted by user id, so concurrent flushes lock rows in the same order.
+constexpr std::string_view UPSERT_READINGS = R"(
+  WITH input AS (
+    SELECT * FROM unnest($1::int[], $2::float8[], $3::float8[], $4::float8[])
+      AS i(user_id, latitude, longitude, accuracy)
+  ),
+  previous AS (
+    SELECT l.user_id, l.cluster_id, l.latitude, l.longitude
+    FROM locations l JOIN input i ON i.user_id = l.user_id
+  ),
+  assigned AS (
+    SELECT i.*, n.cluster_id FROM input i
+    LEFT JOIN LATERAL (
+      SELECT l.cluster_id FROM locations l
+      WHERE l.user_id <> i.user_id AND l.cluster_id IS NOT NULL
+        AND ST_DWithin(l.geom, ST_SetSRID(ST_MakePoint(i.longitude,
+                       i.latitude), 4326)::geography, $5)
+      ORDER BY l.geom <-> ST_SetSRID(ST_MakePoint(i.longitude, i.latitude),
+                                     4326)::geography
+      LIMIT 1
+    ) n ON true
+  ),
+  written AS (
+    INSERT INTO locations (user_id, latitude, longitude, accuracy, device_id,
+                           geom, cluster_id)
+    SELECT user_id, latitude, longitude, accuracy, user_id || '_device',
+           ST_SetSRID(ST_MakePoint(longitude, latitude), 4326), cluster_id
+    FROM assigned
+    ORDER BY user_id
+    ON CONFLICT (user_id) DO UPDATE
+    SET latitude = EXCLUDED.latitude, longitude = EXCLUDED.longitude,
+        accuracy = EXCLUDED.accuracy, geom = EXCLUDED.geom,
+        device_id = EXCLUDED.device_id, cluster_id = EXCLUDED.cluster_id,
+        updated_at = NOW()
+    RETURNING user_id, latitude, longitude, accuracy
+  )
+  SELECT w.user_id, w.latitude, w.longitude, w.accuracy,
+         p.cluster_id AS previous_cluster_id,
+         p.latitude AS previous_latitude, p.longitude AS previous_longitude
+  FROM written w LEFT JOIN previous p ON p.user_id = w.user_id
+)";
+
+// Clears the flush flag when a flush ends, however it ends
+struct FlushingGuard {
+  std::atomic<bool> &flushing;
+
+  ~FlushingGuard() { flushing = false; }
+};
+
+}  // namespace
+
+LocationIngestService::LocationIngestService(ClusterService &cluster_service,
+                                             GeoGridIndex &location_index)
+    : cluster_service_(cluster_service),
+      location_index_(location_index),
+      flush_interval_(std::max(
+          config::get_config_int("location_flush_interval_ms", 1000), 10)),
+      flush_max_rows_(static_cast<std::size_t>(std::max(
+          config::get_config_int("location_flush_max_rows", 5000), 1))) {}
+
+void LocationIngestService::start() {
+  drogon::app().getLoop()->runEvery(
+      std::chrono::duration<double>(flush_interval_), [this]() {
+        drogon::async_run([this]() -> drogon::Task<> { co_await flush(); });
+      });
+}
+
+void LocationIngestService::submit(const GeoPoint &reading) {
+  readings_received_.fetch_add(1, std::memory_order_relaxed);
+  bool full = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.insert_or_assign(reading.user_id, reading);
+    full = pending_.size() == flush_max_rows_;
+  }
+  if (full) {
+    drogon::app().getLoop()->queueInLoop([this]() {
+      drogon::async_run([this]() -> drogon::Task<> { co_await flush(); });
+    });
+  }
+}
+
+LocationIngestService::Stats LocationIngestService::stats() const {
+  Stats stats{
+      .readings_received = readings_received_.load(std::memory_order_relaxed),
+      .rows_written = rows_written_.load(std::memory_order_relaxed),
+      .flushes = flushes_.load(std::memory_order_relaxed),
+      .failed_flushes = failed_flushes_.load(std::memory_order_relaxed),
+      .pending = 0,
+      .coalescing_ratio = 0.0,
+      .flush_p50_ms = flush_latency_.percentile(0.50) / 1000.0,
+      .flush_p99_ms = flush_latency_.percentile(0.99) / 1000.0};
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.pending = pending_.size();
+  }
+  // Readings still pending have not been coalesced yet
+  const auto flushed_readings =
+      stats.readings_received > stats.pending
+          ? stats.readings_received - stats.pending
+          : 0;
+  stats.coalescing_ratio =
+      stats.rows_written == 0 ? 0.0
+                              : static_cast<double>(flushed_readings) /
+                                    static_cast<double>(stats.rows_written);
+  return stats;
+}
+
+drogon::Task<> LocationIngestService::flush() {
+  // One flush at a time, readings keep coalescing meanwhile
+  if (flushing_.exchange(true)) {
+    co_return;
+  }
+  FlushingGuard guard{flushing_};
+
+  ankerl::unordered_dense::map<int, GeoPoint> batch;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batch.swap(pending_);
+  }
+  if (batch.empty()) {
+    co_return;
+  }
+
+  try {
+    std::vector<GeoPoint> readings;
+    readings.reserve(batch.size());
+    for (const auto &[user_id, reading] : batch) {
+      readings.push_back(reading);
+    }
+    std::sort(readings.begin(), readings.end(),
+              [](const GeoPoint &a, const GeoPoint &b) {
+                return a.user_id < b.user_id;
+              });
+    std::vector<std::string> user_ids;
+    std::vector<std::string> latitudes;
+    std::vector<std::string> longitudes;
+    std::vector<std::string> accuracies;
+    user_ids.reserve(readings.size());
+    latitudes.reserve(readings.size());
+    longitudes.reserve(readings.size());
+    accuracies.reserve(readings.size());
+    for (const auto &reading : readings) {
+      user_ids.push_back(std::to_string(reading.user_id));
+      latitudes.push_back(convert::double_to_string(reading.latitude));
+      longitudes.push_back(convert::double_to_string(reading.longitude));
+      accuracies.push_back(convert::double_to_string(reading.accuracy));
+    }
+
+    utilities::ScopedLatencyTimer timer(flush_latency_);
+    auto result = co_await drogon::app().getDbClient()->execSqlCoro(
+        std::string(UPSERT_READINGS),
+        convert::array_to_pgsql_array_string(user_ids),
+        convert::array_to_pgsql_array_string(latitudes),
+        convert::array_to_pgsql_array_string(longitudes),
+        convert::array_to_pgsql_array_string(accuracies),
+        cluster_service_.epsilon());
+
+    for (const auto &row : result) {
+      const GeoPoint point{.user_id = row["user_id"].as<int>(),
+                           .latitude = row["latitude"].as<double>(),
+                           .longitude = row["longitude"].as<double>(),
+                           .accuracy = row["accuracy"].as<double>()};
+      std::optional<std::string> previous_cluster_id;
+      std::optional<GeoPosition> previous_position;
+      if (!row["previous_cluster_id"].isNull()) {
+        previous_cluster_id = row["previous_cluster_id"].as<std::string>();
+      }
+      if (!row["previous_latitude"].isNull()) {
+        previous_position =
+            GeoPosition{.latitude = row["previous_latitude"].as<double>(),
+                        .longitude = row["previous_longitude"].as<double>()};
+      }
+      cluster_service_.mark_dirty(
+          point.user_id, std::move(previous_cluster_id), previous_position,
+          GeoPosition{.latitude = point.latitude,
+                      .longitude = point.longitude});
+      location_index_.upsert(point);
+    }
+    rows_written_.fetch_add(result.size(), std::memory_order_relaxed);
+    flushes_.fetch_add(1, std::memory_order_relaxed);
+  } catch (const drogon::orm::DrogonDbException &e) {
+    LOG_ERROR << "Location flush of " << batch.size()
+              << " rows failed: " << e.base().what();
+    failed_flushes_.fetch_add(1, std::memory_order_relaxed);
+    requeue(batch);
+  } catch (const std::exception &e) {
+    // The upsert is idempotent, so a batch that failed after it was written
+    // is written again to redo the cluster and index updates
+    LOG_ERROR << "Location flush of " << batch.size()
+              << " rows failed: " << e.what();
+    failed_flushes_.fetch_add(1, std::memory_order_relaxed);
+    requeue(batch);
+  }
+}
+
+void LocationIngestService::requeue(
+    const ankerl::unordered_dense::map<int, GeoPoint> &batch) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &[user_id, reading] : batch) {
+    pending_.try_emplace(user_id, reading);
+  }
+}
@@ -0,0 +1,76 @@
+#ifndef LOCATION_INGEST_SERVICE_HPP
+#define LOCATION_INGEST_SERVICE_HPP
+
+#include <ankerl/unordered_dense.h>
+#include <drogon/utils/coroutine.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "../../utilities/latency_histogram.hpp"
+#include "cluster_service.hpp"
+#include "geo_grid_index.hpp"
+
+/**
+ * @brief Write-behind buffer for location readings.
+ * Readings are coalesced per user in memory (last write wins) and flushed
+ * periodically as a single multi-row upsert. The upsert does what
+ * add_location does per row: joins the nearest cluster, reports the move
+ * to the ClusterService and updates the location index.
+ * Readings still pending when the process stops are lost, clients report
+ * again on their next interval.
+ * Configurable through custom_config:
+ * - location_flush_interval_ms: flush period (default 1000)
+ * - location_flush_max_rows: pending users that trigger an early flush
+ *   (default 5000)
+ */
+class LocationIngestService {
+ public:
+  struct Stats {
+    std::uint64_t readings_received = 0;
+    std::uint64_t rows_written = 0;
+    std::uint64_t flushes = 0;
+    std::uint64_t failed_flushes = 0;
+    std::size_t pending = 0;
+    double coalescing_ratio = 0.0;  // readings received / rows written
+    double flush_p50_ms = 0.0;
+    double flush_p99_ms = 0.0;
+  };
+
+  LocationIngestService(ClusterService& cluster_service,
+                        GeoGridIndex& location_index);
+
+  // Schedules the periodic flush, call once the config is loaded
+  void start();
+
+  // Replaces any reading of the same user still pending
+  void submit(const GeoPoint& reading);
+
+  Stats stats() const;
+
+ private:
+  drogon::Task<> flush();
+
+  // Puts a failed batch back, unless a newer reading arrived meanwhile
+  void requeue(const ankerl::unordered_dense::map<int, GeoPoint>& batch);
+
+  ClusterService& cluster_service_;
+  GeoGridIndex& location_index_;
+  std::chrono::milliseconds flush_interval_;
+  std::size_t flush_max_rows_;
+
+  mutable std::mutex mutex_;
+  ankerl::unordered_dense::map<int, GeoPoint> pending_;  // by user id
+  std::atomic<bool> flushing_{false};
+
+  std::atomic<std::uint64_t> readings_received_{0};
+  std::atomic<std::uint64_t> rows_written_{0};
+  std::atomic<std::uint64_t> flushes_{0};
+  std::atomic<std::uint64_t> failed_flushes_{0};
+  utilities::LatencyHistogram flush_latency_;
+};
+
+#endif  // LOCATION_INGEST_SERVICE_HPP
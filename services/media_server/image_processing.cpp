@@ -0,0 +1,215 @@
+#include "image_processing.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+// Implementations live in this translation unit only
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_PNG
+#define STBI_ONLY_GIF
+#include <stb_image.h>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace imaging {
+
+namespace {
+
+// Fixed width filter: every output sample reads `taps` consecutive inputs
+struct Filter {
+  int taps = 0;
+  std::vector<int> first;      // first input index per output
+  std::vector<float> weights;  // [output][taps], zero padded
+};
+
+Filter make_filter(int src_size, int dst_size) {
+  const double scale = static_cast<double>(src_size) / dst_size;
+  const double support = std::max(scale, 1.0);
+
+  Filter filter;
+  filter.taps = std::min(static_cast<int>(std::ceil(support * 2.0)) + 1,
+                         src_size);
+  filter.first.resize(dst_size);
+  filter.weights.assign(static_cast<std::size_t>(dst_size) * filter.taps,
+                        0.0f);
+
+  for (int i = 0; i < dst_size; ++i) {
+    const double center = (i + 0.5) * scale;
+    int first = static_cast<int>(std::floor(center - support));
+    first = std::clamp(first, 0, src_size - filter.taps);
+    filter.first[i] = first;
+
+    float* weights =
+        &filter.weights[static_cast<std::size_t>(i) * filter.taps];
+    double total = 0.0;
+    for (int k = 0; k < filter.taps; ++k) {
+      const double distance = std::abs(first + k + 0.5 - center) / support;
+      const double weight = std::max(0.0, 1.0 - distance);
+      weights[k] = static_cast<float>(weight);
+      total += weight;
+    }
+    if (total > 0.0) {
+      for (int k = 0; k < filter.taps; ++k) {
+        weights[k] = static_cast<float>(weights[k] / total);
+      }
+    } else {
+      weights[0] = 1.0f;
+    }
+  }
+  return filter;
+}
+
+std::uint8_t to_byte(float value) {
+  return static_cast<std::uint8_t>(std::clamp(value + 0.5f, 0.0f, 255.0f));
+}
+
+}  // namespace
+
+std::optional<Image> decode(std::string_view bytes, int channels,
+                            const DecodeLimits& limits) {
+  const auto* buffer = reinterpret_cast<const stbi_uc*>(bytes.data());
+  const auto length = static_cast<int>(bytes.size());
+  int width = 0;
+  int height = 0;
+  int source_channels = 0;
+  // Only parses the header, nothing is allocated for the pixels yet
+  if (!stbi_info_from_memory(buffer, length, &width, &height,
+                             &source_channels) ||
+      width <= 0 || height <= 0 || width > limits.max_side ||
+      height > limits.max_side ||
+      static_cast<std::int64_t>(width) * height > limits.max_pixels) {
+    return std::nullopt;
+  }
+
+  stbi_uc* data = stbi_load_from_memory(buffer, length, &width, &height,
+                                        &source_channels, channels);
+  if (!data) {
+    return std::nullopt;
+  }
+
+  Image image{
+      .width = width, .height = height, .channels = channels, .pixels = {}};
+  image.pixels.assign(data, data + static_cast<std::size_t>(width) * height *
+                                       channels);
+  stbi_image_free(data);
+  return image;
+}
+
+std::string encode_jpeg(const Image& image, int quality) {
+  std::string out;
+  out.reserve(image.pixels.size() / 8);
+  stbi_write_jpg_to_func(
+      [](void* context, void* data, int size) {
+        static_cast<std::string*>(context)->append(
+            static_cast<const char*>(data), static_cast<std::size_t>(size));
+      },
+      &out, image.width, image.height, image.channels, image.pixels.data(),
+      quality);
+  return out;
+}
+
+Image resize(const Image& src, int width, int height) {
+  const int channels = src.channels;
+  const auto src_stride = static_cast<std::size_t>(src.width) * channels;
+  const auto dst_stride = static_cast<std::size_t>(width) * channels;
+
+  const Filter vertical = make_filter(src.height, height);
+  const Filter horizontal = make_filter(src.width, width);
+
+  Image dst{
+      .width = width, .height = height, .channels = channels, .pixels = {}};
+  dst.pixels.resize(dst_stride * height);
+
+  std::vector<float> row(src_stride);
+  std::vector<float> out_row(dst_stride);
+
+  for (int y = 0; y < height; ++y) {
+    // Vertical pass: weighted sum of whole source rows (axpy)
+    std::fill(row.begin(), row.end(), 0.0f);
+    const float* v_weights =
+        &vertical.weights[static_cast<std::size_t>(y) * vertical.taps];
+    for (int k = 0; k < vertical.taps; ++k) {
+      const float weight = v_weights[k];
+      if (weight == 0.0f) {
+        continue;
+      }
+      const std::uint8_t* src_row =
+          &src.pixels[static_cast<std::size_t>(vertical.first[y] + k) *
+                      src_stride];
+      for (std::size_t i = 0; i < src_stride; ++i) {
+        row[i] += weight * static_cast<float>(src_row[i]);
+      }
+    }
+
+    // Horizontal pass over the single intermediate row
+    std::fill(out_row.begin(), out_row.end(), 0.0f);
+    for (int x = 0; x < width; ++x) {
+      const float* h_weights =
+          &horizontal.weights[static_cast<std::size_t>(x) * horizontal.taps];
+      const float* in =
+          &row[static_cast<std::size_t>(horizontal.first[x]) * channels];
+      float* out = &out_row[static_cast<std::size_t>(x) * channels];
+      for (int k = 0; k < horizontal.taps; ++k) {
+        const float weight = h_weights[k];
+        for (int c = 0; c < channels; ++c) {
+          out[c] += weight * in[k * channels + c];
+        }
+      }
+    }
+
+    std::uint8_t* dst_row = &dst.pixels[static_cast<std::size_t>(y) *
+                                        dst_stride];
+    for (std::size_t i = 0; i < dst_stride; ++i) {
+      dst_row[i] = to_byte(out_row[i]);
+    }
+  }
+  return dst;
+}
+
+std::vector<Thumbnail> make_thumbnails(std::string_view bytes,
+                                       std::span<const int> sizes,
+                                       int quality,
+                                       const DecodeLimits& limits) {
+  std::vector<Thumbnail> thumbnails;
+  auto source = decode(bytes, 3, limits);
+  if (!source) {
+    return thumbnails;
+  }
+
+  std::vector<int> ordered(sizes.begin(), sizes.end());
+  std::sort(ordered.begin(), ordered.end(), std::greater<>());
+
+  thumbnails.reserve(ordered.size());
+  Image current = std::move(*source);
+  for (int max_side : ordered) {
+    auto [width, height] = fit_within(current.width, current.height, max_side);
+    if (width != current.width || height != current.height) {
+      current = resize(current, width, height);
+    }
+    thumbnails.push_back(Thumbnail{.max_side = max_side,
+                                   .width = current.width,
+                                   .height = current.height,
+                                   .jpeg = encode_jpeg(current, quality)});
+  }
+  return thumbnails;
+}
+
+std::pair<int, int> fit_within(int width, int height, int max_side) {
+  if (width <= max_side && height <= max_side) {
+    return {width, height};
+  }
+  if (width >= height) {
+    return {max_side,
+            std::max(1, static_cast<int>(std::lround(
+                            static_cast<double>(height) * max_side / width)))};
+  }
+  return {std::max(1, static_cast<int>(std::lround(
+                          static_cast<double>(width) * max_side / height))),
+          max_side};
+}
+
+}  // namespace imaging
@@ -0,0 +1,75 @@
+#ifndef IMAGE_PROCESSING_HPP
+#define IMAGE_PROCESSING_HPP
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace imaging {
+
+// 8-bit interleaved image, rows are tightly packed
+struct Image {
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  std::vector<std::uint8_t> pixels;
+};
+
+// Largest image decode() accepts. A few KB of PNG or JPEG can declare
+// dimensions that would take gigabytes once decoded.
+struct DecodeLimits {
+  int max_side = 16384;
+  std::int64_t max_pixels = 40'000'000;
+};
+
+/**
+ * @brief Decodes a JPEG, PNG or GIF (first frame) image.
+ * The header is checked against limits before any pixel is decoded.
+ * @param channels number of output channels, alpha is dropped for 3.
+ * @return std::nullopt if the bytes are not a supported image or are over
+ * limits.
+ */
+std::optional<Image> decode(std::string_view bytes, int channels = 3,
+                            const DecodeLimits& limits = {});
+
+// Encodes a 1 or 3 channel image as baseline JPEG
+std::string encode_jpeg(const Image& image, int quality = 80);
+
+/**
+ * @brief Resamples an image with a separable triangle (area averaging when
+ * downscaling) filter.
+ * Filter weights are precomputed with a fixed tap count per axis and both
+ * passes run over contiguous float rows, so the inner loops are plain
+ * multiply-adds the compiler vectorizes.
+ */
+Image resize(const Image& src, int width, int height);
+
+struct Thumbnail {
+  int max_side = 0;  // requested bounding box
+  int width = 0;
+  int height = 0;
+  std::string jpeg;
+};
+
+/**
+ * @brief Decodes an image once and renders a JPEG thumbnail per size.
+ * Sizes are processed largest first and each one is resized from the
+ * previous result, which is much cheaper than going back to the source.
+ * @return empty if the bytes are not a supported image or are over limits.
+ */
+std::vector<Thumbnail> make_thumbnails(std::string_view bytes,
+                                       std::span<const int> sizes,
+                                       int quality = 80,
+                                       const DecodeLimits& limits = {});
+
+// Dimensions that fit within max_side x max_side keeping the aspect ratio,
+// images are never upscaled
+std::pair<int, int> fit_within(int width, int height, int max_side);
+
+}  // namespace imaging
+
+#endif  // IMAGE_PROCESSING_HPP
@@ -0,0 +1,143 @@
+#include "media_info_cache.hpp"
+
+#include <drogon/drogon.h>
+
+#include <algorithm>
+#include <utility>
+
+MediaInfoCache::MediaInfoCache(S3Service &s3_service, std::size_t capacity,
+                               std::chrono::milliseconds negative_ttl)
+    : s3_service_(s3_service),
+      capacity_(std::max<std::size_t>(capacity, 1)),
+      negative_ttl_(negative_ttl) {
+  index_.reserve(capacity_);
+}
+
+drogon::Task<MediaInfo> MediaInfoCache::get(std::string bucket_name,
+                                            std::string object_key) {
+  if (!is_cacheable(object_key)) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    co_return co_await s3_service_.get_media_info(bucket_name, object_key);
+  }
+
+  if (auto cached = lookup(object_key)) {
+    co_return std::move(*cached);
+  }
+
+  if (auto from_db = co_await load_from_db(object_key)) {
+    db_hits_.fetch_add(1, std::memory_order_relaxed);
+    store(object_key, *from_db);
+    co_return std::move(*from_db);
+  }
+
+  // Uploaded content type is sniffed once here, the media table keeps the
+  // verified value from then on
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  MediaInfo info =
+      co_await s3_service_.get_verified_media_info(bucket_name, object_key);
+  // A failed lookup (throttling, timeouts, ...) is retried on the next call
+  if (!info.etag.empty() || info.missing) {
+    store(object_key, info);
+  }
+  co_return info;
+}
+
+MediaInfoCache::Stats MediaInfoCache::stats() const {
+  Stats stats{.hits = hits_.load(std::memory_order_relaxed),
+              .negative_hits = negative_hits_.load(std::memory_order_relaxed),
+              .db_hits = db_hits_.load(std::memory_order_relaxed),
+              .misses = misses_.load(std::memory_order_relaxed),
+              .evictions = evictions_.load(std::memory_order_relaxed),
+              .size = 0,
+              .capacity = capacity_,
+              .hit_rate = 0.0};
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.size = lru_.size();
+  }
+  const auto served = stats.hits + stats.negative_hits + stats.db_hits;
+  const auto total = served + stats.misses;
+  stats.hit_rate =
+      total ? static_cast<double>(served) / static_cast<double>(total) : 0.0;
+  return stats;
+}
+
+std::optional<MediaInfo> MediaInfoCache::lookup(const std::string &object_key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(object_key);
+  if (it == index_.end()) {
+    return std::nullopt;
+  }
+
+  auto entry = it->second;
+  if (entry->info.etag.empty()) {
+    if (std::chrono::steady_clock::now() >= entry->expires_at) {
+      lru_.erase(entry);
+      index_.erase(it);
+      return std::nullopt;
+    }
+    negative_hits_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    hits_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  lru_.splice(lru_.begin(), lru_, entry);
+  return entry->info;
+}
+
+void MediaInfoCache::store(const std::string &object_key,
+                           const MediaInfo &info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto expires_at = std::chrono::steady_clock::now() + negative_ttl_;
+
+  if (auto it = index_.find(object_key); it != index_.end()) {
+    it->second->info = info;
+    it->second->expires_at = expires_at;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return;
+  }
+
+  lru_.push_front(
+      Entry{.key = object_key, .info = info, .expires_at = expires_at});
+  index_.emplace(object_key, lru_.begin());
+
+  while (lru_.size() > capacity_) {
+    index_.erase(lru_.back().key);
+    lru_.pop_back();
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+drogon::Task<std::optional<MediaInfo>> MediaInfoCache::load_from_db(
+    const std::string &object_key) {
+  try {
+    // Rows inserted before the etag was recorded fall through to S3
+    auto result = co_await drogon::app().getDbClient()->execSqlCoro(
+        "SELECT mime_type, size, metadata->>'etag' AS etag, "
+        "metadata->>'last_modified' AS last_modified "
+        "FROM media WHERE storage_key = $1 "
+        "AND metadata->>'etag' IS NOT NULL",
+        object_key);
+    if (result.empty()) {
+      co_return std::nullopt;
+    }
+
+    const auto &row = result[0];
+    co_return MediaInfo{
+        .object_key = object_key,
+        .content_type = row["mime_type"].isNull()
+                            ? std::string{}
+                            : row["mime_type"].as<std::string>(),
+        .content_length =
+            row["size"].isNull() ? 0 : row["size"].as<long long>(),
+        .last_modified = row["last_modified"].isNull()
+                             ? std::string{}
+                             : row["last_modified"].as<std::string>(),
+        .etag = row["etag"].as<std::string>(),
+        .custom_metadata = {},
+        .missing = false};
+  } catch (const drogon::orm::DrogonDbException &e) {
+    LOG_ERROR << "Media cache lookup failed: " << e.base().what();
+    co_return std::nullopt;
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef MEDIA_INFO_CACHE_HPP
+#define MEDIA_INFO_CACHE_HPP
+
+#include <ankerl/unordered_dense.h>
+#include <drogon/utils/coroutine.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "s3_service.hpp"
+
+/**
+ * @brief Read-through cache of S3 object metadata.
+ * Lookup order: in-memory LRU -> media table -> S3.
+ * For uploads/ the S3 lookup sniffs the object's leading bytes, so the
+ * content_type served for those keys is always the detected one.
+ * Objects under uploads/ are immutable once written, so positive entries
+ * never expire and are only evicted by the size cap, nothing deletes or
+ * overwrites them. Keys that are not (yet) in the bucket are cached for a
+ * short negative TTL so clients polling a key during upload do not hammer S3,
+ * other S3 failures are not cached. Other keys are passed straight to S3.
+ * Configurable through custom_config:
+ * - media_cache_capacity: max number of entries (default 10000)
+ * - media_cache_negative_ttl_ms: TTL of not found entries (default 2000)
+ */
+class MediaInfoCache {
+ public:
+  struct Stats {
+    std::uint64_t hits = 0;           // served from memory
+    std::uint64_t negative_hits = 0;  // served from a not found entry
+    std::uint64_t db_hits = 0;        // served from the media table
+    std::uint64_t misses = 0;         // went to S3
+    std::uint64_t evictions = 0;
+    std::size_t size = 0;
+    std::size_t capacity = 0;
+    double hit_rate = 0.0;  // requests not reaching S3 / all requests
+  };
+
+  MediaInfoCache(S3Service& s3_service, std::size_t capacity,
+                 std::chrono::milliseconds negative_ttl);
+
+  drogon::Task<MediaInfo> get(std::string bucket_name, std::string object_key);
+
+  // Keys get() caches, every other key costs an S3 request per call
+  static bool is_cacheable(std::string_view object_key) {
+    return object_key.starts_with("uploads/");
+  }
+
+  Stats stats() const;
+
+ private:
+  struct Entry {
+    std::string key;
+    MediaInfo info;
+    // only meaningful for not found entries
+    std::chrono::steady_clock::time_point expires_at;
+  };
+
+  std::optional<MediaInfo> lookup(const std::string& object_key);
+  void store(const std::string& object_key, const MediaInfo& info);
+  drogon::Task<std::optional<MediaInfo>> load_from_db(
+      const std::string& object_key);
+
+  S3Service& s3_service_;
+  const std::size_t capacity_;
+  const std::chrono::milliseconds negative_ttl_;
+
+  mutable std::mutex mutex_;
+  std::list<Entry> lru_;  // most recently used first
+  ankerl::unordered_dense::map<std::string, std::list<Entry>::iterator> index_;
+
+  std::atomic<std::uint64_t> hits_{0};
+  std::atomic<std::uint64_t> negative_hits_{0};
+  std::atomic<std::uint64_t> db_hits_{0};
+  std::atomic<std::uint64_t> misses_{0};
+  std::atomic<std::uint64_t> evictions_{0};
+};
+
+#endif  // MEDIA_INFO_CACHE_HPP
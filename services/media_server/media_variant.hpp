@@ -0,0 +1,16 @@
+#ifndef MEDIA_VARIANT_HPP
+#define MEDIA_VARIANT_HPP
+
+#include <cstdint>
+#include <string>
+
+// Derived rendition of a media item e.g. a thumbnail, stored in
+// media.metadata->'variants'
+struct MediaVariant {
+  std::string object_key;
+  int width = 0;
+  int height = 0;
+  int64_t size = 0;
+};
+
+#endif  // MEDIA_VARIANT_HPP
@@ -1,8 +1,12 @@
 #include "s3_service.hpp"
 
 #include <aws/core/auth/AWSCredentials.h>
+#include <aws/core/http/HttpResponse.h>
 #include <aws/core/utils/DateTime.h>
 #include <aws/core/utils/memory/stl/AWSString.h>
+#include <aws/core/utils/memory/stl/AWSStringStream.h>
+#include <aws/core/utils/threading/Executor.h>
+#include <aws/s3/S3Errors.h>
 #include <aws/s3/model/CreateBucketRequest.h>
 #include <aws/s3/model/GetObjectAttributesRequest.h>
 #include <aws/s3/model/GetObjectRequest.h>
@@ -12,13 +16,87 @@
 #include <drogon/HttpTypes.h>
 #include <drogon/drogon.h>
 
+#include <algorithm>
+#include <coroutine>
+#include <format>
+#include <functional>
+#include <optional>
+
 #include "../../config/config.hpp"
+#include "../../utilities/conversion.hpp"
+#include "../../utilities/media_sniffing.hpp"
 
 // Windows SDK compatibility fix
 #ifdef GetObject
 #undef GetObject
 #endif
 
+namespace {
+
+// A HEAD of a missing key only carries the 404, a GET reports NoSuchKey
+bool is_missing(const Aws::S3::S3Error &error) {
+  return error.GetErrorType() == Aws::S3::S3Errors::NO_SUCH_KEY ||
+         error.GetResponseCode() == Aws::Http::HttpResponseCode::NOT_FOUND;
+}
+
+/**
+ * @brief Awaits a single *Async SDK call.
+ * The launcher receives a completion callback that the SDK handler invokes on
+ * its IO thread. The coroutine is then resumed on the event loop it suspended
+ * on, so the caller never observes a thread switch.
+ */
+template <typename Outcome>
+class SdkCallAwaiter {
+ public:
+  using Completion = std::function<void(Outcome)>;
+
+  explicit SdkCallAwaiter(std::function<void(Completion)> launch)
+      : launch_(std::move(launch)) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    auto *loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    // The completion may resume the coroutine before launch() returns, so
+    // don't touch members once it has been invoked
+    auto launch = std::move(launch_);
+    launch([this, handle, loop](Outcome outcome) {
+      outcome_.emplace(std::move(outcome));
+      if (loop) {
+        loop->queueInLoop([handle]() { handle.resume(); });
+      } else {
+        handle.resume();
+      }
+    });
+  }
+
+  Outcome await_resume() { return std::move(*outcome_); }
+
+ private:
+  std::function<void(Completion)> launch_;
+  std::optional<Outcome> outcome_;
+};
+
+// Adapts a completion callback to the SDK's ResponseReceivedHandler shape
+template <typename Completion>
+auto forward_outcome(Completion done) {
+  return [done = std::move(done)](const auto * /*client*/,
+                                  const auto & /*request*/, auto outcome,
+                                  const auto & /*context*/) {
+    done(std::move(outcome));
+  };
+}
+
+}  // namespace
+
+template <typename Outcome, typename Launcher>
+drogon::Task<Outcome> S3Service::run_async(S3Operation op,
+                                           Launcher launcher) {
+  auto permit = co_await in_flight_->acquire();
+  utilities::ScopedLatencyTimer timer(latency(op));
+  co_return co_await SdkCallAwaiter<Outcome>(std::move(launcher));
+}
+
 S3Service::S3Service() {
   Aws::Client::ClientConfiguration config;
 
@@ -35,7 +113,28 @@ S3Service::S3Service() {
                                                 : Aws::Http::Scheme::HTTP;
   config.verifySSL = false;
 
-  LOG_INFO << "Initializing S3 client with endpoint: " << endpoint;
+  // SDK calls run on their own pool, never on the drogon IO threads
+  const int io_threads =
+      std::max(config::get_config_int("s3_io_threads", 4), 1);
+  const int max_concurrency =
+      std::max(config::get_config_int("s3_max_concurrency", 32), 1);
+  config.executor =
+      Aws::MakeShared<Aws::Utils::Threading::PooledThreadExecutor>(
+          "S3Service", io_threads);
+  config.maxConnections = static_cast<unsigned>(max_concurrency);
+  in_flight_ = std::make_unique<utilities::AsyncSemaphore>(
+      static_cast<std::size_t>(max_concurrency));
+
+  url_cache_capacity_ = static_cast<std::size_t>(
+      std::max(config::get_config_int("presign_cache_capacity", 50000), 0));
+  refresh_margin_ = std::chrono::seconds(
+      std::max(config::get_config_int("presign_refresh_margin_sec", 300), 0));
+  presigner_ = std::make_unique<SigV4Presigner>(endpoint, config.region,
+                                                access_key, secret_key);
+
+  LOG_INFO << "Initializing S3 client with endpoint: " << endpoint
+           << ", io threads: " << io_threads
+           << ", max concurrency: " << max_concurrency;
 
   s3_client_ = std::make_unique<Aws::S3::S3Client>(
       Aws::Auth::AWSCredentials(access_key, secret_key), config,
@@ -50,11 +149,10 @@ drogon::Task<std::string> S3Service::generate_presigned_url(
   std::string url;
 
   if (method == drogon::HttpMethod::Get) {
-    url = s3_client_->GeneratePresignedUrl(bucket_name, object_key,
-                                           Aws::Http::HttpMethod::HTTP_GET,
-                                           expiration_sec);
-    co_return url;
+    co_return presign_get_url(bucket_name, object_key, expiration_sec);
   } else if (method == drogon::HttpMethod::Put) {
+    // Presigning is local CPU work (SigV4), no network round trip
+    utilities::ScopedLatencyTimer timer(latency(S3Operation::presign));
     headers["Content-Type"] = content_type;  // for better browser compatibility
     url = s3_client_->GeneratePresignedUrl(bucket_name, object_key,
                                            Aws::Http::HttpMethod::HTTP_PUT,
@@ -66,27 +164,64 @@ drogon::Task<std::string> S3Service::generate_presigned_url(
   co_return url;
 }
 
+std::string S3Service::presign_get_url(std::string_view bucket_name,
+                                       std::string_view object_key,
+                                       long long expiration_sec) {
+  const auto now = std::chrono::system_clock::now();
+  const auto lifetime = std::chrono::seconds(expiration_sec);
+  const bool cacheable = url_cache_capacity_ > 0 && lifetime > refresh_margin_;
+
+  std::string cache_key;
+  if (cacheable) {
+    cache_key.reserve(bucket_name.size() + object_key.size() + 1);
+    cache_key.append(bucket_name).append("/").append(object_key);
+
+    std::lock_guard<std::mutex> lock(url_cache_mutex_);
+    auto it = url_cache_.find(cache_key);
+    if (it != url_cache_.end() &&
+        it->second.expires_at - now > refresh_margin_) {
+      return it->second.url;
+    }
+  }
+
+  std::string url;
+  {
+    utilities::ScopedLatencyTimer timer(latency(S3Operation::presign));
+    url = presigner_->presign_get(bucket_name, object_key, expiration_sec, now);
+  }
+
+  if (cacheable) {
+    std::lock_guard<std::mutex> lock(url_cache_mutex_);
+    if (url_cache_.size() >= url_cache_capacity_) {
+      // Drop what is no longer reusable, start over if everything still is
+      ankerl::unordered_dense::erase_if(
+          url_cache_, [&](const auto &entry) {
+            return entry.second.expires_at - now <= refresh_margin_;
+          });
+      if (url_cache_.size() >= url_cache_capacity_) {
+        url_cache_.clear();
+      }
+    }
+    url_cache_.insert_or_assign(
+        std::move(cache_key),
+        CachedUrl{.url = url, .expires_at = now + lifetime});
+  }
+  return url;
+}
+
 drogon::Task<bool> S3Service::process_media(const std::string &bucket_name,
                                             const std::string &object_key) {
   LOG_INFO << "Processing media: " << bucket_name << "/" << object_key;
-  Aws::S3::Model::GetObjectRequest get_request;
-  get_request.SetBucket(bucket_name);
-  get_request.SetKey(object_key);
 
-// Windows SDK compatibility fix
-#ifdef GetObject
-#undef GetObject
-#endif
-  Aws::S3::Model::GetObjectOutcome outcome = s3_client_->GetObject(get_request);
-  if (!outcome.IsSuccess()) {
-    LOG_ERROR << "Failed to get object: " << outcome.GetError().GetMessage();
+  // Only the leading bytes are needed for magic-byte validation
+  auto head = co_await get_object_range(bucket_name, object_key, 0,
+                                        utilities::MEDIA_SNIFF_BYTES - 1);
+  if (!head) {
     co_return false;
   }
 
-  LOG_INFO << "Successfully retrieved object, size: "
-           << outcome.GetResult().GetContentLength() << " bytes";
-
-  auto content_type = outcome.GetResult().GetContentType();
+  LOG_INFO << "Successfully retrieved object head, object size: "
+           << head->total_size << " bytes";
 
   /**
    * Todo:
@@ -95,29 +230,103 @@ drogon::Task<bool> S3Service::process_media(const std::string &bucket_name,
    * - Content scanning for inappropriate material
    * - Metadata validation
    * - Virus scanning
-   * - Format validation
    */
-  // auto &metadata = outcome.GetResult().GetMetadata();
+  auto sniffed_type = utilities::sniff_media_type(head->data);
+  if (sniffed_type.empty()) {
+    LOG_INFO << "No processing for this file-type";
+    co_return false;
+  }
+  if (!head->content_type.starts_with(
+          sniffed_type.substr(0, sniffed_type.find('/') + 1))) {
+    LOG_WARN << "Declared content type " << head->content_type
+             << " does not match detected " << sniffed_type << " for "
+             << object_key;
+  }
 
-  if (content_type.find("image/") != std::string::npos) {
-    //  or specific formats e.g. content_type.ends_with(".png") ||
-    //  content_type.ends_with(".jpg")
+  if (sniffed_type.starts_with("image/")) {
     LOG_INFO << "Processing image file: "
              << object_key.substr(object_key.find("_") + 1);
     // image-specific processing here
 
     co_return true;
-  } else if (content_type.find("video/") != std::string::npos) {
-    LOG_INFO << "Processing video file: "
-             << object_key.substr(object_key.find("_") + 1);
-    // video-specific processing here
+  }
 
-    co_return true;
-  } else {
-    LOG_INFO << "No processing for this file-type";
+  LOG_INFO << "Processing video file: "
+           << object_key.substr(object_key.find("_") + 1);
+  // video-specific processing here
+
+  co_return true;
+}
+
+drogon::Task<std::optional<ObjectChunk>> S3Service::get_object_range(
+    std::string bucket_name, std::string object_key, long long first,
+    long long last, bool *missing) {
+  Aws::S3::Model::GetObjectRequest get_request;
+  get_request.SetBucket(bucket_name);
+  get_request.SetKey(object_key);
+  get_request.SetRange(std::format("bytes={}-{}", first, last));
+
+  auto outcome = co_await run_async<Aws::S3::Model::GetObjectOutcome>(
+      S3Operation::get_object, [this, &get_request](auto done) {
+        s3_client_->GetObjectAsync(get_request,
+                                   forward_outcome(std::move(done)));
+      });
+  if (!outcome.IsSuccess()) {
+    LOG_ERROR << "Failed to get object range: "
+              << outcome.GetError().GetMessage();
+    if (missing) {
+      *missing = is_missing(outcome.GetError());
+    }
+    co_return std::nullopt;
   }
 
-  co_return false;
+  auto &result = outcome.GetResult();
+  ObjectChunk chunk{.data = {},
+                    .content_type = result.GetContentType(),
+                    .etag = result.GetETag(),
+                    .last_modified = result.GetLastModified().ToGmtString(
+                        Aws::Utils::DateFormat::ISO_8601),
+                    .total_size = result.GetContentLength()};
+
+  // "bytes first-last/total", absent if the server ignored the range
+  const auto &content_range = result.GetContentRange();
+  if (auto slash = content_range.rfind('/'); slash != std::string::npos) {
+    chunk.total_size =
+        convert::string_to_number<long long>(
+            std::string_view(content_range).substr(slash + 1))
+            .value_or(chunk.total_size);
+  }
+
+  chunk.data.resize(static_cast<std::size_t>(result.GetContentLength()));
+  auto &body = result.GetBody();
+  body.read(chunk.data.data(), static_cast<std::streamsize>(chunk.data.size()));
+  chunk.data.resize(static_cast<std::size_t>(body.gcount()));
+  co_return chunk;
+}
+
+drogon::Task<bool> S3Service::put_object(std::string bucket_name,
+                                         std::string object_key,
+                                         std::string body,
+                                         std::string content_type) {
+  Aws::S3::Model::PutObjectRequest put_request;
+  put_request.SetBucket(bucket_name);
+  put_request.SetKey(object_key);
+  put_request.SetContentType(content_type);
+  put_request.SetContentLength(static_cast<long long>(body.size()));
+  put_request.SetBody(
+      Aws::MakeShared<Aws::StringStream>("S3Service", std::move(body)));
+
+  auto outcome = co_await run_async<Aws::S3::Model::PutObjectOutcome>(
+      S3Operation::put_object, [this, &put_request](auto done) {
+        s3_client_->PutObjectAsync(put_request,
+                                   forward_outcome(std::move(done)));
+      });
+  if (!outcome.IsSuccess()) {
+    LOG_ERROR << "Failed to put object " << object_key << ": "
+              << outcome.GetError().GetMessage();
+    co_return false;
+  }
+  co_return true;
 }
 
 drogon::Task<bool> S3Service::ensure_bucket_exists(
@@ -127,7 +336,10 @@ drogon::Task<bool> S3Service::ensure_bucket_exists(
   Aws::S3::Model::HeadBucketRequest request;
   request.SetBucket(bucket_name);
 
-  auto outcome = s3_client_->HeadBucket(request);
+  auto outcome = co_await run_async<Aws::S3::Model::HeadBucketOutcome>(
+      S3Operation::head_bucket, [this, &request](auto done) {
+        s3_client_->HeadBucketAsync(request, forward_outcome(std::move(done)));
+      });
   if (outcome.IsSuccess()) {
     LOG_INFO << "Bucket " << bucket_name << " already exists";
     co_return true;
@@ -138,7 +350,12 @@ drogon::Task<bool> S3Service::ensure_bucket_exists(
   Aws::S3::Model::CreateBucketRequest create_request;
   create_request.SetBucket(bucket_name);
 
-  auto create_outcome = s3_client_->CreateBucket(create_request);
+  auto create_outcome =
+      co_await run_async<Aws::S3::Model::CreateBucketOutcome>(
+          S3Operation::create_bucket, [this, &create_request](auto done) {
+            s3_client_->CreateBucketAsync(create_request,
+                                          forward_outcome(std::move(done)));
+          });
   if (!create_outcome.IsSuccess()) {
     LOG_ERROR << "Failed to create bucket: "
               << create_outcome.GetError().GetMessage();
@@ -155,11 +372,17 @@ drogon::Task<MediaInfo> S3Service::get_media_info(
   head_request.SetBucket(bucket_name);
   head_request.SetKey(object_key);
 
-  auto outcome = s3_client_->HeadObject(head_request);
+  auto outcome = co_await run_async<Aws::S3::Model::HeadObjectOutcome>(
+      S3Operation::head_object, [this, &head_request](auto done) {
+        s3_client_->HeadObjectAsync(head_request,
+                                    forward_outcome(std::move(done)));
+      });
   if (!outcome.IsSuccess()) {
     LOG_ERROR << "Failed to get object info: "
               << outcome.GetError().GetMessage();
-    co_return MediaInfo{};
+    MediaInfo info;
+    info.missing = is_missing(outcome.GetError());
+    co_return info;
   }
 
   auto &result = outcome.GetResult();
@@ -178,3 +401,36 @@ drogon::Task<MediaInfo> S3Service::get_media_info(
 
   co_return info;
 }
+
+drogon::Task<MediaInfo> S3Service::get_verified_media_info(
+    std::string_view bucket_name, const std::string &object_key) {
+  bool missing = false;
+  auto head =
+      co_await get_object_range(std::string(bucket_name), object_key, 0,
+                                utilities::MEDIA_SNIFF_BYTES - 1, &missing);
+  if (!head) {
+    MediaInfo info;
+    info.missing = missing;
+    co_return info;
+  }
+
+  auto sniffed_type = utilities::sniff_media_type(head->data);
+  if (sniffed_type.empty()) {
+    LOG_WARN << "Unrecognised content for " << object_key << ", declared "
+             << head->content_type;
+  } else if (sniffed_type != head->content_type) {
+    LOG_INFO << "Declared content type " << head->content_type
+             << " replaced by detected " << sniffed_type << " for "
+             << object_key;
+  }
+
+  co_return MediaInfo{
+      .object_key = object_key,
+      .content_type = sniffed_type.empty() ? "application/octet-stream"
+                                           : std::string(sniffed_type),
+      .content_length = head->total_size,
+      .last_modified = std::move(head->last_modified),
+      .etag = std::move(head->etag),
+      .custom_metadata = {},
+      .missing = false};
+}
@@ -1,13 +1,23 @@
 #ifndef S3_SERVICE_HPP
 #define S3_SERVICE_HPP
 
+#include <ankerl/unordered_dense.h>
 #include <aws/core/Aws.h>
 #include <aws/s3/S3Client.h>
 #include <drogon/HttpController.h>
 #include <drogon/utils/coroutine.h>
 
+#include <array>
+#include <chrono>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+
+#include "../../utilities/async_semaphore.hpp"
+#include "../../utilities/latency_histogram.hpp"
+#include "sigv4_presigner.hpp"
 
 struct MediaInfo {
   std::string object_key;
@@ -16,8 +26,48 @@ struct MediaInfo {
   std::string last_modified;
   std::string etag;
   std::unordered_map<std::string, std::string> custom_metadata;
+  // the lookup failed because the object does not exist, not on an error
+  bool missing = false;
+};
+
+// Part of an object returned by a ranged GET
+struct ObjectChunk {
+  std::string data;
+  std::string content_type;
+  std::string etag;
+  std::string last_modified;
+  long long total_size = 0;  // size of the whole object
+};
+
+enum class S3Operation : std::uint8_t {
+  head_object,
+  get_object,
+  put_object,
+  head_bucket,
+  create_bucket,
+  presign,
+  count  // keep last
 };
 
+inline constexpr std::array<std::string_view,
+                            static_cast<std::size_t>(S3Operation::count)>
+    S3_OPERATION_NAMES = {"head_object", "get_object", "put_object",
+                          "head_bucket", "create_bucket", "presign"};
+
+/**
+ * @brief S3 compatible object store client.
+ * Blocking SDK calls are never made on the drogon event loop. Requests are
+ * dispatched through the SDK's *Async callables onto a dedicated IO thread
+ * pool, and the awaiting coroutine is resumed on the event loop it was
+ * suspended on.
+ * Configurable through custom_config:
+ * - s3_io_threads: size of the SDK IO thread pool (default 4)
+ * - s3_max_concurrency: max in-flight requests, extra callers wait without
+ *   blocking (default 32)
+ * - presign_cache_capacity: max cached GET urls (default 50000)
+ * - presign_refresh_margin_sec: cached GET urls are reissued once they have
+ *   less than this left before expiry (default 300)
+ */
 class S3Service {
  public:
   S3Service();
@@ -28,19 +78,74 @@ class S3Service {
       const std::string& content_type = "application/octet-stream",
       long long expiration_sec = 3600);
 
+  // Cached GET presign, cheap enough to call for a whole feed page
+  std::string presign_get_url(std::string_view bucket_name,
+                              std::string_view object_key,
+                              long long expiration_sec = 3600);
+
+  // Validates an object by sniffing its first bytes, the full object is
+  // never downloaded
   drogon::Task<bool> process_media(const std::string& bucket_name,
                                    const std::string& object_key);
 
+  // Fetches bytes [first, last] (inclusive) of an object.
+  // @return std::nullopt if the object or range could not be read, *missing
+  // is then set when the object does not exist
+  drogon::Task<std::optional<ObjectChunk>> get_object_range(
+      std::string bucket_name, std::string object_key, long long first,
+      long long last, bool* missing = nullptr);
+
+  drogon::Task<bool> put_object(std::string bucket_name,
+                                std::string object_key, std::string body,
+                                std::string content_type);
+
   // Ensures a bucket exists, creating it if necessary
   drogon::Task<bool> ensure_bucket_exists(const std::string& bucket_name);
 
+  // On failure the returned info has an empty etag, and missing set when
+  // the object does not exist
   drogon::Task<MediaInfo> get_media_info(std::string_view bucket_name,
                                          const std::string& object_key);
 
+  // Like get_media_info, but content_type is detected from the object's
+  // leading bytes instead of trusting the uploader's declared type, one
+  // ranged GET replaces the HEAD. Unrecognised content is reported as
+  // application/octet-stream.
+  drogon::Task<MediaInfo> get_verified_media_info(
+      std::string_view bucket_name, const std::string& object_key);
+
   Aws::S3::S3Client* get_client() { return s3_client_.get(); }
 
+  // Per-operation latency, measured from dispatch to SDK completion
+  const utilities::LatencyHistogram& get_latency(S3Operation op) const {
+    return latency_[static_cast<std::size_t>(op)];
+  }
+
  private:
+  template <typename Outcome, typename Launcher>
+  drogon::Task<Outcome> run_async(S3Operation op, Launcher launcher);
+
+  utilities::LatencyHistogram& latency(S3Operation op) {
+    return latency_[static_cast<std::size_t>(op)];
+  }
+
+  struct CachedUrl {
+    std::string url;
+    std::chrono::system_clock::time_point expires_at;
+  };
+
   std::unique_ptr<Aws::S3::S3Client> s3_client_;
+  std::unique_ptr<SigV4Presigner> presigner_;
+  std::unique_ptr<utilities::AsyncSemaphore> in_flight_;
+
+  std::mutex url_cache_mutex_;
+  ankerl::unordered_dense::map<std::string, CachedUrl> url_cache_;
+  std::size_t url_cache_capacity_ = 0;
+  std::chrono::seconds refresh_margin_{0};
+
+  std::array<utilities::LatencyHistogram,
+             static_cast<std::size_t>(S3Operation::count)>
+      latency_;
 };
 
 #endif  // S3_SERVICE_HPP
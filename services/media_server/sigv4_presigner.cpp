@@ -0,0 +1,119 @@
+#include "sigv4_presigner.hpp"
+
+#include <aws/core/utils/HashingUtils.h>
+
+#include <format>
+#include <utility>
+
+namespace {
+
+constexpr std::string_view ALGORITHM = "AWS4-HMAC-SHA256";
+constexpr std::string_view SERVICE = "s3";
+
+Aws::Utils::ByteBuffer to_buffer(std::string_view value) {
+  return Aws::Utils::ByteBuffer(
+      reinterpret_cast<const unsigned char *>(value.data()), value.size());
+}
+
+Aws::Utils::ByteBuffer hmac(const Aws::Utils::ByteBuffer &key,
+                            std::string_view data) {
+  return Aws::Utils::HashingUtils::CalculateSHA256HMAC(to_buffer(data), key);
+}
+
+// RFC 3986 encoding as required by SigV4, '/' kept for object key paths
+void uri_encode(std::string &out, std::string_view value, bool encode_slash) {
+  constexpr char hex[] = "0123456789ABCDEF";
+  for (unsigned char c : value) {
+    if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+        (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.' ||
+        c == '~' || (c == '/' && !encode_slash)) {
+      out += static_cast<char>(c);
+    } else {
+      out += '%';
+      out += hex[c >> 4];
+      out += hex[c & 0x0F];
+    }
+  }
+}
+
+}  // namespace
+
+SigV4Presigner::SigV4Presigner(std::string_view endpoint, std::string region,
+                               std::string access_key, std::string secret_key)
+    : region_(std::move(region)),
+      access_key_(std::move(access_key)),
+      secret_key_(std::move(secret_key)) {
+  while (endpoint.ends_with('/')) {
+    endpoint.remove_suffix(1);
+  }
+  const bool https = endpoint.starts_with("https://");
+  if (auto scheme_end = endpoint.find("://");
+      scheme_end != std::string_view::npos) {
+    endpoint.remove_prefix(scheme_end + 3);
+  }
+
+  // Default ports are not part of the signed host header
+  std::string_view host = endpoint;
+  if ((https && host.ends_with(":443")) || (!https && host.ends_with(":80"))) {
+    host = host.substr(0, host.rfind(':'));
+  }
+  host_ = host;
+  base_url_ = std::format("{}://{}", https ? "https" : "http", host_);
+}
+
+std::string SigV4Presigner::presign_get(
+    std::string_view bucket_name, std::string_view object_key,
+    long long expiration_sec, std::chrono::system_clock::time_point now) const {
+  const auto seconds = std::chrono::floor<std::chrono::seconds>(now);
+  const std::string amz_date = std::format("{:%Y%m%dT%H%M%SZ}", seconds);
+  const std::string date = amz_date.substr(0, 8);
+  const std::string scope =
+      std::format("{}/{}/{}/aws4_request", date, region_, SERVICE);
+
+  std::string path;
+  path.reserve(bucket_name.size() + object_key.size() + 16);
+  path += '/';
+  uri_encode(path, bucket_name, true);
+  path += '/';
+  uri_encode(path, object_key, false);
+
+  // Parameters are already in canonical (sorted) order
+  std::string query;
+  query.reserve(256);
+  query += "X-Amz-Algorithm=";
+  query += ALGORITHM;
+  query += "&X-Amz-Credential=";
+  uri_encode(query, std::format("{}/{}", access_key_, scope), true);
+  query += "&X-Amz-Date=";
+  query += amz_date;
+  query += "&X-Amz-Expires=";
+  query += std::to_string(expiration_sec);
+  query += "&X-Amz-SignedHeaders=host";
+
+  const std::string canonical_request =
+      std::format("GET\n{}\n{}\nhost:{}\n\nhost\nUNSIGNED-PAYLOAD", path,
+                  query, host_);
+  const auto canonical_hash = Aws::Utils::HashingUtils::HexEncode(
+      Aws::Utils::HashingUtils::CalculateSHA256(canonical_request));
+  const std::string string_to_sign = std::format(
+      "{}\n{}\n{}\n{}", ALGORITHM, amz_date, scope, canonical_hash);
+
+  const auto signature = Aws::Utils::HashingUtils::HexEncode(
+      hmac(signing_key(date), string_to_sign));
+
+  return std::format("{}{}?{}&X-Amz-Signature={}", base_url_, path, query,
+                     signature);
+}
+
+Aws::Utils::ByteBuffer SigV4Presigner::signing_key(
+    const std::string &date) const {
+  std::lock_guard<std::mutex> lock(key_mutex_);
+  if (key_date_ != date) {
+    auto key = hmac(to_buffer("AWS4" + secret_key_), date);
+    key = hmac(key, region_);
+    key = hmac(key, SERVICE);
+    key_ = hmac(key, "aws4_request");
+    key_date_ = date;
+  }
+  return key_;
+}
@@ -0,0 +1,45 @@
+#ifndef SIGV4_PRESIGNER_HPP
+#define SIGV4_PRESIGNER_HPP
+
+#include <aws/core/utils/Array.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Minimal AWS Signature V4 query string presigner for path style
+ * GET requests.
+ * The SDK rebuilds an HttpRequest and re-derives the signing key chain
+ * (4 HMACs) per URL. The signing key only depends on the secret, date,
+ * region and service, so it is derived once per UTC day here and every URL
+ * costs one SHA256 and one HMAC.
+ */
+class SigV4Presigner {
+ public:
+  SigV4Presigner(std::string_view endpoint, std::string region,
+                 std::string access_key, std::string secret_key);
+
+  std::string presign_get(std::string_view bucket_name,
+                          std::string_view object_key,
+                          long long expiration_sec,
+                          std::chrono::system_clock::time_point now =
+                              std::chrono::system_clock::now()) const;
+
+ private:
+  // Returns the signing key for date (YYYYMMDD), deriving it on day change
+  Aws::Utils::ByteBuffer signing_key(const std::string& date) const;
+
+  std::string base_url_;  // scheme://host[:port]
+  std::string host_;      // host[:port] as signed
+  std::string region_;
+  std::string access_key_;
+  std::string secret_key_;
+
+  mutable std::mutex key_mutex_;
+  mutable std::string key_date_;
+  mutable Aws::Utils::ByteBuffer key_;
+};
+
+#endif  // SIGV4_PRESIGNER_HPP
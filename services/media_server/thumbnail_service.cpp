@@ -0,0 +1,124 @@
+#include "thumbnail_service.hpp"
+
+#include <drogon/drogon.h>
+
+#include <algorithm>
+#include <format>
+#include <glaze/glaze.hpp>
+#include <vector>
+
+#include "../../config/config.hpp"
+#include "../../utilities/run_on_queue.hpp"
+#include "../../utilities/when_all.hpp"
+#include "../service_manager.hpp"
+#include "image_processing.hpp"
+
+ThumbnailService::ThumbnailService(S3Service &s3_service)
+    : s3_service_(s3_service),
+      workers_(static_cast<std::size_t>(
+                   std::max(config::get_config_int("thumbnail_threads", 2), 1)),
+               "ThumbnailWorkers"),
+      jobs_(static_cast<std::size_t>(
+          std::max(config::get_config_int("thumbnail_max_jobs", 4), 1))),
+      max_source_bytes_(std::max(
+          config::get_config_int("thumbnail_max_source_bytes", 20 << 20),
+          1)),
+      decode_limits_{
+          .max_side = std::max(
+              config::get_config_int("thumbnail_max_side", 16384), 1),
+          .max_pixels = std::max(
+              config::get_config_int("thumbnail_max_pixels", 40'000'000),
+              1)} {}
+
+bool ThumbnailService::is_supported(std::string_view mime_type) {
+  return mime_type == "image/jpeg" || mime_type == "image/png" ||
+         mime_type == "image/gif";
+}
+
+std::string ThumbnailService::variant_key(std::string_view object_key,
+                                          int size) {
+  if (object_key.starts_with("uploads/")) {
+    object_key.remove_prefix(std::string_view("uploads/").size());
+  }
+  return std::format("thumbnails/{}_{}.jpg", object_key, size);
+}
+
+void ThumbnailService::enqueue(std::string object_key, int64_t source_size,
+                               std::string_view mime_type) {
+  if (!is_supported(mime_type) || source_size <= 0 ||
+      source_size > max_source_bytes_) {
+    return;
+  }
+  drogon::app().getLoop()->queueInLoop(
+      [this, object_key = std::move(object_key)]() mutable {
+        drogon::async_run(
+            [this, object_key = std::move(object_key)]() -> drogon::Task<> {
+              co_await process(object_key);
+            });
+      });
+}
+
+drogon::Task<> ThumbnailService::process(std::string object_key) {
+  auto permit = co_await jobs_.acquire();
+  const std::string bucket_name(service::BUCKET_NAME);
+
+  try {
+    auto source = co_await s3_service_.get_object_range(
+        bucket_name, object_key, 0, max_source_bytes_ - 1);
+    if (!source || source->total_size > max_source_bytes_) {
+      co_return;
+    }
+
+    auto thumbnails = co_await utilities::run_on_queue(
+        workers_, [data = std::move(source->data), limits = decode_limits_]() {
+          return imaging::make_thumbnails(data, ThumbnailService::SIZES, 80,
+                                          limits);
+        });
+    if (thumbnails.empty()) {
+      LOG_WARN << "Could not decode " << object_key << " for thumbnails";
+      co_return;
+    }
+
+    std::vector<MediaVariant> variants;
+    std::vector<drogon::Task<bool>> uploads;
+    variants.reserve(thumbnails.size());
+    uploads.reserve(thumbnails.size());
+    for (auto &thumbnail : thumbnails) {
+      variants.emplace_back(MediaVariant{
+          .object_key = variant_key(object_key, thumbnail.max_side),
+          .width = thumbnail.width,
+          .height = thumbnail.height,
+          .size = static_cast<int64_t>(thumbnail.jpeg.size())});
+      uploads.emplace_back(
+          s3_service_.put_object(bucket_name, variants.back().object_key,
+                                 std::move(thumbnail.jpeg), "image/jpeg"));
+    }
+    auto uploaded = co_await utilities::when_all(std::move(uploads));
+
+    std::vector<MediaVariant> stored;
+    stored.reserve(variants.size());
+    for (size_t i = 0; i < variants.size(); ++i) {
+      if (uploaded[i]) {
+        stored.push_back(std::move(variants[i]));
+      }
+    }
+    if (stored.empty()) {
+      co_return;
+    }
+
+    co_await drogon::app().getDbClient()->execSqlCoro(
+        "UPDATE media SET metadata = COALESCE(metadata, '{}'::jsonb) || "
+        "jsonb_build_object('variants', $2::jsonb) "
+        "WHERE storage_key = $1",
+        object_key, glz::write_json(stored).value_or("[]"));
+
+    LOG_INFO << "Generated " << stored.size() << " thumbnails for "
+             << object_key;
+  } catch (const drogon::orm::DrogonDbException &e) {
+    LOG_ERROR << "Failed to record thumbnails for " << object_key << ": "
+              << e.base().what();
+  } catch (const std::exception &e) {
+    LOG_ERROR << "Thumbnail generation failed for " << object_key << ": "
+              << e.what();
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef THUMBNAIL_SERVICE_HPP
+#define THUMBNAIL_SERVICE_HPP
+
+#include <drogon/utils/coroutine.h>
+#include <trantor/utils/ConcurrentTaskQueue.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "../../utilities/async_semaphore.hpp"
+#include "image_processing.hpp"
+#include "media_variant.hpp"
+#include "s3_service.hpp"
+
+/**
+ * @brief Background thumbnail generation for verified image uploads.
+ * Each job downloads the source once, decodes and resizes it on a dedicated
+ * worker pool (never on the IO threads), uploads one JPEG per size under
+ * thumbnails/ and records them as MediaVariant in media.metadata->'variants'.
+ * Configurable through custom_config:
+ * - thumbnail_threads: worker pool size (default 2)
+ * - thumbnail_max_jobs: jobs processed at once, bounds memory (default 4)
+ * - thumbnail_max_source_bytes: larger sources are skipped (default 20 MiB)
+ * - thumbnail_max_side, thumbnail_max_pixels: sources declaring larger
+ *   dimensions are skipped before decoding (default 16384 and 40000000)
+ */
+class ThumbnailService {
+ public:
+  // Longest side in pixels of every generated variant
+  static constexpr std::array<int, 3> SIZES = {640, 320, 160};
+
+  explicit ThumbnailService(S3Service& s3_service);
+
+  static bool is_supported(std::string_view mime_type);
+
+  // thumbnails/<uploaded name>_<size>.jpg
+  static std::string variant_key(std::string_view object_key, int size);
+
+  // Schedules a job and returns immediately
+  void enqueue(std::string object_key, int64_t source_size,
+               std::string_view mime_type);
+
+ private:
+  drogon::Task<> process(std::string object_key);
+
+  S3Service& s3_service_;
+  trantor::ConcurrentTaskQueue workers_;
+  utilities::AsyncSemaphore jobs_;
+  int64_t max_source_bytes_;
+  imaging::DecodeLimits decode_limits_;
+};
+
+#endif  // THUMBNAIL_SERVICE_HPP
@@ -0,0 +1,74 @@
+#include "offer_access_cache.hpp"
+
+#include <drogon/drogon.h>
+
+#include <algorithm>
+
+OfferAccessCache::OfferAccessCache(std::chrono::milliseconds ttl)
+    : ttl_(std::max(ttl, std::chrono::milliseconds::zero())) {}
+
+drogon::Task<std::optional<OfferParticipants>> OfferAccessCache::get(
+    int offer_id) {
+  if (auto cached = lookup(offer_id)) {
+    co_return cached;
+  }
+
+  const auto generation = generation_.load(std::memory_order_acquire);
+  auto result = co_await drogon::app().getDbClient()->execSqlCoro(
+      "SELECT o.user_id, o.status, p.user_id AS post_user_id "
+      "FROM offers o "
+      "JOIN posts p ON o.post_id = p.id "
+      "WHERE o.id = $1",
+      offer_id);
+  if (result.empty()) {
+    co_return std::nullopt;
+  }
+
+  OfferParticipants participants{
+      .offer_id = offer_id,
+      .buyer_id = result[0]["post_user_id"].as<int>(),
+      .seller_id = result[0]["user_id"].as<int>(),
+      .status = result[0]["status"].as<std::string>()};
+  store(participants, generation);
+  co_return participants;
+}
+
+void OfferAccessCache::invalidate(int offer_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  generation_.fetch_add(1, std::memory_order_acq_rel);
+  entries_.erase(offer_id);
+}
+
+std::optional<OfferParticipants> OfferAccessCache::lookup(int offer_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(offer_id);
+  if (it == entries_.end()) {
+    return std::nullopt;
+  }
+  if (std::chrono::steady_clock::now() >= it->second.expires_at) {
+    entries_.erase(it);
+    return std::nullopt;
+  }
+  return it->second.participants;
+}
+
+void OfferAccessCache::store(const OfferParticipants& participants,
+                             std::uint64_t generation) {
+  if (ttl_ == std::chrono::milliseconds::zero()) {
+    return;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  // An invalidation during the load may have been for this offer. Checked
+  // under the lock invalidate() holds, so none can slip in before the insert.
+  if (generation_.load(std::memory_order_acquire) != generation) {
+    return;
+  }
+  entries_.insert_or_assign(participants.offer_id,
+                            Entry{.participants = participants,
+                                  .expires_at = now + ttl_});
+  // The map only holds recently checked offers
+  pruner_.after_insert(entries_, [now](const auto& entry) {
+    return entry.second.expires_at <= now;
+  });
+}
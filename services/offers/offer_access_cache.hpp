@@ -0,0 +1,70 @@
+#ifndef OFFER_ACCESS_CACHE_HPP
+#define OFFER_ACCESS_CACHE_HPP
+
+#include <ankerl/unordered_dense.h>
+#include <drogon/utils/coroutine.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "../../utilities/expiry_pruner.hpp"
+
+// Who may act on an offer: the post owner buys, the offer creator sells
+struct OfferParticipants {
+  int offer_id = 0;
+  int buyer_id = 0;   // post owner
+  int seller_id = 0;  // offer creator
+  std::string status;  // pending, accepted or rejected, never back to pending
+
+  bool is_participant(int user_id) const {
+    return user_id == buyer_id || user_id == seller_id;
+  }
+};
+
+/**
+ * @brief Short-TTL cache of offer participants for authorization checks.
+ * Participants never change once an offer exists, so a cached entry can
+ * only go stale on its status. Handlers changing an offer's status call
+ * invalidate() once the change is committed, other instances catch up
+ * within the TTL; a stale status is always pending, so checks on it can only
+ * be too lenient. A load racing with an invalidation is served but not
+ * stored. Offers that do not exist are not cached.
+ * Configurable through custom_config:
+ * - offer_access_cache_ttl_ms: entry lifetime, 0 disables caching
+ *   (default 5000)
+ */
+class OfferAccessCache {
+ public:
+  explicit OfferAccessCache(std::chrono::milliseconds ttl);
+
+  // Participants of offer_id, std::nullopt if there is no such offer.
+  // Database errors propagate as DrogonDbException.
+  drogon::Task<std::optional<OfferParticipants>> get(int offer_id);
+
+  void invalidate(int offer_id);
+
+ private:
+  struct Entry {
+    OfferParticipants participants;
+    std::chrono::steady_clock::time_point expires_at;
+  };
+
+  std::optional<OfferParticipants> lookup(int offer_id);
+  // Skipped when an invalidation happened since the load started at
+  // generation
+  void store(const OfferParticipants& participants,
+             std::uint64_t generation);
+
+  const std::chrono::milliseconds ttl_;
+  std::atomic<std::uint64_t> generation_{0};  // changed under mutex_
+
+  std::mutex mutex_;
+  ankerl::unordered_dense::map<int, Entry> entries_;
+  utilities::ExpiryPruner pruner_;
+};
+
+#endif  // OFFER_ACCESS_CACHE_HPP
@@ -4,7 +4,15 @@
 #include <memory>
 #include <zmq.hpp>
 
+#include "../config/config.hpp"
+#include "./compression/response_compressor.hpp"
+#include "./location/cluster_service.hpp"
+#include "./location/geo_grid_index.hpp"
+#include "./location/location_ingest_service.hpp"
+#include "./media_server/media_info_cache.hpp"
 #include "./media_server/s3_service.hpp"
+#include "./media_server/thumbnail_service.hpp"
+#include "./offers/offer_access_cache.hpp"
 #include "./subber/connection_manager.hpp"
 #include "./subber/pub_manager.hpp"
 #include "./subber/sub_manager.hpp"
@@ -31,6 +39,17 @@ class ServiceManager {
   SubManager& get_subscriber() { return *subscriber_; }
   ConnectionManager& get_connection_manager() { return *conn_mgr_; }
   S3Service& get_s3_service() { return *s3_service_; }
+  MediaInfoCache& get_media_info_cache() { return *media_info_cache_; }
+  ThumbnailService& get_thumbnail_service() { return *thumbnail_service_; }
+  GeoGridIndex& get_location_index() { return *location_index_; }
+  ClusterService& get_cluster_service() { return *cluster_service_; }
+  LocationIngestService& get_location_ingest_service() {
+    return *location_ingest_service_;
+  }
+  OfferAccessCache& get_offer_access_cache() { return *offer_access_cache_; }
+  ResponseCompressor& get_response_compressor() {
+    return *response_compressor_;
+  }
 
   void initialize() {
     context_ = std::make_unique<zmq::context_t>(1);
@@ -42,6 +61,24 @@ class ServiceManager {
     Aws::SDKOptions options;
     Aws::InitAPI(options);
     s3_service_ = std::make_unique<S3Service>();
+    media_info_cache_ = std::make_unique<MediaInfoCache>(
+        *s3_service_,
+        static_cast<std::size_t>(
+            std::max(config::get_config_int("media_cache_capacity", 10000), 1)),
+        std::chrono::milliseconds(
+            config::get_config_int("media_cache_negative_ttl_ms", 2000)));
+    thumbnail_service_ = std::make_unique<ThumbnailService>(*s3_service_);
+    location_index_ = std::make_unique<GeoGridIndex>(
+        config::get_config_int("location_index_cell_m", 1000));
+    cluster_service_ = std::make_unique<ClusterService>();
+    cluster_service_->start();
+    location_ingest_service_ = std::make_unique<LocationIngestService>(
+        *cluster_service_, *location_index_);
+    location_ingest_service_->start();
+    offer_access_cache_ =
+        std::make_unique<OfferAccessCache>(std::chrono::milliseconds(
+            config::get_config_int("offer_access_cache_ttl_ms", 5000)));
+    response_compressor_ = std::make_unique<ResponseCompressor>();
 
     // // Redis PubSub option:
     // conn_mgr_ = std::make_unique<ConnectionManager>();
@@ -72,6 +109,13 @@ class ServiceManager {
   std::unique_ptr<PubManager> publisher_;
   std::unique_ptr<SubManager> subscriber_;
   std::unique_ptr<S3Service> s3_service_;
+  std::unique_ptr<MediaInfoCache> media_info_cache_;
+  std::unique_ptr<ThumbnailService> thumbnail_service_;
+  std::unique_ptr<GeoGridIndex> location_index_;
+  std::unique_ptr<ClusterService> cluster_service_;
+  std::unique_ptr<LocationIngestService> location_ingest_service_;
+  std::unique_ptr<OfferAccessCache> offer_access_cache_;
+  std::unique_ptr<ResponseCompressor> response_compressor_;
 };
 
 #endif  // SERVICE_MANAGER_HPP
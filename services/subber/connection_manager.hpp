@@ -5,6 +5,8 @@
 #include <drogon/WebSocketConnection.h>
 #include <drogon/drogon.h>
 
+#include <chrono>
+#include <cstdint>
 #include <format>
 #include <mutex>
 #include <string>
@@ -13,6 +15,7 @@
 
 #include "../../controllers/common_req_n_resp.hpp"
 #include "../../utilities/json_manipulation.hpp"
+#include "../../utilities/metrics.hpp"
 
 
 // enum class notification_type : uint8_t {}
@@ -193,18 +196,49 @@ class ConnectionManager {
   }
 
   void broadcast(const std::string &topic, const std::string &message) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (const auto &conn_id : subscribers_[topic]) {
-      auto it = connections_.find(conn_id);
-      if (it != connections_.end()) {
-        // store notification in DB
-        store_notification_in_db(conn_id, message);
-        // send notification
-        for (auto &conn : it->second) {
-          conn->send(message);
+    auto &fanout = utilities::Metrics::get_instance().broadcast();
+    const auto start = std::chrono::steady_clock::now();
+    std::uint64_t deliveries = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (const auto &conn_id : subscribers_[topic]) {
+        auto it = connections_.find(conn_id);
+        if (it != connections_.end()) {
+          // store notification in DB
+          store_notification_in_db(conn_id, message);
+          // send notification
+          for (auto &conn : it->second) {
+            conn->send(message);
+            ++deliveries;
+          }
         }
       }
     }
+    fanout.messages.add();
+    fanout.deliveries.add(deliveries);
+    fanout.latency.record(std::chrono::steady_clock::now() - start);
+  }
+
+  struct Stats {
+    std::size_t connections = 0;
+    std::size_t users = 0;   // with at least one open connection
+    std::size_t topics = 0;  // with at least one subscriber
+    std::size_t subscriptions = 0;
+  };
+
+  // For the admin listener's gauges
+  Stats stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    for (const auto &[conn_id, conns] : connections_) {
+      stats.users += conns.empty() ? 0 : 1;
+      stats.connections += conns.size();
+    }
+    for (const auto &[topic, ids] : subscribers_) {
+      stats.topics += ids.empty() ? 0 : 1;
+      stats.subscriptions += ids.size();
+    }
+    return stats;
   }
 
  private:
@@ -280,6 +280,20 @@ DROGON_TEST(ChatsTest) {
   int offer_conversation_id =
       (*get_conv_by_offer_json)["conversation_id"].asInt();
 
+  // The other party of the offer gets the same conversation back
+  auto other_party_conv_req = drogon::HttpRequest::newHttpRequest();
+  other_party_conv_req->setMethod(drogon::Get);
+  other_party_conv_req->setPath("/api/v1/conversations/offer/" +
+                                std::to_string(offer_id));
+  other_party_conv_req->addHeader("Authorization", "Bearer " + token2);
+
+  auto other_party_conv_resp = client->sendRequest(other_party_conv_req);
+  REQUIRE(other_party_conv_resp.second->getStatusCode() == drogon::k200OK);
+  auto other_party_conv_json = other_party_conv_resp.second->getJsonObject();
+  CHECK((*other_party_conv_json)["conversation_id"].asInt() ==
+        offer_conversation_id);
+  CHECK((*other_party_conv_json)["is_new"].asBool() == false);
+
   // Test 11: Send a message in the offer conversation
   Json::Value offer_msg_json;
   offer_msg_json["content"] = "I'm interested in your offer!";
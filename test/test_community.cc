@@ -2,10 +2,50 @@
 #include <drogon/drogon_test.h>
 #include <drogon/utils/Utilities.h>
 
+#include <chrono>
+#include <glaze/glaze.hpp>
 #include <string>
+#include <thread>
 
 #include "helpers.hpp"
 
+namespace {
+
+// The fields of Community's post bodies checked below
+struct BevePost {
+  int id;
+  int user_id;
+  std::string content;
+};
+
+drogon::HttpResponsePtr get_popular_tags(const drogon::HttpClientPtr& client,
+                                         const std::string& token,
+                                         const std::string& accept_encoding) {
+  auto req = drogon::HttpRequest::newHttpRequest();
+  req->setMethod(drogon::Get);
+  req->setPath("/api/v1/posts/tags");
+  req->addHeader("Authorization", "Bearer " + token);
+  if (!accept_encoding.empty()) {
+    req->addHeader("Accept-Encoding", accept_encoding);
+  }
+  return client->sendRequest(req).second;
+}
+
+bool has_tag(const drogon::HttpResponsePtr& resp, const std::string& name) {
+  auto json = resp->getJsonObject();
+  if (!json || !json->isArray()) {
+    return false;
+  }
+  for (const auto& tag : *json) {
+    if (tag["name"].asString() == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
 DROGON_TEST(CommunityTest) {
   auto db_client = drogon::app().getDbClient();
 
@@ -711,5 +751,111 @@ DROGON_TEST(CommunityTest) {
 
   pagination_post_ids.push_back(special_chars_post_id);
 
+  // Test 29: BEVE bodies for clients that ask for them, JSON otherwise
+  auto get_beve_req = drogon::HttpRequest::newHttpRequest();
+  get_beve_req->setMethod(drogon::Get);
+  get_beve_req->setPath("/api/v1/posts/" +
+                        std::to_string(special_chars_post_id));
+  get_beve_req->addHeader("Authorization", "Bearer " + token1);
+  get_beve_req->addHeader("Accept", "application/x-beve");
+
+  auto get_beve_resp = client->sendRequest(get_beve_req);
+  CHECK(get_beve_resp.second->getStatusCode() == drogon::k200OK);
+  CHECK(get_beve_resp.second->getHeader("content-type") ==
+        "application/x-beve");
+  CHECK(get_beve_resp.second->getHeader("vary") == "Accept");
+
+  BevePost beve_post{};
+  auto beve_error =
+      glz::read<glz::opts{.format = glz::BEVE, .error_on_unknown_keys = false}>(
+          beve_post, std::string(get_beve_resp.second->getBody()));
+  CHECK(!beve_error);
+  CHECK(beve_post.id == special_chars_post_id);
+  CHECK(beve_post.user_id == user1_id);
+  CHECK(beve_post.content ==
+        "Special characters: !@#$%^&*()_+{}|:<>?~`-=[]\\;',./");
+
+  auto get_json_fallback_req = drogon::HttpRequest::newHttpRequest();
+  get_json_fallback_req->setMethod(drogon::Get);
+  get_json_fallback_req->setPath("/api/v1/posts");
+  get_json_fallback_req->addHeader("Authorization", "Bearer " + token1);
+  get_json_fallback_req->addHeader("Accept",
+                                   "application/x-beve;q=0, */*;q=0.8");
+
+  auto get_json_fallback_resp = client->sendRequest(get_json_fallback_req);
+  CHECK(get_json_fallback_resp.second->getStatusCode() == drogon::k200OK);
+  auto get_json_fallback_json =
+      get_json_fallback_resp.second->getJsonObject();
+  REQUIRE(get_json_fallback_json != nullptr);
+  CHECK(get_json_fallback_json->isArray());
+
+  // Test 30: Listings are compressed with the coding the client accepts
+  auto get_zstd_req = drogon::HttpRequest::newHttpRequest();
+  get_zstd_req->setMethod(drogon::Get);
+  get_zstd_req->setPath("/api/v1/posts");
+  get_zstd_req->addHeader("Authorization", "Bearer " + token1);
+  get_zstd_req->addHeader("Accept-Encoding", "gzip;q=0.5, zstd");
+
+  auto get_zstd_resp = client->sendRequest(get_zstd_req);
+  CHECK(get_zstd_resp.second->getStatusCode() == drogon::k200OK);
+  CHECK(get_zstd_resp.second->getHeader("content-encoding") == "zstd");
+  CHECK(get_zstd_resp.second->getHeader("vary").find("Accept-Encoding") !=
+        std::string::npos);
+
+  // Test 31: Popular tags are served from the cache, compressed variants
+  // included, until popular_tags_cache_ttl_ms (2000 in test_config.json)
+  // runs out
+  const auto tags_ttl = std::chrono::milliseconds(2100);
+  Json::Value padding_post_json;
+  padding_post_json["content"] = "Post whose tags make the tags body compress";
+  padding_post_json["tags"] = Json::Value(Json::arrayValue);
+  for (int i = 0; i < 8; ++i) {
+    padding_post_json["tags"].append("popular-tags-cache-padding-" +
+                                     std::to_string(i));
+  }
+  padding_post_json["location"] = "Test Location";
+  padding_post_json["is_product_request"] = false;
+  auto padding_post_req =
+      drogon::HttpRequest::newHttpJsonRequest(padding_post_json);
+  padding_post_req->setMethod(drogon::Post);
+  padding_post_req->setPath("/api/v1/posts");
+  padding_post_req->addHeader("Authorization", "Bearer " + token1);
+  CHECK(client->sendRequest(padding_post_req).second->getStatusCode() ==
+        drogon::k200OK);
+
+  // Whatever Test 10 cached expires
+  std::this_thread::sleep_for(tags_ttl);
+  auto cached_tags = get_popular_tags(client, token1, "");
+  REQUIRE(cached_tags->getStatusCode() == drogon::k200OK);
+  CHECK(has_tag(cached_tags, "popular-tags-cache-padding-0"));
+
+  auto zstd_tags = get_popular_tags(client, token1, "zstd");
+  auto zstd_tags_again = get_popular_tags(client, token1, "zstd");
+  CHECK(zstd_tags->getHeader("content-encoding") == "zstd");
+  CHECK(zstd_tags_again->getHeader("content-encoding") == "zstd");
+  CHECK(zstd_tags->getBody() == zstd_tags_again->getBody());
+
+  Json::Value new_tag_post_json;
+  new_tag_post_json["content"] = "Post with a tag the cached body lacks";
+  new_tag_post_json["tags"] = Json::Value(Json::arrayValue);
+  new_tag_post_json["tags"].append("popular-tags-cache-new");
+  new_tag_post_json["location"] = "Test Location";
+  new_tag_post_json["is_product_request"] = false;
+  auto new_tag_post_req =
+      drogon::HttpRequest::newHttpJsonRequest(new_tag_post_json);
+  new_tag_post_req->setMethod(drogon::Post);
+  new_tag_post_req->setPath("/api/v1/posts");
+  new_tag_post_req->addHeader("Authorization", "Bearer " + token1);
+  CHECK(client->sendRequest(new_tag_post_req).second->getStatusCode() ==
+        drogon::k200OK);
+
+  auto still_cached_tags = get_popular_tags(client, token1, "");
+  CHECK(still_cached_tags->getBody() == cached_tags->getBody());
+  CHECK(!has_tag(still_cached_tags, "popular-tags-cache-new"));
+
+  std::this_thread::sleep_for(tags_ttl);
+  auto refreshed_tags = get_popular_tags(client, token1, "");
+  CHECK(has_tag(refreshed_tags, "popular-tags-cache-new"));
+
   helpers::cleanup_db();
 }
@@ -141,5 +141,54 @@ DROGON_TEST(DashboardTest) {
     CHECK(updated_orders_data2["in_progress"].asInt() >= 1);
   }
 
+  // Test 4: Metrics are only served on the admin listener (test config
+  // admin_port)
+  auto get_metrics_req = drogon::HttpRequest::newHttpRequest();
+  get_metrics_req->setMethod(drogon::Get);
+  get_metrics_req->setPath("/metrics");
+
+  auto get_public_metrics_resp = client->sendRequest(get_metrics_req);
+  CHECK(get_public_metrics_resp.second->getStatusCode() ==
+        drogon::k404NotFound);
+
+  auto admin_client =
+      drogon::HttpClient::newHttpClient("http://127.0.0.1:9465");
+  auto get_metrics_resp = admin_client->sendRequest(get_metrics_req);
+  CHECK(get_metrics_resp.second->getStatusCode() == drogon::k200OK);
+  const std::string metrics(get_metrics_resp.second->getBody());
+  CHECK(metrics.find("buyer_http_request_duration_seconds_count{method=\"GET\","
+                     "route=\"/api/v1/dashboard\"} ") != std::string::npos);
+  CHECK(metrics.find("buyer_ws_connections ") != std::string::npos);
+
+  // Test 5: The test config samples every request's DB trace
+  auto get_traces_req = drogon::HttpRequest::newHttpRequest();
+  get_traces_req->setMethod(drogon::Get);
+  get_traces_req->setPath("/traces");
+
+  auto get_public_traces_resp = client->sendRequest(get_traces_req);
+  CHECK(get_public_traces_resp.second->getStatusCode() ==
+        drogon::k404NotFound);
+
+  auto get_traces_resp = admin_client->sendRequest(get_traces_req);
+  CHECK(get_traces_resp.second->getStatusCode() == drogon::k200OK);
+  const std::string traces(get_traces_resp.second->getBody());
+  CHECK(traces.find("\"path\":\"/api/v1/dashboard\"") != std::string::npos);
+  CHECK(traces.find("\"kind\":\"statement\"") != std::string::npos);
+
+  // Test 6: Probes for notification_bench need a topic and a seq
+  auto publish_req = drogon::HttpRequest::newHttpRequest();
+  publish_req->setMethod(drogon::Post);
+  publish_req->setPath("/publish");
+  publish_req->setParameter("topic", "dashboard-test-probe");
+
+  auto publish_no_seq_resp = admin_client->sendRequest(publish_req);
+  CHECK(publish_no_seq_resp.second->getStatusCode() == drogon::k400BadRequest);
+
+  publish_req->setParameter("seq", "1");
+  auto public_publish_resp = client->sendRequest(publish_req);
+  CHECK(public_publish_resp.second->getStatusCode() == drogon::k404NotFound);
+  auto publish_resp = admin_client->sendRequest(publish_req);
+  CHECK(publish_resp.second->getStatusCode() == drogon::k200OK);
+
   helpers::cleanup_db();
 }
\ No newline at end of file
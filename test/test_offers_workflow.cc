@@ -328,6 +328,16 @@ DROGON_TEST(OffersWorkflowTest) {
   }
   CHECK(found_updated_offer);
 
+  // Test 12: The accepted offer can no longer be negotiated
+  negotiate_req = drogon::HttpRequest::newHttpJsonRequest(negotiate_json);
+  negotiate_req->setMethod(drogon::Post);
+  negotiate_req->setPath("/api/v1/offers/" + std::to_string(offer_id) +
+                         "/negotiate");
+  negotiate_req->addHeader("Authorization", "Bearer " + token1);
+
+  negotiate_resp = client->sendRequest(negotiate_req);
+  CHECK(negotiate_resp.second->getStatusCode() == drogon::k400BadRequest);
+
   // -------------------------
   // New Post with More Offers and Negotiations
   // -------------------------
@@ -694,5 +704,62 @@ DROGON_TEST(OffersWorkflowTest) {
 
   get_offers_req = drogon::HttpRequest::newHttpRequest();
 
+  // Test 29: Page through the offers user2 received, the accepted and the
+  // rejected offer share updated_at so the higher id comes first
+  auto get_received_req = drogon::HttpRequest::newHttpRequest();
+  get_received_req->setMethod(drogon::Get);
+  get_received_req->setPath("/api/v1/offers/received");
+  get_received_req->setParameter("limit", "1");
+  get_received_req->addHeader("Authorization", "Bearer " + token2);
+
+  auto get_received_resp = client->sendRequest(get_received_req);
+  REQUIRE(get_received_resp.second->getStatusCode() == drogon::k200OK);
+
+  auto get_received_resp_json = get_received_resp.second->getJsonObject();
+  REQUIRE((*get_received_resp_json)["offers"].size() == 1);
+  CHECK((*get_received_resp_json)["offers"][0]["id"].asInt() ==
+        ignored_offer_id);
+  REQUIRE((*get_received_resp_json)["next_cursor"].isString());
+
+  get_received_req = drogon::HttpRequest::newHttpRequest();
+  get_received_req->setMethod(drogon::Get);
+  get_received_req->setPath("/api/v1/offers/received");
+  get_received_req->setParameter("limit", "1");
+  get_received_req->setParameter(
+      "cursor", (*get_received_resp_json)["next_cursor"].asString());
+  get_received_req->addHeader("Authorization", "Bearer " + token2);
+
+  get_received_resp = client->sendRequest(get_received_req);
+  REQUIRE(get_received_resp.second->getStatusCode() == drogon::k200OK);
+
+  get_received_resp_json = get_received_resp.second->getJsonObject();
+  REQUIRE((*get_received_resp_json)["offers"].size() == 1);
+  CHECK((*get_received_resp_json)["offers"][0]["id"].asInt() == offer_id);
+  CHECK(!get_received_resp_json->isMember("next_cursor"));
+
+  // Test 30: Status filters, user3's only offer was rejected
+  auto get_my_offers = [&](const std::string& status) {
+    auto get_my_offers_req = drogon::HttpRequest::newHttpRequest();
+    get_my_offers_req->setMethod(drogon::Get);
+    get_my_offers_req->setPath("/api/v1/offers/my-offers");
+    get_my_offers_req->setParameter("status", status);
+    get_my_offers_req->addHeader("Authorization", "Bearer " + token3);
+    return client->sendRequest(get_my_offers_req);
+  };
+
+  auto get_my_offers_resp = get_my_offers("pending,accepted");
+  REQUIRE(get_my_offers_resp.second->getStatusCode() == drogon::k200OK);
+  CHECK((*get_my_offers_resp.second->getJsonObject())["offers"].empty());
+
+  get_my_offers_resp = get_my_offers("rejected");
+  REQUIRE(get_my_offers_resp.second->getStatusCode() == drogon::k200OK);
+  auto get_my_offers_resp_json = get_my_offers_resp.second->getJsonObject();
+  REQUIRE((*get_my_offers_resp_json)["offers"].size() == 1);
+  CHECK((*get_my_offers_resp_json)["offers"][0]["id"].asInt() ==
+        ignored_offer_id);
+
+  get_my_offers_resp = get_my_offers("unknown");
+  CHECK(get_my_offers_resp.second->getStatusCode() == drogon::k400BadRequest);
+
   helpers::cleanup_db();
 }
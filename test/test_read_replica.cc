@@ -0,0 +1,156 @@
+#include <drogon/HttpClient.h>
+#include <drogon/drogon_test.h>
+#include <drogon/utils/Utilities.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "helpers.hpp"
+
+namespace {
+
+// Resumes WAL replay on the replica however the test exits, later tests
+// read through it
+struct ReplayResumer {
+  drogon::orm::DbClientPtr replica;
+
+  ~ReplayResumer() {
+    try {
+      replica->execSqlSync("SELECT pg_wal_replay_resume()");
+    } catch (const drogon::orm::DrogonDbException& e) {
+      LOG_ERROR << "Resuming replay failed: " << e.base().what();
+    }
+  }
+};
+
+std::string register_user(const drogon::HttpClientPtr& client,
+                          const std::string& username) {
+  Json::Value register_json;
+  register_json["username"] = username;
+  register_json["email"] = username + "@example.com";
+  register_json["password"] = "password123";
+  auto register_req = drogon::HttpRequest::newHttpJsonRequest(register_json);
+  register_req->setMethod(drogon::Post);
+  register_req->setPath("/api/v1/auth/register");
+
+  auto register_resp = client->sendRequest(register_req);
+  if (register_resp.second->getStatusCode() != drogon::k200OK) {
+    return "";
+  }
+  return (*register_resp.second->getJsonObject())["token"].asString();
+}
+
+// Ids of the posts GET /api/v1/posts returns to the token's user
+std::vector<int> visible_posts(const drogon::HttpClientPtr& client,
+                               const std::string& token) {
+  auto get_posts_req = drogon::HttpRequest::newHttpRequest();
+  get_posts_req->setMethod(drogon::Get);
+  get_posts_req->setPath("/api/v1/posts");
+  get_posts_req->addHeader("Authorization", "Bearer " + token);
+
+  auto get_posts_resp = client->sendRequest(get_posts_req);
+  std::vector<int> ids;
+  if (get_posts_resp.second->getStatusCode() != drogon::k200OK) {
+    return ids;
+  }
+  for (const auto& post : *get_posts_resp.second->getJsonObject()) {
+    ids.push_back(post["id"].asInt());
+  }
+  return ids;
+}
+
+bool contains(const std::vector<int>& ids, int id) {
+  return std::find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+}  // namespace
+
+// Needs the postgres-test-replica service of docker-compose.test.yml and the
+// "replica" db client of test_config.json
+DROGON_TEST(ReadReplicaTest) {
+  auto db_client = drogon::app().getDbClient();
+  auto replica_client = drogon::app().getDbClient("replica");
+
+  helpers::cleanup_db();
+
+  // The replica is a hot standby of the test database
+  auto standby = replica_client->execSqlSync(
+      "SELECT pg_is_in_recovery() AS standby, current_database() AS db");
+  REQUIRE(standby.size() == 1);
+  CHECK(standby[0]["standby"].as<bool>());
+  CHECK(standby[0]["db"].as<std::string>() == "buyer_app_test");
+  CHECK_THROWS(replica_client->execSqlSync(
+      "INSERT INTO posts (user_id, content) VALUES (1, 'read only')"));
+
+  auto client = drogon::HttpClient::newHttpClient("http://127.0.0.1:5555");
+
+  // Registering is anonymous, neither user is sticky yet
+  std::string writer_token = register_user(client, "testreplica1");
+  std::string reader_token = register_user(client, "testreplica2");
+  REQUIRE(!writer_token.empty());
+  REQUIRE(!reader_token.empty());
+
+  // With replay paused the replica never sees the new posts, so only reads
+  // routed to the primary can return them. Replay stops before the next WAL
+  // record once the pause is requested.
+  replica_client->execSqlSync("SELECT pg_wal_replay_pause()");
+  ReplayResumer resumer{replica_client};
+
+  std::vector<int> post_ids;
+  for (int i = 0; i < 5; ++i) {
+    Json::Value create_post_json;
+    create_post_json["content"] = "Replica test post " + std::to_string(i);
+    create_post_json["tags"] = Json::Value(Json::arrayValue);
+    create_post_json["tags"].append("replica");
+    create_post_json["location"] = "Test Location";
+    create_post_json["is_product_request"] = false;
+
+    auto create_post_req =
+        drogon::HttpRequest::newHttpJsonRequest(create_post_json);
+    create_post_req->setMethod(drogon::Post);
+    create_post_req->setPath("/api/v1/posts");
+    create_post_req->addHeader("Authorization", "Bearer " + writer_token);
+
+    auto create_post_resp = client->sendRequest(create_post_req);
+    REQUIRE(create_post_resp.second->getStatusCode() == drogon::k200OK);
+    post_ids.push_back(
+        (*create_post_resp.second->getJsonObject())["post_id"].asInt());
+
+    // The writer reads their own writes from the primary
+    CHECK(contains(visible_posts(client, writer_token), post_ids.back()));
+  }
+
+  // Other users still read from the replica
+  auto reader_posts = visible_posts(client, reader_token);
+  for (int post_id : post_ids) {
+    CHECK(!contains(reader_posts, post_id));
+  }
+
+  // Once the sticky window has passed the writer reads from the replica too
+  const int sticky_ms =
+      drogon::app().getCustomConfig().get("db_replica_sticky_ms", 2000).asInt();
+  std::this_thread::sleep_for(std::chrono::milliseconds(sticky_ms + 500));
+  CHECK(!contains(visible_posts(client, writer_token), post_ids.back()));
+
+  // Primary writes reach the replica once replay resumes
+  replica_client->execSqlSync("SELECT pg_wal_replay_resume()");
+  auto user_result = db_client->execSqlSync(
+      "SELECT id FROM users WHERE username = 'testreplica1'");
+  REQUIRE(user_result.size() == 1);
+  int replicated = 0;
+  for (int attempt = 0; attempt < 50 && replicated < 5; ++attempt) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    replicated = replica_client
+                     ->execSqlSync(
+                         "SELECT COUNT(*) AS count FROM posts "
+                         "WHERE user_id = $1",
+                         user_result[0]["id"].as<int>())[0]["count"]
+                     .as<int>();
+  }
+  CHECK(replicated == 5);
+
+  helpers::cleanup_db();
+}
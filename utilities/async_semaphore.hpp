@@ -0,0 +1,117 @@
+#ifndef ASYNC_SEMAPHORE_HPP
+#define ASYNC_SEMAPHORE_HPP
+
+#include <trantor/net/EventLoop.h>
+
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+namespace utilities {
+
+/**
+ * @brief Counting semaphore for coroutines.
+ * co_await acquire() suspends (without blocking the event loop thread) when
+ * no permit is available. Waiters are resumed in FIFO order on the event loop
+ * they were suspended on.
+ *
+ * @code
+ * auto permit = co_await semaphore.acquire();
+ * // ... permit is released when it goes out of scope
+ * @endcode
+ */
+class AsyncSemaphore {
+ public:
+  class Permit {
+   public:
+    Permit() = default;
+    explicit Permit(AsyncSemaphore *semaphore) : semaphore_(semaphore) {}
+    Permit(Permit &&other) noexcept
+        : semaphore_(std::exchange(other.semaphore_, nullptr)) {}
+    Permit &operator=(Permit &&other) noexcept {
+      if (this != &other) {
+        release();
+        semaphore_ = std::exchange(other.semaphore_, nullptr);
+      }
+      return *this;
+    }
+    Permit(const Permit &) = delete;
+    Permit &operator=(const Permit &) = delete;
+    ~Permit() { release(); }
+
+    void release() {
+      if (semaphore_) {
+        std::exchange(semaphore_, nullptr)->release();
+      }
+    }
+
+   private:
+    AsyncSemaphore *semaphore_ = nullptr;
+  };
+
+  class Awaiter {
+   public:
+    explicit Awaiter(AsyncSemaphore &semaphore) : semaphore_(semaphore) {}
+    bool await_ready() const noexcept { return false; }
+    // returns false (do not suspend) if a permit was taken immediately
+    bool await_suspend(std::coroutine_handle<> handle) {
+      std::lock_guard<std::mutex> lock(semaphore_.mutex_);
+      if (semaphore_.available_ > 0) {
+        --semaphore_.available_;
+        return false;
+      }
+      semaphore_.waiters_.emplace_back(
+          handle, trantor::EventLoop::getEventLoopOfCurrentThread());
+      return true;
+    }
+    Permit await_resume() noexcept { return Permit{&semaphore_}; }
+
+   private:
+    AsyncSemaphore &semaphore_;
+  };
+
+  explicit AsyncSemaphore(std::size_t permits) : available_(permits) {}
+
+  AsyncSemaphore(const AsyncSemaphore &) = delete;
+  AsyncSemaphore &operator=(const AsyncSemaphore &) = delete;
+
+  [[nodiscard]] Awaiter acquire() { return Awaiter{*this}; }
+
+  std::size_t waiting() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return waiters_.size();
+  }
+
+ private:
+  // Hands the permit directly to the oldest waiter if there is one
+  void release() {
+    std::coroutine_handle<> handle;
+    trantor::EventLoop *loop = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (waiters_.empty()) {
+        ++available_;
+        return;
+      }
+      std::tie(handle, loop) = waiters_.front();
+      waiters_.pop_front();
+    }
+    if (loop) {
+      loop->queueInLoop([handle]() { handle.resume(); });
+    } else {
+      handle.resume();
+    }
+  }
+
+  std::mutex mutex_;
+  std::size_t available_;
+  std::deque<std::pair<std::coroutine_handle<>, trantor::EventLoop *>>
+      waiters_;
+};
+
+}  // namespace utilities
+
+#endif  // ASYNC_SEMAPHORE_HPP
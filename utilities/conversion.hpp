@@ -1,6 +1,7 @@
 #ifndef CONVERSION_HPP
 #define CONVERSION_HPP
 
+#include <algorithm>
 #include <charconv>
 #include <concepts>
 #include <optional>
@@ -50,6 +51,39 @@ inline std::string array_to_pgsql_array_string(
   return result;
 }
 
+// Array of strings to a PostgreSQL array literal with every element quoted,
+// safe for values containing commas, quotes, braces or backslashes.
+// Suitable for binding as a single $n::text[] parameter.
+inline std::string array_to_quoted_pgsql_array_string(
+    std::span<const std::string> values) {
+  std::string result = "{";
+  for (size_t i{0}; const auto& value : values) {
+    if (i > 0) {
+      result += ",";
+    }
+    result += '"';
+    for (char c : value) {
+      if (c == '"' || c == '\\') {
+        result += '\\';
+      }
+      result += c;
+    }
+    result += '"';
+    ++i;
+  }
+  result += "}";
+
+  return result;
+}
+
+// Shortest string that parses back to the same double, std::to_string
+// rounds to 6 decimals. Suitable as a numeric PostgreSQL array element.
+inline std::string double_to_string(double value) {
+  char buffer[32];
+  auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  return std::string(buffer, end);
+}
+
 // PostgresSQL array string to std::vector<std::string>
 inline std::vector<std::string> pgsql_array_string_to_vector(
     const std::string& array_str) {
@@ -79,6 +113,34 @@ inline std::vector<std::string> pgsql_array_string_to_vector(
   return result;
 }
 
+// Same as pgsql_array_string_to_vector, the elements point into array_str
+inline std::vector<std::string_view> pgsql_array_string_to_views(
+    std::string_view array_str) {
+  std::vector<std::string_view> result;
+
+  if (array_str.size() < 2) {
+    return result;
+  }
+
+  auto content = array_str.substr(1, array_str.size() - 2);
+
+  size_t count = std::count(content.begin(), content.end(), ',') + 1;
+  result.reserve(count);
+
+  size_t start = 0;
+  size_t end = content.find(',');
+  while (end != std::string_view::npos) {
+    result.emplace_back(content.substr(start, end - start));
+    start = end + 1;
+    end = content.find(',', start);
+  }
+  if (!content.substr(start).empty()) {
+    result.emplace_back(content.substr(start));
+  }
+
+  return result;
+}
+
 }  // namespace convert
 
 #endif
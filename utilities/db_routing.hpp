@@ -0,0 +1,117 @@
+#ifndef DB_ROUTING_HPP
+#define DB_ROUTING_HPP
+
+#include <ankerl/unordered_dense.h>
+#include <drogon/HttpRequest.h>
+#include <drogon/drogon.h>
+#include <drogon/orm/DbClient.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "../config/config.hpp"
+#include "db_tracing.hpp"
+#include "expiry_pruner.hpp"
+
+namespace utilities {
+
+/**
+ * @brief Routes read-only statements to a replica client with
+ * read-your-writes stickiness.
+ * After a user's successful write (any authenticated non-GET request, see
+ * main.cc), that user's reads go to the primary for db_replica_sticky_ms so
+ * they never observe replication lag on their own data. Everything else
+ * reads from the replica. Stickiness is per process.
+ * Configurable through custom_config:
+ * - db_read_replica: name of the replica in db_clients, empty disables
+ *   routing (default "")
+ * - db_replica_sticky_ms: primary only window after a write (default 2000)
+ */
+class DbRouter {
+ public:
+  static DbRouter &get_instance() {
+    static DbRouter instance;
+    return instance;
+  }
+
+  DbRouter(const DbRouter &) = delete;
+  DbRouter &operator=(const DbRouter &) = delete;
+
+  // Client for a statement that only reads, on behalf of user_id
+  drogon::orm::DbClientPtr reader(std::string_view user_id) {
+    if (replica_name_.empty() ||
+        (!user_id.empty() && is_sticky(user_id))) {
+      return drogon::app().getDbClient();
+    }
+    return drogon::app().getDbClient(replica_name_);
+  }
+
+  void note_write(std::string_view user_id) {
+    if (replica_name_.empty() || user_id.empty()) {
+      return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    auto &shard = shard_of(user_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.sticky_until.insert_or_assign(std::string(user_id),
+                                        now + sticky_window_);
+    // The map only holds recently active writers
+    shard.pruner.after_insert(shard.sticky_until, [now](const auto &entry) {
+      return entry.second <= now;
+    });
+  }
+
+  bool enabled() const { return !replica_name_.empty(); }
+
+ private:
+  static constexpr std::size_t kShards = 16;
+  struct Shard {
+    std::mutex mutex;
+    ankerl::unordered_dense::map<std::string,
+                                 std::chrono::steady_clock::time_point>
+        sticky_until;
+    ExpiryPruner pruner;
+  };
+
+  DbRouter()
+      : replica_name_(config::get_config_value("db_read_replica", "")),
+        sticky_window_(std::max(
+            config::get_config_int("db_replica_sticky_ms", 2000), 0)) {}
+
+  Shard &shard_of(std::string_view user_id) {
+    return shards_[std::hash<std::string_view>{}(user_id) % kShards];
+  }
+
+  bool is_sticky(std::string_view user_id) {
+    auto &shard = shard_of(user_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.sticky_until.find(std::string(user_id));
+    return it != shard.sticky_until.end() &&
+           it->second > std::chrono::steady_clock::now();
+  }
+
+  const std::string replica_name_;
+  const std::chrono::milliseconds sticky_window_;
+  std::array<Shard, kShards> shards_;
+};
+
+// Client for a handler that only reads. Anonymous requests always use the
+// replica when one is configured. Traced like traced_db_client().
+inline TracedDbPtr read_db_client(
+    const drogon::HttpRequestPtr &req) {
+  const auto &attributes = req->getAttributes();
+  return traced_db_client(
+      req, DbRouter::get_instance().reader(
+               attributes->find("current_user_id")
+                   ? attributes->get<std::string>("current_user_id")
+                   : std::string()));
+}
+
+}  // namespace utilities
+
+#endif  // DB_ROUTING_HPP
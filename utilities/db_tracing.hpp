@@ -0,0 +1,530 @@
+#ifndef DB_TRACING_HPP
+#define DB_TRACING_HPP
+
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <drogon/drogon.h>
+#include <drogon/orm/DbClient.h>
+#include <drogon/orm/Exception.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <format>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../config/config.hpp"
+#include "metrics.hpp"
+#include "sql_pipeline.hpp"
+
+namespace utilities {
+
+// One statement or transaction of a request
+struct DbSpan {
+  int parent = -1;   // index of the enclosing transaction span, -1 for none
+  std::string kind;  // "statement" or "transaction"
+  std::string fingerprint;
+  std::uint64_t start_us = 0;  // since the request was parsed
+  std::uint64_t wait_us = 0;   // transactions: waiting for a connection
+  std::uint64_t exec_us = 0;
+  std::uint64_t rows = 0;
+  bool queued = false;  // statements: sent while every connection was busy
+  bool error = false;
+  bool rolled_back = false;
+};
+
+struct RequestTraceRecord {
+  std::string method;
+  std::string path;
+  int status = 0;
+  std::uint64_t total_us = 0;
+  std::uint64_t db_us = 0;  // top level spans, waits included
+  std::vector<DbSpan> spans;
+};
+
+/**
+ * @brief SQL with its literals replaced by ?, whitespace collapsed and cut
+ * to kMaxLength, so statements that only differ in inlined values match.
+ * Parameters ($1, $2, ...) are kept as is.
+ */
+inline std::string sql_fingerprint(std::string_view sql) {
+  constexpr std::size_t kMaxLength = 200;
+  auto is_word = [](char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_' || c == '$' || c == '.';
+  };
+  std::string out;
+  out.reserve(std::min(sql.size(), kMaxLength + 3));
+  for (std::size_t i = 0; i < sql.size() && out.size() < kMaxLength; ++i) {
+    const char c = sql[i];
+    if (c == ' ' || c == '\n' || c == '\t' || c == '\r') {
+      if (!out.empty() && out.back() != ' ') {
+        out += ' ';
+      }
+    } else if (c == '\'') {
+      // '' inside a literal is an escaped quote
+      for (++i; i < sql.size(); ++i) {
+        if (sql[i] == '\'' && (i + 1 == sql.size() || sql[i + 1] != '\'')) {
+          break;
+        }
+        i += sql[i] == '\'' ? 1 : 0;
+      }
+      out += '?';
+    } else if (c >= '0' && c <= '9' && (out.empty() || !is_word(out.back()))) {
+      while (i + 1 < sql.size() && is_word(sql[i + 1])) {
+        ++i;
+      }
+      out += '?';
+    } else {
+      out += c;
+    }
+  }
+  if (out.size() >= kMaxLength) {
+    out += "...";
+  }
+  return out;
+}
+
+/**
+ * @brief DB spans of one request, filled by TracedDb. Statements sent
+ * together (see pipeline()) complete on other threads, hence the mutex.
+ */
+class RequestTrace {
+ public:
+  // Spans past this are dropped, a runaway loop must not grow the trace
+  static constexpr std::size_t kMaxSpans = 256;
+
+  explicit RequestTrace(std::chrono::steady_clock::time_point started_at)
+      : started_at_(started_at) {}
+
+  // @return the span's index, -1 when the trace is full
+  int begin(std::string_view kind, std::string fingerprint, int parent,
+            bool queued) {
+    const auto start_us = elapsed_us(std::chrono::steady_clock::now());
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spans_.size() >= kMaxSpans) {
+      return -1;
+    }
+    spans_.push_back(DbSpan{.parent = parent,
+                            .kind = std::string(kind),
+                            .fingerprint = std::move(fingerprint),
+                            .start_us = start_us,
+                            .queued = queued});
+    return static_cast<int>(spans_.size()) - 1;
+  }
+
+  void set_wait(int span, std::chrono::nanoseconds wait) {
+    update(span, [&](DbSpan &s) { s.wait_us = to_us(wait); });
+  }
+
+  void finish(int span, std::chrono::nanoseconds exec, std::uint64_t rows,
+              bool error) {
+    update(span, [&](DbSpan &s) {
+      s.exec_us = to_us(exec);
+      s.rows = rows;
+      s.error = error;
+    });
+  }
+
+  void mark_rolled_back(int span) {
+    update(span, [](DbSpan &s) { s.rolled_back = true; });
+  }
+
+  std::vector<DbSpan> spans() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spans_;
+  }
+
+ private:
+  static std::uint64_t to_us(std::chrono::nanoseconds d) {
+    return static_cast<std::uint64_t>(std::max<std::int64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(d).count(), 0));
+  }
+
+  std::uint64_t elapsed_us(std::chrono::steady_clock::time_point t) const {
+    return to_us(t - started_at_);
+  }
+
+  template <typename Update>
+  void update(int span, Update &&apply) {
+    if (span < 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    apply(spans_[static_cast<std::size_t>(span)]);
+  }
+
+  const std::chrono::steady_clock::time_point started_at_;
+  mutable std::mutex mutex_;
+  std::vector<DbSpan> spans_;
+};
+
+namespace detail {
+
+inline std::uint64_t rows_of(const drogon::orm::Result &result) {
+  return result.empty() ? result.affectedRows() : result.size();
+}
+
+// Awaits one statement sent through Db::send(), see TracedDb::execSqlCoro
+template <typename Db, typename... Args>
+class StatementAwaiter {
+ public:
+  StatementAwaiter(std::shared_ptr<Db> db, SqlStatement<Args...> statement)
+      : db_(std::move(db)), statement_(std::move(statement)) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    // The result may resume the coroutine before send() returns, so don't
+    // touch members once it has been called
+    auto db = std::move(db_);
+    db->send(
+        std::move(statement_),
+        [this, handle](const drogon::orm::Result &result) {
+          result_.emplace(result);
+          handle.resume();
+        },
+        [this, handle](const std::exception_ptr &e) {
+          error_ = e;
+          handle.resume();
+        });
+  }
+
+  drogon::orm::Result await_resume() {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+    return std::move(*result_);
+  }
+
+ private:
+  std::shared_ptr<Db> db_;
+  SqlStatement<Args...> statement_;
+  std::optional<drogon::orm::Result> result_;
+  std::exception_ptr error_;
+};
+
+}  // namespace detail
+
+/**
+ * @brief DB client or transaction handed to request handlers, see
+ * traced_db_client(). It offers the DbClient calls handlers use
+ * (execSqlCoro, execSqlAsync, newTransactionCoro and pipeline()) and times
+ * each statement around drogon's public binder: DbClient::execSql is private
+ * to the binder, so the client itself cannot be decorated.
+ * Drogon does not expose how long a statement waited for a connection: a
+ * statement sent while none was free is flagged queued and its wait is part
+ * of exec_us. Transactions report their wait separately. A transaction's span
+ * lasts from the connection being granted to its handle going away, which is
+ * when drogon commits, and statements run on it are children of that span.
+ */
+class TracedDb : public std::enable_shared_from_this<TracedDb> {
+ public:
+  TracedDb(drogon::orm::DbClientPtr client, std::shared_ptr<RequestTrace> trace)
+      : client_(std::move(client)), trace_(std::move(trace)) {}
+
+  TracedDb(std::shared_ptr<drogon::orm::Transaction> transaction,
+           std::shared_ptr<RequestTrace> trace, int span)
+      : client_(transaction),
+        transaction_(std::move(transaction)),
+        trace_(std::move(trace)),
+        span_(span),
+        acquired_at_(std::chrono::steady_clock::now()) {}
+
+  TracedDb(const TracedDb &) = delete;
+  TracedDb &operator=(const TracedDb &) = delete;
+
+  ~TracedDb() {
+    if (transaction_ && trace_) {
+      trace_->finish(span_, std::chrono::steady_clock::now() - acquired_at_, 0,
+                     false);
+    }
+  }
+
+  // Parameters are copied or moved into the statement, as with statement()
+  template <typename... Args>
+  detail::StatementAwaiter<TracedDb, std::decay_t<Args>...> execSqlCoro(
+      std::string sql, Args &&...args) {
+    return {shared_from_this(),
+            statement(std::move(sql), std::forward<Args>(args)...)};
+  }
+
+  // on_error takes a const DrogonDbException &, as with DbClient
+  template <typename OnResult, typename OnError, typename... Args>
+  void execSqlAsync(std::string sql, OnResult &&on_result, OnError &&on_error,
+                    Args &&...args) {
+    send(statement(std::move(sql), std::forward<Args>(args)...),
+         std::forward<OnResult>(on_result),
+         [on_error = std::forward<OnError>(on_error)](
+             const std::exception_ptr &e) {
+           try {
+             std::rethrow_exception(e);
+           } catch (const drogon::orm::DrogonDbException &error) {
+             on_error(error);
+           }
+         });
+  }
+
+  // On a transaction, the transaction itself, as in drogon
+  drogon::Task<std::shared_ptr<TracedDb>> newTransactionCoro() {
+    if (transaction_) {
+      co_return shared_from_this();
+    }
+    const int span = trace_ ? trace_->begin("transaction", "BEGIN", -1,
+                                            !client_->hasAvailableConnections())
+                            : -1;
+    const auto requested_at = std::chrono::steady_clock::now();
+    std::shared_ptr<drogon::orm::Transaction> transaction;
+    try {
+      transaction = co_await client_->newTransactionCoro();
+    } catch (...) {
+      // Timed out waiting for a connection
+      if (trace_) {
+        trace_->set_wait(span, std::chrono::steady_clock::now() - requested_at);
+        trace_->finish(span, {}, 0, true);
+      }
+      throw;
+    }
+    if (trace_) {
+      trace_->set_wait(span, std::chrono::steady_clock::now() - requested_at);
+    }
+    co_return std::make_shared<TracedDb>(std::move(transaction), trace_, span);
+  }
+
+  // Transactions only
+  void rollback() {
+    if (trace_) {
+      trace_->mark_rolled_back(span_);
+    }
+    transaction_->rollback();
+  }
+
+  // Transactions only
+  void setCommitCallback(const std::function<void(bool)> &commit_callback) {
+    transaction_->setCommitCallback(commit_callback);
+  }
+
+  /**
+   * @brief Sends one statement without waiting, on_result or on_error (taking
+   * a const std::exception_ptr &) is called with its outcome. Feeds the per
+   * statement metrics and, when the request is traced, its span.
+   */
+  template <typename... Args, typename OnResult, typename OnError>
+  void send(SqlStatement<Args...> &&statement, OnResult &&on_result,
+            OnError &&on_error) {
+    // Keyed by fingerprint, inlined literals must not create new series
+    auto fingerprint = sql_fingerprint(statement.sql);
+    auto *metrics = &Metrics::get_instance().statement(fingerprint);
+    const int span =
+        trace_ ? trace_->begin("statement", std::move(fingerprint), span_,
+                               !client_->hasAvailableConnections())
+               : -1;
+    const auto sent_at = std::chrono::steady_clock::now();
+    detail::send_statement(
+        *client_, std::move(statement),
+        [on_result = std::forward<OnResult>(on_result), trace = trace_, span,
+         metrics, sent_at](const drogon::orm::Result &result) {
+          const auto elapsed = std::chrono::steady_clock::now() - sent_at;
+          metrics->latency.record(elapsed);
+          if (trace) {
+            trace->finish(span, elapsed, detail::rows_of(result), false);
+          }
+          on_result(result);
+        },
+        [on_error = std::forward<OnError>(on_error), trace = trace_, span,
+         metrics, sent_at](const std::exception_ptr &e) {
+          const auto elapsed = std::chrono::steady_clock::now() - sent_at;
+          metrics->latency.record(elapsed);
+          metrics->errors.fetch_add(1, std::memory_order_relaxed);
+          if (trace) {
+            trace->finish(span, elapsed, 0, true);
+          }
+          on_error(e);
+        });
+  }
+
+ private:
+  drogon::orm::DbClientPtr client_;  // the transaction for transactions
+  std::shared_ptr<drogon::orm::Transaction> transaction_;
+  std::shared_ptr<RequestTrace> trace_;
+  int span_ = -1;  // the transaction's span, parent of its statements
+  std::chrono::steady_clock::time_point acquired_at_;
+};
+
+using TracedDbPtr = std::shared_ptr<TracedDb>;
+
+/**
+ * @brief Keeps the traces of slow requests, logged with their span tree, and
+ * of every trace_sample_every-th request, for the admin listener.
+ * Configurable through custom_config:
+ * - slow_request_ms: requests at least this slow are logged and kept,
+ *   0 disables tracing (default 500)
+ * - trace_sample_every: also keep one in N traced requests, 0 keeps none
+ *   (default 100)
+ * - trace_buffer_size: traces kept of each kind, oldest dropped first
+ *   (default 50)
+ */
+class TraceStore {
+ public:
+  static TraceStore &get_instance() {
+    static TraceStore instance;
+    return instance;
+  }
+
+  TraceStore(const TraceStore &) = delete;
+  TraceStore &operator=(const TraceStore &) = delete;
+
+  bool enabled() const { return slow_threshold_.count() > 0; }
+
+  // Called once the response is ready, from main.cc's post-handling advice
+  void finish(const drogon::HttpRequestPtr &req,
+              const drogon::HttpResponsePtr &resp) {
+    const auto &attributes = req->getAttributes();
+    if (!attributes->find(kAttribute)) {
+      return;
+    }
+    const auto &trace =
+        attributes->get<std::shared_ptr<RequestTrace>>(kAttribute);
+    const auto total_us = static_cast<std::uint64_t>(
+        std::max<std::int64_t>(trantor::Date::now().microSecondsSinceEpoch() -
+                                   req->creationDate().microSecondsSinceEpoch(),
+                               0));
+    const bool slow = total_us >= static_cast<std::uint64_t>(
+                                      std::chrono::microseconds(slow_threshold_)
+                                          .count());
+    const bool sampled =
+        sample_every_ > 0 &&
+        requests_.fetch_add(1, std::memory_order_relaxed) % sample_every_ == 0;
+    if (!slow && !sampled) {
+      return;
+    }
+
+    RequestTraceRecord record{.method = req->methodString(),
+                              .path = req->path(),
+                              .status = static_cast<int>(resp->statusCode()),
+                              .total_us = total_us,
+                              .spans = trace->spans()};
+    for (const auto &span : record.spans) {
+      if (span.parent < 0) {
+        record.db_us += span.wait_us + span.exec_us;
+      }
+    }
+    if (slow) {
+      LOG_WARN << "Slow request " << format(record);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &kept = slow ? slow_ : sampled_;
+    if (kept.size() >= capacity_) {
+      kept.pop_front();
+    }
+    kept.push_back(std::move(record));
+  }
+
+  std::vector<RequestTraceRecord> slow() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {slow_.begin(), slow_.end()};
+  }
+
+  std::vector<RequestTraceRecord> sampled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {sampled_.begin(), sampled_.end()};
+  }
+
+  // One line for the request, then one per span indented under its parent
+  static std::string format(const RequestTraceRecord &record) {
+    std::string out = std::format(
+        "{} {} {} in {:.1f} ms, DB {:.1f} ms over {} spans", record.method,
+        record.path, record.status, record.total_us / 1000.0,
+        record.db_us / 1000.0, record.spans.size());
+    for (const auto &span : record.spans) {
+      int depth = 1;
+      for (int p = span.parent; p >= 0;
+           p = record.spans[static_cast<std::size_t>(p)].parent) {
+        ++depth;
+      }
+      std::format_to(std::back_inserter(out), "\n{:{}}+{:.1f} ms {}", "",
+                     depth * 2, span.start_us / 1000.0, span.kind);
+      if (span.wait_us > 0) {
+        std::format_to(std::back_inserter(out), " wait {:.1f} ms",
+                       span.wait_us / 1000.0);
+      }
+      std::format_to(std::back_inserter(out), " {:.1f} ms",
+                     span.exec_us / 1000.0);
+      if (span.kind == "statement") {
+        std::format_to(std::back_inserter(out), ", {} rows", span.rows);
+      }
+      out += span.queued ? ", queued" : "";
+      out += span.error ? ", failed" : "";
+      out += span.rolled_back ? ", rolled back" : "";
+      if (span.kind == "statement") {
+        out += ": ";
+        out += span.fingerprint;
+      }
+    }
+    return out;
+  }
+
+  // Request attribute holding the std::shared_ptr<RequestTrace>
+  static constexpr const char *kAttribute = "db_trace";
+
+ private:
+  TraceStore()
+      : slow_threshold_(
+            std::max(config::get_config_int("slow_request_ms", 500), 0)),
+        sample_every_(static_cast<std::uint64_t>(
+            std::max(config::get_config_int("trace_sample_every", 100), 0))),
+        capacity_(static_cast<std::size_t>(
+            std::max(config::get_config_int("trace_buffer_size", 50), 1))) {}
+
+  const std::chrono::milliseconds slow_threshold_;
+  const std::uint64_t sample_every_;
+  const std::size_t capacity_;
+  std::atomic<std::uint64_t> requests_{0};
+  mutable std::mutex mutex_;
+  std::deque<RequestTraceRecord> slow_;
+  std::deque<RequestTraceRecord> sampled_;
+};
+
+/**
+ * @brief DB client for a request handler: statements are timed per
+ * statement (see Metrics) and, with tracing enabled, recorded as spans of
+ * the request's trace.
+ */
+inline TracedDbPtr traced_db_client(
+    const drogon::HttpRequestPtr &req,
+    drogon::orm::DbClientPtr client = drogon::app().getDbClient()) {
+  std::shared_ptr<RequestTrace> trace;
+  if (TraceStore::get_instance().enabled()) {
+    const auto &attributes = req->getAttributes();
+    if (attributes->find(TraceStore::kAttribute)) {
+      trace = attributes->get<std::shared_ptr<RequestTrace>>(
+          TraceStore::kAttribute);
+    } else {
+      // Offsets are relative to the request being parsed
+      const auto parsed_us = trantor::Date::now().microSecondsSinceEpoch() -
+                             req->creationDate().microSecondsSinceEpoch();
+      trace = std::make_shared<RequestTrace>(
+          std::chrono::steady_clock::now() -
+          std::chrono::microseconds(std::max<std::int64_t>(parsed_us, 0)));
+      attributes->insert(TraceStore::kAttribute, trace);
+    }
+  }
+  return std::make_shared<TracedDb>(std::move(client), std::move(trace));
+}
+
+}  // namespace utilities
+
+#endif  // DB_TRACING_HPP
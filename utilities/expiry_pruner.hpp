@@ -0,0 +1,40 @@
+#ifndef EXPIRY_PRUNER_HPP
+#define EXPIRY_PRUNER_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+namespace utilities {
+
+/**
+ * @brief Amortized pruning for maps that only hold recently used entries.
+ * Expired entries are erased once the map doubled since the last prune, so
+ * each insert pays O(1) on average and a map never grows past twice its live
+ * entries. Not thread safe, call under the lock guarding the map.
+ *
+ * @code
+ * pruner_.after_insert(entries_, [now](const auto& entry) {
+ *   return entry.second.expires_at <= now;
+ * });
+ * @endcode
+ */
+class ExpiryPruner {
+ public:
+  static constexpr std::size_t kMinPruneSize = 1024;
+
+  template <typename Map, typename Expired>
+  void after_insert(Map& map, Expired expired) {
+    if (map.size() < prune_at_) {
+      return;
+    }
+    erase_if(map, expired);
+    prune_at_ = std::max(kMinPruneSize, map.size() * 2);
+  }
+
+ private:
+  std::size_t prune_at_ = kMinPruneSize;
+};
+
+}  // namespace utilities
+
+#endif  // EXPIRY_PRUNER_HPP
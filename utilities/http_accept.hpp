@@ -0,0 +1,76 @@
+#ifndef HTTP_ACCEPT_HPP
+#define HTTP_ACCEPT_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+
+namespace utilities {
+
+constexpr bool iequals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    auto lower = [](char c) {
+      return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    };
+    if (lower(a[i]) != lower(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+constexpr std::string_view trim_whitespace(std::string_view sv) {
+  while (!sv.empty() && (sv.front() == ' ' || sv.front() == '\t')) {
+    sv.remove_prefix(1);
+  }
+  while (!sv.empty() && (sv.back() == ' ' || sv.back() == '\t')) {
+    sv.remove_suffix(1);
+  }
+  return sv;
+}
+
+/**
+ * @brief Calls visit(value, q) for each element of a weighted list such as
+ * Accept or Accept-Encoding (RFC 9110 12.4.2), e.g. "br;q=1.0, gzip;q=0.8".
+ * Values are trimmed, other parameters are dropped and q defaults to 1.
+ * Elements with q=0 ("not acceptable") are visited too, they can override a
+ * wildcard.
+ */
+template <class Visit>
+void for_each_weighted_value(std::string_view header, Visit &&visit) {
+  while (!header.empty()) {
+    const auto comma = header.find(',');
+    const auto element = header.substr(0, comma);
+    header.remove_prefix(comma == std::string_view::npos ? header.size()
+                                                         : comma + 1);
+
+    const auto semicolon = element.find(';');
+    const auto value = trim_whitespace(element.substr(0, semicolon));
+    if (value.empty()) {
+      continue;
+    }
+
+    double q = 1;
+    auto params = semicolon == std::string_view::npos
+                      ? std::string_view()
+                      : element.substr(semicolon + 1);
+    while (!params.empty()) {
+      const auto next = params.find(';');
+      const auto param = trim_whitespace(params.substr(0, next));
+      params.remove_prefix(next == std::string_view::npos ? params.size()
+                                                          : next + 1);
+      if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') &&
+          param[1] == '=') {
+        std::from_chars(param.data() + 2, param.data() + param.size(), q);
+      }
+    }
+    visit(value, q);
+  }
+}
+
+}  // namespace utilities
+
+#endif  // HTTP_ACCEPT_HPP
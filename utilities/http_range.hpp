@@ -0,0 +1,132 @@
+#ifndef HTTP_RANGE_HPP
+#define HTTP_RANGE_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace utilities {
+
+struct ByteRange {
+  std::int64_t first = 0;
+  std::int64_t last = 0;  // inclusive
+
+  std::int64_t length() const { return last - first + 1; }
+};
+
+enum class RangeStatus : std::uint8_t {
+  none,           // no (usable) Range header, serve the whole object
+  satisfiable,    // serve ByteRange with 206
+  unsatisfiable,  // reply 416
+};
+
+struct RangeRequest {
+  RangeStatus status = RangeStatus::none;
+  ByteRange range;
+};
+
+/**
+ * @brief Parses a single range "bytes=first-last", "bytes=first-" or
+ * "bytes=-suffix" (RFC 9110 14.1.2) against an object of total_size bytes.
+ * Multiple ranges and malformed headers are ignored (whole object is served)
+ * which the RFC allows.
+ */
+inline RangeRequest parse_range_header(std::string_view header,
+                                       std::int64_t total_size) {
+  constexpr std::string_view prefix = "bytes=";
+  if (!header.starts_with(prefix) || total_size < 0) {
+    return {};
+  }
+  header.remove_prefix(prefix.size());
+  if (header.find(',') != std::string_view::npos) {
+    return {};
+  }
+
+  auto dash = header.find('-');
+  if (dash == std::string_view::npos) {
+    return {};
+  }
+
+  auto parse = [](std::string_view sv) -> std::optional<std::int64_t> {
+    std::int64_t value = 0;
+    auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), value);
+    if (ec != std::errc{} || ptr != sv.data() + sv.size() || value < 0) {
+      return std::nullopt;
+    }
+    return value;
+  };
+
+  auto first_sv = header.substr(0, dash);
+  auto last_sv = header.substr(dash + 1);
+
+  if (first_sv.empty()) {
+    // suffix range: last N bytes
+    auto suffix = parse(last_sv);
+    if (!suffix) {
+      return {};
+    }
+    if (*suffix == 0 || total_size == 0) {
+      return {.status = RangeStatus::unsatisfiable, .range = {}};
+    }
+    std::int64_t length = *suffix < total_size ? *suffix : total_size;
+    return {.status = RangeStatus::satisfiable,
+            .range = {.first = total_size - length, .last = total_size - 1}};
+  }
+
+  auto first = parse(first_sv);
+  if (!first) {
+    return {};
+  }
+  std::int64_t last = total_size - 1;
+  if (!last_sv.empty()) {
+    auto parsed_last = parse(last_sv);
+    if (!parsed_last || *parsed_last < *first) {
+      return {};
+    }
+    last = *parsed_last < last ? *parsed_last : last;
+  }
+
+  if (*first >= total_size) {
+    return {.status = RangeStatus::unsatisfiable, .range = {}};
+  }
+  return {.status = RangeStatus::satisfiable,
+          .range = {.first = *first, .last = last}};
+}
+
+/**
+ * @brief Checks an If-None-Match header value against an entity tag.
+ * Uses weak comparison as required for If-None-Match.
+ */
+inline bool etag_matches(std::string_view if_none_match,
+                         std::string_view etag) {
+  auto strip_weak = [](std::string_view tag) {
+    if (tag.starts_with("W/")) {
+      tag.remove_prefix(2);
+    }
+    return tag;
+  };
+  etag = strip_weak(etag);
+  if (etag.empty()) {
+    return false;
+  }
+
+  while (!if_none_match.empty()) {
+    auto comma = if_none_match.find(',');
+    auto tag = if_none_match.substr(0, comma);
+    while (!tag.empty() && tag.front() == ' ') tag.remove_prefix(1);
+    while (!tag.empty() && tag.back() == ' ') tag.remove_suffix(1);
+    if (tag == "*" || strip_weak(tag) == etag) {
+      return true;
+    }
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    if_none_match.remove_prefix(comma + 1);
+  }
+  return false;
+}
+
+}  // namespace utilities
+
+#endif  // HTTP_RANGE_HPP
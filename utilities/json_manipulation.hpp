@@ -1,9 +1,12 @@
 #ifndef JSON_MANIPULATION_HPP
 #define JSON_MANIPULATION_HPP
 
+#include <algorithm>
+#include <cstddef>
 #include <glaze/glaze.hpp>
 #include <optional>
 #include <string>
+#include <string_view>
 
 namespace utilities {
 
@@ -83,6 +86,74 @@ template <glz::read_supported<glz::JSON> T, glz::is_buffer Buffer>
   return value;
 }
 
+// Per-thread body buffers above this capacity are released after use
+inline constexpr std::size_t kMaxRetainedJsonBuffer = 1 << 20;
+
+namespace detail {
+
+/**
+ * @brief Runs write(buffer) on a per-thread buffer that keeps its capacity
+ * between calls and returns an exact-size copy of what was written, or an
+ * empty string when write returns an error.
+ */
+template <class Write>
+[[nodiscard]] inline std::string write_through_thread_buffer(Write &&write) {
+  thread_local std::string buffer;
+  std::string body;
+  if (!write(buffer)) {
+    body.assign(buffer);
+  }
+  if (buffer.capacity() > kMaxRetainedJsonBuffer) {
+    buffer = std::string();
+  }
+  return body;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Serializes value as JSON through a per-thread buffer that keeps its
+ * capacity between calls, instead of growing a new string from empty.
+ * Once the buffer is warm the returned exact-size copy is the only
+ * allocation.
+ * @return the JSON text, empty on error like
+ * glz::write_json(value).value_or("").
+ */
+template <class T>
+[[nodiscard]] inline std::string write_json_body(const T &value) {
+  return detail::write_through_thread_buffer(
+      [&](std::string &buffer) { return glz::write_json(value, buffer); });
+}
+
+// String literal usable as a template argument, see error_body()
+template <std::size_t N>
+struct FixedString {
+  constexpr FixedString(const char (&str)[N]) { std::copy_n(str, N, value); }
+  constexpr std::string_view view() const { return {value, N - 1}; }
+
+  char value[N]{};
+};
+
+namespace detail {
+
+// Serializes like SimpleError
+struct ErrorBody {
+  std::string_view error;
+};
+
+}  // namespace detail
+
+/**
+ * @brief {"error":Message}, serialized once per message for the lifetime of
+ * the program.
+ */
+template <FixedString Message>
+[[nodiscard]] inline const std::string &error_body() {
+  static const std::string body =
+      glz::write_json(detail::ErrorBody{Message.view()}).value_or("");
+  return body;
+}
+
 }  // namespace utilities
 
 #endif  // JSON_MANIPULATION_HPP
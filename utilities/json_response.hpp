@@ -0,0 +1,68 @@
+#ifndef JSON_RESPONSE_HPP
+#define JSON_RESPONSE_HPP
+
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <drogon/HttpTypes.h>
+
+#include "json_manipulation.hpp"
+#include "wire_format.hpp"
+
+namespace utilities {
+
+/**
+ * @brief JSON response with the body serialized through write_json_body(),
+ * the body is moved into the response.
+ */
+template <typename T>
+drogon::HttpResponsePtr json_response(
+    const T &value, drogon::HttpStatusCode code = drogon::k200OK) {
+  auto resp =
+      drogon::HttpResponse::newHttpResponse(code, drogon::CT_APPLICATION_JSON);
+  resp->setBody(write_json_body(value));
+  return resp;
+}
+
+/**
+ * @brief Response with value encoded as the request's Accept header asks,
+ * see wire_format_from_accept(): BEVE or MessagePack for clients that opt
+ * in, JSON otherwise. For the read endpoints with large bodies (feeds,
+ * messages, offers); errors stay JSON for every client.
+ */
+template <typename T>
+drogon::HttpResponsePtr negotiated_response(
+    const drogon::HttpRequestPtr &req, const T &value,
+    drogon::HttpStatusCode code = drogon::k200OK) {
+  const auto format = wire_format_from_accept(req->getHeader("accept"));
+  drogon::HttpResponsePtr resp;
+  if (format == WireFormat::json) {
+    resp = json_response(value, code);
+  } else {
+    resp = drogon::HttpResponse::newHttpResponse();
+    resp->setStatusCode(code);
+    resp->setContentTypeString(content_type(format));
+    resp->setBody(write_wire_body(format, value));
+  }
+  // Caches must not hand one client's encoding to another
+  resp->addHeader("Vary", "Accept");
+  return resp;
+}
+
+/**
+ * @brief JSON error response with the prebuilt error_body<Message>().
+ * Middlewares add headers to the responses they pass on, so every call
+ * still gets its own response object, only the body is shared.
+ * e.g. callback(error_response<"Database error">(k500InternalServerError))
+ */
+template <FixedString Message>
+drogon::HttpResponsePtr error_response(drogon::HttpStatusCode code) {
+  const auto &body = error_body<Message>();
+  auto resp =
+      drogon::HttpResponse::newHttpResponse(code, drogon::CT_APPLICATION_JSON);
+  resp->setBody(body.data(), body.size());
+  return resp;
+}
+
+}  // namespace utilities
+
+#endif  // JSON_RESPONSE_HPP
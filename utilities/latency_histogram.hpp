@@ -0,0 +1,138 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+namespace utilities {
+
+/**
+ * @brief Lock-free log-linear (HDR style) latency histogram.
+ * Values are recorded in microseconds. Every power of two range is split into
+ * 8 linear sub-buckets, so reported percentiles are within ~12.5% of the real
+ * value. Recording is a few relaxed atomic increments and never allocates.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr std::size_t kSubBucketBits = 3;
+  static constexpr std::size_t kSubBuckets = std::size_t{1} << kSubBucketBits;
+  // 40 power of two ranges covers ~12 days in microseconds
+  static constexpr std::size_t kBucketCount = 40 * kSubBuckets;
+
+  struct Snapshot {
+    std::uint64_t count = 0;
+    std::uint64_t sum_us = 0;
+    double p50_us = 0.0;
+    double p90_us = 0.0;
+    double p99_us = 0.0;
+  };
+
+  void record(std::chrono::nanoseconds elapsed) noexcept {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+                  .count();
+    record_us(static_cast<std::uint64_t>(std::max<std::int64_t>(us, 0)));
+  }
+
+  void record_us(std::uint64_t us) noexcept {
+    counts_[bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(us, std::memory_order_relaxed);
+  }
+
+  std::uint64_t count() const noexcept {
+    return count_.load(std::memory_order_relaxed);
+  }
+
+  std::uint64_t sum_us() const noexcept {
+    return sum_us_.load(std::memory_order_relaxed);
+  }
+
+  std::uint64_t bucket_count(std::size_t idx) const noexcept {
+    return counts_[idx].load(std::memory_order_relaxed);
+  }
+
+  // Upper bound (in microseconds) of the bucket holding the q-th quantile
+  double percentile(double q) const noexcept {
+    const std::uint64_t total = count();
+    if (total == 0) {
+      return 0.0;
+    }
+    auto target = static_cast<std::uint64_t>(
+        std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(total)));
+    target = std::max<std::uint64_t>(target, 1);
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBucketCount; ++i) {
+      seen += bucket_count(i);
+      if (seen >= target) {
+        return static_cast<double>(bucket_upper_bound(i));
+      }
+    }
+    return static_cast<double>(bucket_upper_bound(kBucketCount - 1));
+  }
+
+  Snapshot snapshot() const noexcept {
+    return Snapshot{.count = count(),
+                    .sum_us = sum_us(),
+                    .p50_us = percentile(0.50),
+                    .p90_us = percentile(0.90),
+                    .p99_us = percentile(0.99)};
+  }
+
+  static constexpr std::size_t bucket_index(std::uint64_t us) noexcept {
+    if (us < kSubBuckets) {
+      return static_cast<std::size_t>(us);  // exact for tiny values
+    }
+    const auto msb = static_cast<std::size_t>(std::bit_width(us) - 1);
+    const std::size_t shift = msb - kSubBucketBits;
+    const std::size_t sub = (us >> shift) & (kSubBuckets - 1);
+    return std::min((shift + 1) * kSubBuckets + sub, kBucketCount - 1);
+  }
+
+  static constexpr std::uint64_t bucket_lower_bound(std::size_t idx) noexcept {
+    if (idx < kSubBuckets) {
+      return idx;
+    }
+    const std::size_t shift = idx / kSubBuckets - 1;
+    const std::size_t sub = idx % kSubBuckets;
+    return static_cast<std::uint64_t>(kSubBuckets | sub) << shift;
+  }
+
+  static constexpr std::uint64_t bucket_upper_bound(std::size_t idx) noexcept {
+    return bucket_lower_bound(idx + 1);
+  }
+
+ private:
+  std::array<std::atomic<std::uint64_t>, kBucketCount> counts_{};
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> sum_us_{0};
+};
+
+/**
+ * @brief Records the lifetime of the scope into a LatencyHistogram.
+ */
+class ScopedLatencyTimer {
+ public:
+  explicit ScopedLatencyTimer(LatencyHistogram &histogram) noexcept
+      : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+
+  ScopedLatencyTimer(const ScopedLatencyTimer &) = delete;
+  ScopedLatencyTimer &operator=(const ScopedLatencyTimer &) = delete;
+
+  ~ScopedLatencyTimer() {
+    histogram_.record(std::chrono::steady_clock::now() - start_);
+  }
+
+ private:
+  LatencyHistogram &histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace utilities
+
+#endif  // LATENCY_HISTOGRAM_HPP
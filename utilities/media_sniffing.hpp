@@ -0,0 +1,104 @@
+#ifndef MEDIA_SNIFFING_HPP
+#define MEDIA_SNIFFING_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace utilities {
+
+// Enough bytes to recognise every signature handled by sniff_media_type
+inline constexpr std::size_t MEDIA_SNIFF_BYTES = 16;
+
+// Media types accepted for upload and attachment
+inline constexpr auto ALLOWED_MEDIA_TYPES = std::to_array<std::string_view>({
+    "image/jpeg", "image/png", "image/gif", "image/webp", "video/mp4",
+    "video/webm",  // "video/quicktime",
+});
+
+inline bool is_allowed_media_type(std::string_view mime_type) {
+  return std::ranges::find(ALLOWED_MEDIA_TYPES, mime_type) !=
+         ALLOWED_MEDIA_TYPES.end();
+}
+
+namespace detail {
+
+// Leading bytes of a format, compared under a mask so wildcards cost nothing
+struct MagicSignature {
+  std::array<std::uint8_t, MEDIA_SNIFF_BYTES> bytes{};
+  std::array<std::uint8_t, MEDIA_SNIFF_BYTES> mask{};
+  std::size_t length = 0;  // bytes needed for a match
+  std::string_view mime_type;
+};
+
+// '?' in the pattern matches any byte
+consteval MagicSignature make_signature(std::string_view pattern,
+                                        std::string_view mime_type) {
+  MagicSignature signature{.bytes = {},
+                           .mask = {},
+                           .length = pattern.size(),
+                           .mime_type = mime_type};
+  for (std::size_t i = 0; i < pattern.size(); ++i) {
+    if (pattern[i] != '?') {
+      signature.bytes[i] = static_cast<std::uint8_t>(pattern[i]);
+      signature.mask[i] = 0xFF;
+    }
+  }
+  return signature;
+}
+
+// Earlier entries win, so more specific ISO BMFF brands come before mp4
+inline constexpr auto MAGIC_SIGNATURES = std::to_array<MagicSignature>({
+    make_signature("\xFF\xD8\xFF", "image/jpeg"),
+    make_signature("\x89PNG\r\n\x1A\n", "image/png"),
+    make_signature("GIF87a", "image/gif"),
+    make_signature("GIF89a", "image/gif"),
+    make_signature("RIFF????WEBP", "image/webp"),
+    make_signature("????ftypheic", "image/heic"),
+    make_signature("????ftypmif1", "image/heic"),
+    make_signature("????ftypavif", "image/avif"),
+    make_signature("????ftypqt  ", "video/quicktime"),
+    make_signature("????ftyp", "video/mp4"),
+    make_signature("\x1A\x45\xDF\xA3", "video/webm"),
+});
+static_assert(MAGIC_SIGNATURES.size() <= 32);
+
+}  // namespace detail
+
+/**
+ * @brief Detects the media type of an object from its leading bytes.
+ * The head is copied into a fixed 16 byte window and every signature is
+ * tested with the same masked xor over the whole window (a single vector
+ * compare), results are collected in a bitmask and the first match is picked
+ * without branching per signature.
+ * @return the mime type or an empty view if no signature matches.
+ */
+inline std::string_view sniff_media_type(std::string_view head) {
+  std::array<std::uint8_t, MEDIA_SNIFF_BYTES> window{};
+  const std::size_t available = std::min(head.size(), window.size());
+  std::memcpy(window.data(), head.data(), available);
+
+  std::uint32_t matches = 0;
+  for (std::size_t s = 0; s < detail::MAGIC_SIGNATURES.size(); ++s) {
+    const auto& signature = detail::MAGIC_SIGNATURES[s];
+    std::uint8_t diff = 0;
+    for (std::size_t i = 0; i < MEDIA_SNIFF_BYTES; ++i) {
+      diff |= (window[i] ^ signature.bytes[i]) & signature.mask[i];
+    }
+    const bool matched = (diff == 0) & (available >= signature.length);
+    matches |= static_cast<std::uint32_t>(matched) << s;
+  }
+
+  if (matches == 0) {
+    return {};
+  }
+  return detail::MAGIC_SIGNATURES[std::countr_zero(matches)].mime_type;
+}
+
+}  // namespace utilities
+
+#endif  // MEDIA_SNIFFING_HPP
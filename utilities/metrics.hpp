@@ -0,0 +1,414 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <ankerl/unordered_dense.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "latency_histogram.hpp"
+
+namespace utilities {
+
+/**
+ * @brief Counter written by a single thread and read by any.
+ * add() is a relaxed load and store, no locked instruction, so it costs about
+ * as much as a plain increment. Readers never see a torn value.
+ */
+class LocalCounter {
+ public:
+  void add(std::uint64_t n = 1) noexcept {
+    value_.store(value_.load(std::memory_order_relaxed) + n,
+                 std::memory_order_relaxed);
+  }
+
+  std::uint64_t value() const noexcept {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<std::uint64_t> value_{0};
+};
+
+// Bucket counts of one or more histograms, summed for a scrape
+struct HistogramTotals {
+  std::array<std::uint64_t, LatencyHistogram::kBucketCount> counts{};
+  std::uint64_t sum_us = 0;
+
+  void add(const LatencyHistogram &h) noexcept {
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+      counts[i] += h.bucket_count(i);
+    }
+    sum_us += h.sum_us();
+  }
+};
+
+/**
+ * @brief LatencyHistogram's buckets for a single writer thread, see
+ * LocalCounter. Merge the histograms of every thread with add_to().
+ */
+class LocalHistogram {
+ public:
+  void record(std::chrono::nanoseconds elapsed) noexcept {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+                  .count();
+    record_us(static_cast<std::uint64_t>(std::max<std::int64_t>(us, 0)));
+  }
+
+  void record_us(std::uint64_t us) noexcept {
+    counts_[LatencyHistogram::bucket_index(us)].add();
+    sum_us_.add(us);
+  }
+
+  void add_to(HistogramTotals &totals) const noexcept {
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+      totals.counts[i] += counts_[i].value();
+    }
+    totals.sum_us += sum_us_.value();
+  }
+
+ private:
+  std::array<LocalCounter, LatencyHistogram::kBucketCount> counts_{};
+  LocalCounter sum_us_;
+};
+
+// Prometheus text exposition format 0.0.4
+namespace prometheus {
+
+// Histogram bucket bounds, in seconds
+inline constexpr std::array<double, 15> kLatencyBounds = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+    0.05,   0.1,     0.25,   0.5,   1.0,    2.5,   5.0};
+
+inline void append_family(std::string &out, std::string_view name,
+                          std::string_view type, std::string_view help) {
+  std::format_to(std::back_inserter(out), "# HELP {} {}\n# TYPE {} {}\n", name,
+                 help, name, type);
+}
+
+// Escapes a label value: backslash, double quote and line feed
+inline void append_label_value(std::string &out, std::string_view value) {
+  for (const char c : value) {
+    if (c == '\\' || c == '"') {
+      out += '\\';
+      out += c;
+    } else if (c == '\n') {
+      out += "\\n";
+    } else {
+      out += c;
+    }
+  }
+}
+
+// labels is "" or a list without braces, e.g. route="/a",code="2xx"
+template <typename Value>
+void append_sample(std::string &out, std::string_view name,
+                   std::string_view labels, Value value) {
+  if (labels.empty()) {
+    std::format_to(std::back_inserter(out), "{} {}\n", name, value);
+  } else {
+    std::format_to(std::back_inserter(out), "{}{{{}}} {}\n", name, labels,
+                   value);
+  }
+}
+
+/**
+ * @brief Writes the _bucket, _sum and _count samples of a histogram in
+ * seconds. A LatencyHistogram bucket is counted under the first bound at or
+ * above its upper edge, so each le undercounts by at most one sub-bucket
+ * (12.5%).
+ */
+inline void append_histogram(std::string &out, std::string_view name,
+                             std::string_view labels,
+                             const HistogramTotals &totals) {
+  const std::string_view separator = labels.empty() ? "" : ",";
+  std::uint64_t cumulative = 0;
+  std::size_t bucket = 0;
+  auto count_below = [&](double bound_us) {
+    while (bucket < totals.counts.size() &&
+           static_cast<double>(LatencyHistogram::bucket_upper_bound(bucket)) <=
+               bound_us) {
+      cumulative += totals.counts[bucket++];
+    }
+  };
+  for (const double bound : kLatencyBounds) {
+    count_below(bound * 1e6);
+    std::format_to(std::back_inserter(out), "{}_bucket{{{}{}le=\"{}\"}} {}\n",
+                   name, labels, separator, bound, cumulative);
+  }
+  count_below(std::numeric_limits<double>::infinity());
+  std::format_to(std::back_inserter(out), "{}_bucket{{{}{}le=\"+Inf\"}} {}\n",
+                 name, labels, separator, cumulative);
+  append_sample(out, std::string(name) + "_sum", labels,
+                static_cast<double>(totals.sum_us) / 1e6);
+  append_sample(out, std::string(name) + "_count", labels, cumulative);
+}
+
+inline void append_histogram(std::string &out, std::string_view name,
+                             std::string_view labels,
+                             const LatencyHistogram &h) {
+  HistogramTotals totals;
+  totals.add(h);
+  append_histogram(out, name, labels, totals);
+}
+
+}  // namespace prometheus
+
+/**
+ * @brief Process wide request, SQL statement and broadcast metrics, rendered
+ * in the Prometheus text format by the admin listener (controllers/admin.cc).
+ * Request and broadcast series keep one block per recording thread: after a
+ * thread's first use of a series, recording is a thread-local hash lookup and
+ * a few plain stores. Statements take milliseconds, so their series are
+ * shared LatencyHistograms instead.
+ */
+class Metrics {
+ public:
+  // Belongs to the thread that got it from route(), only record from there
+  struct RequestBlock {
+    LocalHistogram latency;
+    std::array<LocalCounter, 5> responses;  // 1xx to 5xx
+
+    void record(std::chrono::nanoseconds elapsed, int status) noexcept {
+      latency.record(elapsed);
+      if (status >= 100 && status < 600) {
+        responses[static_cast<std::size_t>(status / 100 - 1)].add();
+      }
+    }
+  };
+
+  // Belongs to the thread that got it from broadcast(), one sample per
+  // ConnectionManager::broadcast call
+  struct FanoutBlock {
+    LocalHistogram latency;
+    LocalCounter messages;
+    LocalCounter deliveries;  // frames sent to connections
+  };
+
+  struct StatementMetrics {
+    LatencyHistogram latency;
+    std::atomic<std::uint64_t> errors{0};
+  };
+
+  // Distinct statements beyond this are folded into one "other" series
+  static constexpr std::size_t kMaxStatements = 1024;
+
+  static Metrics &get_instance() {
+    static Metrics instance;
+    return instance;
+  }
+
+  Metrics(const Metrics &) = delete;
+  Metrics &operator=(const Metrics &) = delete;
+
+  // pattern is the route's ADD_METHOD_TO path, e.g. /api/v1/posts/{post_id}
+  RequestBlock &route(std::string_view method, std::string_view pattern) {
+    thread_local ankerl::unordered_dense::map<RouteKey, RequestBlock *,
+                                              RouteKeyHash>
+        blocks;
+    if (auto it = blocks.find(RouteKey{method, pattern}); it != blocks.end()) {
+      return *it->second;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &series = routes_[std::format("{} {}", method, pattern)];
+    if (!series) {
+      series = std::make_unique<RouteSeries>(std::string(method),
+                                             std::string(pattern));
+    }
+    auto &block =
+        *series->blocks.emplace_back(std::make_unique<RequestBlock>());
+    // Keyed by views of the registry's strings, they live as long as it
+    blocks.emplace(RouteKey{series->method, series->pattern}, &block);
+    return block;
+  }
+
+  FanoutBlock &broadcast() {
+    thread_local FanoutBlock *block = nullptr;
+    if (!block) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      block = broadcasts_.emplace_back(std::make_unique<FanoutBlock>()).get();
+    }
+    return *block;
+  }
+
+  // fingerprint is the statement's sql_fingerprint() (see db_tracing.hpp),
+  // so statements only differing in inlined values share a series
+  StatementMetrics &statement(std::string_view fingerprint) {
+    thread_local ankerl::unordered_dense::map<std::string_view,
+                                              StatementMetrics *>
+        cache;
+    if (auto it = cache.find(fingerprint); it != cache.end()) {
+      return *it->second;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = statements_.find(fingerprint);
+    if (it == statements_.end()) {
+      if (statements_.size() >= kMaxStatements) {
+        // Not cached, there is no registry string to key it by
+        auto &other = statements_[std::string(kOtherStatement)];
+        if (!other) {
+          other = std::make_unique<StatementMetrics>();
+        }
+        return *other;
+      }
+      it = statements_
+               .emplace(std::string(fingerprint),
+                        std::make_unique<StatementMetrics>())
+               .first;
+    }
+    cache.emplace(it->first, it->second.get());
+    return *it->second;
+  }
+
+  /**
+   * @brief Appends every series. Statements are labelled with a short hash
+   * of their fingerprint and its first words.
+   */
+  void render(std::string &out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    prometheus::append_family(out, "buyer_http_request_duration_seconds",
+                              "histogram",
+                              "Time from request parsed to response sent.");
+    for (const auto &[key, series] : routes_) {
+      HistogramTotals totals;
+      for (const auto &block : series->blocks) {
+        block->latency.add_to(totals);
+      }
+      prometheus::append_histogram(out, "buyer_http_request_duration_seconds",
+                                   series->labels, totals);
+    }
+    prometheus::append_family(out, "buyer_http_responses_total", "counter",
+                              "Responses by status class.");
+    for (const auto &[key, series] : routes_) {
+      for (std::size_t i = 0; i < 5; ++i) {
+        std::uint64_t responses = 0;
+        for (const auto &block : series->blocks) {
+          responses += block->responses[i].value();
+        }
+        prometheus::append_sample(
+            out, "buyer_http_responses_total",
+            std::format("{},code=\"{}xx\"", series->labels, i + 1), responses);
+      }
+    }
+
+    prometheus::append_family(out, "buyer_db_statement_duration_seconds",
+                              "histogram",
+                              "Time from statement sent to result received.");
+    for (const auto &[sql, metrics] : statements_) {
+      prometheus::append_histogram(out, "buyer_db_statement_duration_seconds",
+                                   statement_labels(sql), metrics->latency);
+    }
+    prometheus::append_family(out, "buyer_db_statement_errors_total",
+                              "counter", "Statements that raised an error.");
+    for (const auto &[sql, metrics] : statements_) {
+      prometheus::append_sample(
+          out, "buyer_db_statement_errors_total", statement_labels(sql),
+          metrics->errors.load(std::memory_order_relaxed));
+    }
+
+    HistogramTotals fanout;
+    std::uint64_t messages = 0;
+    std::uint64_t deliveries = 0;
+    for (const auto &block : broadcasts_) {
+      block->latency.add_to(fanout);
+      messages += block->messages.value();
+      deliveries += block->deliveries.value();
+    }
+    prometheus::append_family(out, "buyer_ws_broadcast_duration_seconds",
+                              "histogram",
+                              "Fan-out time of one published notification.");
+    prometheus::append_histogram(out, "buyer_ws_broadcast_duration_seconds",
+                                 "", fanout);
+    prometheus::append_family(out, "buyer_ws_broadcast_messages_total",
+                              "counter", "Notifications broadcast.");
+    prometheus::append_sample(out, "buyer_ws_broadcast_messages_total", "",
+                              messages);
+    prometheus::append_family(out, "buyer_ws_broadcast_deliveries_total",
+                              "counter", "Frames sent to WebSocket clients.");
+    prometheus::append_sample(out, "buyer_ws_broadcast_deliveries_total", "",
+                              deliveries);
+  }
+
+ private:
+  static constexpr std::string_view kOtherStatement = "other";
+  // Characters of SQL kept in the sql label
+  static constexpr std::size_t kSqlLabelLength = 60;
+
+  struct RouteSeries {
+    RouteSeries(std::string method, std::string pattern)
+        : method(std::move(method)), pattern(std::move(pattern)) {
+      labels = "method=\"";
+      prometheus::append_label_value(labels, this->method);
+      labels += "\",route=\"";
+      prometheus::append_label_value(labels, this->pattern);
+      labels += '"';
+    }
+
+    std::string method;
+    std::string pattern;
+    std::string labels;
+    std::vector<std::unique_ptr<RequestBlock>> blocks;  // one per thread
+  };
+
+  using RouteKey = std::pair<std::string_view, std::string_view>;
+
+  struct RouteKeyHash {
+    using is_avalanching = void;
+    std::uint64_t operator()(const RouteKey &key) const noexcept {
+      const ankerl::unordered_dense::hash<std::string_view> hash;
+      return ankerl::unordered_dense::detail::wyhash::mix(hash(key.first),
+                                                          hash(key.second));
+    }
+  };
+
+  Metrics() = default;
+
+  // statement="<hash>",sql="<first words, whitespace collapsed>"
+  static std::string statement_labels(std::string_view sql) {
+    std::string head;
+    for (const char c : sql) {
+      if (head.size() >= kSqlLabelLength) {
+        head += "...";
+        break;
+      }
+      const bool space = c == ' ' || c == '\n' || c == '\t' || c == '\r';
+      if (!space) {
+        head += c;
+      } else if (!head.empty() && head.back() != ' ') {
+        head += ' ';
+      }
+    }
+    std::string labels =
+        std::format("statement=\"{:08x}\",sql=\"",
+                    std::hash<std::string_view>{}(sql) & 0xffffffffU);
+    prometheus::append_label_value(labels, head);
+    labels += '"';
+    return labels;
+  }
+
+  mutable std::mutex mutex_;
+  // Keyed by "<method> <pattern>", sorted for the scrape output
+  std::map<std::string, std::unique_ptr<RouteSeries>> routes_;
+  std::vector<std::unique_ptr<FanoutBlock>> broadcasts_;
+  std::map<std::string, std::unique_ptr<StatementMetrics>, std::less<>>
+      statements_;
+};
+
+}  // namespace utilities
+
+#endif  // METRICS_HPP
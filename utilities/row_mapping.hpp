@@ -0,0 +1,134 @@
+#ifndef ROW_MAPPING_HPP
+#define ROW_MAPPING_HPP
+
+#include <array>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "conversion.hpp"
+
+namespace utilities {
+
+// Binds a result column to a member of a row view, see RowMapper
+template <typename View, typename Member>
+struct ColumnBinding {
+  std::string_view column;
+  Member View::*member;
+};
+
+template <typename View, typename Member>
+constexpr ColumnBinding<View, Member> column(std::string_view name,
+                                             Member View::*member) {
+  return {name, member};
+}
+
+/**
+ * @brief A struct with a static constexpr tuple of column() bindings named
+ * columns. Members that are not bound (e.g. media) are left to the handler.
+ */
+template <typename View>
+concept RowView = requires { std::tuple_size<decltype(View::columns)>::value; };
+
+namespace detail {
+
+template <typename T>
+struct is_optional : std::false_type {};
+
+template <typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+// Text format values, as sent by PostgreSQL
+template <typename T>
+T parse_column_text(std::string_view text) {
+  if constexpr (std::same_as<T, std::string_view>) {
+    return text;
+  } else if constexpr (std::same_as<T, std::vector<std::string_view>>) {
+    return convert::pgsql_array_string_to_views(text);
+  } else if constexpr (std::same_as<T, bool>) {
+    return text == "t" || text == "true" || text == "1";
+  } else {
+    static_assert(std::is_arithmetic_v<T>, "unsupported row view member");
+    T value{};
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+  }
+}
+
+template <typename T, typename Field>
+void read_column(const Field &field, T &out) {
+  if constexpr (is_optional<T>::value) {
+    if (field.isNull()) {
+      out.reset();
+    } else {
+      out.emplace(parse_column_text<typename T::value_type>(
+          field.template as<std::string_view>()));
+    }
+  } else {
+    // NULL reads as the type's default, like Field::as<T>()
+    out = field.isNull() ? T{}
+                         : parse_column_text<T>(
+                               field.template as<std::string_view>());
+  }
+}
+
+}  // namespace detail
+
+/**
+ * @brief Maps result rows onto a row view without copying or looking up
+ * columns by name per row.
+ * Column indices are resolved once when the mapper is built for a result.
+ * std::string_view members point into the result, which has to outlive the
+ * views, typically until they are serialized with glz::write_json. Numbers
+ * are parsed in place with std::from_chars, std::vector<std::string_view>
+ * members read a text[] column. NULL reads as the member's default, or
+ * std::nullopt for std::optional members.
+ * Works with drogon::orm::Result and Row, or anything with the same
+ * columnNumber(), operator[](index), isNull() and as<std::string_view>().
+ * @throws drogon::orm::RangeError (from columnNumber) when a bound column is
+ * missing from the result.
+ */
+template <RowView View>
+class RowMapper {
+ public:
+  static constexpr std::size_t kColumns =
+      std::tuple_size_v<std::remove_cvref_t<decltype(View::columns)>>;
+
+  template <typename Result>
+  explicit RowMapper(const Result &result) {
+    std::apply(
+        [&](const auto &...bindings) {
+          std::size_t i = 0;
+          ((indices_[i++] = static_cast<std::size_t>(
+                result.columnNumber(std::string(bindings.column).c_str()))),
+           ...);
+        },
+        View::columns);
+  }
+
+  template <typename Row>
+  View operator()(const Row &row) const {
+    View view{};
+    std::apply(
+        [&](const auto &...bindings) {
+          std::size_t i = 0;
+          (detail::read_column(row[indices_[i++]], view.*(bindings.member)),
+           ...);
+        },
+        View::columns);
+    return view;
+  }
+
+ private:
+  std::array<std::size_t, kColumns> indices_{};
+};
+
+}  // namespace utilities
+
+#endif  // ROW_MAPPING_HPP
@@ -0,0 +1,81 @@
+#ifndef RUN_ON_QUEUE_HPP
+#define RUN_ON_QUEUE_HPP
+
+#include <trantor/net/EventLoop.h>
+#include <trantor/utils/TaskQueue.h>
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace utilities {
+
+/**
+ * @brief Awaiter that runs CPU bound work on a task queue (worker pool) and
+ * resumes the coroutine on the event loop it was suspended on.
+ *
+ * @code
+ * auto jpeg = co_await utilities::run_on_queue(pool, [&] { return encode(); });
+ * @endcode
+ */
+template <typename Work>
+class RunOnQueueAwaiter {
+ public:
+  using Result = std::invoke_result_t<Work&>;
+
+  RunOnQueueAwaiter(trantor::TaskQueue& queue, Work work)
+      : queue_(queue), work_(std::move(work)) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    auto* loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    queue_.runTaskInQueue([this, handle, loop]() {
+      try {
+        if constexpr (std::is_void_v<Result>) {
+          work_();
+        } else {
+          result_.emplace(work_());
+        }
+      } catch (...) {
+        exception_ = std::current_exception();
+      }
+      if (loop) {
+        loop->queueInLoop([handle]() { handle.resume(); });
+      } else {
+        handle.resume();
+      }
+    });
+  }
+
+  Result await_resume() {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+    if constexpr (!std::is_void_v<Result>) {
+      return std::move(*result_);
+    }
+  }
+
+ private:
+  struct Empty {};
+  using Storage =
+      std::conditional_t<std::is_void_v<Result>, Empty, std::optional<Result>>;
+
+  trantor::TaskQueue& queue_;
+  Work work_;
+  [[no_unique_address]] Storage result_;
+  std::exception_ptr exception_;
+};
+
+template <typename Work>
+[[nodiscard]] RunOnQueueAwaiter<Work> run_on_queue(trantor::TaskQueue& queue,
+                                                   Work work) {
+  return RunOnQueueAwaiter<Work>(queue, std::move(work));
+}
+
+}  // namespace utilities
+
+#endif  // RUN_ON_QUEUE_HPP
@@ -0,0 +1,151 @@
+#ifndef SQL_PIPELINE_HPP
+#define SQL_PIPELINE_HPP
+
+#include <drogon/orm/DbClient.h>
+#include <drogon/utils/coroutine.h>
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace utilities {
+
+// A statement and its parameters, see statement() and pipeline()
+template <typename... Args>
+struct SqlStatement {
+  std::string sql;
+  std::tuple<Args...> args;
+};
+
+// Parameters are copied or moved into the statement, so temporaries are fine
+template <typename... Args>
+SqlStatement<std::decay_t<Args>...> statement(std::string sql,
+                                              Args &&...args) {
+  return {std::move(sql), {std::forward<Args>(args)...}};
+}
+
+namespace detail {
+
+template <std::size_t N>
+struct PipelineState {
+  // The last arrival (a statement or the awaiting coroutine) continues
+  bool arrive() {
+    return remaining.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+
+  void set_error(std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(error_mutex);
+    if (!error) {
+      error = std::move(e);
+    }
+  }
+
+  std::array<std::optional<drogon::orm::Result>, N> results;
+  std::atomic<std::size_t> remaining{N + 1};
+  std::coroutine_handle<> waiter;
+  std::mutex error_mutex;
+  std::exception_ptr error;
+};
+
+template <std::size_t N>
+struct PipelineAwaiter {
+  std::shared_ptr<PipelineState<N>> state;
+
+  bool await_ready() const noexcept { return false; }
+  // Doesn't suspend if every statement already completed
+  bool await_suspend(std::coroutine_handle<> handle) {
+    state->waiter = handle;
+    return !state->arrive();
+  }
+  void await_resume() const noexcept {}
+};
+
+// Same binder sequence as DbClient::execSqlCoro, without waiting
+template <typename... Args, typename OnResult, typename OnError>
+void send_statement(drogon::orm::DbClient &client,
+                    SqlStatement<Args...> &&statement, OnResult &&on_result,
+                    OnError &&on_error) {
+  auto binder = client << std::move(statement.sql);
+  std::apply([&binder](auto &&...args) { (binder << ... << args); },
+             std::move(statement.args));
+  binder >> std::forward<OnResult>(on_result);
+  binder >> std::forward<OnError>(on_error);
+  binder.exec();
+}
+
+// Clients that are not a DbClient (utilities::TracedDb) send through their
+// own send(), with the same callbacks
+template <std::size_t I, std::size_t N, typename Client, typename... Args>
+void send_pipelined(Client &client, SqlStatement<Args...> &&statement,
+                    const std::shared_ptr<PipelineState<N>> &state) {
+  auto on_result = [state](const drogon::orm::Result &result) {
+    state->results[I].emplace(result);
+    if (state->arrive()) {
+      state->waiter.resume();
+    }
+  };
+  auto on_error = [state](const std::exception_ptr &e) {
+    state->set_error(e);
+    if (state->arrive()) {
+      state->waiter.resume();
+    }
+  };
+  if constexpr (std::is_base_of_v<drogon::orm::DbClient, Client>) {
+    send_statement(client, std::move(statement), std::move(on_result),
+                   std::move(on_error));
+  } else {
+    client.send(std::move(statement), std::move(on_result),
+                std::move(on_error));
+  }
+}
+
+template <typename>
+using ResultOf = drogon::orm::Result;
+
+}  // namespace detail
+
+/**
+ * @brief Sends all statements before waiting for any result, then waits for
+ * every one of them.
+ * With auto_batch enabled on the client (PostgreSQL >= 14) the statements go
+ * out back to back on one connection in pipeline mode, a single round trip
+ * instead of one per statement. Without it they are spread over the idle
+ * connections of the pool. On a transaction they still run one after the
+ * other, in order, but the coroutine only resumes once.
+ * Statements must not depend on each other's results, their relative order
+ * is only guaranteed within a transaction or a pipeline.
+ * @return one Result per statement, in the same order.
+ * @throws the first DrogonDbException raised, after all statements finished.
+ */
+template <typename Client, typename... Statements>
+drogon::Task<std::tuple<detail::ResultOf<Statements>...>> pipeline(
+    std::shared_ptr<Client> client, Statements... statements) {
+  constexpr std::size_t N = sizeof...(Statements);
+  static_assert(N > 0, "pipeline needs at least one statement");
+
+  auto state = std::make_shared<detail::PipelineState<N>>();
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    (detail::send_pipelined<I>(*client, std::move(statements), state), ...);
+  }(std::index_sequence_for<Statements...>{});
+  co_await detail::PipelineAwaiter<N>{state};
+
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+  co_return [&]<std::size_t... I>(std::index_sequence<I...>) {
+    return std::tuple<detail::ResultOf<Statements>...>(
+        std::move(*state->results[I])...);
+  }(std::index_sequence_for<Statements...>{});
+}
+
+}  // namespace utilities
+
+#endif  // SQL_PIPELINE_HPP
@@ -0,0 +1,103 @@
+#ifndef WHEN_ALL_HPP
+#define WHEN_ALL_HPP
+
+#include <drogon/utils/coroutine.h>
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace utilities {
+
+namespace detail {
+
+template <typename T>
+struct WhenAllState {
+  explicit WhenAllState(std::size_t n) : results(n), remaining(n + 1) {}
+
+  // The last arrival (a task or the awaiting coroutine itself) continues
+  bool arrive() {
+    return remaining.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+
+  void set_error(std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(error_mutex);
+    if (!error) {
+      error = std::move(e);
+    }
+  }
+
+  std::vector<std::optional<T>> results;
+  std::atomic<std::size_t> remaining;
+  std::coroutine_handle<> waiter;
+  std::mutex error_mutex;
+  std::exception_ptr error;
+};
+
+template <typename T>
+drogon::AsyncTask when_all_run_one(drogon::Task<T> task,
+                                   std::shared_ptr<WhenAllState<T>> state,
+                                   std::size_t idx) {
+  try {
+    state->results[idx].emplace(co_await std::move(task));
+  } catch (...) {
+    state->set_error(std::current_exception());
+  }
+  if (state->arrive()) {
+    state->waiter.resume();
+  }
+}
+
+template <typename T>
+struct WhenAllAwaiter {
+  std::shared_ptr<WhenAllState<T>> state;
+
+  bool await_ready() const noexcept { return false; }
+  // Doesn't suspend if every task already finished synchronously
+  bool await_suspend(std::coroutine_handle<> handle) {
+    state->waiter = handle;
+    return !state->arrive();
+  }
+  void await_resume() const noexcept {}
+};
+
+}  // namespace detail
+
+/**
+ * @brief Runs all tasks concurrently and waits for every one of them.
+ * Tasks start in order on the calling thread and interleave at their
+ * suspension points, e.g. S3 or database round trips.
+ * @return results in the same order as the input tasks.
+ * @throws the first exception raised by any task, after all have finished.
+ */
+template <typename T>
+drogon::Task<std::vector<T>> when_all(std::vector<drogon::Task<T>> tasks) {
+  if (tasks.empty()) {
+    co_return std::vector<T>{};
+  }
+
+  auto state = std::make_shared<detail::WhenAllState<T>>(tasks.size());
+  for (std::size_t i = 0; i < tasks.size(); ++i) {
+    detail::when_all_run_one(std::move(tasks[i]), state, i);
+  }
+  co_await detail::WhenAllAwaiter<T>{state};
+
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+
+  std::vector<T> results;
+  results.reserve(state->results.size());
+  for (auto &result : state->results) {
+    results.emplace_back(std::move(*result));
+  }
+  co_return results;
+}
+
+}  // namespace utilities
+
+#endif  // WHEN_ALL_HPP
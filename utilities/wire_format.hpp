@@ -0,0 +1,123 @@
+#ifndef WIRE_FORMAT_HPP
+#define WIRE_FORMAT_HPP
+
+#include <cstdint>
+#include <glaze/glaze.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "http_accept.hpp"
+#include "json_manipulation.hpp"
+
+#if __has_include(<glaze/msgpack.hpp>)
+#include <glaze/msgpack.hpp>
+#define UTILITIES_HAS_MSGPACK 1
+#else
+#define UTILITIES_HAS_MSGPACK 0
+#endif
+
+namespace utilities {
+
+// Response body encodings, all written from the same glaze reflected structs
+enum class WireFormat : std::uint8_t {
+  json,
+  beve,     // glaze's binary format, https://github.com/beve-org/beve
+  msgpack,  // only negotiated when the glaze build has MessagePack support
+};
+
+inline constexpr bool kMsgpackAvailable = UTILITIES_HAS_MSGPACK;
+
+constexpr std::string_view content_type(WireFormat format) {
+  switch (format) {
+    case WireFormat::beve:
+      return "application/x-beve";
+    case WireFormat::msgpack:
+      return "application/msgpack";
+    case WireFormat::json:
+      break;
+  }
+  return "application/json; charset=utf-8";
+}
+
+namespace detail {
+
+struct AcceptedFormat {
+  WireFormat format = WireFormat::json;
+  bool specific = false;  // named exactly rather than matched by a wildcard
+};
+
+inline std::optional<AcceptedFormat> accepted_format(std::string_view media) {
+  if (iequals(media, "application/json")) {
+    return AcceptedFormat{.format = WireFormat::json, .specific = true};
+  }
+  if (iequals(media, "application/x-beve") ||
+      iequals(media, "application/beve")) {
+    return AcceptedFormat{.format = WireFormat::beve, .specific = true};
+  }
+  if (kMsgpackAvailable && (iequals(media, "application/msgpack") ||
+                            iequals(media, "application/x-msgpack") ||
+                            iequals(media, "application/vnd.msgpack"))) {
+    return AcceptedFormat{.format = WireFormat::msgpack, .specific = true};
+  }
+  if (media == "*/*" || iequals(media, "application/*")) {
+    return AcceptedFormat{.format = WireFormat::json, .specific = false};
+  }
+  return std::nullopt;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Picks the body encoding for an Accept header (RFC 9110 12.5.1).
+ * The acceptable format with the highest q wins, a named type beats a
+ * wildcard at equal q and earlier entries win ties. Wildcards, a missing or
+ * malformed header and headers naming nothing we speak all give JSON, the
+ * API never answers 406.
+ */
+inline WireFormat wire_format_from_accept(std::string_view accept) {
+  WireFormat best = WireFormat::json;
+  double best_q = 0;
+  bool best_specific = false;
+
+  for_each_weighted_value(accept, [&](std::string_view media, double q) {
+    const auto accepted = detail::accepted_format(media);
+    if (accepted && q > 0 &&
+        (q > best_q || (q == best_q && accepted->specific && !best_specific))) {
+      best = accepted->format;
+      best_q = q;
+      best_specific = accepted->specific;
+    }
+  });
+  return best;
+}
+
+/**
+ * @brief Serializes value in the given format through the per-thread buffer
+ * of write_json_body().
+ * @return the body, empty on error like write_json_body()
+ */
+template <class T>
+[[nodiscard]] inline std::string write_wire_body(WireFormat format,
+                                                 const T &value) {
+  switch (format) {
+    case WireFormat::beve:
+      return detail::write_through_thread_buffer(
+          [&](std::string &buffer) { return glz::write_beve(value, buffer); });
+    case WireFormat::msgpack:
+#if UTILITIES_HAS_MSGPACK
+      return detail::write_through_thread_buffer([&](std::string &buffer) {
+        return glz::write_msgpack(value, buffer);
+      });
+#else
+      break;
+#endif
+    case WireFormat::json:
+      break;
+  }
+  return write_json_body(value);
+}
+
+}  // namespace utilities
+
+#endif  // WIRE_FORMAT_HPP